@@ -6,8 +6,17 @@
 
 class ActuatorSerializer {
 public:
+    virtual ~ActuatorSerializer() {
+    }
 
     virtual void serialize(rapidjson::Document& jsonDocument, bool onlyIfChanged) = 0;
+
+    /**
+     * Sets the actuator from a number, converted to the actuator's type, for code that drives
+     * actuators without knowing their type, such as a RuleEngine.
+     */
+    virtual void setNumericValue(double /* value */) {
+    }
 };
 
 #endif
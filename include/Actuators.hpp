@@ -5,7 +5,9 @@
 #include <mutex>
 #include <string>
 #include "rapidjson/document.h"
+#include "ProfiledMutex.hpp"
 #include "Station.hpp"
+#include "TagNames.hpp"
 #include "ActuatorSerializer.hpp"
 
 template<typename T>
@@ -23,33 +25,51 @@ public:
      * station.
      */
     Actuator(Station& station, std::string name, T value)
-    : m_name(name), m_value(value), m_changed(true), m_mutex() {
+    : m_tag(TagNames::intern(station.getPrefix() + name)), m_value(value), m_changed(true), m_mutex() {
+        nameLock(m_mutex, "actuator", TagNames::getName(m_tag));
         station.add(this);
     }
 
+    inline TagId getTag() const {
+        return m_tag;
+    }
+
     inline std::string getName() const {
-        std::lock_guard<std::mutex> scopedLock(m_mutex);
-        return m_name;
+        return std::string(TagNames::getName(m_tag), TagNames::getLength(m_tag));
     }
 
+    /**
+     * Adds the actuator's value to a frame, replacing the value it added to the same frame before.
+     * The frame refers to the interned name rather than copying it.
+     */
     void serialize(rapidjson::Document& jsonDocument, bool onlyIfChanged) {
-        std::lock_guard<std::mutex> scopedLock(m_mutex);
+        std::lock_guard<Mutex> scopedLock(m_mutex);
         if (!onlyIfChanged || m_changed) {
-            rapidjson::GenericStringRef<char> name(m_name.c_str());
-            jsonDocument.AddMember(name, m_value, jsonDocument.GetAllocator());
+            rapidjson::GenericStringRef<char> name(TagNames::getName(m_tag), TagNames::getLength(m_tag));
+            rapidjson::Value::MemberIterator member = jsonDocument.FindMember(rapidjson::Value(name));
+            if (member != jsonDocument.MemberEnd()) {
+                member->value = m_value;
+            }
+            else {
+                jsonDocument.AddMember(name, m_value, jsonDocument.GetAllocator());
+            }
             m_changed = false;
         }
     }
 
+    virtual void setNumericValue(double value) {
+        setValue(static_cast<T>(value));
+    }
+
 protected:
     
     inline T getValue() const {
-        std::lock_guard<std::mutex> scopedLock(m_mutex);
+        std::lock_guard<Mutex> scopedLock(m_mutex);
         return m_value;
     }
     
     inline void setValue(T value) {
-        std::lock_guard<std::mutex> scopedLock(m_mutex);
+        std::lock_guard<Mutex> scopedLock(m_mutex);
         if (value != m_value) {
             m_value = value;
             m_changed = true;
@@ -57,10 +77,10 @@ protected:
     }
         
 private:
-    std::string         m_name;     // Name of the actuator
+    TagId               m_tag;      // Interned name of the actuator
     T                   m_value;    // Value of the actuator
     bool                m_changed;  // True when a change has not been reported (through serialize)
-    mutable std::mutex  m_mutex;    // Provides thread-safety for the class
+    mutable Mutex       m_mutex;    // Provides thread-safety for the class
 };
 
 class OnOffActuator : public Actuator<bool> {
@@ -17,6 +17,11 @@
 #include "Sensors.hpp"
 #include "Station.hpp"
 
+/**
+ * Counts boxes onto the entry conveyor and off the exit conveyor, and holds the emitter off while
+ * the station is full.  The entry and exit handlers are tasks on the factory's Executor, each
+ * resumed by its own sensor, so a station holds no thread of its own.
+ */
 class BasicConveyorControl {
 public:
     BasicConveyorControl(Factory& factory, std::string stationPrefix, int32_t maxBoxCount);
@@ -25,6 +30,7 @@ public:
     void waitUntilDone();
 
 private:  
+    void startConveyors();
     void handleBoxEntry();
     void handleBoxExit();
     
@@ -38,8 +44,9 @@ private:
     RetroreflectiveSensor m_exitSensor;
     int32_t               m_maxBoxCount;
     int32_t               m_boxCount;
-    std::thread*          m_entryThread;
-    std::thread*          m_exitThread;
+    bool                  m_entryBoxDetected;   // Entry beam broken by a box not yet counted
+    bool                  m_exitBoxDetected;    // Exit beam broken by a box not yet counted
+    bool                  m_started;
     std::mutex            m_boxCountMutex;
 };
 
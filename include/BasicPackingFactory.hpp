@@ -11,14 +11,35 @@
 
 
 #include <atomic>
+#include <chrono>
+#include <memory>
 #include <thread>
 #include "Parts.hpp"
 #include "Factory.hpp"
 #include "Sensors.hpp"
 
+/**
+ * Tuning of the packing sequence.  The defaults are the values the demo was written with.
+ */
+struct PackingParameters {
+    PackingParameters()
+    : delta(0.3), pollInterval(std::chrono::milliseconds(250)), gripDelay(std::chrono::milliseconds(250)),
+      traverseDelay(std::chrono::milliseconds(500)), bladeDelay(std::chrono::seconds(1)),
+      boxPollInterval(std::chrono::seconds(1)) {
+    }
+
+    float           delta;              // Distance from a target height that counts as arrived
+    Clock::Duration pollInterval;       // Between checks for a box, a pallet and the gripper height
+    Clock::Duration gripDelay;          // Before and after closing or opening the gripper
+    Clock::Duration traverseDelay;      // Between moving over the pallet and lowering the box
+    Clock::Duration bladeDelay;         // Between stopping the box conveyor and lowering the blade
+    Clock::Duration boxPollInterval;    // Between checks for the box having been picked
+};
+
 class BasicPackingFactory {
 public:
-    BasicPackingFactory(Factory& factory);
+    BasicPackingFactory(Factory& factory, const PackingParameters& parameters = PackingParameters());
+    ~BasicPackingFactory();
     void packingManager();
     void palletManager();
     void boxConveyorManager();
@@ -28,6 +49,8 @@ public:
     
 private:
     Factory&                    m_factory;
+    Clock&                      m_clock;
+    PackingParameters           m_parameters;
     Station                     m_palletStation;
     Station                     m_boxStation;
     Station                     m_packingStation;
@@ -45,9 +68,9 @@ private:
     StopBlade                   m_boxStopBlade;
     PickAndPlace                m_pickAndPlace;
     DisplayNumberActuator<int>  m_digitalDisplay;
-    std::thread*                m_palletManagerThread;
-    std::thread*                m_boxConveyorManagerThread;
-    std::thread*                m_packingManagerThread;
+    std::unique_ptr<std::thread> m_palletManagerThread;
+    std::unique_ptr<std::thread> m_boxConveyorManagerThread;
+    std::unique_ptr<std::thread> m_packingManagerThread;
     std::atomic_bool            m_boxReady;
     std::atomic_bool            m_palletReady;
     std::atomic_bool            m_palletFull;
@@ -0,0 +1,37 @@
+/*
+ * File:   CacheAligned.hpp
+ *
+ * Heap allocation for types that keep members on their own cache lines.
+ */
+
+#pragma once
+#ifndef CACHE_ALIGNED_HPP
+#define CACHE_ALIGNED_HPP
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <new>
+
+/**
+ * Base for classes that are created with new and hold alignas(CACHE_LINE_SIZE) members.  Before
+ * C++17 a plain new only guarantees the alignment of the largest fundamental type, which would
+ * put such members back on a shared line, so the class gets its own aligned operator new.
+ */
+class CacheAligned {
+public:
+    static const size_t CACHE_LINE_SIZE = 64;
+
+    static void* operator new(size_t size) {
+        void* pointer = nullptr;
+        if (posix_memalign(&pointer, CACHE_LINE_SIZE, size) != 0) {
+            throw std::bad_alloc();
+        }
+        return pointer;
+    }
+
+    static void operator delete(void* pointer) {
+        free(pointer);
+    }
+};
+
+#endif
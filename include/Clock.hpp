@@ -0,0 +1,242 @@
+/*
+ * File:   Clock.hpp
+ *
+ * Time source for all controller timing.
+ */
+
+#pragma once
+#ifndef CLOCK_HPP
+#define CLOCK_HPP
+
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+/**
+ * Station code reads the time and sleeps through a Clock instead of calling sleep() or
+ * std::this_thread directly, so the same controller can run in real time, scaled time or
+ * discrete-event time against a simulated plant.
+ *
+ * Times are durations since the clock started.  Threads that use the clock should be started with
+ * newThread() so that a discrete-event clock knows how many threads can still make progress, and
+ * code that blocks outside the clock (on a sensor, for instance) brackets the wait with blocked()
+ * and released() as Sensor and Factory do.  The wall clocks ignore both.
+ *
+ * Stopping a clock makes every sleep on it, and every wait that checks isStopped(), throw
+ * Clock::Stopped, which unwinds the threads started with newThread().
+ */
+class Clock {
+public:
+    typedef std::chrono::nanoseconds Duration;
+
+    /**
+     * Lets one thread cut short another thread's sleepUntil(time, wakeup) with wake().  A wake-up
+     * that comes while the thread is not sleeping ends its next sleep at once, so it is never lost
+     * between deciding to sleep and sleeping.
+     */
+    class Wakeup {
+    public:
+        Wakeup()
+        : m_pending(false), m_sleeper(nullptr) {
+        }
+
+    private:
+        friend class Clock;
+        friend class DiscreteEventClock;
+
+        bool    m_pending;      // Woken while not sleeping
+        void*   m_sleeper;      // The discrete-event sleeper while the thread sleeps
+    };
+
+    class Stopped : public std::runtime_error {
+    public:
+        Stopped()
+        : std::runtime_error("clock stopped") {
+        }
+    };
+
+    virtual ~Clock() {
+    }
+
+    /**
+     * @return time since the clock started
+     */
+    virtual Duration now() = 0;
+
+    /**
+     * Blocks the calling thread until the clock reaches a time.
+     */
+    virtual void sleepUntil(Duration time) = 0;
+
+    /**
+     * Blocks the calling thread until the clock reaches a time or another thread calls
+     * wake(wakeup), whichever comes first.
+     */
+    virtual void sleepUntil(Duration time, Wakeup& wakeup) = 0;
+
+    /**
+     * Ends the sleep of the thread sleeping on wakeup, or its next sleep if it is not sleeping.
+     */
+    virtual void wake(Wakeup& wakeup);
+
+    inline void sleepFor(Duration duration) {
+        sleepUntil(now() + duration);
+    }
+
+    /**
+     * Wakes every sleeper; they, and any later sleep, throw Clock::Stopped.
+     */
+    virtual void stop();
+
+    inline bool isStopped() const {
+        return m_stopped;
+    }
+
+    /**
+     * Whether time only moves once every registered thread is idle.  Work handed from one thread
+     * to another should then run on the thread that hands it over, since two threads reacting to
+     * the same event at once would make the run depend on how they are scheduled.
+     */
+    virtual bool isDiscrete() const {
+        return false;
+    }
+
+    /**
+     * Registers a thread that uses the clock; call before the thread starts.
+     */
+    virtual void attach() {
+    }
+
+    /**
+     * Unregisters a thread when it stops using the clock.
+     */
+    virtual void detach() {
+    }
+
+    /**
+     * The calling thread is about to block until another thread releases it.
+     */
+    virtual void blocked() {
+    }
+
+    /**
+     * The calling thread has made count blocked threads runnable again.
+     */
+    virtual void released(uint32_t /* count */) {
+    }
+
+    /**
+     * Starts a thread registered with the clock for as long as function runs.  The thread ends
+     * quietly when the clock is stopped.
+     */
+    template<typename Function, typename... Args>
+    std::thread* newThread(Function function, Args... args) {
+        std::function<void()> body(std::bind(function, args...));
+        attach();
+        return new std::thread([this, body]() {
+            try {
+                body();
+            }
+            catch (const Stopped&) {
+            }
+            detach();
+        });
+    }
+
+    /**
+     * Clock shared by everything that is not given one explicitly.
+     */
+    static Clock& realTime();
+
+protected:
+    Clock();
+
+    /**
+     * Sleeps until a wall-clock time or a wake-up, or throws Clock::Stopped if the clock is
+     * stopped first.
+     */
+    void sleepUntilWallTime(std::chrono::steady_clock::time_point time, Wakeup* wakeup = nullptr);
+
+    std::atomic<bool>       m_stopped;
+    std::mutex              m_stopMutex;
+    std::condition_variable m_stopControl;
+};
+
+/**
+ * Wall-clock time.
+ */
+class RealTimeClock : public Clock {
+public:
+    RealTimeClock();
+    virtual Duration now();
+    virtual void sleepUntil(Duration time);
+    virtual void sleepUntil(Duration time, Wakeup& wakeup);
+
+private:
+    std::chrono::steady_clock::time_point m_start;
+};
+
+/**
+ * Wall-clock time sped up (or slowed down) by a constant factor.
+ */
+class ScaledClock : public Clock {
+public:
+
+    /**
+     * @param scale     Clock seconds per wall-clock second
+     */
+    explicit ScaledClock(double scale);
+    virtual Duration now();
+    virtual void sleepUntil(Duration time);
+    virtual void sleepUntil(Duration time, Wakeup& wakeup);
+
+private:
+    std::chrono::steady_clock::time_point m_start;
+    double                                m_scale;
+};
+
+/**
+ * Simulated time that jumps straight to the next wake-up time as soon as every registered thread
+ * is sleeping or blocked, so idle time costs nothing.  The last thread to block advances the
+ * clock and wakes the next sleeper that is due; sleepers due at the same time take turns, which
+ * keeps runs reproducible.
+ */
+class DiscreteEventClock : public Clock {
+public:
+    DiscreteEventClock();
+    virtual Duration now();
+    virtual void sleepUntil(Duration time);
+    virtual void sleepUntil(Duration time, Wakeup& wakeup);
+    virtual void wake(Wakeup& wakeup);
+    virtual void stop();
+    virtual void attach();
+    virtual void detach();
+    virtual void blocked();
+    virtual void released(uint32_t count);
+
+    virtual bool isDiscrete() const {
+        return true;
+    }
+
+private:
+    struct Sleeper {
+        std::condition_variable wakeControl;
+        Duration                time;
+        bool                    woken;
+    };
+
+    void advance();
+
+    std::mutex                          m_mutex;
+    Duration                            m_now;
+    uint32_t                            m_runnableCount;    // Registered threads neither sleeping nor blocked
+    std::multimap<Duration, Sleeper*>   m_sleepers;         // By wake-up time
+};
+
+#endif
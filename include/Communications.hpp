@@ -9,24 +9,81 @@
 #define COMMUNICATIONS_HPP
 
 #include <stdint.h>
+#include <atomic>
+#include <memory>
 #include <mutex>
 #include <string>
 #include <thread>
+#include "Clock.hpp"
 #include "CommunicationsEventHandler.hpp"
+#include "ProfiledMutex.hpp"
+#include "Transport.hpp"
+#include "WireCapture.hpp"
 
-class Communications {
+/**
+ * TCP connection to Factory IO.  connect() only selects the event handler; the connection is made
+ * by openSocket(), or replaced by a capture with openReplay().
+ */
+class Communications : public Transport {
 public:
     Communications(CommunicationsEventHandler* communicationsEventHandler);
+    virtual void connect(CommunicationsEventHandler& eventHandler, Clock& clock);
     bool openSocket(std::string ipAddress, uint32_t port);
-    void sendMessage(std::string text);
+
+    /**
+     * Feeds the inbound frames of a capture to the event handler as if they were being received,
+     * instead of connecting.  Frames sent while replaying are dropped.  If the recorded side spoke
+     * first, the replay starts when the first frame is sent, so a controller that asks for a
+     * snapshot gets the recorded answer.
+     *
+     * @param speed     Multiple of the recorded pace, or 0 to replay as fast as possible
+     * @param clock     Clock that paces the replay
+     */
+    bool openReplay(std::string capturePath, double speed, Clock& clock);
+
+    /**
+     * Asks the kernel to timestamp inbound data as it arrives (SO_TIMESTAMPING, software receive
+     * timestamps), so the time frames spend queued in the socket buffer shows up in
+     * factoryio_socket_queue_seconds.  Call before openSocket().  Without kernel timestamps,
+     * frames are stamped when they are read.
+     */
+    void setReceiveTimestamps(bool enabled);
+
+    /**
+     * Records every frame sent and received.  Call before opening; the capture must outlive the
+     * connection.
+     */
+    void setCapture(WireCapture* capture);
+
+    /**
+     * Blocks until the connection closes or the replay ends.
+     */
+    void waitUntilClosed();
+
+    /**
+     * Shuts the socket down, or ends the replay, and waits for the receiving thread, so the event
+     * handler is not called again once it returns.
+     */
+    virtual void disconnect();
+
+    virtual void sendMessage(const std::string& text);
 
 private:
     void receiverThread();
+    void replayThread(double speed, Clock* clock);
+    void closeSocket();
 
     int32_t                     m_socketFd;
     CommunicationsEventHandler* m_eventHandler;
     std::thread*                m_thread;
-    std::mutex                  m_mutex;
+    Mutex                       m_mutex;
+    bool                        m_receiveTimestamps;
+    WireCapture*                m_capture;          // Null unless capturing
+    std::unique_ptr<WireReplay> m_replay;           // Null unless replaying
+    bool                        m_sent;             // A frame has been sent
+    ConditionVariable           m_sentControl;
+    std::atomic<bool>           m_closing;          // disconnect() has been called
+    Mutex                       m_joinMutex;        // Serializes joining m_thread
 };
 
 #endif
@@ -9,13 +9,25 @@
 #ifndef COMMUNICATIONS_EVENT_HANDLER_HPP
 #define COMMUNICATIONS_EVENT_HANDLER_HPP
 
+#include <stdint.h>
 #include <string>
 
 class CommunicationsEventHandler {
 public:
+    virtual ~CommunicationsEventHandler() {
+    }
+
     virtual void handleConnectionEstablished() = 0;
     virtual void handleConnectionLost() = 0;
     virtual void handleMessageReceived(std::string message) = 0;
+
+    /**
+     * A frame with the time it arrived, in nanoseconds of CLOCK_REALTIME: the kernel's receive
+     * timestamp if the transport has one, otherwise when it was read from the socket.
+     */
+    virtual void handleMessageReceived(std::string message, uint64_t /* arrivalNs */) {
+        handleMessageReceived(message);
+    }
 };
 
 #endif
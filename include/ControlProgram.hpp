@@ -0,0 +1,84 @@
+/*
+ * File:   ControlProgram.hpp
+ *
+ * Bytecode and variable table of a compiled structured-text program.
+ */
+
+#pragma once
+#ifndef CONTROL_PROGRAM_HPP
+#define CONTROL_PROGRAM_HPP
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+/**
+ * What StructuredText::compile() produces and ProgramVm runs.  The code is for a stack machine
+ * whose values are all doubles: BOOL is 0 or 1, INT holds whole numbers and TIME is in
+ * milliseconds.  Variables, constants and the hidden state of edge triggers and timers are
+ * addressed by index, so a scan touches no names and allocates nothing.
+ */
+struct ControlProgram {
+    enum Opcode : uint8_t {
+        OP_PUSH,            // Pushes constants[operand]
+        OP_LOAD,            // Pushes variables[operand]
+        OP_STORE,           // Pops into variables[operand]
+        OP_ADD,
+        OP_SUBTRACT,
+        OP_MULTIPLY,
+        OP_DIVIDE,
+        OP_DIVIDE_INT,      // Truncates; division by zero gives 0
+        OP_MODULO,
+        OP_NEGATE,
+        OP_NOT,
+        OP_AND,
+        OP_OR,
+        OP_XOR,
+        OP_EQUAL,
+        OP_NOT_EQUAL,
+        OP_LESS,
+        OP_LESS_EQUAL,
+        OP_GREATER,
+        OP_GREATER_EQUAL,
+        OP_RISING,          // R_TRIG: edge of the popped value against state[operand]
+        OP_FALLING,         // F_TRIG
+        OP_ON_DELAY,        // TON: pops the preset and the input, timer start in state[operand]
+        OP_JUMP,            // To operand
+        OP_JUMP_IF_FALSE,   // Pops the condition
+        OP_END
+    };
+
+    struct Instruction {
+        Opcode      opcode;
+        uint32_t    operand;
+    };
+
+    enum Type {
+        TYPE_BOOL,
+        TYPE_INT,
+        TYPE_REAL
+    };
+
+    enum Binding {
+        BINDING_NONE,       // VAR: kept from one scan to the next
+        BINDING_INPUT,      // VAR_INPUT: latched from a sensor before each scan
+        BINDING_OUTPUT      // VAR_OUTPUT: written to an actuator after each scan
+    };
+
+    struct Variable {
+        std::string name;
+        Type        type;
+        double      initialValue;
+        Binding     binding;
+        std::string tag;            // Tag within the station, for inputs and outputs
+    };
+
+    std::string                 name;
+    std::vector<Instruction>    code;
+    std::vector<double>         constants;
+    std::vector<Variable>       variables;
+    uint32_t                    stateCount;     // Hidden slots of R_TRIG, F_TRIG and TON calls
+    uint32_t                    maxStackDepth;
+};
+
+#endif
@@ -0,0 +1,114 @@
+/*
+ * File:   Executor.hpp
+ *
+ * Bounded pool of workers that run station tasks, with per-worker deques and work stealing.
+ */
+
+#pragma once
+#ifndef EXECUTOR_HPP
+#define EXECUTOR_HPP
+
+#include <stdint.h>
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "Clock.hpp"
+#include "ProfiledMutex.hpp"
+
+/**
+ * Runs station logic as short tasks instead of a thread per manager, so that many stations share
+ * a fixed number of workers rather than each keeping threads that mostly sit blocked.  A task
+ * never blocks: it reacts to the current sensor values, writes its actuators and re-arms itself,
+ * either on a sensor (Sensor::resumeOnChange) or on a timer (schedule()).
+ *
+ * Each worker owns a deque.  A task submitted from a worker goes onto that worker's deque and is
+ * popped last-in first-out, while it is still warm in the cache; tasks submitted from other
+ * threads, such as the dispatcher waking a sensor's continuation, are dealt round robin.  A
+ * worker whose deque is empty steals the oldest task of another worker before it parks.
+ *
+ * Workers and the timer thread are started with Clock::newThread() and park as blocked threads,
+ * so a discrete-event clock advances once every worker is idle and every timer is in the future.
+ * With a discrete-event clock a submitted task runs on the submitting thread instead, so the tasks
+ * a frame or a timer releases run one after another in the order they were released, and the
+ * dispatcher does not move on until they have all reacted.
+ * Tasks that must not run concurrently (the continuations of one sensor, for instance) have to
+ * be chained by the code that submits them; the executor itself orders nothing.
+ */
+class Executor {
+public:
+    typedef std::function<void()> Task;
+
+    /**
+     * Starts the workers and the timer thread.
+     *
+     * @param clock         Clock the workers are registered with and timers are measured on
+     * @param workerCount   Number of workers, or 0 for one per CPU
+     */
+    explicit Executor(Clock& clock, uint32_t workerCount = 0);
+
+    /**
+     * Stops the executor and waits for its threads.
+     */
+    ~Executor();
+
+    /**
+     * Queues a task to run as soon as a worker is free, or runs it straight away if the clock is
+     * discrete.  Ignored once the executor is stopped.
+     */
+    void submit(Task task);
+
+    /**
+     * Queues a task to run once the clock has advanced by delay.
+     */
+    void schedule(Clock::Duration delay, Task task);
+
+    /**
+     * Drops every queued task and timer and lets the workers exit once their current task ends.
+     */
+    void stop();
+
+    /**
+     * Blocks until the executor has been stopped and its threads have exited.
+     */
+    void join();
+
+    uint32_t getWorkerCount() const {
+        return static_cast<uint32_t>(m_workers.size());
+    }
+
+private:
+    struct Worker {
+        std::deque<Task>                tasks;
+        Mutex                           mutex;
+        std::unique_ptr<std::thread>    thread;
+    };
+
+    void runWorker(uint32_t index);
+    void runTimers();
+    bool takeTask(uint32_t index, Task& task);
+    void push(uint32_t index, Task task);
+
+    Clock&                                  m_clock;
+    std::vector<std::unique_ptr<Worker>>    m_workers;
+    std::atomic<uint32_t>                   m_nextWorker;       // Round robin for outside submissions
+    std::atomic<uint64_t>                   m_queuedCount;      // Tasks in all the deques
+    std::atomic<bool>                       m_stopping;
+    bool                                    m_runInline;        // Submitted tasks run on the caller
+    Mutex                                   m_parkMutex;
+    ConditionVariable                       m_parkControl;
+    uint32_t                                m_parkedCount;      // Workers parked and not yet woken
+    uint32_t                                m_wakeCount;        // Wake-ups not yet taken by a worker
+    Mutex                                   m_timerMutex;
+    ConditionVariable                       m_timerControl;
+    std::multimap<Clock::Duration, Task>    m_timers;           // By due time
+    bool                                    m_timerThreadParked;
+    Clock::Wakeup                           m_timerWakeup;      // Cuts the timer thread's sleep short
+    std::unique_ptr<std::thread>            m_timerThread;
+    Mutex                                   m_joinMutex;
+};
+
+#endif
@@ -8,36 +8,167 @@
 #ifndef FACTORY_HPP
 #define FACTORY_HPP
 
+#include <atomic>
 #include <list>
+#include <memory>
 #include <mutex>
+#include <ostream>
 #include <string>
-#include <condition_variable>
+#include <vector>
+#include "rapidjson/document.h"
+#include "Clock.hpp"
 #include "Communications.hpp"
+#include "Executor.hpp"
+#include "ProfiledMutex.hpp"
 #include "ActuatorSerializer.hpp"
 #include "SensorDeserializer.hpp"
+#include "SensorPipeline.hpp"
+#include "Transport.hpp"
+#include "WaitStrategy.hpp"
 
+class RuleEngine;
+class Station;
+
+/**
+ * Connection to the Factory IO scene.  Synchronization is split into independent domains so that
+ * the connection is full duplex:
+ *   - registration: guards the sensor registry and actuator list, which are published as
+ *     immutable snapshots so the send and receive paths never hold it for longer than a pointer
+ *     copy
+ *   - pending: guards the outbound frame that stations add their changes to
+ *   - outbound: serializes JSON encoding and the (possibly blocking) send of actuator frames
+ *   - dispatch: serializes the application of inbound sensor frames
+ *   - wait: guards the change counter that waitForSensorChange() blocks on
+ *
+ * Sensors are indexed by their interned tag (see TagNames), so a frame is dispatched by finding
+ * the id of each of its tags rather than by asking every sensor whether the frame has its tag,
+ * and the stations whose sensors changed are woken once each.  Each tag also lists the
+ * RuleEngine inputs bound to it; the engines whose inputs a frame changed are evaluated on the
+ * dispatching thread before anyone is woken.  Outbound, applyChanges() adds the changes to a
+ * pending frame; whichever station finds no frame being sent sends it, and keeps sending until
+ * no changes are left, so the changes of stations that flush while a frame is on its way go out
+ * together in the next one.
+ *
+ * Inbound frames are parsed and dispatched on the receiver thread unless enablePipeline() is
+ * called before start(), in which case they pass through a SensorPipeline, optionally conflating
+ * the backlog when dispatch falls behind.
+ *
+ * Controllers that run as tasks share the factory's Executor, created with one worker per CPU
+ * the first time it is asked for unless enableExecutor() sized it first.
+ *
+ * All timing goes through the factory's Clock, which is the shared real-time clock unless another
+ * one is given.  Instead of the TCP connection, start() can link the factory to any other
+ * Transport: a SimulatedPlant in the same process, which is how controllers are run in scaled or
+ * discrete-event time, or a LoopbackTransport that benchmarks feed directly.  stop()
+ * stops the clock, so every controller thread blocked on the factory or sleeping on its clock
+ * unwinds with Clock::Stopped, and stops the executor.
+ *
+ * Over TCP, startCapture() records the traffic to a file that startReplay() can later feed back
+ * through the receive path in place of the connection, and enableReceiveTimestamps() stamps
+ * frames with their kernel arrival time.  getArrivalTime() is the arrival of the latest frame, so
+ * controllers can tell how stale the sensor values are.
+ */
 class Factory {
 public:
       Factory();
+      explicit Factory(Clock& clock);
+      ~Factory();
       Factory& add(ActuatorSerializer* actuatorSerializer);
       Factory& add(SensorDeserializer* sensorDeserializer);
+      Factory& add(SensorDeserializer* sensorDeserializer, Station* station);
+      Factory& add(RuleEngine* ruleEngine);
       void applyChanges();
       void applyChanges(std::list<ActuatorSerializer*>& actuatorSerializerList);
       bool start();
+      bool start(std::string ipAddress, uint32_t port);
+      bool start(Transport& transport);
+      void enableReceiveTimestamps();
+      void setArrivalTime(uint64_t arrivalNs);
+      uint64_t getArrivalTime() const;
+      bool startCapture(const std::string& capturePath);
+      bool startReplay(const std::string& capturePath, double speed = 1.0);
+      void waitUntilDisconnected();
+      void stop();
+      Clock& getClock();
       void handleNewSensorValues(std::string jsonString);
+      void dispatchSensorValues(const rapidjson::Document& jsonDocument);
+      void dispatchSensorValues(const rapidjson::Document& jsonDocument,
+                                const ConflatedTagMap& conflatedTags);
+      void enablePipeline(size_t capacity = SensorPipeline::DEFAULT_CAPACITY, bool conflation = false);
+      const SensorPipeline* getPipeline() const;
+      void enableExecutor(uint32_t workerCount = 0);
+      Executor& getExecutor();
       void waitForSensorChange();
+      void waitForSensorChange(WaitStrategy waitStrategy);
       void loadSensorValues();
     
 private:    
+    typedef std::vector<ActuatorSerializer*> ActuatorSerializerList;
+    typedef std::vector<SensorDeserializer*> SensorDeserializerList;
+
+    struct RuleBinding {
+        RuleEngine*         engine;
+        uint32_t            input;      // The engine's input for the sensor
+    };
+
+    struct SensorEntry {
+        SensorDeserializer*         sensor;
+        Station*                    station;    // Null for sensors registered with the factory directly
+        std::vector<RuleBinding>    rules;      // Rule engines that read the sensor
+    };
+
+    /**
+     * Sensors by interned tag, plus the few that read the whole frame.
+     */
+    struct SensorRegistry {
+        SensorDeserializerList                  sensors;    // In registration order
+        std::vector<std::vector<SensorEntry>>   tags;       // Indexed by TagId, up to the highest registered
+        std::vector<SensorEntry>                untagged;
+        std::vector<Station*>                   stations;
+    };
+
+    void dispatchSensorValues(const rapidjson::Document& jsonDocument,
+                              const ConflatedTagMap* conflatedTags);
+    void sensorChanged(const SensorEntry& entry);
+    void flushChanges();
+    void sendMessage(const std::string& text);
+    void waitForSensorChange(std::unique_lock<Mutex>& scopedLock, uint64_t changeCount,
+                             WaitStrategy waitStrategy = WAIT_BLOCK);
+    void writeMetrics(std::ostream& output) const;
+    std::shared_ptr<const ActuatorSerializerList> actuatorSerializers() const;
+    std::shared_ptr<const SensorRegistry> sensorRegistry() const;
 
     const std::string IP_ADDRESS = "10.0.0.19";
     const uint32_t TCP_PORT = 910;
     
-    Communications                  m_communications;
-    std::list<ActuatorSerializer*>  m_actuatorSerializerList;
-    std::list<SensorDeserializer*>  m_sensorDeserializerList;
-    std::mutex                      m_mutex;
-    std::condition_variable         m_changeControl;
+    Clock&                                          m_clock;
+    std::unique_ptr<CommunicationsEventHandler>     m_eventHandler;     // Receives from every transport
+    std::unique_ptr<WireCapture>                    m_capture;          // Outlives the connection
+    Communications                                  m_communications;
+    Transport*                                      m_transport;        // m_communications unless started on another
+    std::shared_ptr<const ActuatorSerializerList>   m_actuatorSerializerList;
+    std::shared_ptr<const SensorRegistry>           m_sensorRegistry;
+    mutable Mutex                                   m_registrationMutex;
+    Mutex                                           m_pendingMutex;
+    rapidjson::Document                             m_pendingFrame;     // Changes not yet sent
+    bool                                            m_flushing;         // A station is sending the pending frame
+    Mutex                                           m_outboundMutex;
+    Mutex                                           m_dispatchMutex;
+    SensorDeserializerList                          m_changedSensors;   // Reused by each dispatch
+    std::vector<Station*>                           m_changedStations;  // Reused by each dispatch
+    std::vector<RuleEngine*>                        m_changedRuleEngines; // Reused by each dispatch
+    uint64_t                                        m_dispatchCount;    // Stamps the stations changed by a dispatch
+    std::atomic<bool>                               m_loadPending;      // loadSensorValues() awaits a frame
+    Mutex                                           m_waitMutex;
+    ConditionVariable                               m_changeControl;
+    uint64_t                                        m_changeCount;      // Frames that changed a sensor
+    std::atomic<uint64_t>                           m_publishedChangeCount; // Copy that spinning waiters poll
+    uint32_t                                        m_waiterCount;      // Waiters not yet released by a change
+    uint64_t                                        m_notifyTimeNs;     // When the last waiters were woken
+    std::atomic<uint64_t>                           m_arrivalNs;        // Arrival of the latest frame, or 0
+    std::unique_ptr<SensorPipeline>                 m_pipeline;         // Null unless enabled
+    std::unique_ptr<Executor>                       m_executor;         // Null until a station needs it
+    uint32_t                                        m_metricsCollector; // Per-tag and pipeline metrics
 };
 
 #endif
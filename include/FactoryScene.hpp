@@ -0,0 +1,45 @@
+/* 
+ * File:   FactoryScene.hpp
+ *
+ * Scene behind a FactoryServer connection.
+ */
+
+#pragma once
+#ifndef FACTORY_SCENE_HPP
+#define FACTORY_SCENE_HPP
+
+#include "rapidjson/document.h"
+
+/**
+ * The plant side of a Factory IO connection: it consumes actuator frames and produces sensor
+ * values.  A FactoryServer serializes all calls to a scene, so implementations need no locking.
+ */
+class FactoryScene {
+public:
+    virtual ~FactoryScene() {
+    }
+
+    /**
+     * Applies an actuator frame received from the controller.
+     */
+    virtual void applyActuatorValues(const rapidjson::Document& frame) = 0;
+
+    /**
+     * Advances the scene.
+     *
+     * @param elapsedSeconds    Scene time since the previous step
+     */
+    virtual void step(double elapsedSeconds) = 0;
+
+    /**
+     * Adds sensor values to a frame.
+     *
+     * @param frame         JSON object to add the values to
+     * @param changedOnly   Add only the values that changed since the previous call
+     *
+     * @return true if any value was added
+     */
+    virtual bool getSensorValues(rapidjson::Document& frame, bool changedOnly) = 0;
+};
+
+#endif
@@ -0,0 +1,96 @@
+/* 
+ * File:   FactoryServer.hpp
+ *
+ * Headless stand-in for the Factory IO side of the connection.
+ */
+
+#pragma once
+#ifndef FACTORY_SERVER_HPP
+#define FACTORY_SERVER_HPP
+
+#include <stdint.h>
+#include <atomic>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <string>
+#include <thread>
+#include "rapidjson/document.h"
+#include "FactoryScene.hpp"
+
+/**
+ * Speaks the Factory IO framing and JSON protocol so that Factory can be run, load tested and
+ * benchmarked without a Windows box running the real application.  Each accepted connection gets
+ * its own scene:
+ *   - actuator frames from the controller are applied to the scene
+ *   - {"Send Sensor Data":true} is answered with every sensor value of the scene
+ *   - the scene is stepped at a fixed frame rate and the sensor values that changed are streamed
+ */
+class FactoryServer {
+public:
+    typedef std::function<FactoryScene*()> SceneFactory;
+
+    struct Statistics {
+        uint64_t connections;
+        uint64_t framesIn;
+        uint64_t bytesIn;
+        uint64_t framesOut;
+        uint64_t bytesOut;
+    };
+
+    /**
+     * @param sceneFactory  Creates the scene for each connection; the server owns the result
+     * @param frameRate     Scene steps per second of scene time; 0 steps as fast as the connection
+     *                      allows, by the wall-clock time since the previous step
+     * @param timeScale     Scene seconds per wall-clock second; 0 runs the scene as fast as the
+     *                      connection allows, one 1/frameRate step at a time
+     */
+    FactoryServer(SceneFactory sceneFactory, double frameRate, double timeScale = 1.0);
+    ~FactoryServer();
+
+    /**
+     * Starts accepting connections.
+     *
+     * @param ipAddress     Address to listen on
+     * @param port          TCP port to listen on; 0 picks a free port (see getPort())
+     *
+     * @return true if the server is listening
+     */
+    bool start(std::string ipAddress, uint32_t port);
+
+    /**
+     * Closes the listening socket and every connection.
+     */
+    void stop();
+
+    uint32_t getPort() const {
+        return m_port;
+    }
+
+    Statistics getStatistics() const;
+
+private:
+    class Session;
+
+    void acceptorThread();
+    void reapSessions();
+    void countIn(size_t bytes);
+    void countOut(size_t bytes);
+
+    SceneFactory            m_sceneFactory;
+    double                  m_frameRate;
+    double                  m_timeScale;
+    int32_t                 m_listenFd;
+    uint32_t                m_port;
+    std::atomic<bool>       m_running;
+    std::thread*            m_acceptorThread;
+    std::mutex              m_mutex;            // Guards the session list
+    std::list<Session*>     m_sessions;
+    std::atomic<uint64_t>   m_connections;
+    std::atomic<uint64_t>   m_framesIn;
+    std::atomic<uint64_t>   m_bytesIn;
+    std::atomic<uint64_t>   m_framesOut;
+    std::atomic<uint64_t>   m_bytesOut;
+};
+
+#endif
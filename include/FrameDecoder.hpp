@@ -0,0 +1,47 @@
+/* 
+ * File:   FrameDecoder.hpp
+ *
+ * Splits a byte stream into Factory IO frames.
+ */
+
+#pragma once
+#ifndef FRAME_DECODER_HPP
+#define FRAME_DECODER_HPP
+
+#include <stddef.h>
+#include <string>
+
+/**
+ * Factory IO frames are JSON text delimited by START_OF_TEXT and END_OF_TEXT.  Bytes are appended
+ * as they arrive, in pieces of any size, and complete frames are taken out one at a time.  Bytes
+ * before a start marker are discarded.
+ */
+class FrameDecoder {
+public:
+    static const std::string START_OF_TEXT;
+    static const std::string END_OF_TEXT;
+
+    FrameDecoder();
+
+    void append(const char* data, size_t size);
+
+    /**
+     * Extracts the next complete frame.
+     *
+     * @param frameText     Receives the text between the delimiters
+     *
+     * @return true if a frame was extracted
+     */
+    bool next(std::string& frameText);
+
+    /**
+     * Wraps text in the frame delimiters.
+     */
+    static std::string encode(const std::string& text);
+
+private:
+    std::string m_data;
+    size_t      m_position;     // Bytes of m_data already consumed
+};
+
+#endif
@@ -0,0 +1,91 @@
+/*
+ * File:   Histogram.hpp
+ *
+ * High-dynamic-range histogram of latencies.
+ */
+
+#pragma once
+#ifndef HISTOGRAM_HPP
+#define HISTOGRAM_HPP
+
+#include <stdint.h>
+#include <ostream>
+#include <vector>
+
+/**
+ * Records non-negative integer values (typically nanoseconds) from 0 up to a highest trackable
+ * value with a fixed number of significant decimal digits, in the bucket layout of HdrHistogram:
+ * values below the sub-bucket count are counted exactly, and every power of two above that is
+ * split into half as many linear sub-buckets.  Recording is a few shifts and an increment, and
+ * the memory used depends only on the range and precision, not on the number of values.
+ *
+ * Values above the highest trackable value are counted in the last bucket; getMax() still returns
+ * the exact maximum.  A histogram is not thread-safe; record into one per thread and add() them.
+ */
+class Histogram {
+public:
+
+    /**
+     * @param highestTrackableValue Largest value kept at full precision
+     * @param significantDigits     Decimal digits of precision, 1 to 5
+     */
+    explicit Histogram(uint64_t highestTrackableValue = 3600000000000ULL, uint32_t significantDigits = 3);
+
+    void record(uint64_t value);
+
+    /**
+     * Adds the counts of a histogram with the same range and precision.
+     */
+    void add(const Histogram& other);
+
+    void reset();
+
+    uint64_t getTotalCount() const {
+        return m_totalCount;
+    }
+
+    uint64_t getMin() const;
+
+    uint64_t getMax() const {
+        return m_max;
+    }
+
+    double getMean() const;
+
+    double getStandardDeviation() const;
+
+    /**
+     * @param percentile    0 to 100
+     *
+     * @return the largest value equivalent (within the precision) to the value at the percentile
+     */
+    uint64_t getValueAtPercentile(double percentile) const;
+
+    /**
+     * Writes the percentile distribution in the HdrHistogram text (.hgrm) format, which the
+     * HdrHistogram plotting tools read.
+     *
+     * @param scale                 Values are divided by this, e.g. 1000 to print microseconds
+     * @param ticksPerHalfDistance  Rows per halving of the distance to 100%
+     */
+    void writePercentiles(std::ostream& output, double scale = 1.0, uint32_t ticksPerHalfDistance = 5) const;
+
+private:
+    uint32_t indexOf(uint64_t value) const;
+    uint64_t lowestValueAt(uint32_t index) const;
+    uint64_t highestValueAt(uint32_t index) const;
+    uint64_t countAtOrBelow(uint64_t value) const;
+
+    uint64_t                m_highestTrackableValue;
+    uint32_t                m_significantDigits;
+    uint32_t                m_subBucketMagnitude;   // log2 of the sub-bucket count
+    uint32_t                m_subBucketCount;
+    uint32_t                m_subBucketHalfCount;
+    std::vector<uint64_t>   m_counts;
+    uint64_t                m_totalCount;
+    uint64_t                m_max;
+    double                  m_sum;                  // For the mean and standard deviation
+    double                  m_sumOfSquares;
+};
+
+#endif
@@ -0,0 +1,182 @@
+/*
+ * File:   Log.hpp
+ *
+ * Low-overhead asynchronous logging.
+ */
+
+#pragma once
+#ifndef LOG_HPP
+#define LOG_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <atomic>
+#include <string>
+#include <type_traits>
+
+enum LogLevel {
+    LOG_LEVEL_TRACE = 0,
+    LOG_LEVEL_DEBUG = 1,
+    LOG_LEVEL_INFO = 2,
+    LOG_LEVEL_WARNING = 3,
+    LOG_LEVEL_ERROR = 4
+};
+
+/**
+ * Records below this level are compiled out entirely.  Override with -DFACTORYIO_LOG_LEVEL=n,
+ * where n is one of the LogLevel values.
+ */
+#ifndef FACTORYIO_LOG_LEVEL
+#define FACTORYIO_LOG_LEVEL 1
+#endif
+
+/**
+ * Log macros.  The first argument is a format string literal in which each "{}" is replaced by
+ * the next argument; the arguments are copied in binary form and formatted later by the drain
+ * thread, so the calling thread never formats or performs I/O, and locks only to wake the drain
+ * thread when it is idle.
+ */
+#define LOG_AT(level, ...) \
+    do { \
+        if (((level) >= FACTORYIO_LOG_LEVEL) && Log::enabled(level)) { \
+            Log::write((level), __VA_ARGS__); \
+        } \
+    } while (0)
+
+/**
+ * Logs only every interval-th time this statement is reached on the calling thread.
+ */
+#define LOG_SAMPLED(level, interval, ...) \
+    do { \
+        if (((level) >= FACTORYIO_LOG_LEVEL) && Log::enabled(level)) { \
+            static thread_local uint32_t logSampleCount = 0; \
+            if ((logSampleCount++ % (interval)) == 0) { \
+                Log::write((level), __VA_ARGS__); \
+            } \
+        } \
+    } while (0)
+
+#define LOG_TRACE(...)   LOG_AT(LOG_LEVEL_TRACE, __VA_ARGS__)
+#define LOG_DEBUG(...)   LOG_AT(LOG_LEVEL_DEBUG, __VA_ARGS__)
+#define LOG_INFO(...)    LOG_AT(LOG_LEVEL_INFO, __VA_ARGS__)
+#define LOG_WARNING(...) LOG_AT(LOG_LEVEL_WARNING, __VA_ARGS__)
+#define LOG_ERROR(...)   LOG_AT(LOG_LEVEL_ERROR, __VA_ARGS__)
+
+/**
+ * Front end of the logger.  Each logging thread owns a lock-free buffer of binary records; a
+ * background thread drains all buffers, formats the records and writes them to the log file
+ * (standard output until open() is called).  When a thread's buffer is full the record is dropped
+ * and counted rather than blocking the caller.
+ */
+class Log {
+public:
+
+    /**
+     * Redirects the log to a file.
+     *
+     * @param path  File to append to
+     *
+     * @return true if the file could be opened
+     */
+    static bool open(const std::string& path);
+
+    /**
+     * Sets the runtime level; records below it cost a single branch.
+     */
+    static void setLevel(LogLevel level);
+
+    static inline bool enabled(int level) {
+        return level >= s_level.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * Blocks until every record written so far has reached the log file.
+     */
+    static void flush();
+
+    /**
+     * Number of records dropped because a thread's buffer was full.
+     */
+    static uint64_t getDroppedCount();
+
+    template<typename... Args>
+    static void write(int level, const char* format, const Args&... args) {
+        Record record(level, format);
+        encode(record, args...);
+        commit(record);
+    }
+
+    /**
+     * A record under construction on the caller's stack: header followed by encoded arguments.
+     */
+    struct Record {
+        static const size_t MAX_SIZE = 512;
+        static const size_t MAX_STRING_SIZE = 256;
+
+        Record(int level, const char* format);
+        void add(uint8_t type, const void* value, size_t size);
+
+        uint8_t data[MAX_SIZE];
+        size_t  size;
+    };
+
+    enum ArgumentType {
+        ARGUMENT_SIGNED,
+        ARGUMENT_UNSIGNED,
+        ARGUMENT_DOUBLE,
+        ARGUMENT_BOOL,
+        ARGUMENT_STRING
+    };
+
+private:
+    static void encode(Record& /* record */) {
+    }
+
+    template<typename T, typename... Args>
+    static void encode(Record& record, const T& value, const Args&... args) {
+        encodeValue(record, value);
+        encode(record, args...);
+    }
+
+    static void encodeValue(Record& record, bool value) {
+        uint8_t flag = value ? 1 : 0;
+        record.add(ARGUMENT_BOOL, &flag, sizeof(flag));
+    }
+
+    static void encodeValue(Record& record, const char* value) {
+        encodeString(record, value, strlen(value));
+    }
+
+    static void encodeValue(Record& record, const std::string& value) {
+        encodeString(record, value.data(), value.size());
+    }
+
+    template<typename T>
+    static void encodeValue(Record& record, const T& value,
+                            typename std::enable_if<std::is_integral<T>::value ||
+                                                    std::is_enum<T>::value>::type* = 0) {
+        if (std::is_signed<T>::value) {
+            int64_t signedValue = static_cast<int64_t>(value);
+            record.add(ARGUMENT_SIGNED, &signedValue, sizeof(signedValue));
+        }
+        else {
+            uint64_t unsignedValue = static_cast<uint64_t>(value);
+            record.add(ARGUMENT_UNSIGNED, &unsignedValue, sizeof(unsignedValue));
+        }
+    }
+
+    template<typename T>
+    static void encodeValue(Record& record, const T& value,
+                            typename std::enable_if<std::is_floating_point<T>::value>::type* = 0) {
+        double doubleValue = value;
+        record.add(ARGUMENT_DOUBLE, &doubleValue, sizeof(doubleValue));
+    }
+
+    static void encodeString(Record& record, const char* value, size_t size);
+    static void commit(const Record& record);
+
+    static std::atomic<int> s_level;
+};
+
+#endif
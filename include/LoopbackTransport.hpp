@@ -0,0 +1,69 @@
+/*
+ * File:   LoopbackTransport.hpp
+ *
+ * In-memory transport for benchmarks and tests.
+ */
+
+#pragma once
+#ifndef LOOPBACK_TRANSPORT_HPP
+#define LOOPBACK_TRANSPORT_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <string>
+#include "FrameDecoder.hpp"
+#include "Transport.hpp"
+
+/**
+ * Stands in for the TCP connection without any system calls.  Bytes injected by the caller go
+ * through the same frame decoder and event handler as bytes read from a socket, on the calling
+ * thread, and frames sent by the factory are counted and optionally handed to a callback.  This
+ * measures the factory's own cost of framing, parsing and dispatch apart from the kernel's.
+ */
+class LoopbackTransport : public Transport {
+public:
+    typedef std::function<void(const std::string&)> OutputHandler;
+
+    LoopbackTransport();
+
+    virtual void connect(CommunicationsEventHandler& eventHandler, Clock& clock);
+    virtual void sendMessage(const std::string& text);
+
+    /**
+     * Receives bytes as if they had been read from the socket: delimited frames, or pieces of
+     * them.  Injection from several threads is serialized.
+     */
+    void inject(const char* data, size_t size);
+
+    inline void inject(const std::string& data) {
+        inject(data.data(), data.size());
+    }
+
+    /**
+     * Hands every frame the factory sends to a function, on the sending thread.  Call before
+     * connecting.
+     */
+    void setOutputHandler(OutputHandler outputHandler);
+
+    uint64_t getReceivedCount() const {
+        return m_receivedCount;
+    }
+
+    uint64_t getSentCount() const {
+        return m_sentCount;
+    }
+
+private:
+    CommunicationsEventHandler* m_eventHandler;
+    OutputHandler               m_outputHandler;
+    std::mutex                  m_inboundMutex;     // Serializes injection
+    FrameDecoder                m_frameDecoder;
+    std::string                 m_messageText;      // Reused by each frame
+    std::atomic<uint64_t>       m_receivedCount;    // Frames delivered to the event handler
+    std::atomic<uint64_t>       m_sentCount;        // Frames sent by the factory
+};
+
+#endif
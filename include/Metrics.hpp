@@ -0,0 +1,201 @@
+/*
+ * File:   Metrics.hpp
+ *
+ * Always-on counters and latency histograms, exported in the Prometheus text format.
+ */
+
+#pragma once
+#ifndef METRICS_HPP
+#define METRICS_HPP
+
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "CacheAligned.hpp"
+#include "Histogram.hpp"
+
+/**
+ * A monotonically increasing count.  Each adding thread gets its own shard on its own cache line,
+ * which only that thread writes, so counting from several threads never contends; the shards are
+ * summed only when the counter is read.
+ */
+class Counter {
+public:
+    Counter(const char* name, const char* help);
+
+    inline void add(uint64_t count = 1) {
+        std::atomic<uint64_t>& value = localShard().value;
+        value.store(value.load(std::memory_order_relaxed) + count, std::memory_order_relaxed);
+    }
+
+    /**
+     * Sums the shards of every thread that has added so far.
+     */
+    uint64_t get() const;
+
+    const char* getName() const {
+        return m_name;
+    }
+
+    const char* getHelp() const {
+        return m_help;
+    }
+
+private:
+    struct Shard : public CacheAligned {
+        Shard();
+
+        alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> value;   // Written by the owning thread only
+    };
+
+    Shard& localShard();
+
+    const char*                         m_name;
+    const char*                         m_help;
+    uint32_t                            m_index;    // Slot in each thread's shard table
+    mutable std::mutex                  m_mutex;    // Guards the shard list
+    std::vector<std::unique_ptr<Shard>> m_shards;
+};
+
+/**
+ * A distribution of durations in nanoseconds.  Each recording thread gets its own Histogram, so
+ * recording never contends with other threads; the shards are merged only when the metric is read.
+ */
+class LatencyHistogram {
+public:
+    LatencyHistogram(const char* name, const char* help);
+
+    void record(uint64_t nanoseconds);
+
+    /**
+     * Merges the shards of every thread that has recorded so far.
+     */
+    Histogram snapshot() const;
+
+    const char* getName() const {
+        return m_name;
+    }
+
+    const char* getHelp() const {
+        return m_help;
+    }
+
+private:
+    struct Shard {
+        Shard();
+
+        std::mutex  mutex;      // Taken by the owning thread to record and by readers to merge
+        Histogram   histogram;
+    };
+
+    Shard& localShard();
+
+    const char*                         m_name;
+    const char*                         m_help;
+    uint32_t                            m_index;    // Slot in each thread's shard table
+    mutable std::mutex                  m_mutex;    // Guards the shard list
+    std::vector<std::unique_ptr<Shard>> m_shards;
+};
+
+/**
+ * Registry of every counter and histogram in the process, plus the instruments of the factory
+ * itself.  Metrics are meant to live as long as the process; they register themselves when
+ * constructed and are never removed.  Values that are only sampled when the metrics are read,
+ * such as queue depths, come from collectors.
+ *
+ * The metrics can be served over HTTP for a Prometheus scraper, or written to a file whenever the
+ * process receives a signal.
+ */
+class Metrics {
+public:
+    typedef std::function<void(std::ostream&)> Collector;
+
+    static Counter          framesReceived;
+    static Counter          framesSent;
+    static Counter          bytesReceived;
+    static Counter          bytesSent;
+    static Counter          changesMerged;
+    static Counter          tasksExecuted;
+    static Counter          tasksStolen;
+    static Counter          rulesEvaluated;
+    static Counter          rulesFired;
+    static Counter          scanOverruns;
+    static LatencyHistogram parseTime;
+    static LatencyHistogram dispatchTime;
+    static LatencyHistogram sendBlockedTime;
+    static LatencyHistogram socketQueueTime;
+    static LatencyHistogram handlerTime;
+    static LatencyHistogram wakeLatency;
+    static LatencyHistogram scanTime;
+
+    static inline uint64_t nowNs() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    /**
+     * Adds a function that writes sampled metrics, with writeHeader() and writeSample().
+     *
+     * @return an id for removeCollector()
+     */
+    static uint32_t addCollector(Collector collector);
+
+    /**
+     * Removes a collector; returns only once the collector is no longer running.
+     */
+    static void removeCollector(uint32_t id);
+
+    /**
+     * Writes every metric in the Prometheus text exposition format.  Histograms are written as
+     * summaries in seconds.
+     */
+    static void write(std::ostream& output);
+
+    static void writeHeader(std::ostream& output, const char* name, const char* type, const char* help);
+
+    /**
+     * @param labels    Label name and value pairs; values are escaped
+     */
+    static void writeSample(std::ostream& output, const char* name,
+                            const std::vector<std::pair<std::string, std::string> >& labels, double value);
+
+    /**
+     * Serves the metrics to HTTP GET requests on a thread of its own.
+     *
+     * @param ipAddress     Address to listen on, normally 127.0.0.1
+     * @param port          TCP port
+     *
+     * @return true if listening
+     */
+    static bool serve(const std::string& ipAddress, uint32_t port);
+
+    /**
+     * Writes the metrics to a file each time the process receives a signal, e.g. SIGUSR1.
+     *
+     * @return true if the handler was installed
+     */
+    static bool dumpOnSignal(int signal, const std::string& path);
+
+    /**
+     * Runs an action on a thread of its own each time the process receives a signal; the action
+     * is free to lock and do I/O.  Later calls for the same signal replace the action.
+     *
+     * @return true if the handler was installed
+     */
+    static bool onSignal(int signal, std::function<void()> action);
+
+private:
+    static void registerCounter(Counter* counter);
+    static void registerHistogram(LatencyHistogram* histogram);
+
+    friend class Counter;
+    friend class LatencyHistogram;
+};
+
+#endif
@@ -0,0 +1,268 @@
+/*
+ * File:   PlantScene.hpp
+ *
+ * Headless kinematic model of the Factory IO parts used by the demo controllers.
+ */
+
+#pragma once
+#ifndef PLANT_SCENE_HPP
+#define PLANT_SCENE_HPP
+
+#include <stdint.h>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "FactoryScene.hpp"
+
+/**
+ * A scene built out of one-dimensional conveyors that carry items, plus the devices that act on
+ * them: emitters, removers, roller stops and stop blades, retroreflective and diffuse sensors,
+ * conveyor scales, pop-up wheel sorters and a pick and place.  The model is kinematic only;
+ * items move at the speed of the conveyor under their centre, queue up behind each other and
+ * behind raised stops, and cross to the next conveyor when their centre passes its end.  That is
+ * enough to produce the sensor edges the controllers react to, at any time scale.
+ *
+ * Tag names are the names the controllers give their parts, so a scene is assembled by naming the
+ * same tags (see PlantScenes.hpp for the demo layouts).  Lengths are in metres, speeds in metres
+ * per second and weights in kilograms; pick and place axes use the controller's own units.
+ */
+class PlantScene : public FactoryScene {
+public:
+
+    /**
+     * Where a pick and place picks items up and drops them off.
+     */
+    struct PickAndPlaceLayout {
+        double      pickX;          // Gripper position above the pick-up point
+        double      pickY;
+        double      pickZ;          // Gripper height at which an item on the pick-up point is reached
+        uint32_t    pickConveyor;   // Conveyor and position of the pick-up point
+        double      pickPosition;
+        uint32_t    placeConveyor;  // Conveyor and position of the drop-off point; an item
+        double      placePosition;  // released there is loaded onto the item below it
+        double      axisSpeed;      // Axis units per second
+        double      tolerance;      // Axis units within which the gripper is on target
+    };
+
+    struct Statistics {
+        uint64_t    emitted;        // Items created by emitters
+        uint64_t    removed;        // Items taken away by removers
+        uint64_t    picked;         // Items lifted by a pick and place
+        uint64_t    placed;         // Items loaded onto another item by a pick and place
+        double      sceneTime;      // Seconds of scene time simulated
+    };
+
+    /**
+     * @param seed  Seed of the generator that picks emitted item weights
+     */
+    explicit PlantScene(uint32_t seed = 1);
+
+    /**
+     * Adds a conveyor.
+     *
+     * @param forwardTag    Actuator that drives the conveyor forward
+     * @param length        Length of the conveyor
+     * @param speed         Conveying speed
+     * @param backwardTag   Actuator that drives the conveyor backward, if any
+     *
+     * @return index of the conveyor, used to attach devices to it
+     */
+    uint32_t addConveyor(std::string forwardTag, double length, double speed, std::string backwardTag = "");
+
+    /**
+     * Makes items that leave the end of one conveyor enter the start of another.
+     */
+    void connect(uint32_t from, uint32_t to);
+
+    /**
+     * Turns a conveyor into a pop-up wheel sorter: the wheels drive it forward, and the direction
+     * selected when an item leaves decides which conveyor it enters.
+     */
+    void addWheelSorter(uint32_t sorter, std::string leftTag, std::string rightTag,
+                        uint32_t left, uint32_t right, uint32_t straight);
+
+    /**
+     * Adds an emitter that drops an item onto the start of a conveyor whenever it is on, the
+     * start is clear and the interval since the previous item has passed.  The interval is the
+     * minimum interval plus an exponentially distributed delay with the given mean.
+     */
+    void addEmitter(std::string tag, uint32_t conveyor, double itemLength, double minimumWeight,
+                    double maximumWeight, double interval, double meanExtraInterval = 0);
+
+    /**
+     * Adds a remover that takes away every item reaching the end of a conveyor while it is on.
+     */
+    void addRemover(std::string tag, uint32_t conveyor);
+
+    /**
+     * Adds a roller stop or stop blade that holds items back while it is raised.
+     */
+    void addStop(std::string tag, uint32_t conveyor, double position);
+
+    /**
+     * Adds a retroreflective sensor, which is true while its beam is not interrupted.
+     */
+    void addBeamSensor(std::string tag, uint32_t conveyor, double position);
+
+    /**
+     * Adds a diffuse sensor, which is true while an item is in front of it.
+     */
+    void addPresenceSensor(std::string tag, uint32_t conveyor, double position);
+
+    /**
+     * Adds a weight sensor reporting the total weight of the items on a conveyor.
+     */
+    void addScale(std::string tag, uint32_t conveyor);
+
+    /**
+     * Adds a pick and place with the tags of the PickAndPlace part named name.
+     */
+    void addPickAndPlace(std::string name, const PickAndPlaceLayout& layout);
+
+    virtual void applyActuatorValues(const rapidjson::Document& frame);
+    virtual void step(double elapsedSeconds);
+    virtual bool getSensorValues(rapidjson::Document& frame, bool changedOnly);
+
+    Statistics getStatistics() const {
+        return m_statistics;
+    }
+
+    /**
+     * Time from emission to removal of every item removed so far, in seconds.
+     */
+    const std::vector<double>& getLeadTimes() const {
+        return m_leadTimes;
+    }
+
+    /**
+     * Fraction of scene time the conveyors spent running with items on them, averaged over all
+     * conveyors.
+     */
+    double getUtilization() const;
+
+    /**
+     * Number of items taken away by the remover with the given tag.
+     */
+    uint64_t getRemovedCount(const std::string& tag) const;
+
+private:
+    static const double MAX_STEP;       // Longest scene time advanced in one move
+    static const double ITEM_GAP;       // Closest two items get to each other
+
+    struct Item {
+        uint32_t    conveyor;
+        double      position;           // Centre of the item along its conveyor
+        double      length;
+        double      weight;
+        uint32_t    load;               // Items placed onto this one
+        double      emittedTime;        // Scene time at which the item was emitted
+    };
+
+    struct Conveyor {
+        uint32_t    forwardTag;
+        uint32_t    backwardTag;
+        double      length;
+        double      speed;
+        int32_t     next;               // Conveyor fed by this one, or -1
+        int32_t     remover;            // Remover at the end, or -1
+        bool        sorter;
+        uint32_t    leftTag;
+        uint32_t    rightTag;
+        int32_t     left;
+        int32_t     right;
+        double      busyTime;           // Scene time spent running with items on it
+    };
+
+    struct Emitter {
+        uint32_t    tag;
+        uint32_t    conveyor;
+        double      itemLength;
+        double      minimumWeight;
+        double      maximumWeight;
+        double      interval;
+        double      meanExtraInterval;
+        double      nextInterval;       // Interval before the next item
+        double      idleTime;           // Scene time since the last item was emitted
+    };
+
+    struct Remover {
+        uint32_t    tag;
+        uint64_t    count;
+    };
+
+    struct Stop {
+        uint32_t    tag;
+        uint32_t    conveyor;
+        double      position;
+    };
+
+    enum SensorKind {
+        SENSOR_BEAM,
+        SENSOR_PRESENCE,
+        SENSOR_WEIGHT,
+        SENSOR_POSITION,        // Pick and place sensors are updated with their axes
+        SENSOR_GRIPPER,
+        SENSOR_LIMIT
+    };
+
+    struct Sensor {
+        std::string name;
+        SensorKind  kind;
+        uint32_t    conveyor;
+        double      position;
+        double      value;
+        bool        changed;
+    };
+
+    struct Axis {
+        uint32_t    setpointTag;
+        uint32_t    sensor;
+        double      position;
+    };
+
+    struct PickAndPlace {
+        PickAndPlaceLayout  layout;
+        Axis                x;
+        Axis                y;
+        Axis                z;
+        uint32_t            grabTag;
+        uint32_t            rotateTag;
+        uint32_t            itemDetectedSensor;
+        uint32_t            rotateLimitSensor;
+        double              rotation;   // 0 at rest, 1 at the rotate limit
+        bool                holding;
+        Item                heldItem;
+    };
+
+    uint32_t actuator(const std::string& tag);
+    uint32_t sensor(const std::string& name, SensorKind kind, uint32_t conveyor, double position, double value);
+    bool isOn(uint32_t tag) const {
+        return m_actuatorValues[tag] != 0;
+    }
+    int32_t nextConveyor(uint32_t conveyor) const;
+    int32_t findItem(uint32_t conveyor, double position) const;
+    bool covers(const Item& item, uint32_t conveyor, double position) const;
+    void move(double elapsedSeconds);
+    void moveItems(double elapsedSeconds);
+    void emitItems(double elapsedSeconds);
+    void movePickAndPlace(PickAndPlace& pickAndPlace, double elapsedSeconds);
+    void updateSensors();
+    void setSensor(Sensor& sensor, double value);
+
+    std::unordered_map<std::string, uint32_t>   m_actuatorIndex;    // Actuator tag to index
+    std::vector<std::string>                    m_actuatorNames;
+    std::vector<double>                         m_actuatorValues;   // Last value received
+    std::vector<Conveyor>                       m_conveyors;
+    std::vector<Emitter>                        m_emitters;
+    std::vector<Remover>                        m_removers;
+    std::vector<Stop>                           m_stops;
+    std::vector<Sensor>                         m_sensors;
+    std::vector<PickAndPlace>                   m_pickAndPlaces;
+    std::vector<Item>                           m_items;
+    std::vector<double>                         m_leadTimes;
+    std::mt19937                                m_random;
+    Statistics                                  m_statistics;
+};
+
+#endif
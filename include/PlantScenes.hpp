@@ -0,0 +1,53 @@
+/*
+ * File:   PlantScenes.hpp
+ *
+ * Plant models of the scenes driven by the demo controllers.
+ */
+
+#pragma once
+#ifndef PLANT_SCENES_HPP
+#define PLANT_SCENES_HPP
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "PlantScene.hpp"
+
+/**
+ * Layouts matching the parts and tag names of the demo controllers.  Dimensions and speeds
+ * approximate the Factory IO parts; they only need to be close enough for the controllers to see
+ * the same sequence of sensor edges as in the real scenes.
+ */
+namespace PlantScenes {
+
+    /**
+     * Emitter, entry and exit roller conveyors with a retroreflective sensor each, and a remover,
+     * as driven by BasicConveyorControl.
+     *
+     * @param stationPrefix     Prefix of the tag names, e.g. "Station 1 "
+     * @param seed              Seed of the scene's random weights and arrival delays
+     * @param meanArrivalDelay  Mean random delay added to the emitters' minimum intervals
+     */
+    PlantScene* createBasicConveyorScene(std::string stationPrefix, uint32_t seed = 1, double meanArrivalDelay = 0);
+
+    /**
+     * Side-by-side copies of the basic conveyor scene, one per station prefix, as driven by one
+     * BasicConveyorControl each over the same connection.
+     */
+    PlantScene* createBasicConveyorScene(const std::vector<std::string>& stationPrefixes, uint32_t seed = 1,
+                                         double meanArrivalDelay = 0);
+
+    /**
+     * Pallet line with a roller stop, box line with a stop blade and a pick and place loading
+     * boxes onto pallets, as driven by BasicPackingFactory.
+     */
+    PlantScene* createBasicPackingScene(uint32_t seed = 1, double meanArrivalDelay = 0);
+
+    /**
+     * Entry conveyor, conveyor scale and pop-up wheel sorter feeding left, right and back
+     * conveyors, as driven by SortingByWeightFactory.
+     */
+    PlantScene* createSortingByWeightScene(uint32_t seed = 1, double meanArrivalDelay = 0);
+}
+
+#endif
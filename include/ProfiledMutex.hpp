@@ -0,0 +1,86 @@
+/*
+ * File:   ProfiledMutex.hpp
+ *
+ * Mutex that records how often, and how long, its lock is contended and held.
+ */
+
+#pragma once
+#ifndef PROFILED_MUTEX_HPP
+#define PROFILED_MUTEX_HPP
+
+#include <stdint.h>
+#include <condition_variable>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include "Histogram.hpp"
+
+/**
+ * A drop-in replacement for std::mutex that counts acquisitions and contended acquisitions, and
+ * keeps histograms of the time spent waiting for the lock and the time it was held.  Locks are
+ * reported by kind (sensor, actuator, station, ...) and label, usually the tag name; locks with
+ * the same kind and label are added together.
+ *
+ * The statistics of a lock are only updated while it is held, so they need no locking of their
+ * own.  Reports are available from writeReport() and, as factoryio_lock_* metrics, from Metrics.
+ */
+class ProfiledMutex {
+public:
+    ProfiledMutex();
+    ~ProfiledMutex();
+
+    ProfiledMutex(const ProfiledMutex&) = delete;
+    ProfiledMutex& operator=(const ProfiledMutex&) = delete;
+
+    void lock();
+    bool try_lock();
+    void unlock();
+
+    /**
+     * @param kind      What the lock protects; a string literal
+     * @param label     Tag or other name; locks without one are numbered
+     */
+    void setName(const char* kind, const std::string& label);
+
+    /**
+     * Writes a table of every lock kind and label, most waited-for first.
+     */
+    static void writeReport(std::ostream& output);
+
+private:
+    friend class LockRegistry;
+
+    std::mutex  m_mutex;
+    const char* m_kind;
+    std::string m_label;
+    uint64_t    m_acquisitions;
+    uint64_t    m_contendedAcquisitions;
+    Histogram   m_waitTimes;        // Nanoseconds, contended acquisitions only
+    Histogram   m_holdTimes;        // Nanoseconds
+    uint64_t    m_lockedNs;         // When the current holder acquired the lock
+};
+
+/**
+ * The mutex and condition variable of sensors, actuators, stations, Factory and Communications.
+ * They are plain std::mutex and std::condition_variable unless built with
+ * -DFACTORYIO_PROFILE_LOCKS, e.g. make clean && make CPPFLAGS=-DFACTORYIO_PROFILE_LOCKS.
+ */
+#ifdef FACTORYIO_PROFILE_LOCKS
+typedef ProfiledMutex               Mutex;
+typedef std::condition_variable_any ConditionVariable;
+#else
+typedef std::mutex                  Mutex;
+typedef std::condition_variable     ConditionVariable;
+#endif
+
+/**
+ * Names a Mutex for the lock profile; does nothing unless locks are profiled.
+ */
+inline void nameLock(ProfiledMutex& mutex, const char* kind, const std::string& label = std::string()) {
+    mutex.setName(kind, label);
+}
+
+inline void nameLock(std::mutex& /* mutex */, const char* /* kind */, const std::string& /* label */ = std::string()) {
+}
+
+#endif
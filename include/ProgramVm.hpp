@@ -0,0 +1,61 @@
+/*
+ * File:   ProgramVm.hpp
+ *
+ * Allocation-free interpreter for one instance of a ControlProgram.
+ */
+
+#pragma once
+#ifndef PROGRAM_VM_HPP
+#define PROGRAM_VM_HPP
+
+#include <stdint.h>
+#include <vector>
+#include "ControlProgram.hpp"
+
+/**
+ * Runs a compiled program one scan at a time.  The variables, the operand stack and the hidden
+ * state are sized when the VM is created, so scan() neither allocates nor checks bounds; the
+ * compiler guarantees the stack depth and the variable indices.
+ *
+ * Inputs are set with setVariable() before a scan and outputs read with getVariable() after it,
+ * as ScanController does.  The first scan sets the previous value of every R_TRIG and F_TRIG,
+ * so an input that is already on when the program starts is not an edge.
+ */
+class ProgramVm {
+public:
+    explicit ProgramVm(const ControlProgram& program);
+
+    /**
+     * Runs the program from the top.
+     *
+     * @param nowMs     Time of the scan in milliseconds, for TON
+     *
+     * @return the number of instructions executed
+     */
+    uint32_t scan(double nowMs);
+
+    /**
+     * Restores every variable to its initial value and clears the triggers and timers.
+     */
+    void reset();
+
+    double getVariable(uint32_t index) const {
+        return m_variables[index];
+    }
+
+    void setVariable(uint32_t index, double value) {
+        m_variables[index] = value;
+    }
+
+    const ControlProgram& getProgram() const {
+        return m_program;
+    }
+
+private:
+    const ControlProgram&   m_program;
+    std::vector<double>     m_variables;
+    std::vector<double>     m_state;    // Previous trigger inputs and timer starts; -1 when unset
+    std::vector<double>     m_stack;
+};
+
+#endif
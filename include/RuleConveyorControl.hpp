@@ -0,0 +1,44 @@
+/*
+ * File:   RuleConveyorControl.hpp
+ *
+ * BasicConveyorControl's logic written as rules.
+ */
+
+#pragma once
+#ifndef RULE_CONVEYOR_CONTROL_HPP
+#define RULE_CONVEYOR_CONTROL_HPP
+
+#include <stdint.h>
+#include <string>
+#include "Actuators.hpp"
+#include "Factory.hpp"
+#include "RuleEngine.hpp"
+#include "Sensors.hpp"
+#include "Station.hpp"
+
+/**
+ * Counts boxes onto the entry conveyor and off the exit conveyor, and holds the emitter off while
+ * the station is full, like BasicConveyorControl, but with a RuleEngine that the factory
+ * evaluates as it dispatches each frame, so the station needs neither a thread nor a task.
+ */
+class RuleConveyorControl {
+public:
+    RuleConveyorControl(Factory& factory, std::string stationPrefix, int32_t maxBoxCount);
+    void start();
+    void stop();
+    void waitUntilDone();
+
+private:
+    Factory&              m_factory;
+    Station               m_station;
+    Emitter               m_emitter;
+    Remover               m_remover;
+    DigitalRollerConveyor m_entryConveyor;
+    DigitalRollerConveyor m_exitConveyor;
+    RetroreflectiveSensor m_entrySensor;
+    RetroreflectiveSensor m_exitSensor;
+    RuleEngine            m_rules;
+    bool                  m_started;
+};
+
+#endif
@@ -0,0 +1,204 @@
+/*
+ * File:   RuleEngine.hpp
+ *
+ * Declarative sensor-to-actuator rules, evaluated inline as the factory dispatches each frame.
+ */
+
+#pragma once
+#ifndef RULE_ENGINE_HPP
+#define RULE_ENGINE_HPP
+
+#include <stdint.h>
+#include <initializer_list>
+#include <string>
+#include <vector>
+#include "Clock.hpp"
+#include "ProfiledMutex.hpp"
+#include "ActuatorSerializer.hpp"
+#include "SensorDeserializer.hpp"
+
+class Station;
+
+/**
+ * Interlocks and sequencing for one station written as rules instead of a controller task.  A
+ * rule is a list of conditions over inputs and a list of actions:
+ *
+ *     RuleEngine::Input boxes = rules.counter("boxes");
+ *     rules.when({ RuleEngine::rising(entry) }).add(boxes, 1);
+ *     rules.when({ RuleEngine::rising(entry), RuleEngine::compare(boxes, RuleEngine::GREATER_EQUAL, max) })
+ *          .set(emitter, false);
+ *
+ * Inputs are sensors, counters that actions update, and on-delay timers that turn true once
+ * another input has been nonzero for a while.  A rule with an edge condition fires once for every
+ * such edge of its input, so a pulse hidden by conflation still counts; its other conditions only
+ * gate it.  A rule without one fires each time its conditions become true.  Rules fire in the
+ * order they were declared, and a rule that changes a counter re-evaluates the rules that read it
+ * in the same pass.
+ *
+ * start() compiles the rules into flat tables, with each input indexing the rules that read it,
+ * and registers the engine with the factory.  The factory then evaluates the engine on the
+ * dispatching thread, right after a frame has been applied and before any waiting thread is
+ * woken, and only the rules whose inputs the frame changed are looked at.  Actuator changes are
+ * flushed with the station's applyChanges() before dispatch moves on.  Only timers use another
+ * thread: they are scheduled on the factory's Executor, which is not started for rules without
+ * timers.  The engine must outlive the factory's executor.
+ */
+class RuleEngine {
+public:
+    typedef uint32_t Input;
+
+    enum Comparison {
+        EQUAL,
+        NOT_EQUAL,
+        LESS,
+        LESS_EQUAL,
+        GREATER,
+        GREATER_EQUAL
+    };
+
+    struct Condition {
+        enum Kind {
+            RISING,     // Input went from zero to nonzero
+            FALLING,    // Input went from nonzero to zero
+            COMPARE     // Input compares with value
+        };
+
+        Kind        kind;
+        Input       input;
+        Comparison  comparison;
+        double      value;
+    };
+
+    /**
+     * Actions of the rule last added with when().  Actuators must belong to the engine's station,
+     * whose applyChanges() sends them.
+     */
+    class Actions {
+    public:
+        Actions& set(ActuatorSerializer& actuator, double value);
+        Actions& add(Input counter, double delta);
+        Actions& assign(Input counter, double value);
+
+    private:
+        friend class RuleEngine;
+
+        Actions(RuleEngine& engine)
+        : m_engine(engine) {
+        }
+
+        RuleEngine& m_engine;
+    };
+
+    static const uint32_t MAX_PASSES;   // Counter updates a frame can chain before evaluation stops
+
+    explicit RuleEngine(Station& station);
+
+    Input input(SensorDeserializer& sensor);
+    Input counter(const std::string& name, double value = 0);
+    Input onDelay(Input source, Clock::Duration delay);
+
+    static Condition rising(Input input);
+    static Condition falling(Input input);
+    static Condition compare(Input input, Comparison comparison, double value);
+
+    /**
+     * Adds a rule with the given conditions; its actions are added to the returned object.  Rules
+     * can only be added before start().
+     */
+    Actions when(std::initializer_list<Condition> conditions);
+
+    /**
+     * Compiles the rules, fires those whose conditions already hold and registers the engine with
+     * the factory.  The station's sensors should have been loaded first.
+     */
+    void start();
+
+    uint32_t getRuleCount() const {
+        return static_cast<uint32_t>(m_rules.size());
+    }
+
+private:
+    friend class Factory;
+
+    enum InputKind {
+        INPUT_SENSOR,
+        INPUT_COUNTER,
+        INPUT_TIMER
+    };
+
+    struct InputState {
+        InputKind           kind;
+        SensorDeserializer* sensor;         // Null unless a sensor
+        std::string         name;
+        double              value;
+        uint64_t            changeCount;    // Sensor's change count when last read; for a timer, the
+                                            // source's falling edges when it was armed
+        uint64_t            risingCount;    // Edges seen since start()
+        uint64_t            fallingCount;
+        Input               source;         // Input a timer follows
+        Clock::Duration     delay;
+        uint64_t            generation;     // Invalidates a timer's scheduled expiry
+        uint32_t            firstDependent; // Slice of m_dependents
+        uint32_t            dependentCount;
+        uint32_t            firstTimer;     // Slice of m_timerDependents
+        uint32_t            timerCount;
+        bool                armed;          // A timer's expiry is scheduled
+        bool                changedPending; // In m_changedInputs
+    };
+
+    struct Action {
+        enum Kind {
+            SET,
+            ADD,
+            ASSIGN
+        };
+
+        Kind                kind;
+        ActuatorSerializer* actuator;
+        Input               counter;
+        double              value;
+    };
+
+    struct Rule {
+        uint32_t    firstCondition;
+        uint32_t    conditionCount;
+        uint32_t    firstAction;
+        uint32_t    actionCount;
+        uint32_t    edgeCondition;      // Index into m_conditions, or NO_EDGE
+        uint64_t    consumedEdges;      // Edges of the edge condition's input already fired for
+        bool        conditionsHeld;     // Level rules fire when their conditions become true
+        bool        dirty;
+    };
+
+    static const uint32_t NO_EDGE;
+
+    Input addInput(InputKind kind, SensorDeserializer* sensor, const std::string& name, double value);
+    void sensorChanged(Input input);
+    void evaluate();
+    void expireTimer(Input timer, uint64_t generation);
+    void refreshSensor(Input input);
+    void setInputValue(Input input, double value);
+    void inputChanged(Input input);
+    void updateTimers(Input source);
+    void runRules();
+    void evaluateRule(uint32_t index);
+    bool levelConditionsHold(const Rule& rule) const;
+    void fire(const Rule& rule);
+
+    Station&                    m_station;
+    std::vector<InputState>     m_inputs;
+    std::vector<Condition>      m_conditions;
+    std::vector<Action>         m_actions;
+    std::vector<Rule>           m_rules;
+    std::vector<uint32_t>       m_dependents;       // Rules reading each input, sliced by input
+    std::vector<Input>          m_timerDependents;  // Timers following each input, sliced by input
+    std::vector<uint32_t>       m_dirtyRules;       // Rules to evaluate in this pass
+    std::vector<uint32_t>       m_nextDirtyRules;   // Rules dirtied by this pass
+    std::vector<Input>          m_changedInputs;    // Sensors changed by the frame being dispatched
+    bool                        m_actuatorsChanged; // An action set an actuator since the last flush
+    bool                        m_started;
+    uint64_t                    m_dispatchCount;    // Factory's last dispatch to change an input
+    Mutex                       m_mutex;            // Guards the tables against timer expiries
+};
+
+#endif
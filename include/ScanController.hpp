@@ -0,0 +1,100 @@
+/*
+ * File:   ScanController.hpp
+ *
+ * Runs structured-text programs against a factory in a fixed scan cycle.
+ */
+
+#pragma once
+#ifndef SCAN_CONTROLLER_HPP
+#define SCAN_CONTROLLER_HPP
+
+#include <stdint.h>
+#include <list>
+#include <memory>
+#include <string>
+#include <vector>
+#include "Clock.hpp"
+#include "ControlProgram.hpp"
+#include "Factory.hpp"
+#include "ProfiledMutex.hpp"
+#include "ProgramVm.hpp"
+#include "Station.hpp"
+
+/**
+ * A soft PLC: every period it latches each program's inputs from their sensors, runs each
+ * program once on its ProgramVm, writes the outputs to their actuators and sends whatever changed
+ * in a single frame.  Each program is loaded for a station prefix, and the sensors and actuators
+ * its inputs and outputs name are created for that station, so the same program file can drive
+ * any number of identical stations.
+ *
+ * The scan is a timer task on the factory's Executor, so hundreds of programs share one task and
+ * no thread of their own.  Programs can be loaded while the controller runs, from files that are
+ * compiled at run time, so the control logic changes without rebuilding.  Programs are never
+ * unloaded: like any station, their parts stay registered with the factory, which the controller
+ * must not outlive.
+ */
+class ScanController {
+public:
+    static const Clock::Duration DEFAULT_PERIOD;
+
+    explicit ScanController(Factory& factory, Clock::Duration period = DEFAULT_PERIOD);
+
+    /**
+     * Compiles a program and binds it to a station.
+     *
+     * @param source        Structured text (see StructuredText)
+     * @param sourceName    Name used in compiler errors
+     * @param stationPrefix Prefix of the tags the program's inputs and outputs name
+     *
+     * @return false if the program does not compile
+     */
+    bool load(const std::string& source, const std::string& sourceName, const std::string& stationPrefix);
+
+    /**
+     * Compiles the program file at path and binds it to a station.
+     */
+    bool loadFile(const std::string& path, const std::string& stationPrefix);
+
+    /**
+     * Loads the sensor values and starts scanning.
+     */
+    void start();
+
+    void stop();
+
+    /**
+     * Returns once the factory has been stopped and the last scan has ended.
+     */
+    void waitUntilDone();
+
+    uint32_t getProgramCount() const;
+
+private:
+    /**
+     * A compiled program with its station, parts and bindings.
+     */
+    struct LoadedProgram {
+        LoadedProgram(Factory& factory, const std::string& stationPrefix, const ControlProgram& compiled);
+
+        ControlProgram                                      program;
+        ProgramVm                                           vm;
+        Station                                             station;
+        std::vector<std::unique_ptr<SensorDeserializer>>    sensors;
+        std::vector<std::unique_ptr<ActuatorSerializer>>    actuators;
+        std::vector<std::pair<SensorDeserializer*, uint32_t>>   inputs;     // Sensor and variable
+        std::vector<std::pair<ActuatorSerializer*, uint32_t>>   outputs;    // Actuator and variable
+    };
+
+    bool add(const ControlProgram& program, const std::string& stationPrefix);
+    void scan();
+
+    Factory&                                    m_factory;
+    Clock::Duration                             m_period;
+    Clock::Duration                             m_nextScan;     // When the next scan is due
+    std::vector<std::unique_ptr<LoadedProgram>> m_programs;
+    std::list<ActuatorSerializer*>              m_actuatorList; // Every program's outputs, flushed together
+    bool                                        m_started;
+    mutable Mutex                               m_mutex;        // Guards the programs against loads
+};
+
+#endif
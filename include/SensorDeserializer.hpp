@@ -2,13 +2,89 @@
 #ifndef SENSOR_DESERIALIZER_HPP
 #define SENSOR_DESERIALIZER_HPP
 
+#include <stdint.h>
+#include <string>
+#include <unordered_map>
 #include "rapidjson/document.h"
+#include "TagNames.hpp"
+
+/**
+ * What a boolean tag did across several frames that were merged into one (see SensorPipeline).
+ */
+struct ConflatedTag {
+    bool     firstValue;    // Value in the oldest merged frame
+    uint32_t edgeCount;     // Value changes between the merged frames
+};
+
+typedef std::unordered_map<TagId, ConflatedTag> ConflatedTagMap;     // By interned tag
 
 class SensorDeserializer
 {
 public:
+    virtual ~SensorDeserializer() {
+    }
+
     virtual bool deserialize(const rapidjson::Document& jsonDocument) = 0;
+
+    /**
+     * Applies a frame that was merged from several frames.  Sensors that care about edges use
+     * the conflated tags to count the changes that the merge hid.
+     */
+    virtual bool deserialize(const rapidjson::Document& jsonDocument,
+                             const ConflatedTagMap& /* conflatedTags */) {
+        return deserialize(jsonDocument);
+    }
+
+    /**
+     * Applies the value of the sensor's own tag, as found by the factory's tag registry.  Only
+     * called for sensors that name their tag with getTag().
+     *
+     * @param value         Value of the tag in the frame
+     * @param conflatedTag  What the tag did across merged frames, or null
+     *
+     * @return true if the sensor received an update
+     */
+    virtual bool deserialize(const rapidjson::Value& /* value */, const ConflatedTag* /* conflatedTag */) {
+        return false;
+    }
+
+    virtual void notifyChange() = 0;
+
+    /**
+     * Wakes threads waiting on the sensor after its clock has been stopped.
+     */
+    virtual void notifyStop() {
+    }
+
+    /**
+     * Interned tag the sensor reads, or NO_TAG if it reads several.
+     */
+    virtual TagId getTag() const {
+        return TagNames::NO_TAG;
+    }
+
+    /**
+     * Name of the sensor's tag, for logs and metrics; empty if it reads several.
+     */
+    std::string getName() const {
+        const TagId tag = getTag();
+        return std::string(TagNames::getName(tag), TagNames::getLength(tag));
+    }
+
+    /**
+     * Value of the sensor as a number, with true as 1, for code that reads sensors without knowing
+     * their type, such as a RuleEngine.
+     */
+    virtual double getNumericValue() const {
+        return 0;
+    }
+
+    /**
+     * Value changes seen so far, for metrics and edge detection.
+     */
+    virtual uint64_t getChangeCount() const {
+        return 0;
+    }
 };
 
 #endif
-
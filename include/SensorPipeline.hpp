@@ -0,0 +1,180 @@
+/* 
+ * File:   SensorPipeline.hpp
+ *
+ * Optional three-stage pipeline for inbound sensor frames.
+ */
+
+#pragma once
+#ifndef SENSOR_PIPELINE_HPP
+#define SENSOR_PIPELINE_HPP
+
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include "rapidjson/document.h"
+#include "CacheAligned.hpp"
+#include "ProfiledMutex.hpp"
+#include "SensorDeserializer.hpp"
+#include "SpscRing.hpp"
+#include "TagNames.hpp"
+
+class Factory;
+
+/**
+ * Splits inbound sensor frame handling across three threads so that a slow stage never delays
+ * the next recv():
+ *   1) framing runs on the Communications receiver thread, which copies each frame into a
+ *      preallocated slot of the frame ring (submit)
+ *   2) a parser thread turns frame text into JSON documents held in the document ring
+ *   3) a dispatcher thread applies the documents to the factory's sensors and wakes waiters
+ *
+ * When a ring is full the stage feeding it waits, so backpressure reaches the socket only once
+ * the whole pipeline is saturated.
+ *
+ * With conflation enabled the dispatcher, whenever it finds more than one document queued, merges
+ * the whole backlog into a single frame holding the latest value of each tag and applies it in one
+ * pass.  Boolean tags keep their edge counts through the merge, so no pulse is lost.
+ */
+class SensorPipeline : public CacheAligned {
+public:
+
+    /**
+     * Counters for one stage.  Queue wait is the time a frame spent in the stage's input ring;
+     * service is the time the stage spent working on it.  The framing stage has no input ring; its
+     * stalls are the times it found the frame ring full.
+     */
+    struct StageStatistics {
+        uint64_t frames;
+        uint64_t totalQueueWaitNs;
+        uint64_t maxQueueWaitNs;
+        uint64_t totalServiceNs;
+        uint64_t maxServiceNs;
+        uint64_t stalls;
+        size_t   occupancy;         // Frames currently waiting in the stage's input ring
+        size_t   maxOccupancy;      // High-water mark of the input ring
+        size_t   capacity;          // Size of the input ring
+    };
+
+    /**
+     * Counters for conflation.  A merged frame is one that was folded into another instead of
+     * being dispatched on its own; a dropped value is a tag value overwritten by a later frame.
+     */
+    struct ConflationStatistics {
+        uint64_t passes;            // Dispatches of a merged backlog
+        uint64_t mergedFrames;
+        uint64_t droppedValues;
+        uint64_t preservedEdges;    // Boolean edges carried across a merge
+    };
+
+    struct Statistics {
+        StageStatistics      framing;
+        StageStatistics      parsing;
+        StageStatistics      dispatch;
+        ConflationStatistics conflation;
+    };
+
+    static const size_t DEFAULT_CAPACITY = 256;
+
+    SensorPipeline(Factory& factory, size_t capacity = DEFAULT_CAPACITY, bool conflation = false);
+    ~SensorPipeline();
+
+    /**
+     * Queues a frame for parsing, waiting for room if the ring is full.  Called by the receiver
+     * thread only.  A frame that finds the ring full once the pipeline is being destroyed is
+     * dropped, since nothing will drain the ring any more.
+     *
+     * @param frameText     JSON text of the frame
+     */
+    void submit(const std::string& frameText);
+
+    Statistics getStatistics() const;
+
+private:
+    typedef std::chrono::steady_clock SteadyClock;
+
+    struct MergedMember {
+        rapidjson::SizeType index;      // Position in the merged document
+        TagId               tag;        // Interned tag, or NO_TAG if no sensor has it
+    };
+
+    typedef std::unordered_map<std::string, MergedMember> MemberIndex;
+
+    struct FrameSlot {
+        std::string                 text;
+        SteadyClock::time_point     queuedTime;
+    };
+
+    struct DocumentSlot {
+        static const size_t BUFFER_SIZE = 16 * 1024;
+
+        DocumentSlot()
+        : allocator(buffer, BUFFER_SIZE), document(&allocator) {
+        }
+
+        char                                        buffer[BUFFER_SIZE];
+        rapidjson::MemoryPoolAllocator<>            allocator;
+        rapidjson::Document                         document;
+        SteadyClock::time_point                     queuedTime;
+    };
+
+    /**
+     * Lock-free counters for one stage, written only by the stage's own thread.
+     */
+    class StageCounters {
+    public:
+        StageCounters();
+        void record(SteadyClock::time_point queuedTime, SteadyClock::time_point startTime,
+                    SteadyClock::time_point endTime, size_t occupancy);
+        void recordStall();
+        StageStatistics get(size_t occupancy, size_t capacity) const;
+
+    private:
+        static void storeMax(std::atomic<uint64_t>& maximum, uint64_t value);
+
+        std::atomic<uint64_t> m_frames;
+        std::atomic<uint64_t> m_totalQueueWaitNs;
+        std::atomic<uint64_t> m_maxQueueWaitNs;
+        std::atomic<uint64_t> m_totalServiceNs;
+        std::atomic<uint64_t> m_maxServiceNs;
+        std::atomic<uint64_t> m_stalls;
+        std::atomic<uint64_t> m_maxOccupancy;
+    };
+
+    void parserThread();
+    void dispatcherThread();
+    void dispatchConflated(size_t frameCount);
+    static void increment(std::atomic<uint64_t>& counter, uint64_t amount);
+
+    static const size_t MERGE_BUFFER_SIZE = 64 * 1024;
+    template<typename Ready>
+    void backOff(uint32_t& idleCount, Ready ready);
+    void wakeParked();
+
+    Factory&                            m_factory;
+    SpscRing<FrameSlot>                 m_frameRing;
+    SpscRing<DocumentSlot>              m_documentRing;
+    StageCounters                       m_framingCounters;
+    StageCounters                       m_parsingCounters;
+    StageCounters                       m_dispatchCounters;
+    const bool                          m_conflation;
+    char                                m_mergedBuffer[MERGE_BUFFER_SIZE];
+    rapidjson::MemoryPoolAllocator<>    m_mergedAllocator;
+    rapidjson::Document                 m_mergedDocument;
+    MemberIndex                         m_mergedIndex;      // Tag name -> merged member
+    ConflatedTagMap                     m_conflatedTags;
+    std::atomic<uint64_t>               m_conflationPasses;
+    std::atomic<uint64_t>               m_mergedFrames;
+    std::atomic<uint64_t>               m_droppedValues;
+    std::atomic<uint64_t>               m_preservedEdges;
+    std::atomic<bool>                   m_running;
+    Mutex                               m_parkMutex;
+    ConditionVariable                   m_parkControl;      // Signalled when a ring moves
+    std::atomic<uint32_t>               m_parkedCount;      // Stages parked in backOff()
+    std::thread*                        m_parserThread;
+    std::thread*                        m_dispatcherThread;
+};
+
+#endif
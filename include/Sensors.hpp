@@ -3,11 +3,21 @@
 #define SENSORS_HPP
 
 #include <stdint.h>
+#include <algorithm>
+#include <atomic>
+#include <iterator>
 #include <mutex>
 #include <string>
-#include <condition_variable>
+#include <vector>
 #include "rapidjson/document.h"
+#include "Clock.hpp"
+#include "Executor.hpp"
+#include "Metrics.hpp"
+#include "ProfiledMutex.hpp"
+#include "TagNames.hpp"
+#include "Trace.hpp"
 #include "Station.hpp"
+#include "WaitStrategy.hpp"
 #include "SensorDeserializer.hpp"
 
 /**
@@ -29,50 +39,191 @@ public:
      * @param value     Sensor's default value
      */
     Sensor(Station& station, std::string name, T value)
-    : m_name(name), m_value(value), m_changed(false), m_mutex(), m_changeControl() {
+    : m_tag(TagNames::intern(station.getPrefix() + name)), m_value(value), m_changed(false), m_changeCount(0),
+      m_waiterCount(0), m_releasedCount(0), m_notifyTimeNs(0), m_wakeCount(0), m_continuations(),
+      m_releasedContinuations(), m_executor(nullptr), m_station(station), m_clock(station.getClock()), m_mutex(),
+      m_changeControl() {
+        nameLock(m_mutex, "sensor", TagNames::getName(m_tag));
         station.add(this);
     }
 
     /**
-     * Gets the name of the sensor.
-     *
-     * @return  The name of the sensor.
+     * Gets the interned tag of the sensor, which never changes.
      */
-    inline std::string getName() const {
-        std::lock_guard<std::mutex> scopedLock(m_mutex);
-        return m_name;
+    virtual TagId getTag() const {
+        return m_tag;
     }
 
     /**
      * Sets the value of the sensor with a new value if the new value is specified in the JSON
-     * document.
+     * document.  Waiting threads are not woken here; the factory calls notifyChange() once the
+     * whole frame has been applied.
      * 
      * @param jsonDocument  Contains new sensor values
      * 
      * @return true if the sensor received an update
      */
     virtual bool deserialize(const rapidjson::Document& jsonDocument) {
-        // If the document has a value for a sensor with this name and with the
-        // same type as the value, set the new value.
-        std::lock_guard<std::mutex> scopedLock(m_mutex);
-        if ((jsonDocument.HasMember(m_name.c_str())) && (jsonDocument[m_name.c_str()].Is<T>())) {
-            T value = jsonDocument[m_name.c_str()].Get<T>();
-            if (value != m_value) {
-                m_value = value;
-                m_changed = true;
-                m_changeControl.notify_all();
-                return true;
+        rapidjson::Value::ConstMemberIterator member = jsonDocument.FindMember(tagName());
+        return (member != jsonDocument.MemberEnd()) && deserialize(member->value, nullptr);
+    }
+
+    /**
+     * Sets the value of the sensor from a frame merged out of several frames.
+     *
+     * @param jsonDocument  Contains the latest value of each tag
+     * @param conflatedTags First value and edge count of the boolean tags that were merged
+     *
+     * @return true if the sensor received an update
+     */
+    virtual bool deserialize(const rapidjson::Document& jsonDocument,
+                             const ConflatedTagMap& conflatedTags) {
+        rapidjson::Value::ConstMemberIterator member = jsonDocument.FindMember(tagName());
+        if (member == jsonDocument.MemberEnd()) {
+            return false;
+        }
+        ConflatedTagMap::const_iterator conflatedTag = conflatedTags.find(m_tag);
+        return deserialize(member->value, (conflatedTag != conflatedTags.end()) ? &conflatedTag->second : nullptr);
+    }
+
+    /**
+     * Sets the value of the sensor if the tag's value has the sensor's type and differs from the
+     * current one.  Every edge of a merged boolean tag counts as a change, so a pulse that the
+     * merge flattened still wakes waiters and shows up in getChangeCount().
+     *
+     * @param value         Value of the sensor's tag
+     * @param conflatedTag  First value and edge count of the tag if it was merged, or null
+     *
+     * @return true if the sensor received an update
+     */
+    virtual bool deserialize(const rapidjson::Value& value, const ConflatedTag* conflatedTag) {
+        if (!value.Is<T>()) {
+            return false;
+        }
+        const T newValue = value.Get<T>();
+        std::lock_guard<Mutex> scopedLock(m_mutex);
+        uint32_t edgeCount = (newValue != m_value) ? 1 : 0;
+        if (conflatedTag != nullptr) {
+            edgeCount = std::max(leadingEdge(conflatedTag->firstValue, m_value) + conflatedTag->edgeCount, edgeCount);
+        }
+        if (edgeCount == 0) {
+            return false;
+        }
+        m_value = newValue;
+        m_changed = true;
+        m_changeCount += edgeCount;
+        releaseWaiters();
+        return true;
+    }
+
+    /**
+     * Wakes the threads blocked in waitForChange() and submits the tasks armed with
+     * resumeOnChange().  No wake-up is issued when nobody is waiting.
+     */
+    virtual void notifyChange() {
+        uint32_t releasedCount = 0;
+        uint64_t notifyTimeNs = 0;
+        std::vector<Executor::Task> continuations;
+        {
+            std::lock_guard<Mutex> scopedLock(m_mutex);
+            releasedCount = m_releasedCount;
+            m_releasedCount = 0;
+            m_notifyTimeNs = Metrics::nowNs();
+            notifyTimeNs = m_notifyTimeNs;
+            if (releasedCount > 0) {
+                m_wakeCount.store(m_wakeCount.load(std::memory_order_relaxed) + 1, std::memory_order_release);
             }
+            continuations.swap(m_releasedContinuations);
+        }
+        if (releasedCount > 0) {
+            m_clock.released(releasedCount);
+            m_changeControl.notify_all();
+        }
+        for (Executor::Task& continuation : continuations) {
+            Executor::Task task(std::move(continuation));
+            m_executor->submit([task, notifyTimeNs] {
+                Metrics::wakeLatency.record(Metrics::nowNs() - notifyTimeNs);
+                Trace::adoptFlow();
+                task();
+            });
         }
-        return false;
     }
 
+    /**
+     * Wakes the blocked threads so they can see the clock has stopped, and drops the armed tasks.
+     */
+    virtual void notifyStop() {
+        {
+            std::lock_guard<Mutex> scopedLock(m_mutex);
+            m_continuations.clear();
+            m_releasedContinuations.clear();
+        }
+        m_changeControl.notify_all();
+    }
+
+    virtual double getNumericValue() const {
+        return static_cast<double>(getValue());
+    }
+
+    /**
+     * Gets the number of value changes the sensor has seen, including pulses that were merged
+     * away when inbound frames were conflated.
+     */
+    virtual uint64_t getChangeCount() const {
+        std::lock_guard<Mutex> scopedLock(m_mutex);
+        return m_changeCount;
+    }
+
+    /**
+     * Blocks until the sensor's value changes.  Returns immediately if the value changed since the
+     * previous call, and throws Clock::Stopped if the clock is stopped first.  The station's
+     * WaitStrategy decides whether the thread spins before parking.
+     */
     void waitForChange() {
-        std::unique_lock<std::mutex> scopedLock(m_mutex);
+        std::unique_lock<Mutex> scopedLock(m_mutex);
         if (!m_changed) {
-            m_changeControl.wait(scopedLock);
+            TRACE_SCOPE("waitForChange");
+            const uint64_t changeCount = m_changeCount;
+            ++m_waiterCount;
+            m_clock.blocked();
+            const WaitStrategy waitStrategy = m_station.getWaitStrategy();
+            if (waitStrategy != WAIT_BLOCK) {
+                const uint64_t wakeCount = m_wakeCount.load(std::memory_order_relaxed);
+                scopedLock.unlock();
+                spinUntil(waitStrategy, [this, wakeCount] {
+                    return (m_wakeCount.load(std::memory_order_acquire) != wakeCount) || m_clock.isStopped();
+                });
+                scopedLock.lock();
+            }
+            m_changeControl.wait(scopedLock, [this, changeCount] {
+                return (m_changeCount != changeCount) || m_clock.isStopped();
+            });
+            if (m_changeCount == changeCount) {
+                throw Clock::Stopped();
+            }
+            Metrics::wakeLatency.record(Metrics::nowNs() - m_notifyTimeNs);
+            Trace::adoptFlow();
+        }
+        m_changed = false;
+    }
+
+    /**
+     * Runs task on the station's executor once the sensor's value changes, or straight away if it
+     * changed since the previous wait, like waitForChange() but without holding a thread while
+     * nothing happens.  The task runs once; a task that keeps reacting re-arms itself.
+     */
+    void resumeOnChange(Executor::Task task) {
+        Executor& executor = m_station.getExecutor();
+        {
+            std::lock_guard<Mutex> scopedLock(m_mutex);
+            if (!m_changed) {
+                m_executor = &executor;
+                m_continuations.push_back(std::move(task));
+                return;
+            }
             m_changed = false;
         }
+        executor.submit(std::move(task));
     }
     
 protected:
@@ -83,7 +234,7 @@ protected:
      * @return  The value of the sensor.
      */
     inline T getValue() const {
-        std::lock_guard<std::mutex> scopedLock(m_mutex);
+        std::lock_guard<Mutex> scopedLock(m_mutex);
         return m_value;
     }
 
@@ -93,16 +244,61 @@ protected:
      * @param value     Sensor's new value
      */
     inline void setValue(T value) {
-        std::lock_guard<std::mutex> scopedLock(m_mutex);
+        std::lock_guard<Mutex> scopedLock(m_mutex);
         m_value = value;
     }
     
 private:
-    std::string                     m_name;             // Name of the sensor
+
+    /**
+     * Every waiter is released by a change; they are handed to the clock as runnable again when
+     * notifyChange() wakes them.  Armed tasks take the change, as a woken waiter would.  Called
+     * with m_mutex held.
+     */
+    inline void releaseWaiters() {
+        m_releasedCount += m_waiterCount;
+        m_waiterCount = 0;
+        if (!m_continuations.empty()) {
+            m_releasedContinuations.insert(m_releasedContinuations.end(),
+                                           std::make_move_iterator(m_continuations.begin()),
+                                           std::make_move_iterator(m_continuations.end()));
+            m_continuations.clear();
+            m_changed = false;
+        }
+    }
+
+    /**
+     * The tag's name from the interner, as a string the frame can be searched for without
+     * measuring it.
+     */
+    rapidjson::Value tagName() const {
+        return rapidjson::Value(rapidjson::StringRef(TagNames::getName(m_tag), TagNames::getLength(m_tag)));
+    }
+
+    static uint32_t leadingEdge(bool firstValue, bool value) {
+        return (firstValue != value) ? 1 : 0;
+    }
+
+    template<typename U>
+    static uint32_t leadingEdge(bool /* firstValue */, const U& /* value */) {
+        return 0;
+    }
+
+    TagId                           m_tag;              // Interned name of the sensor
     T                               m_value;            // Value of the sensor
     bool                            m_changed;          // Used to report changed value
-    mutable std::mutex              m_mutex;            // Provides thread-safety for the class
-    mutable std::condition_variable m_changeControl;
+    uint64_t                        m_changeCount;      // Number of value changes received
+    uint32_t                        m_waiterCount;      // Waiters not yet released by a change
+    uint32_t                        m_releasedCount;    // Waiters released but not yet woken
+    uint64_t                        m_notifyTimeNs;     // When the last waiters were woken
+    std::atomic<uint64_t>           m_wakeCount;        // Wake-ups; spinning waiters poll it
+    std::vector<Executor::Task>     m_continuations;    // Tasks armed by resumeOnChange()
+    std::vector<Executor::Task>     m_releasedContinuations; // Released by a change, not yet submitted
+    Executor*                       m_executor;         // Runs the armed tasks
+    Station&                        m_station;          // Chooses the wait strategy
+    Clock&                          m_clock;            // Told when waiters block and are woken
+    mutable Mutex                   m_mutex;            // Provides thread-safety for the class
+    mutable ConditionVariable       m_changeControl;
 };
 
 /**
@@ -214,7 +410,7 @@ public:
     }
 
     inline bool bitSet(uint32_t bitPosition) {
-        return (getValue() & (1 << bitPosition) == bitPosition);
+        return (getValue() & (1u << bitPosition)) != 0;
     }
 };
 
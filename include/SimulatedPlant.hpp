@@ -0,0 +1,71 @@
+/*
+ * File:   SimulatedPlant.hpp
+ *
+ * In-process stand-in for the Factory IO connection.
+ */
+
+#pragma once
+#ifndef SIMULATED_PLANT_HPP
+#define SIMULATED_PLANT_HPP
+
+#include <stdint.h>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include "Clock.hpp"
+#include "FactoryScene.hpp"
+#include "Transport.hpp"
+
+/**
+ * Runs a scene in the same process as the controllers, stepped on the factory's clock.  Actuator
+ * frames are applied to the scene as soon as they are sent and sensor frames are handed straight
+ * to the factory, so nothing is ever in flight between the two; with a DiscreteEventClock the
+ * whole system therefore advances only when every controller thread is waiting.
+ */
+class SimulatedPlant : public Transport {
+public:
+
+    /**
+     * @param scene         Scene to run; the plant takes ownership
+     * @param frameRate     Scene steps (and sensor frames) per second of clock time
+     */
+    SimulatedPlant(FactoryScene* scene, double frameRate = 100.0);
+
+    /**
+     * Starts stepping the scene on the factory's clock.
+     */
+    virtual void connect(CommunicationsEventHandler& eventHandler, Clock& clock);
+
+    /**
+     * Waits for the stepper to finish once the clock has been stopped.
+     */
+    virtual void disconnect();
+
+    /**
+     * Handles a frame sent by the factory: a sensor data request or actuator values.
+     */
+    virtual void sendMessage(const std::string& text);
+
+    /**
+     * Runs a function on the scene with the scene locked, e.g. to read its statistics.
+     */
+    template<typename Function>
+    void inspect(Function function) {
+        std::lock_guard<std::mutex> scopedLock(m_mutex);
+        function(*m_scene);
+    }
+
+private:
+    void stepperThread();
+    void sendSensorValues(bool changedOnly);
+
+    std::unique_ptr<FactoryScene>   m_scene;
+    Clock::Duration                 m_period;
+    CommunicationsEventHandler*     m_eventHandler;
+    Clock*                          m_clock;
+    std::thread*                    m_stepperThread;
+    std::mutex                      m_mutex;        // Serializes access to the scene
+};
+
+#endif
@@ -8,35 +8,73 @@
 #ifndef SORTING_BY_WEIGHT_FACTORY_HPP
 #define SORTING_BY_WEIGHT_FACTORY_HPP
 
+#include <memory>
 #include <thread>
-#include "Parts.hpp"
 #include "Factory.hpp"
-#include "Sensors.hpp"
-#include "Station.hpp"
-#include "Actuators.hpp"
+#include "StaticStation.hpp"
+
+/**
+ * Tags of the sorting by weight scene.  The conveyor scale and the wheel sorter are spelled out
+ * as the tags their parts would name.
+ */
+struct SortingByWeightCell {
+    enum Input {
+        ENTRY_SENSOR,
+        SCALE_SENSOR,
+        SCALE_WEIGHT
+    };
+
+    enum Output {
+        EMITTER,
+        LEFT_REMOVER,
+        RIGHT_REMOVER,
+        BACK_REMOVER,
+        ENTRY_CONVEYOR,
+        BACK_CONVEYOR,
+        LEFT_CONVEYOR,
+        RIGHT_CONVEYOR,
+        SCALE_FORWARD,
+        SCALE_BACKWARD,
+        SORTER_FORWARD,
+        SORTER_LEFT,
+        SORTER_RIGHT
+    };
+
+    static constexpr StaticTag INPUTS[] = {
+        { TAG_BOOL,  "Entry Sensor" },
+        { TAG_BOOL,  "Scale Sensor" },
+        { TAG_FLOAT, "Conveyor Scale Weight" }
+    };
+
+    static constexpr StaticTag OUTPUTS[] = {
+        { TAG_BOOL, "Emitter" },
+        { TAG_BOOL, "Left Remover" },
+        { TAG_BOOL, "Right Remover" },
+        { TAG_BOOL, "Back Remover" },
+        { TAG_BOOL, "Entry Conveyor" },
+        { TAG_BOOL, "Back Conveyor" },
+        { TAG_BOOL, "Left Conveyor" },
+        { TAG_BOOL, "Right Conveyor" },
+        { TAG_BOOL, "Conveyor Scale Forward" },
+        { TAG_BOOL, "Conveyor Scale Backward" },
+        { TAG_BOOL, "Wheel Sorter Forward" },
+        { TAG_BOOL, "Wheel Sorter Left" },
+        { TAG_BOOL, "Wheel Sorter Right" }
+    };
+};
 
 class SortingByWeightFactory {
 public:
     SortingByWeightFactory(Factory& factory);
+    ~SortingByWeightFactory();
     void sortingManager();
     void waitUntilDone();
     
 private:
     Factory&              m_factory;
-    Station               m_station;
-    Emitter               m_emitter;
-    Remover               m_leftRemover;
-    Remover               m_rightRemover;
-    Remover               m_backRemover;
-    DigitalRollerConveyor m_entryConveyor;
-    DigitalRollerConveyor m_backConveyor;
-    DigitalRollerConveyor m_leftConveyor;
-    DigitalRollerConveyor m_rightConveyor;
-    ConveyorScale         m_conveyorScale;
-    PopUpWheelSorter      m_popUpWheelSorter;
-    RetroreflectiveSensor m_entrySensor;
-    DiffuseSensor         m_scaleSensor; 
-    std::thread          *m_managerThread;
+    Clock&                m_clock;
+    StaticStation<SortingByWeightCell> m_cell;
+    std::unique_ptr<std::thread> m_managerThread;
 };
 
 #endif 
@@ -0,0 +1,123 @@
+/* 
+ * File:   SpscRing.hpp
+ *
+ * Bounded lock-free ring connecting exactly one producer thread to exactly one consumer thread.
+ */
+
+#pragma once
+#ifndef SPSC_RING_HPP
+#define SPSC_RING_HPP
+
+#include <stddef.h>
+#include <atomic>
+
+/**
+ * Single-producer/single-consumer ring of preallocated slots.  Slots are constructed once and
+ * reused, so a slot type that keeps its buffers (a std::string, a rapidjson allocator) does not
+ * allocate in steady state.
+ *
+ * The producer claims the next free slot, fills it in place and publishes it; the consumer peeks
+ * at the oldest published slot, uses it in place and releases it.
+ *
+ * @param <T>   Slot type; must be default constructible
+ */
+template<typename T>
+class SpscRing {
+public:
+
+    /**
+     * @param capacity  Number of slots, rounded up to a power of two
+     */
+    SpscRing(size_t capacity)
+    : m_capacity(roundUpToPowerOfTwo(capacity)), m_mask(m_capacity - 1), m_slots(new T[m_capacity]),
+      m_head(0), m_tail(0) {
+    }
+
+    ~SpscRing() {
+        delete[] m_slots;
+    }
+
+    /**
+     * Producer side: returns the next free slot, or nullptr when the ring is full.
+     */
+    T* claim() {
+        const size_t tail = m_tail.load(std::memory_order_relaxed);
+        if (tail - m_head.load(std::memory_order_acquire) == m_capacity) {
+            return nullptr;
+        }
+        return &m_slots[tail & m_mask];
+    }
+
+    /**
+     * Producer side: makes the slot returned by claim() visible to the consumer.
+     */
+    void publish() {
+        m_tail.store(m_tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    /**
+     * Consumer side: returns the oldest published slot, or nullptr when the ring is empty.
+     */
+    T* front() {
+        const size_t head = m_head.load(std::memory_order_relaxed);
+        if (head == m_tail.load(std::memory_order_acquire)) {
+            return nullptr;
+        }
+        return &m_slots[head & m_mask];
+    }
+
+    /**
+     * Consumer side: returns the published slot at the given distance from the oldest one, or
+     * nullptr when fewer slots are published.  peek(0) is front().
+     */
+    T* peek(size_t index) {
+        const size_t head = m_head.load(std::memory_order_relaxed);
+        if (m_tail.load(std::memory_order_acquire) - head <= index) {
+            return nullptr;
+        }
+        return &m_slots[(head + index) & m_mask];
+    }
+
+    /**
+     * Consumer side: hands the oldest slots back to the producer.
+     *
+     * @param count     Number of slots to release
+     */
+    void release(size_t count = 1) {
+        m_head.store(m_head.load(std::memory_order_relaxed) + count, std::memory_order_release);
+    }
+
+    /**
+     * Number of published slots not yet released.  Exact only when called from the producer or
+     * the consumer; an approximation from any other thread.
+     */
+    size_t size() const {
+        return m_tail.load(std::memory_order_acquire) - m_head.load(std::memory_order_acquire);
+    }
+
+    size_t capacity() const {
+        return m_capacity;
+    }
+
+private:
+    SpscRing(const SpscRing&);
+    SpscRing& operator=(const SpscRing&);
+
+    static size_t roundUpToPowerOfTwo(size_t value) {
+        size_t power = 1;
+        while (power < value) {
+            power <<= 1;
+        }
+        return power;
+    }
+
+    static const size_t CACHE_LINE_SIZE = 64;
+
+    const size_t                        m_capacity;
+    const size_t                        m_mask;
+    T*                                  m_slots;
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> m_head;    // Next slot to consume
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> m_tail;    // Next slot to produce
+};
+
+#endif
@@ -0,0 +1,453 @@
+/*
+ * File:   StaticStation.hpp
+ *
+ * Stations whose tags are fixed at compile time, with typed values and static dispatch tables.
+ */
+
+#pragma once
+#ifndef STATIC_STATION_HPP
+#define STATIC_STATION_HPP
+
+#include <stdint.h>
+#include <string.h>
+#include <mutex>
+#include <string>
+#include <tuple>
+#include "rapidjson/document.h"
+#include "ActuatorSerializer.hpp"
+#include "Factory.hpp"
+#include "ProfiledMutex.hpp"
+#include "SensorDeserializer.hpp"
+#include "Station.hpp"
+#include "TagNames.hpp"
+
+enum StaticTagType {
+    TAG_BOOL,
+    TAG_INT,
+    TAG_UINT,
+    TAG_FLOAT
+};
+
+/**
+ * A tag of a static station's layout: its type and its name within the station's prefix.
+ */
+struct StaticTag {
+    StaticTagType   type;
+    const char*     name;
+};
+
+template<StaticTagType TYPE> struct StaticTagValue;
+template<> struct StaticTagValue<TAG_BOOL>  { typedef bool     Type; };
+template<> struct StaticTagValue<TAG_INT>   { typedef int32_t  Type; };
+template<> struct StaticTagValue<TAG_UINT>  { typedef uint32_t Type; };
+template<> struct StaticTagValue<TAG_FLOAT> { typedef float    Type; };
+
+/**
+ * The list 0 .. N - 1, which the station's tables are expanded over.  It is built by halves so
+ * that the slot table of a large layout stays within the compiler's template depth.
+ */
+template<uint32_t... I> struct StaticIndices {
+};
+
+template<typename First, typename Second> struct StaticIndicesConcat;
+
+template<uint32_t... First, uint32_t... Second>
+struct StaticIndicesConcat<StaticIndices<First...>, StaticIndices<Second...>> {
+    typedef StaticIndices<First..., (sizeof...(First) + Second)...> Type;
+};
+
+template<uint32_t N> struct MakeStaticIndices {
+    typedef typename StaticIndicesConcat<typename MakeStaticIndices<N / 2>::Type,
+                                         typename MakeStaticIndices<N - N / 2>::Type>::Type Type;
+};
+
+template<> struct MakeStaticIndices<0> {
+    typedef StaticIndices<> Type;
+};
+
+template<> struct MakeStaticIndices<1> {
+    typedef StaticIndices<0> Type;
+};
+
+/**
+ * Perfect hash of a layout's input names, searched for by the compiler: FNV-1a with a seeded
+ * offset basis, whose top bits index a table of at least count² slots, so that a seed without
+ * collisions turns up within the first few tried.  The functions are single expressions because
+ * C++11 allows nothing else in a constexpr function.
+ */
+struct StaticHash {
+    static constexpr uint32_t FNV_OFFSET_BASIS = 2166136261u;
+    static constexpr uint32_t FNV_PRIME = 16777619u;
+    static constexpr uint32_t SEED_MULTIPLIER = 0x9e3779b9u;
+    static constexpr uint32_t MAX_SEED = 64;        // Seeds tried before the layout is rejected
+
+    static constexpr uint32_t hash(const char* name, uint32_t seed) {
+        return hashFrom(name, FNV_OFFSET_BASIS ^ (seed * SEED_MULTIPLIER));
+    }
+
+    /**
+     * The same hash of a name that is not null-terminated, for the frame's tags.
+     */
+    static uint32_t hash(const char* name, size_t length, uint32_t seed) {
+        uint32_t value = FNV_OFFSET_BASIS ^ (seed * SEED_MULTIPLIER);
+        for (size_t index = 0; index < length; ++index) {
+            value = (value ^ static_cast<uint8_t>(name[index])) * FNV_PRIME;
+        }
+        return value;
+    }
+
+    static constexpr uint32_t slot(uint32_t hashValue, uint32_t slotBits) {
+        return hashValue >> (32 - slotBits);
+    }
+
+    static constexpr uint32_t slotBits(uint32_t count, uint32_t bits = 3) {
+        return ((1u << bits) >= count * count) ? bits : slotBits(count, bits + 1);
+    }
+
+    static constexpr uint32_t findSeed(const StaticTag* tags, uint32_t count, uint32_t slotBits, uint32_t seed = 0) {
+        return (seed >= MAX_SEED) ? MAX_SEED
+             : !anyCollision(tags, count, slotBits, seed, 0) ? seed
+             : findSeed(tags, count, slotBits, seed + 1);
+    }
+
+    /**
+     * Entry of the slot table: one more than the index of the input that hashes to the slot, or 0.
+     */
+    static constexpr uint8_t slotEntry(const StaticTag* tags, uint32_t count, uint32_t slotBits, uint32_t seed,
+                                       uint32_t slotIndex, uint32_t index = 0) {
+        return (index >= count) ? 0
+             : (slot(hash(tags[index].name, seed), slotBits) == slotIndex) ? static_cast<uint8_t>(index + 1)
+             : slotEntry(tags, count, slotBits, seed, slotIndex, index + 1);
+    }
+
+private:
+    static constexpr uint32_t hashFrom(const char* name, uint32_t value) {
+        return (*name == '\0') ? value : hashFrom(name + 1, (value ^ static_cast<uint8_t>(*name)) * FNV_PRIME);
+    }
+
+    static constexpr bool collidesWith(const StaticTag* tags, uint32_t count, uint32_t slotBits, uint32_t seed,
+                                       uint32_t first, uint32_t second) {
+        return (second < count) &&
+               ((slot(hash(tags[first].name, seed), slotBits) == slot(hash(tags[second].name, seed), slotBits)) ||
+                collidesWith(tags, count, slotBits, seed, first, second + 1));
+    }
+
+    static constexpr bool anyCollision(const StaticTag* tags, uint32_t count, uint32_t slotBits, uint32_t seed,
+                                       uint32_t first) {
+        return (first < count) &&
+               (collidesWith(tags, count, slotBits, seed, first, first + 1) ||
+                anyCollision(tags, count, slotBits, seed, first + 1));
+    }
+};
+
+template<typename Station, typename Indices> struct StaticInputTable;
+template<typename Station, typename Indices> struct StaticOutputTable;
+template<typename Station, typename Indices> struct StaticSlotTable;
+
+/**
+ * A station whose tags are declared at compile time by a layout:
+ *
+ *     struct Cell {
+ *         enum Input { AT_ENTRY, WEIGHT };
+ *         enum Output { EMITTER, CONVEYOR };
+ *         static constexpr StaticTag INPUTS[] = { { TAG_BOOL, "At Entry" }, { TAG_FLOAT, "Weight" } };
+ *         static constexpr StaticTag OUTPUTS[] = { { TAG_BOOL, "Emitter" }, { TAG_BOOL, "Conveyor" } };
+ *     };
+ *
+ *     StaticStation<Cell> cell(factory);
+ *     cell.set<Cell::EMITTER>(cell.get<Cell::WEIGHT>() < 5);
+ *
+ * The enums give the position of each tag in its array, and every value is kept in a tuple of its
+ * tag's type, so get() and set() compile to a field access.  The station registers with the
+ * factory as one sensor that reads the whole frame and one actuator that writes all of its
+ * outputs: a frame's tags are found with a perfect hash of the input names that the compiler
+ * builds, and decoded by a table of functions instantiated for each input's type, and a flush
+ * encodes the changed outputs the same way.  No tag goes through the factory's registry or a
+ * virtual call of its own.  A layout with duplicate input names does not compile.
+ *
+ * Because the station reads every frame in full, it suits a cell that has the connection to
+ * itself or shares it with a few others; many prefixed copies of a cell on one connection are
+ * better off as Stations, whose tags the factory indexes.  Threads wait on the station as a whole.
+ */
+template<typename Layout>
+class StaticStation : public SensorDeserializer, public ActuatorSerializer {
+public:
+    static constexpr uint32_t INPUT_COUNT = sizeof(Layout::INPUTS) / sizeof(StaticTag);
+    static constexpr uint32_t OUTPUT_COUNT = sizeof(Layout::OUTPUTS) / sizeof(StaticTag);
+    static constexpr uint32_t SLOT_BITS = StaticHash::slotBits(INPUT_COUNT);
+    static constexpr uint32_t SEED = StaticHash::findSeed(Layout::INPUTS, INPUT_COUNT, SLOT_BITS);
+
+    static_assert(INPUT_COUNT <= 64, "A static station has at most 64 inputs");
+    static_assert(OUTPUT_COUNT <= 64, "A static station has at most 64 outputs");
+    static_assert(SEED < StaticHash::MAX_SEED, "The input names of a static station must be distinct");
+
+    template<uint32_t I>
+    struct Input {
+        typedef typename StaticTagValue<Layout::INPUTS[I].type>::Type Type;
+    };
+
+    template<uint32_t I>
+    struct Output {
+        typedef typename StaticTagValue<Layout::OUTPUTS[I].type>::Type Type;
+    };
+
+    /**
+     * Registers the station with the factory.  Values start at false or 0, and every output is
+     * sent by the first flush, as with Actuator.
+     */
+    explicit StaticStation(Factory& factory, std::string prefix = "")
+    : m_station(factory, prefix), m_inputs(), m_outputs(), m_changedOutputs(ALL_OUTPUTS), m_inputTags(),
+      m_outputTags(), m_mutex() {
+        nameLock(m_mutex, "static station", prefix);
+        for (uint32_t index = 0; index < INPUT_COUNT; ++index) {
+            m_inputTags[index] = TagNames::intern(m_station.getPrefix() + getInputName(index));
+        }
+        for (uint32_t index = 0; index < OUTPUT_COUNT; ++index) {
+            m_outputTags[index] = TagNames::intern(m_station.getPrefix() + getOutputName(index));
+        }
+        m_station.add(static_cast<SensorDeserializer*>(this));
+        m_station.add(static_cast<ActuatorSerializer*>(this));
+    }
+
+    template<uint32_t I>
+    typename Input<I>::Type get() const {
+        std::lock_guard<Mutex> scopedLock(m_mutex);
+        return std::get<I>(m_inputs);
+    }
+
+    /**
+     * Sets an output, which the next applyChanges() sends if the value changed.
+     */
+    template<uint32_t I>
+    void set(typename Output<I>::Type value) {
+        std::lock_guard<Mutex> scopedLock(m_mutex);
+        if (value != std::get<I>(m_outputs)) {
+            std::get<I>(m_outputs) = value;
+            m_changedOutputs |= 1ull << I;
+        }
+    }
+
+    void applyChanges() {
+        m_station.applyChanges();
+    }
+
+    /**
+     * Blocks until a frame changes one of the inputs, or throws Clock::Stopped.
+     */
+    void waitForSensorChange() {
+        m_station.waitForSensorChange();
+    }
+
+    Station& getStation() {
+        return m_station;
+    }
+
+    static const char* getInputName(uint32_t index) {
+        return InputTable::NAMES[index];
+    }
+
+    static const char* getOutputName(uint32_t index) {
+        return OutputTable::NAMES[index];
+    }
+
+    /**
+     * Finds an input by its name within the prefix: one hash, one table load and one comparison.
+     *
+     * @return the index of the input, or -1
+     */
+    static int32_t findInput(const char* name, size_t length) {
+        const uint32_t entry = SlotTable::SLOTS[StaticHash::slot(StaticHash::hash(name, length, SEED), SLOT_BITS)];
+        if (entry == 0) {
+            return -1;
+        }
+        const char* inputName = InputTable::NAMES[entry - 1];
+        return ((strncmp(inputName, name, length) == 0) && (inputName[length] == '\0'))
+             ? static_cast<int32_t>(entry - 1) : -1;
+    }
+
+    virtual bool deserialize(const rapidjson::Document& jsonDocument) {
+        return decodeFrame(jsonDocument, nullptr);
+    }
+
+    virtual bool deserialize(const rapidjson::Document& jsonDocument, const ConflatedTagMap& conflatedTags) {
+        return decodeFrame(jsonDocument, &conflatedTags);
+    }
+
+    /**
+     * Waiters are woken through the station, which the factory notifies.
+     */
+    virtual void notifyChange() {
+    }
+
+    /**
+     * Adds the changed outputs to a frame, or all of them.
+     */
+    virtual void serialize(rapidjson::Document& jsonDocument, bool onlyIfChanged) {
+        std::lock_guard<Mutex> scopedLock(m_mutex);
+        uint64_t outputs = ALL_OUTPUTS;
+        if (onlyIfChanged) {
+            outputs = m_changedOutputs;
+        }
+        m_changedOutputs = 0;
+        while (outputs != 0) {
+            (this->*OutputTable::ENCODERS[__builtin_ctzll(outputs)])(jsonDocument);
+            outputs &= outputs - 1;
+        }
+    }
+
+private:
+    typedef bool (StaticStation::*Decoder)(const rapidjson::Value& value, const ConflatedTag* conflatedTag);
+    typedef void (StaticStation::*Encoder)(rapidjson::Document& jsonDocument);
+    typedef StaticInputTable<StaticStation, typename MakeStaticIndices<INPUT_COUNT>::Type> InputTable;
+    typedef StaticOutputTable<StaticStation, typename MakeStaticIndices<OUTPUT_COUNT>::Type> OutputTable;
+    typedef StaticSlotTable<StaticStation, typename MakeStaticIndices<(1u << SLOT_BITS)>::Type> SlotTable;
+
+    template<typename, typename> friend struct StaticInputTable;
+    template<typename, typename> friend struct StaticOutputTable;
+    template<typename, typename> friend struct StaticSlotTable;
+
+    template<typename Indices> struct InputValues;
+    template<typename Indices> struct OutputValues;
+
+    template<uint32_t... I>
+    struct InputValues<StaticIndices<I...>> {
+        typedef std::tuple<typename Input<I>::Type...> Type;
+    };
+
+    template<uint32_t... I>
+    struct OutputValues<StaticIndices<I...>> {
+        typedef std::tuple<typename Output<I>::Type...> Type;
+    };
+
+    typedef typename InputValues<typename MakeStaticIndices<INPUT_COUNT>::Type>::Type InputTuple;
+    typedef typename OutputValues<typename MakeStaticIndices<OUTPUT_COUNT>::Type>::Type OutputTuple;
+
+    static constexpr uint64_t ALL_OUTPUTS = (OUTPUT_COUNT == 64) ? ~0ull : ((1ull << OUTPUT_COUNT) - 1);
+
+    bool decodeFrame(const rapidjson::Document& jsonDocument, const ConflatedTagMap* conflatedTags) {
+        if (!jsonDocument.IsObject()) {
+            return false;
+        }
+        const std::string& prefix = m_station.getPrefix();
+        bool changed = false;
+        std::lock_guard<Mutex> scopedLock(m_mutex);
+        for (rapidjson::Value::ConstMemberIterator member = jsonDocument.MemberBegin();
+             member != jsonDocument.MemberEnd(); ++member) {
+            const char* name = member->name.GetString();
+            const size_t length = member->name.GetStringLength();
+            if ((length <= prefix.size()) || (memcmp(name, prefix.data(), prefix.size()) != 0)) {
+                continue;
+            }
+            const int32_t input = findInput(name + prefix.size(), length - prefix.size());
+            if (input < 0) {
+                continue;
+            }
+            const ConflatedTag* conflatedTag = nullptr;
+            if (conflatedTags != nullptr) {
+                ConflatedTagMap::const_iterator conflated = conflatedTags->find(m_inputTags[input]);
+                conflatedTag = (conflated != conflatedTags->end()) ? &conflated->second : nullptr;
+            }
+            if ((this->*InputTable::DECODERS[input])(member->value, conflatedTag)) {
+                changed = true;
+            }
+        }
+        return changed;
+    }
+
+    /**
+     * Applies the value of input I if it has the input's type.  A merged tag that changed and
+     * changed back still counts as a change.  Called with m_mutex held.
+     */
+    template<uint32_t I>
+    bool decode(const rapidjson::Value& value, const ConflatedTag* conflatedTag) {
+        typedef typename Input<I>::Type Type;
+        if (!value.Is<Type>()) {
+            return false;
+        }
+        const Type newValue = value.Get<Type>();
+        Type& currentValue = std::get<I>(m_inputs);
+        const bool changed = (newValue != currentValue) || ((conflatedTag != nullptr) && (conflatedTag->edgeCount > 0));
+        currentValue = newValue;
+        return changed;
+    }
+
+    /**
+     * Adds output I to a frame, replacing the value it added to the same frame before.  Called with
+     * m_mutex held.
+     */
+    template<uint32_t I>
+    void encode(rapidjson::Document& jsonDocument) {
+        rapidjson::GenericStringRef<char> name(TagNames::getName(m_outputTags[I]),
+                                               TagNames::getLength(m_outputTags[I]));
+        rapidjson::Value::MemberIterator member = jsonDocument.FindMember(rapidjson::Value(name));
+        if (member != jsonDocument.MemberEnd()) {
+            member->value = std::get<I>(m_outputs);
+        }
+        else {
+            jsonDocument.AddMember(name, std::get<I>(m_outputs), jsonDocument.GetAllocator());
+        }
+    }
+
+    static constexpr const char* inputName(uint32_t index) {
+        return Layout::INPUTS[index].name;
+    }
+
+    static constexpr const char* outputName(uint32_t index) {
+        return Layout::OUTPUTS[index].name;
+    }
+
+    static constexpr uint8_t slotEntry(uint32_t slotIndex) {
+        return StaticHash::slotEntry(Layout::INPUTS, INPUT_COUNT, SLOT_BITS, SEED, slotIndex);
+    }
+
+    Station                 m_station;
+    InputTuple              m_inputs;
+    OutputTuple             m_outputs;
+    uint64_t                m_changedOutputs;               // Bit per output not yet sent
+    TagId                   m_inputTags[INPUT_COUNT];       // Interned with the prefix, for conflated frames
+    TagId                   m_outputTags[OUTPUT_COUNT];     // Interned with the prefix
+    mutable Mutex           m_mutex;                        // Guards the values
+};
+
+/**
+ * Names and decoders of a static station's inputs, in layout order.
+ */
+template<typename Station, uint32_t... I>
+struct StaticInputTable<Station, StaticIndices<I...>> {
+    static constexpr const char* NAMES[] = { Station::inputName(I)... };
+    static constexpr typename Station::Decoder DECODERS[] = { &Station::template decode<I>... };
+};
+
+template<typename Station, uint32_t... I>
+constexpr const char* StaticInputTable<Station, StaticIndices<I...>>::NAMES[];
+
+template<typename Station, uint32_t... I>
+constexpr typename Station::Decoder StaticInputTable<Station, StaticIndices<I...>>::DECODERS[];
+
+/**
+ * Names and encoders of a static station's outputs, in layout order.
+ */
+template<typename Station, uint32_t... I>
+struct StaticOutputTable<Station, StaticIndices<I...>> {
+    static constexpr const char* NAMES[] = { Station::outputName(I)... };
+    static constexpr typename Station::Encoder ENCODERS[] = { &Station::template encode<I>... };
+};
+
+template<typename Station, uint32_t... I>
+constexpr const char* StaticOutputTable<Station, StaticIndices<I...>>::NAMES[];
+
+template<typename Station, uint32_t... I>
+constexpr typename Station::Encoder StaticOutputTable<Station, StaticIndices<I...>>::ENCODERS[];
+
+/**
+ * Perfect hash slots of a static station's inputs.
+ */
+template<typename Station, uint32_t... S>
+struct StaticSlotTable<Station, StaticIndices<S...>> {
+    static constexpr uint8_t SLOTS[] = { Station::slotEntry(S)... };
+};
+
+template<typename Station, uint32_t... S>
+constexpr uint8_t StaticSlotTable<Station, StaticIndices<S...>>::SLOTS[];
+
+#endif
@@ -1,4 +1,4 @@
-/* 
+/*
  * File:   Station.hpp
  * Author: Nicole
  *
@@ -8,41 +8,97 @@
 #ifndef STATION_HPP
 #define STATION_HPP
 
+#include <stdint.h>
+#include <atomic>
+#include <string>
 #include "Factory.hpp"
+#include "ProfiledMutex.hpp"
+#include "WaitStrategy.hpp"
 #include "ActuatorSerializer.hpp"
 #include "SensorDeserializer.hpp"
 
+/**
+ * A group of parts driven together.  Several stations can share one factory connection: each
+ * station's parts are named within its prefix ("Station 2 " turns "Emitter" into the tag
+ * "Station 2 Emitter"), a frame wakes only the stations whose sensors it changed, and each station
+ * flushes only its own actuators, which the factory merges with the other stations' changes into
+ * as few outbound frames as it can.
+ */
 class Station {
 public:
-    Station(Factory& factory)
-    :  m_factory(factory), m_actuatorList(), m_mutex() {
-    }
-    
+    explicit Station(Factory& factory, std::string prefix = "");
+
     void add(ActuatorSerializer* actuatorSerializer) {
-        std::lock_guard<std::mutex> scopedLock(m_mutex);
+        std::lock_guard<Mutex> scopedLock(m_mutex);
         m_actuatorList.push_back(actuatorSerializer);
     }
-    
+
     void add(SensorDeserializer* sensorDeserializer) {
-        m_factory.add(sensorDeserializer);
-//        std::lock_guard<std::mutex> scopedLock(m_mutex);
-//        m_sensorList.push_back(sensorDeserializer);
+        m_factory.add(sensorDeserializer, this);
+    }
+
+    void add(RuleEngine* ruleEngine) {
+        m_factory.add(ruleEngine);
     }
+
     void applyChanges() {
-        std::lock_guard<std::mutex> scopedLock(m_mutex);
+        std::lock_guard<Mutex> scopedLock(m_mutex);
         m_factory.applyChanges(m_actuatorList);
     }
-    
-    void waitForSensorChange() {
-        m_factory.waitForSensorChange();
+
+    /**
+     * Blocks until a frame changes one of the station's sensors, or throws Clock::Stopped if the
+     * clock is stopped first.  Changes to other stations' sensors do not wake the station.
+     */
+    void waitForSensorChange();
+
+    /**
+     * Selects how the station's threads wait, on its sensors and on the station.
+     */
+    void setWaitStrategy(WaitStrategy waitStrategy) {
+        m_waitStrategy.store(waitStrategy, std::memory_order_relaxed);
+    }
+
+    WaitStrategy getWaitStrategy() const {
+        return m_waitStrategy.load(std::memory_order_relaxed);
     }
+
+    /**
+     * Prefix of the tag names of the station's parts.
+     */
+    const std::string& getPrefix() const {
+        return m_prefix;
+    }
+
+    Clock& getClock() {
+        return m_factory.getClock();
+    }
+
+    /**
+     * Executor that runs the station's tasks; shared by every station of the factory.
+     */
+    Executor& getExecutor() {
+        return m_factory.getExecutor();
+    }
+
 private:
+    friend class Factory;
+
+    void notifyChange();
+    void notifyStop();
+
     Factory&                       m_factory;
+    std::string                    m_prefix;
     std::list<ActuatorSerializer*> m_actuatorList;
-//    std::list<SensorDeserializer*> m_sensorList;
-    std::mutex                     m_mutex;
-    
+    Mutex                          m_mutex;
+    std::atomic<WaitStrategy>      m_waitStrategy;
+    Mutex                          m_waitMutex;
+    ConditionVariable              m_changeControl;
+    uint64_t                       m_changeCount;          // Frames that changed one of the sensors
+    std::atomic<uint64_t>          m_publishedChangeCount; // Copy that spinning waiters poll
+    uint32_t                       m_waiterCount;          // Waiters not yet released by a change
+    uint64_t                       m_notifyTimeNs;         // When the last waiters were woken
+    uint64_t                       m_dispatchCount;        // Factory's last dispatch to change a sensor
 };
 
-#endif 
-
+#endif
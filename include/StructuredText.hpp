@@ -0,0 +1,56 @@
+/*
+ * File:   StructuredText.hpp
+ *
+ * Compiler from a subset of IEC 61131-3 structured text to ControlProgram bytecode.
+ */
+
+#pragma once
+#ifndef STRUCTURED_TEXT_HPP
+#define STRUCTURED_TEXT_HPP
+
+#include <string>
+#include "ControlProgram.hpp"
+
+/**
+ * Compiles one program written in this subset of structured text:
+ *
+ *     PROGRAM Conveyor
+ *     VAR_INPUT
+ *         atEntry AT "At Entry" : BOOL;
+ *     END_VAR
+ *     VAR_OUTPUT
+ *         emitter AT "Emitter" : BOOL := TRUE;
+ *     END_VAR
+ *     VAR
+ *         boxes : INT;
+ *     END_VAR
+ *     IF R_TRIG(atEntry) THEN
+ *         boxes := boxes + 1;
+ *     END_IF;
+ *     END_PROGRAM
+ *
+ * Inputs and outputs name a tag of the station the program is loaded for with AT.  The types are
+ * BOOL, INT, REAL and TIME (milliseconds, written T#500ms, T#2s, T#1m or T#1h).  Statements are
+ * assignments and IF / ELSIF / ELSE; there are no loops, so a scan always ends.  Expressions
+ * have the usual operators (OR, XOR, AND or &, NOT, =, <>, <, <=, >, >=, +, -, *, /, MOD) and
+ * the calls R_TRIG(in), F_TRIG(in) and TON(in, preset), each call keeping its own state.
+ * Keywords and names are case-insensitive, and comments are (* ... *) or // to the end of the
+ * line.
+ */
+class StructuredText {
+public:
+
+    /**
+     * Compiles source into program.  Errors are logged with the source name and line.
+     *
+     * @return true if the program compiled
+     */
+    static bool compile(const std::string& source, const std::string& sourceName, ControlProgram& program);
+
+    /**
+     * Compiles the file at path.
+     */
+    static bool compileFile(const std::string& path, ControlProgram& program);
+};
+
+#endif
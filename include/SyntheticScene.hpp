@@ -0,0 +1,53 @@
+/* 
+ * File:   SyntheticScene.hpp
+ *
+ * Scene that streams synthetic boolean sensor tags for load testing.
+ */
+
+#pragma once
+#ifndef SYNTHETIC_SCENE_HPP
+#define SYNTHETIC_SCENE_HPP
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "FactoryScene.hpp"
+
+/**
+ * A set of boolean sensor tags, some of which are toggled on every step, walking round-robin over
+ * the whole set.  Actuator frames are counted and otherwise ignored.
+ */
+class SyntheticScene : public FactoryScene {
+public:
+
+    /**
+     * @param tagCount      Number of sensor tags, named prefix + index
+     * @param tagsPerStep   Number of tags toggled on every step
+     * @param prefix        Prefix of the tag names
+     */
+    SyntheticScene(uint32_t tagCount, uint32_t tagsPerStep, std::string prefix = "Sensor ");
+
+    /**
+     * @param tagNames      Names of the sensor tags
+     * @param tagsPerStep   Number of tags toggled on every step
+     */
+    SyntheticScene(const std::vector<std::string>& tagNames, uint32_t tagsPerStep);
+
+    virtual void applyActuatorValues(const rapidjson::Document& frame);
+    virtual void step(double elapsedSeconds);
+    virtual bool getSensorValues(rapidjson::Document& frame, bool changedOnly);
+
+    uint64_t getActuatorFrameCount() const {
+        return m_actuatorFrameCount;
+    }
+
+private:
+    std::vector<std::string>    m_tagNames;
+    std::vector<bool>           m_values;
+    std::vector<bool>           m_changed;
+    uint32_t                    m_tagsPerStep;
+    uint32_t                    m_nextTag;
+    uint64_t                    m_actuatorFrameCount;
+};
+
+#endif
@@ -0,0 +1,59 @@
+/*
+ * File:   TagNames.hpp
+ *
+ * Process-wide interning of tag names into dense integer ids.
+ */
+
+#pragma once
+#ifndef TAG_NAMES_HPP
+#define TAG_NAMES_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+typedef uint32_t TagId;
+
+/**
+ * Gives every distinct tag name a dense id, from 0 in the order the names are first seen, and
+ * keeps each name once, null-terminated, in an arena that lives as long as the process.  Sensors
+ * and actuators hold the id of their tag, the factory indexes its sensors by id, and the name
+ * only comes back out for the wire, logs and metric labels, as a pointer that never moves.
+ *
+ * find() and getName() take no lock: ids are looked up in an open-addressed table that is
+ * replaced, never changed in place, when it grows, and names are published before their ids.
+ * Only intern() takes a lock, and only to add a name.  Names are never removed.
+ */
+class TagNames {
+public:
+    static const TagId NO_TAG = UINT32_MAX;
+
+    /**
+     * Returns the id of a name, adding the name if it is new.
+     */
+    static TagId intern(const char* name, size_t length);
+
+    static TagId intern(const std::string& name) {
+        return intern(name.data(), name.size());
+    }
+
+    /**
+     * Returns the id of a name, or NO_TAG if it was never interned, which means no sensor or
+     * actuator has that tag.
+     */
+    static TagId find(const char* name, size_t length);
+
+    /**
+     * Null-terminated name of an interned tag, valid for the rest of the process.
+     */
+    static const char* getName(TagId tag);
+
+    static uint32_t getLength(TagId tag);
+
+    /**
+     * Number of names interned so far; every id is below it.
+     */
+    static uint32_t getCount();
+};
+
+#endif
@@ -0,0 +1,75 @@
+/*
+ * File:   ThreadProfile.hpp
+ *
+ * CPU affinity, real-time priority and memory locking for the threads on the control path.
+ */
+
+#pragma once
+#ifndef THREAD_PROFILE_HPP
+#define THREAD_PROFILE_HPP
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+/**
+ * Where and at what priority each kind of thread runs.  The profile is configured once, before
+ * the factory and its controllers start, and each thread applies the settings of its role as the
+ * first thing it does:
+ *   receiver     Communications receiver or replay thread, and the SensorPipeline threads
+ *   controller   the manager threads of the controllers and the Executor workers
+ *   writer       the WireCapture writer
+ *
+ * A role can be pinned to a set of CPUs and run SCHED_FIFO at a priority; its threads prefault
+ * their stack so the first deep call does not page fault.  lockMemory() keeps every page of the
+ * process resident.  Settings that need a capability the process lacks (CAP_SYS_NICE for real-time
+ * priorities, CAP_IPC_LOCK or a high RLIMIT_MEMLOCK for mlockall) are skipped with a warning, and
+ * the thread carries on with the default policy.
+ */
+class ThreadProfile {
+public:
+    enum Role {
+        ROLE_RECEIVER,
+        ROLE_CONTROLLER,
+        ROLE_WRITER,
+        ROLE_COUNT
+    };
+
+    struct Settings {
+        Settings()
+        : configured(false), cpus(), priority(0) {
+        }
+
+        bool                configured;
+        std::vector<int>    cpus;           // Empty for any CPU
+        int                 priority;       // SCHED_FIFO priority, or 0 for the default policy
+    };
+
+    static void configure(Role role, const Settings& settings);
+
+    /**
+     * Configures roles from a specification such as "receiver:2:80,controller:3:70,writer:0-1:0",
+     * each entry a role, a CPU list ("2", "0-1", "1+3" or "*") and a SCHED_FIFO priority.
+     *
+     * @return false if the specification is malformed; nothing is configured then
+     */
+    static bool configure(const std::string& specification);
+
+    /**
+     * Locks all current and future pages of the process into memory.
+     *
+     * @return true if the pages are locked
+     */
+    static bool lockMemory();
+
+    /**
+     * Applies the settings of a role to the calling thread; does nothing for a role that was not
+     * configured.
+     */
+    static void apply(Role role);
+
+private:
+    static Settings s_settings[ROLE_COUNT];
+};
+
+#endif
@@ -0,0 +1,118 @@
+/*
+ * File:   Trace.hpp
+ *
+ * Scoped tracing zones and flows, exported in the Chrome trace-event format.
+ */
+
+#pragma once
+#ifndef TRACE_HPP
+#define TRACE_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <ostream>
+#include <string>
+
+#define TRACE_CONCATENATE_(a, b) a##b
+#define TRACE_CONCATENATE(a, b) TRACE_CONCATENATE_(a, b)
+
+/**
+ * Records a zone from here to the end of the enclosing scope.  The name must be a string literal.
+ */
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCATENATE(traceScope, __LINE__)(name)
+
+/**
+ * Tracing of the control path: the receiver and pipeline threads, frame dispatch, the station
+ * threads and applyChanges().  Each thread records into a ring buffer of its own, so a trace
+ * holds the latest events of every thread and recording never blocks on another thread.
+ *
+ * Flows link the sensor frame a station thread woke up for to the actuator frame it sent: a
+ * dispatch that changes a sensor starts a flow, a thread woken by the change adopts it, and the
+ * next applyChanges() on that thread ends it.
+ *
+ * Tracing is off until enable() is called; until then each zone and flow costs a branch.  The
+ * trace is written with write(), on demand, and loads in chrome://tracing or Perfetto.
+ */
+class Trace {
+public:
+    static const size_t DEFAULT_CAPACITY = 65536;
+
+    /**
+     * Starts recording.
+     *
+     * @param capacity  Events kept per thread; older events are overwritten
+     */
+    static void enable(size_t capacity = DEFAULT_CAPACITY);
+
+    static void disable();
+
+    static inline bool isEnabled() {
+        return s_enabled.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * Names the calling thread in the trace.  The name must be a string literal.
+     */
+    static void setThreadName(const char* name);
+
+    /**
+     * Records a zone that ran on the calling thread; see TRACE_SCOPE.
+     */
+    static void complete(const char* name, uint64_t startNs, uint64_t endNs);
+
+    /**
+     * Starts a flow from the current zone, and makes it the one woken threads adopt.
+     */
+    static void beginFlow(const char* name);
+
+    /**
+     * Continues the latest flow on the calling thread, which has just been woken by it.
+     */
+    static void adoptFlow();
+
+    /**
+     * Ends the calling thread's flow, if any, in the current zone.
+     */
+    static void endFlow();
+
+    /**
+     * Writes every thread's events as Chrome trace-event JSON.
+     */
+    static void write(std::ostream& output);
+
+    /**
+     * @return true if the trace was written
+     */
+    static bool write(const std::string& path);
+
+private:
+    static std::atomic<bool> s_enabled;
+};
+
+/**
+ * A zone for the lifetime of the object; see TRACE_SCOPE.
+ */
+class TraceScope {
+public:
+    explicit TraceScope(const char* name)
+    : m_name(name), m_startNs(Trace::isEnabled() ? now() : 0) {
+    }
+
+    ~TraceScope() {
+        if (m_startNs != 0) {
+            Trace::complete(m_name, m_startNs, now());
+        }
+    }
+
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+    static uint64_t now();
+
+private:
+    const char* m_name;
+    uint64_t    m_startNs;      // 0 if tracing was off when the zone started
+};
+
+#endif
@@ -0,0 +1,42 @@
+/*
+ * File:   Transport.hpp
+ *
+ * Carries frames between a Factory and a scene.
+ */
+
+#pragma once
+#ifndef TRANSPORT_HPP
+#define TRANSPORT_HPP
+
+#include <string>
+#include "Clock.hpp"
+#include "CommunicationsEventHandler.hpp"
+
+/**
+ * The factory sends frames through a transport and receives them through the event handler it
+ * hands to the transport when it starts.  Frames are the text between the Factory IO delimiters;
+ * a transport that needs framing adds it.  Communications is the TCP transport, SimulatedPlant runs
+ * a scene in process and LoopbackTransport hands frames to and from the caller directly.
+ */
+class Transport {
+public:
+    virtual ~Transport() {
+    }
+
+    /**
+     * Starts delivering received frames to the event handler.  Called by Factory::start().
+     *
+     * @param clock     Factory's clock, for transports that run on their own timing
+     */
+    virtual void connect(CommunicationsEventHandler& eventHandler, Clock& clock) = 0;
+
+    /**
+     * Stops delivering frames; called by Factory::stop() once the clock has been stopped.
+     */
+    virtual void disconnect() {
+    }
+
+    virtual void sendMessage(const std::string& text) = 0;
+};
+
+#endif
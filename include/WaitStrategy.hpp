@@ -0,0 +1,92 @@
+/*
+ * File:   WaitStrategy.hpp
+ *
+ * How a thread waits for a sensor change: park, spin and then park, or busy-poll.
+ */
+
+#pragma once
+#ifndef WAIT_STRATEGY_HPP
+#define WAIT_STRATEGY_HPP
+
+#include <stdint.h>
+#include <chrono>
+#include <string>
+
+/**
+ * Waiting threads normally park on a condition variable, which costs a futex wake-up and a
+ * context switch per change.  A station whose reactions matter more than a core can instead have
+ * its threads spin on the change counter of the sensor or factory they wait on:
+ *   WAIT_BLOCK             park straight away
+ *   WAIT_SPIN_THEN_PARK    spin for up to WAIT_SPIN_BUDGET, then park
+ *   WAIT_BUSY_POLL         spin until the change, never parking; for threads pinned to a core of
+ *                          their own (see ThreadProfile)
+ *
+ * A spinning thread still counts as blocked for the Clock, so discrete-event time advances
+ * while it spins.
+ */
+enum WaitStrategy {
+    WAIT_BLOCK,
+    WAIT_SPIN_THEN_PARK,
+    WAIT_BUSY_POLL
+};
+
+const std::chrono::microseconds WAIT_SPIN_BUDGET(50);
+
+inline const char* getWaitStrategyName(WaitStrategy strategy) {
+    switch (strategy) {
+        case WAIT_SPIN_THEN_PARK: return "spin";
+        case WAIT_BUSY_POLL:      return "poll";
+        default:                  return "block";
+    }
+}
+
+/**
+ * @return false if name is not block, spin or poll
+ */
+inline bool parseWaitStrategy(const std::string& name, WaitStrategy& strategy) {
+    for (WaitStrategy candidate : { WAIT_BLOCK, WAIT_SPIN_THEN_PARK, WAIT_BUSY_POLL }) {
+        if (name == getWaitStrategyName(candidate)) {
+            strategy = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Tells the core that the thread is spinning, which frees pipeline resources for a sibling
+ * hyperthread and saves power.
+ */
+inline void cpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield");
+#endif
+}
+
+/**
+ * Spins until done() returns true, as the strategy allows.
+ *
+ * @return true once done(), or false if the caller should park instead
+ */
+template<typename Done>
+bool spinUntil(WaitStrategy strategy, Done done) {
+    if (strategy == WAIT_BLOCK) {
+        return false;
+    }
+    const uint32_t CLOCK_CHECK_INTERVAL = 64;      // Spins between reads of the clock
+    const std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + WAIT_SPIN_BUDGET;
+    for (uint32_t spinCount = 1; ; ++spinCount) {
+        if (done()) {
+            return true;
+        }
+        cpuRelax();
+        if ((strategy == WAIT_SPIN_THEN_PARK) && ((spinCount % CLOCK_CHECK_INTERVAL) == 0) &&
+            (std::chrono::steady_clock::now() >= deadline)) {
+            return false;
+        }
+    }
+}
+
+#endif
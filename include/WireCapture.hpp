@@ -0,0 +1,133 @@
+/*
+ * File:   WireCapture.hpp
+ *
+ * Recording and memory-mapped replay of the frames exchanged with Factory IO.
+ */
+
+#pragma once
+#ifndef WIRE_CAPTURE_HPP
+#define WIRE_CAPTURE_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * A capture file starts with a header and is followed by one record per frame, each a fixed-size
+ * record header and the frame text without its delimiters.  Integers are in host byte order, so a
+ * capture is replayed on the kind of machine that recorded it.
+ */
+struct WireCaptureFormat {
+    static const char     MAGIC[8];
+
+    enum Direction {
+        INBOUND = 0,            // Received from the scene
+        OUTBOUND = 1            // Sent to the scene
+    };
+
+    struct FileHeader {
+        char        magic[8];
+        uint64_t    startTimeNs;    // System time at which the capture started, since the epoch
+    };
+
+    struct RecordHeader {
+        uint64_t    timestampNs;    // Monotonic time since the capture started
+        uint32_t    size;           // Bytes of frame text that follow
+        uint8_t     direction;
+        uint8_t     reserved[3];
+    };
+};
+
+/**
+ * Appends frames to a capture file.  record() only copies the frame into a buffer under a short
+ * lock; the buffer is written out when it fills up or once a second, whichever comes first, so a
+ * crash loses at most the last second of traffic.
+ */
+class WireCapture {
+public:
+    WireCapture();
+    ~WireCapture();
+
+    /**
+     * Creates (or truncates) a capture file and writes its header.
+     *
+     * @return true if the file could be created
+     */
+    bool open(const std::string& path);
+
+    void record(WireCaptureFormat::Direction direction, const char* data, size_t size);
+
+    /**
+     * Writes out buffered records.
+     */
+    void flush();
+
+    uint64_t getRecordCount() const {
+        return m_recordCount;
+    }
+
+private:
+    static const size_t BUFFER_SIZE = 256 * 1024;
+
+    void writerThread();
+    void write();
+
+    int32_t                                 m_fd;
+    std::chrono::steady_clock::time_point   m_start;
+    std::mutex                              m_mutex;
+    std::condition_variable                 m_writeControl;
+    std::vector<char>                       m_buffer;
+    uint64_t                                m_recordCount;
+    bool                                    m_closing;
+    std::thread*                            m_thread;       // Writes the buffer out periodically
+};
+
+/**
+ * Read-only view of a capture file, mapped into memory so records are handed out without copying.
+ * A record cut short at the end of the file, as left by a crash, is ignored.
+ */
+class WireReplay {
+public:
+    struct Record {
+        uint64_t                        timestampNs;
+        WireCaptureFormat::Direction    direction;
+        const char*                     data;
+        size_t                          size;
+    };
+
+    WireReplay();
+    ~WireReplay();
+
+    /**
+     * Maps a capture file and checks its header.
+     *
+     * @return true if the file is a capture
+     */
+    bool open(const std::string& path);
+
+    /**
+     * Returns the next record.
+     *
+     * @return false at the end of the capture
+     */
+    bool next(Record& record);
+
+    /**
+     * Goes back to the first record.
+     */
+    void rewind();
+
+    uint64_t getStartTimeNs() const;
+
+private:
+    const char* m_data;
+    size_t      m_size;
+    size_t      m_position;     // Offset of the next record
+};
+
+#endif
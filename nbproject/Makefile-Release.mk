@@ -37,10 +37,34 @@ OBJECTDIR=${CND_BUILDDIR}/${CND_CONF}/${CND_PLATFORM}
 OBJECTFILES= \
 	${OBJECTDIR}/src/BasicConveyorControl.o \
 	${OBJECTDIR}/src/BasicPackingFactory.o \
+	${OBJECTDIR}/src/Clock.o \
 	${OBJECTDIR}/src/Communications.o \
+	${OBJECTDIR}/src/Executor.o \
 	${OBJECTDIR}/src/Factory.o \
+	${OBJECTDIR}/src/FactoryServer.o \
+	${OBJECTDIR}/src/FrameDecoder.o \
+	${OBJECTDIR}/src/Histogram.o \
+	${OBJECTDIR}/src/Log.o \
+	${OBJECTDIR}/src/LoopbackTransport.o \
 	${OBJECTDIR}/src/Main.o \
-	${OBJECTDIR}/src/SortingByWeightFactory.o
+	${OBJECTDIR}/src/Metrics.o \
+	${OBJECTDIR}/src/PlantScene.o \
+	${OBJECTDIR}/src/PlantScenes.o \
+	${OBJECTDIR}/src/ProfiledMutex.o \
+	${OBJECTDIR}/src/ProgramVm.o \
+	${OBJECTDIR}/src/RuleConveyorControl.o \
+	${OBJECTDIR}/src/RuleEngine.o \
+	${OBJECTDIR}/src/ScanController.o \
+	${OBJECTDIR}/src/SensorPipeline.o \
+	${OBJECTDIR}/src/SimulatedPlant.o \
+	${OBJECTDIR}/src/SortingByWeightFactory.o \
+	${OBJECTDIR}/src/Station.o \
+	${OBJECTDIR}/src/StructuredText.o \
+	${OBJECTDIR}/src/SyntheticScene.o \
+	${OBJECTDIR}/src/TagNames.o \
+	${OBJECTDIR}/src/ThreadProfile.o \
+	${OBJECTDIR}/src/Trace.o \
+	${OBJECTDIR}/src/WireCapture.o
 
 
 # C Compiler Flags
@@ -77,26 +101,146 @@ ${OBJECTDIR}/src/BasicPackingFactory.o: src/BasicPackingFactory.cpp
 	${RM} "$@.d"
 	$(COMPILE.cc) -O2 -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/src/BasicPackingFactory.o src/BasicPackingFactory.cpp
 
+${OBJECTDIR}/src/Clock.o: src/Clock.cpp
+	${MKDIR} -p ${OBJECTDIR}/src
+	${RM} "$@.d"
+	$(COMPILE.cc) -O2 -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/src/Clock.o src/Clock.cpp
+
 ${OBJECTDIR}/src/Communications.o: src/Communications.cpp
 	${MKDIR} -p ${OBJECTDIR}/src
 	${RM} "$@.d"
 	$(COMPILE.cc) -O2 -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/src/Communications.o src/Communications.cpp
 
+${OBJECTDIR}/src/Executor.o: src/Executor.cpp
+	${MKDIR} -p ${OBJECTDIR}/src
+	${RM} "$@.d"
+	$(COMPILE.cc) -O2 -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/src/Executor.o src/Executor.cpp
+
 ${OBJECTDIR}/src/Factory.o: src/Factory.cpp
 	${MKDIR} -p ${OBJECTDIR}/src
 	${RM} "$@.d"
 	$(COMPILE.cc) -O2 -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/src/Factory.o src/Factory.cpp
 
+${OBJECTDIR}/src/FactoryServer.o: src/FactoryServer.cpp
+	${MKDIR} -p ${OBJECTDIR}/src
+	${RM} "$@.d"
+	$(COMPILE.cc) -O2 -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/src/FactoryServer.o src/FactoryServer.cpp
+
+${OBJECTDIR}/src/FrameDecoder.o: src/FrameDecoder.cpp
+	${MKDIR} -p ${OBJECTDIR}/src
+	${RM} "$@.d"
+	$(COMPILE.cc) -O2 -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/src/FrameDecoder.o src/FrameDecoder.cpp
+
+${OBJECTDIR}/src/Histogram.o: src/Histogram.cpp
+	${MKDIR} -p ${OBJECTDIR}/src
+	${RM} "$@.d"
+	$(COMPILE.cc) -O2 -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/src/Histogram.o src/Histogram.cpp
+
+${OBJECTDIR}/src/Log.o: src/Log.cpp
+	${MKDIR} -p ${OBJECTDIR}/src
+	${RM} "$@.d"
+	$(COMPILE.cc) -O2 -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/src/Log.o src/Log.cpp
+
+${OBJECTDIR}/src/LoopbackTransport.o: src/LoopbackTransport.cpp
+	${MKDIR} -p ${OBJECTDIR}/src
+	${RM} "$@.d"
+	$(COMPILE.cc) -O2 -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/src/LoopbackTransport.o src/LoopbackTransport.cpp
+
 ${OBJECTDIR}/src/Main.o: src/Main.cpp
 	${MKDIR} -p ${OBJECTDIR}/src
 	${RM} "$@.d"
 	$(COMPILE.cc) -O2 -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/src/Main.o src/Main.cpp
 
+${OBJECTDIR}/src/Metrics.o: src/Metrics.cpp
+	${MKDIR} -p ${OBJECTDIR}/src
+	${RM} "$@.d"
+	$(COMPILE.cc) -O2 -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/src/Metrics.o src/Metrics.cpp
+
+${OBJECTDIR}/src/PlantScene.o: src/PlantScene.cpp
+	${MKDIR} -p ${OBJECTDIR}/src
+	${RM} "$@.d"
+	$(COMPILE.cc) -O2 -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/src/PlantScene.o src/PlantScene.cpp
+
+${OBJECTDIR}/src/PlantScenes.o: src/PlantScenes.cpp
+	${MKDIR} -p ${OBJECTDIR}/src
+	${RM} "$@.d"
+	$(COMPILE.cc) -O2 -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/src/PlantScenes.o src/PlantScenes.cpp
+
+${OBJECTDIR}/src/ProfiledMutex.o: src/ProfiledMutex.cpp
+	${MKDIR} -p ${OBJECTDIR}/src
+	${RM} "$@.d"
+	$(COMPILE.cc) -O2 -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/src/ProfiledMutex.o src/ProfiledMutex.cpp
+
+${OBJECTDIR}/src/ProgramVm.o: src/ProgramVm.cpp
+	${MKDIR} -p ${OBJECTDIR}/src
+	${RM} "$@.d"
+	$(COMPILE.cc) -O2 -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/src/ProgramVm.o src/ProgramVm.cpp
+
+${OBJECTDIR}/src/RuleConveyorControl.o: src/RuleConveyorControl.cpp
+	${MKDIR} -p ${OBJECTDIR}/src
+	${RM} "$@.d"
+	$(COMPILE.cc) -O2 -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/src/RuleConveyorControl.o src/RuleConveyorControl.cpp
+
+${OBJECTDIR}/src/RuleEngine.o: src/RuleEngine.cpp
+	${MKDIR} -p ${OBJECTDIR}/src
+	${RM} "$@.d"
+	$(COMPILE.cc) -O2 -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/src/RuleEngine.o src/RuleEngine.cpp
+
+${OBJECTDIR}/src/ScanController.o: src/ScanController.cpp
+	${MKDIR} -p ${OBJECTDIR}/src
+	${RM} "$@.d"
+	$(COMPILE.cc) -O2 -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/src/ScanController.o src/ScanController.cpp
+
+${OBJECTDIR}/src/SensorPipeline.o: src/SensorPipeline.cpp
+	${MKDIR} -p ${OBJECTDIR}/src
+	${RM} "$@.d"
+	$(COMPILE.cc) -O2 -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/src/SensorPipeline.o src/SensorPipeline.cpp
+
+${OBJECTDIR}/src/SimulatedPlant.o: src/SimulatedPlant.cpp
+	${MKDIR} -p ${OBJECTDIR}/src
+	${RM} "$@.d"
+	$(COMPILE.cc) -O2 -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/src/SimulatedPlant.o src/SimulatedPlant.cpp
+
 ${OBJECTDIR}/src/SortingByWeightFactory.o: src/SortingByWeightFactory.cpp
 	${MKDIR} -p ${OBJECTDIR}/src
 	${RM} "$@.d"
 	$(COMPILE.cc) -O2 -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/src/SortingByWeightFactory.o src/SortingByWeightFactory.cpp
 
+${OBJECTDIR}/src/Station.o: src/Station.cpp
+	${MKDIR} -p ${OBJECTDIR}/src
+	${RM} "$@.d"
+	$(COMPILE.cc) -O2 -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/src/Station.o src/Station.cpp
+
+${OBJECTDIR}/src/StructuredText.o: src/StructuredText.cpp
+	${MKDIR} -p ${OBJECTDIR}/src
+	${RM} "$@.d"
+	$(COMPILE.cc) -O2 -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/src/StructuredText.o src/StructuredText.cpp
+
+${OBJECTDIR}/src/SyntheticScene.o: src/SyntheticScene.cpp
+	${MKDIR} -p ${OBJECTDIR}/src
+	${RM} "$@.d"
+	$(COMPILE.cc) -O2 -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/src/SyntheticScene.o src/SyntheticScene.cpp
+
+${OBJECTDIR}/src/TagNames.o: src/TagNames.cpp
+	${MKDIR} -p ${OBJECTDIR}/src
+	${RM} "$@.d"
+	$(COMPILE.cc) -O2 -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/src/TagNames.o src/TagNames.cpp
+
+${OBJECTDIR}/src/ThreadProfile.o: src/ThreadProfile.cpp
+	${MKDIR} -p ${OBJECTDIR}/src
+	${RM} "$@.d"
+	$(COMPILE.cc) -O2 -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/src/ThreadProfile.o src/ThreadProfile.cpp
+
+${OBJECTDIR}/src/Trace.o: src/Trace.cpp
+	${MKDIR} -p ${OBJECTDIR}/src
+	${RM} "$@.d"
+	$(COMPILE.cc) -O2 -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/src/Trace.o src/Trace.cpp
+
+${OBJECTDIR}/src/WireCapture.o: src/WireCapture.cpp
+	${MKDIR} -p ${OBJECTDIR}/src
+	${RM} "$@.d"
+	$(COMPILE.cc) -O2 -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/src/WireCapture.o src/WireCapture.cpp
+
 # Subprojects
 .build-subprojects:
 
@@ -1,94 +1,106 @@
+#include <functional>
 #include "BasicConveyorControl.hpp"
-#include <iostream>
+#include "Log.hpp"
 
 BasicConveyorControl::BasicConveyorControl(Factory& factory, std::string stationPrefix, int32_t maxBoxCount)
 : m_factory(factory),
-  m_station(factory),
-  m_emitter(m_station, stationPrefix + "Emitter"),
-  m_remover(m_station, stationPrefix + "Remover"),
-  m_entryConveyor(m_station, stationPrefix + "Entry Conveyor"),
-  m_exitConveyor(m_station, stationPrefix + "Exit Conveyor"),
-  m_entrySensor(m_station, stationPrefix + "At Entry"),
-  m_exitSensor(m_station, stationPrefix + "At Exit"),
+  m_station(factory, stationPrefix),
+  m_emitter(m_station, "Emitter"),
+  m_remover(m_station, "Remover"),
+  m_entryConveyor(m_station, "Entry Conveyor"),
+  m_exitConveyor(m_station, "Exit Conveyor"),
+  m_entrySensor(m_station, "At Entry"),
+  m_exitSensor(m_station, "At Exit"),
   m_maxBoxCount(maxBoxCount),
   m_boxCount(0),
-  m_entryThread(nullptr),
-  m_exitThread(nullptr),
+  m_entryBoxDetected(false),
+  m_exitBoxDetected(false),
+  m_started(false),
   m_boxCountMutex() {
 }
 
 void BasicConveyorControl::start() {
     m_factory.loadSensorValues();
-    if ((m_entryThread == nullptr) && (m_entryThread == nullptr)) {
-        m_entryThread = new std::thread(&BasicConveyorControl::handleBoxEntry, this);
-        m_exitThread = new std::thread(&BasicConveyorControl::handleBoxExit, this);
+    if (!m_started) {
+        m_started = true;
+        Executor& executor = m_station.getExecutor();
+        executor.submit(std::bind(&BasicConveyorControl::startConveyors, this));
+        executor.submit(std::bind(&BasicConveyorControl::handleBoxExit, this));
     }
     else {
-        std::cerr << "Nice try buddy!" << std::endl;
+        LOG_ERROR("Nice try buddy!");
     }
 }    
 
+/**
+ * Stops the whole factory, which stops the executor; tasks still armed on a sensor never run.
+ */
 void BasicConveyorControl::stop() {
-    //TODO(nkb): Add ability to stop the application
+    m_factory.stop();
 }
 
+/**
+ * Returns once the factory has been stopped and no task of the station is running any more.
+ */
 void BasicConveyorControl::waitUntilDone() {
-    m_entryThread->join();
-    m_exitThread->join();
+    m_station.getExecutor().join();
 }
 
-void BasicConveyorControl::handleBoxEntry() { 
-    std::cout << "Handle box entry thread started" << std::endl;
-    bool boxDetected = false;
+void BasicConveyorControl::startConveyors() {
+    LOG_INFO("Box entry and exit tasks started");
     m_emitter.setOn(true);
     m_remover.setOn(true);
     m_entryConveyor.setOn(true);
     m_exitConveyor.setOn(true);
     m_station.applyChanges();
-    for (;;) {
-        if (!m_entrySensor.beamDetected() && !boxDetected) {
-            boxDetected = true;
+    handleBoxEntry();
+}
+
+/**
+ * One step of the entry handler: counts a box once it has passed the entry sensor, then waits for
+ * the sensor's next change.
+ */
+void BasicConveyorControl::handleBoxEntry() { 
+    if (!m_entrySensor.beamDetected() && !m_entryBoxDetected) {
+        m_entryBoxDetected = true;
+    }
+    if ((m_entryBoxDetected) && (m_entrySensor.beamDetected())) {
+        m_entryBoxDetected = false;
+        uint32_t currentBoxCount = 0;
+        {
+            std::lock_guard<std::mutex> scopedLock(m_boxCountMutex);
+            currentBoxCount = ++m_boxCount;
         }
-        if ((boxDetected) && (m_entrySensor.beamDetected())) {
-            boxDetected = false;
-            uint32_t currentBoxCount = 0;
-            {
-                std::lock_guard<std::mutex> scopedLock(m_boxCountMutex);
-                currentBoxCount = ++m_boxCount;
-            }
-            
-            if (currentBoxCount >= m_maxBoxCount) {
-                std::lock_guard<std::mutex> scopedLock(m_boxCountMutex);  // temp
-                m_emitter.setOn(false);
-                m_station.applyChanges();
-            }
+        
+        if (currentBoxCount >= static_cast<uint32_t>(m_maxBoxCount)) {
+            std::lock_guard<std::mutex> scopedLock(m_boxCountMutex);  // temp
+            m_emitter.setOn(false);
+            m_station.applyChanges();
         }
-        m_entrySensor.waitForChange();
     }
+    m_entrySensor.resumeOnChange(std::bind(&BasicConveyorControl::handleBoxEntry, this));
 }
 
+/**
+ * One step of the exit handler: uncounts a box once it has passed the exit sensor and restarts
+ * the emitter, then waits for the sensor's next change.
+ */
 void BasicConveyorControl::handleBoxExit() {
-    std::cout << "Handle box exit thread started" << std::endl;
-
-    bool boxDetected = false;
-    for (;;) {
-        if (!m_exitSensor.beamDetected() && !boxDetected) {
-            boxDetected = true;
-        }
-        if ((boxDetected) && (m_exitSensor.beamDetected())) {
-            boxDetected = false;
-            {
-                 std::lock_guard<std::mutex> scopedLock(m_boxCountMutex);
-                --m_boxCount;
-            }
-            if (!m_emitter.getOn()) {
-                m_emitter.setOn(true);
-                m_station.applyChanges();
-            }
-        }    
-        m_exitSensor.waitForChange();
+    if (!m_exitSensor.beamDetected() && !m_exitBoxDetected) {
+        m_exitBoxDetected = true;
     }
+    if ((m_exitBoxDetected) && (m_exitSensor.beamDetected())) {
+        m_exitBoxDetected = false;
+        {
+             std::lock_guard<std::mutex> scopedLock(m_boxCountMutex);
+            --m_boxCount;
+        }
+        if (!m_emitter.getOn()) {
+            m_emitter.setOn(true);
+            m_station.applyChanges();
+        }
+    }    
+    m_exitSensor.resumeOnChange(std::bind(&BasicConveyorControl::handleBoxExit, this));
 }
 
         
-
@@ -1,10 +1,13 @@
 
-#include <unistd.h>
 #include <chrono>
 #include "BasicPackingFactory.hpp"
+#include "ThreadProfile.hpp"
+#include "Trace.hpp"
 
-BasicPackingFactory::BasicPackingFactory(Factory& factory)
+BasicPackingFactory::BasicPackingFactory(Factory& factory, const PackingParameters& parameters)
 : m_factory(factory),
+  m_clock(factory.getClock()),
+  m_parameters(parameters),
   m_palletStation(factory),  
   m_boxStation(factory),
   m_packingStation(factory),
@@ -22,9 +25,9 @@ BasicPackingFactory::BasicPackingFactory(Factory& factory)
   m_boxStopBlade(m_boxStation, "Box Stop Blade"),
   m_pickAndPlace(m_packingStation, "Pick and Place"),
   m_digitalDisplay(m_packingStation, "Box Count"),
-  m_palletManagerThread(nullptr),
-  m_boxConveyorManagerThread(nullptr),
-  m_packingManagerThread(nullptr),
+  m_palletManagerThread(),
+  m_boxConveyorManagerThread(),
+  m_packingManagerThread(),
   m_boxReady(false),
   m_palletReady(false),
   m_palletFull(false) {
@@ -32,9 +35,20 @@ BasicPackingFactory::BasicPackingFactory(Factory& factory)
 
 void BasicPackingFactory::start() {
     m_factory.loadSensorValues();
-    m_palletManagerThread = new std::thread(&BasicPackingFactory::palletManager, this);
-    m_boxConveyorManagerThread = new std::thread(&BasicPackingFactory::boxConveyorManager, this);
-    m_packingManagerThread = new std::thread(&BasicPackingFactory::packingManager, this);
+    m_palletManagerThread.reset(m_clock.newThread(&BasicPackingFactory::palletManager, this));
+    m_boxConveyorManagerThread.reset(m_clock.newThread(&BasicPackingFactory::boxConveyorManager, this));
+    m_packingManagerThread.reset(m_clock.newThread(&BasicPackingFactory::packingManager, this));
+}
+
+/**
+ * A station that is still running stops the whole factory, as stop() does, before its threads
+ * are joined.
+ */
+BasicPackingFactory::~BasicPackingFactory() {
+    if (m_packingManagerThread && m_packingManagerThread->joinable()) {
+        stop();
+    }
+    waitUntilDone();
 }
 
 class Position {
@@ -51,23 +65,26 @@ void BasicPackingFactory::packingManager() {
     const float Y_PICK_UP = 5.3;
     const float Z_PICK_UP = 5.5;
     const float Z_TOP = 0.0;
-    const float DELTA = 0.3;
+    const float DELTA = m_parameters.delta;
     Position boxPosition[6] = {{3.2, 4.2, 10},
                                {3.2, 7.2, 10},
                                {3.2, 4.2, 5.5},
                                {3.2, 7.2, 5.5},
                                {3.2, 4.2, .5},
                                {3.2, 7.2, .5}};
+    Trace::setThreadName("packingManager");
+    ThreadProfile::apply(ThreadProfile::ROLE_CONTROLLER);
     
     for (;;) {
         for (int32_t boxIndex = 0; boxIndex < 6; ++boxIndex) {
+            TRACE_SCOPE("pack box");
             m_pickAndPlace.setX(X_PICK_UP);
             m_pickAndPlace.setY(Y_PICK_UP);
             m_pickAndPlace.setZ(Z_TOP);
             m_packingStation.applyChanges();
 
             while (!m_boxReady || !m_palletReady) {
-                std::this_thread::sleep_for(std::chrono::milliseconds(250));
+                m_clock.sleepFor(m_parameters.pollInterval);
             }
 
             m_pickAndPlace.setZ(Z_PICK_UP);
@@ -77,33 +94,33 @@ void BasicPackingFactory::packingManager() {
                 m_packingStation.waitForSensorChange();
             }
 
-            std::this_thread::sleep_for(std::chrono::milliseconds(250));
+            m_clock.sleepFor(m_parameters.gripDelay);
             m_pickAndPlace.setGrab(true);
             m_packingStation.applyChanges();
-            std::this_thread::sleep_for(std::chrono::milliseconds(250));
+            m_clock.sleepFor(m_parameters.gripDelay);
 
             m_pickAndPlace.setZ(Z_TOP);
             m_packingStation.applyChanges();
             while (m_pickAndPlace.getZ() > DELTA) {
-                std::this_thread::sleep_for(std::chrono::milliseconds(250));
+                m_clock.sleepFor(m_parameters.pollInterval);
             }
 
             m_pickAndPlace.setX(boxPosition[boxIndex].x);
             m_pickAndPlace.setY(boxPosition[boxIndex].y);
             m_packingStation.applyChanges();
 
-            std::this_thread::sleep_for(std::chrono::milliseconds(500));
+            m_clock.sleepFor(m_parameters.traverseDelay);
             m_pickAndPlace.setZ(boxPosition[boxIndex].z);
             m_packingStation.applyChanges();
 
             while (m_pickAndPlace.getZ() < boxPosition[boxIndex].z - DELTA) {
-                std::this_thread::sleep_for(std::chrono::milliseconds(250));
+                m_clock.sleepFor(m_parameters.pollInterval);
             }
 
-            std::this_thread::sleep_for(std::chrono::milliseconds(250));
+            m_clock.sleepFor(m_parameters.gripDelay);
             m_pickAndPlace.setGrab(false);
             m_packingStation.applyChanges();
-            std::this_thread::sleep_for(std::chrono::milliseconds(250));
+            m_clock.sleepFor(m_parameters.gripDelay);
 
             m_pickAndPlace.setZ(Z_TOP);
             m_digitalDisplay.setNumber(boxIndex + 1);
@@ -116,8 +133,11 @@ void BasicPackingFactory::packingManager() {
 }
 
 void BasicPackingFactory::boxConveyorManager() {
+    Trace::setThreadName("boxConveyorManager");
+    ThreadProfile::apply(ThreadProfile::ROLE_CONTROLLER);
     
     for (;;) {
+        TRACE_SCOPE("box cycle");
         m_boxEmitter.setOn(true);
         m_boxStation.applyChanges();
 
@@ -137,17 +157,17 @@ void BasicPackingFactory::boxConveyorManager() {
 
         m_boxConveyor.setOn(false);
         m_boxStation.applyChanges();
-        sleep(1);
+        m_clock.sleepFor(m_parameters.bladeDelay);
         m_boxStopBlade.setRaised(false);
         m_boxStation.applyChanges();
 
         m_boxReady = true;
 
         while (m_boxReady) {
-            sleep(1);
+            m_clock.sleepFor(m_parameters.boxPollInterval);
         }
     }
-    sleep(1000);
+    m_clock.sleepFor(std::chrono::seconds(1000));
 }
     
 
@@ -158,11 +178,14 @@ void BasicPackingFactory::boxConveyorManager() {
  *  2) moves the pallet to the packing location
  */
 void BasicPackingFactory::palletManager() {
+    Trace::setThreadName("palletManager");
+    ThreadProfile::apply(ThreadProfile::ROLE_CONTROLLER);
 
     m_palletExitConveyor.setOn(true);
     m_palletRemover.setOn(true);
 
     for (;;) {
+        TRACE_SCOPE("pallet cycle");
         m_palletEmitter.setOn(true);
         m_palletStation.applyChanges();
 
@@ -184,7 +207,7 @@ void BasicPackingFactory::palletManager() {
         m_palletReady = true;
 
         while (!m_palletFull) {
-            std::this_thread::sleep_for(std::chrono::milliseconds(250));
+            m_clock.sleepFor(m_parameters.pollInterval);
         }
 
         m_palletRollerStop.setRaised(false);
@@ -202,9 +225,18 @@ void BasicPackingFactory::palletManager() {
 }
 
 
+/**
+ * Stops the whole factory; the manager threads unwind out of their waits.
+ */
 void BasicPackingFactory::stop() {
-
+    m_factory.stop();
 }
+
 void BasicPackingFactory::waitUntilDone() {
-    sleep(1000);
+    for (std::unique_ptr<std::thread>* thread : { &m_palletManagerThread, &m_boxConveyorManagerThread,
+                                                  &m_packingManagerThread }) {
+        if (*thread && (*thread)->joinable()) {
+            (*thread)->join();
+        }
+    }
 }
@@ -0,0 +1,208 @@
+#include "Clock.hpp"
+
+Clock::Clock()
+: m_stopped(false), m_stopMutex(), m_stopControl() {
+}
+
+void Clock::stop() {
+    {
+        std::lock_guard<std::mutex> scopedLock(m_stopMutex);
+        m_stopped = true;
+    }
+    m_stopControl.notify_all();
+}
+
+void Clock::wake(Wakeup& wakeup) {
+    {
+        std::lock_guard<std::mutex> scopedLock(m_stopMutex);
+        wakeup.m_pending = true;
+    }
+    m_stopControl.notify_all();
+}
+
+void Clock::sleepUntilWallTime(std::chrono::steady_clock::time_point time, Wakeup* wakeup) {
+    std::unique_lock<std::mutex> scopedLock(m_stopMutex);
+    m_stopControl.wait_until(scopedLock, time, [this, wakeup] {
+        return m_stopped.load() || ((wakeup != nullptr) && wakeup->m_pending);
+    });
+    if (wakeup != nullptr) {
+        wakeup->m_pending = false;
+    }
+    if (m_stopped) {
+        throw Stopped();
+    }
+}
+
+Clock& Clock::realTime() {
+    static RealTimeClock clock;
+    return clock;
+}
+
+RealTimeClock::RealTimeClock()
+: m_start(std::chrono::steady_clock::now()) {
+}
+
+Clock::Duration RealTimeClock::now() {
+    return std::chrono::duration_cast<Duration>(std::chrono::steady_clock::now() - m_start);
+}
+
+void RealTimeClock::sleepUntil(Duration time) {
+    sleepUntilWallTime(m_start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(time));
+}
+
+void RealTimeClock::sleepUntil(Duration time, Wakeup& wakeup) {
+    sleepUntilWallTime(m_start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(time), &wakeup);
+}
+
+ScaledClock::ScaledClock(double scale)
+: m_start(std::chrono::steady_clock::now()), m_scale(scale) {
+}
+
+Clock::Duration ScaledClock::now() {
+    std::chrono::duration<double, std::nano> elapsed(std::chrono::steady_clock::now() - m_start);
+    return std::chrono::duration_cast<Duration>(elapsed * m_scale);
+}
+
+void ScaledClock::sleepUntil(Duration time) {
+    std::chrono::duration<double, std::nano> wallTime(time);
+    sleepUntilWallTime(m_start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(wallTime / m_scale));
+}
+
+void ScaledClock::sleepUntil(Duration time, Wakeup& wakeup) {
+    std::chrono::duration<double, std::nano> wallTime(time);
+    sleepUntilWallTime(m_start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(wallTime / m_scale),
+                       &wakeup);
+}
+
+DiscreteEventClock::DiscreteEventClock()
+: m_mutex(), m_now(Duration::zero()), m_runnableCount(0), m_sleepers() {
+}
+
+Clock::Duration DiscreteEventClock::now() {
+    std::lock_guard<std::mutex> scopedLock(m_mutex);
+    return m_now;
+}
+
+void DiscreteEventClock::sleepUntil(Duration time) {
+    std::unique_lock<std::mutex> scopedLock(m_mutex);
+    if (m_stopped) {
+        throw Stopped();
+    }
+    if (time <= m_now) {
+        return;
+    }
+    Sleeper sleeper;
+    sleeper.time = time;
+    sleeper.woken = false;
+    m_sleepers.insert(std::make_pair(time, &sleeper));
+    --m_runnableCount;
+    advance();
+    sleeper.wakeControl.wait(scopedLock, [&sleeper] { return sleeper.woken; });
+    if (m_stopped) {
+        throw Stopped();
+    }
+}
+
+void DiscreteEventClock::sleepUntil(Duration time, Wakeup& wakeup) {
+    std::unique_lock<std::mutex> scopedLock(m_mutex);
+    if (m_stopped) {
+        throw Stopped();
+    }
+    if (wakeup.m_pending || (time <= m_now)) {
+        wakeup.m_pending = false;
+        return;
+    }
+    Sleeper sleeper;
+    sleeper.time = time;
+    sleeper.woken = false;
+    m_sleepers.insert(std::make_pair(time, &sleeper));
+    wakeup.m_sleeper = &sleeper;
+    --m_runnableCount;
+    advance();
+    sleeper.wakeControl.wait(scopedLock, [&sleeper] { return sleeper.woken; });
+    wakeup.m_sleeper = nullptr;
+    wakeup.m_pending = false;
+    if (m_stopped) {
+        throw Stopped();
+    }
+}
+
+/**
+ * Takes the sleeper off the timeline without moving the clock.  The waking thread makes it
+ * runnable, as released() would.
+ */
+void DiscreteEventClock::wake(Wakeup& wakeup) {
+    std::lock_guard<std::mutex> scopedLock(m_mutex);
+    Sleeper* sleeper = static_cast<Sleeper*>(wakeup.m_sleeper);
+    if (sleeper == nullptr) {
+        wakeup.m_pending = true;
+        return;
+    }
+    if (sleeper->woken) {
+        return;
+    }
+    typedef std::multimap<Duration, Sleeper*>::iterator SleeperIterator;
+    const std::pair<SleeperIterator, SleeperIterator> range = m_sleepers.equal_range(sleeper->time);
+    for (SleeperIterator entry = range.first; entry != range.second; ++entry) {
+        if (entry->second == sleeper) {
+            m_sleepers.erase(entry);
+            break;
+        }
+    }
+    sleeper->woken = true;
+    ++m_runnableCount;
+    sleeper->wakeControl.notify_one();
+}
+
+void DiscreteEventClock::stop() {
+    std::lock_guard<std::mutex> scopedLock(m_mutex);
+    Clock::stop();
+    for (std::multimap<Duration, Sleeper*>::value_type& sleeper : m_sleepers) {
+        sleeper.second->woken = true;
+        sleeper.second->wakeControl.notify_one();
+    }
+    m_sleepers.clear();
+}
+
+void DiscreteEventClock::attach() {
+    std::lock_guard<std::mutex> scopedLock(m_mutex);
+    ++m_runnableCount;
+}
+
+void DiscreteEventClock::detach() {
+    std::lock_guard<std::mutex> scopedLock(m_mutex);
+    --m_runnableCount;
+    advance();
+}
+
+void DiscreteEventClock::blocked() {
+    std::lock_guard<std::mutex> scopedLock(m_mutex);
+    --m_runnableCount;
+    advance();
+}
+
+void DiscreteEventClock::released(uint32_t count) {
+    std::lock_guard<std::mutex> scopedLock(m_mutex);
+    m_runnableCount += count;
+}
+
+/**
+ * Jumps to the earliest wake-up time once nothing else can run and wakes the sleeper that went to
+ * sleep first for that time.  Sleepers due at the same time are woken one after another, each once
+ * the previous one (and whatever it set off) has blocked again, so that runs are reproducible.
+ * Called with m_mutex held.
+ */
+void DiscreteEventClock::advance() {
+    if ((m_runnableCount > 0) || m_sleepers.empty()) {
+        return;
+    }
+    const Duration wakeTime = m_sleepers.begin()->first;
+    if (wakeTime > m_now) {
+        m_now = wakeTime;
+    }
+    Sleeper* sleeper = m_sleepers.begin()->second;
+    m_sleepers.erase(m_sleepers.begin());
+    sleeper->woken = true;
+    ++m_runnableCount;
+    sleeper->wakeControl.notify_one();
+}
@@ -5,18 +5,62 @@
 #include <sys/socket.h> 
 #include <netinet/in.h> 
 #include <string.h>
-#include <iostream>
+#include <time.h>
+#ifdef __linux__
+#include <linux/errqueue.h>
+#include <linux/net_tstamp.h>
+#endif
 #include "Communications.hpp"
+#include "FrameDecoder.hpp"
+#include "Log.hpp"
+#include "Metrics.hpp"
+#include "ThreadProfile.hpp"
+#include "Trace.hpp"
 
 using namespace std;
 
 const int32_t STATUS_SUCCESS(0);
 const int32_t STATUS_FAILURE(-1);
-std::string START_OF_TEXT = "\a\a";
-std::string END_OF_TEXT = "\b\b";
+
+namespace {
+
+    const size_t CONTROL_SIZE = 256;    // Room for the receive timestamp control message
+
+    uint64_t realTimeNs() {
+        struct timespec time;
+        clock_gettime(CLOCK_REALTIME, &time);
+        return static_cast<uint64_t>(time.tv_sec) * 1000000000ULL + time.tv_nsec;
+    }
+
+    /**
+     * @return the kernel's software receive timestamp of the data just read, or 0 if it has none
+     */
+    uint64_t kernelTimestamp(struct msghdr& message) {
+#ifdef SO_TIMESTAMPING
+        for (struct cmsghdr* control = CMSG_FIRSTHDR(&message); control != nullptr;
+             control = CMSG_NXTHDR(&message, control)) {
+            if ((control->cmsg_level == SOL_SOCKET) && (control->cmsg_type == SCM_TIMESTAMPING)) {
+                // The software timestamp comes first; the others are for hardware timestamping
+                struct scm_timestamping timestamps;
+                memcpy(&timestamps, CMSG_DATA(control), sizeof(timestamps));
+                return static_cast<uint64_t>(timestamps.ts[0].tv_sec) * 1000000000ULL + timestamps.ts[0].tv_nsec;
+            }
+        }
+#endif
+        return 0;
+    }
+}
 
 Communications::Communications(CommunicationsEventHandler* communicationsEventHandler)
-    : m_socketFd(STATUS_FAILURE), m_eventHandler(communicationsEventHandler), m_thread(nullptr) {
+    : m_socketFd(STATUS_FAILURE), m_eventHandler(communicationsEventHandler), m_thread(nullptr),
+      m_receiveTimestamps(false), m_capture(nullptr), m_replay(), m_sent(false), m_sentControl(), m_closing(false),
+      m_joinMutex() {
+    nameLock(m_mutex, "communications");
+    nameLock(m_joinMutex, "communications", "join");
+}
+
+void Communications::connect(CommunicationsEventHandler& eventHandler, Clock& /* clock */) {
+    m_eventHandler = &eventHandler;
 }
 
 bool Communications::openSocket(string ipAddress, uint32_t port) {
@@ -25,7 +69,7 @@ bool Communications::openSocket(string ipAddress, uint32_t port) {
     m_socketFd = socket(AF_INET, SOCK_STREAM, USE_DEFAULT_PROTOCOL);
     
     if (m_socketFd == STATUS_FAILURE) {
-        std::cerr << "failed to create socket" << std::endl;
+        LOG_ERROR("failed to create socket");
         return false;
     }
     
@@ -35,64 +79,203 @@ bool Communications::openSocket(string ipAddress, uint32_t port) {
     server.sin_addr.s_addr = inet_addr(ipAddress.c_str());
     server.sin_port = htons(port);
     
-    if (connect(m_socketFd, (struct sockaddr *) &server, sizeof(server)) < 0) {
-        std::cout << "failed to connect" << std::endl;
+    if (::connect(m_socketFd, (struct sockaddr *) &server, sizeof(server)) < 0) {
+        LOG_ERROR("failed to connect to {}:{}", ipAddress, port);
         return false;
     }
+    if (m_receiveTimestamps) {
+#ifdef SO_TIMESTAMPING
+        const int flags = SOF_TIMESTAMPING_RX_SOFTWARE | SOF_TIMESTAMPING_SOFTWARE;
+        if (setsockopt(m_socketFd, SOL_SOCKET, SO_TIMESTAMPING, &flags, sizeof(flags)) == STATUS_FAILURE) {
+            LOG_WARNING("kernel receive timestamps are not available");
+            m_receiveTimestamps = false;
+        }
+#else
+        LOG_WARNING("kernel receive timestamps are not supported on this platform");
+        m_receiveTimestamps = false;
+#endif
+    }
     m_eventHandler->handleConnectionEstablished();
     m_thread = new std::thread(&Communications::receiverThread, this);
     return true;
 }
 
-void Communications::sendMessage(std::string text) {
-    std::lock_guard<std::mutex> scopedLock(m_mutex);
-    //std::cout << "Sent: " << text << std::endl;
-    text = START_OF_TEXT + text + END_OF_TEXT;
-    if (send(m_socketFd, text.c_str(), text.size(), 0) == STATUS_FAILURE) {
-        close(m_socketFd);
+bool Communications::openReplay(string capturePath, double speed, Clock& clock) {
+    m_replay.reset(new WireReplay());
+    if (!m_replay->open(capturePath)) {
+        m_replay.reset();
+        return false;
+    }
+    m_eventHandler->handleConnectionEstablished();
+    m_thread = clock.newThread(&Communications::replayThread, this, speed, &clock);
+    return true;
+}
+
+void Communications::setReceiveTimestamps(bool enabled) {
+    m_receiveTimestamps = enabled;
+}
+
+void Communications::setCapture(WireCapture* capture) {
+    m_capture = capture;
+}
+
+void Communications::waitUntilClosed() {
+    std::lock_guard<Mutex> scopedLock(m_joinMutex);
+    if (m_thread != nullptr) {
+        m_thread->join();
+        delete m_thread;
+        m_thread = nullptr;
+    }
+}
+
+/**
+ * Shutting the socket down ends the receiver's read with end of file, without closing a descriptor
+ * it may still be using.  The replay stops at its next frame, or straight away if it is still
+ * waiting for the first frame to be sent; a paced replay is woken by the stopped clock.  Called
+ * on the receiving thread itself, it only asks the thread to stop.
+ */
+void Communications::disconnect() {
+    {
+        std::lock_guard<Mutex> scopedLock(m_mutex);
+        m_closing = true;
+        if (m_socketFd != STATUS_FAILURE) {
+            shutdown(m_socketFd, SHUT_RDWR);
+        }
+        m_sentControl.notify_all();
+    }
+    std::lock_guard<Mutex> scopedLock(m_joinMutex);
+    if ((m_thread != nullptr) && (m_thread->get_id() != std::this_thread::get_id())) {
+        m_thread->join();
+        delete m_thread;
+        m_thread = nullptr;
+    }
+}
+
+void Communications::sendMessage(const std::string& text) {
+    std::lock_guard<Mutex> scopedLock(m_mutex);
+    LOG_TRACE("Sent: {}", text);
+    if (m_capture != nullptr) {
+        m_capture->record(WireCaptureFormat::OUTBOUND, text.data(), text.size());
+    }
+    if (m_replay) {
+        if (!m_sent) {
+            m_sent = true;
+            m_sentControl.notify_all();
+        }
+        return;
+    }
+    const std::string frame = FrameDecoder::encode(text);
+    const uint64_t startNs = Metrics::nowNs();
+    if (send(m_socketFd, frame.c_str(), frame.size(), 0) == STATUS_FAILURE) {
+        closeSocket();
         m_eventHandler->handleConnectionLost();
         throw std::runtime_error("failed send");
     }
+    Metrics::sendBlockedTime.record(Metrics::nowNs() - startNs);
+    Metrics::bytesSent.add(frame.size());
 }
 
 void Communications::receiverThread() {
-    std::cout << "Started receiver thread" << std::endl;
+    LOG_INFO("Started receiver thread");
+    Trace::setThreadName("receiver");
+    ThreadProfile::apply(ThreadProfile::ROLE_RECEIVER);
 
     const int BUFFER_SIZE(8 * 1024);
     char buffer[BUFFER_SIZE];
 
-    size_t startIndex = string::npos;
-    size_t endIndex = string::npos;
-    string data;
+    FrameDecoder frameDecoder;
+    string messageText;
+
+    // Frames completed by a read are stamped with the arrival of that read's data
+    char control[CONTROL_SIZE];
+    struct iovec data;
+    data.iov_base = buffer;
+    data.iov_len = BUFFER_SIZE;
+    struct msghdr message;
+    memset(&message, 0, sizeof(message));
+    message.msg_iov = &data;
+    message.msg_iovlen = 1;
+    uint64_t readNs = 0;
+    uint64_t arrivalNs = 0;
 
     for (;;) {
-        if (startIndex == string::npos)
-            startIndex = data.find(START_OF_TEXT, 0);
-
-        if (startIndex != string::npos)
-            endIndex = data.find(END_OF_TEXT, startIndex);
-
-        if (endIndex != string::npos) {
-            string messageText = data.substr(startIndex + START_OF_TEXT.size(), endIndex - (startIndex + START_OF_TEXT.size()));
-            m_eventHandler->handleMessageReceived(messageText);
-            data = data.substr(endIndex + END_OF_TEXT.size(), data.length() - (endIndex + END_OF_TEXT.size()));
-            startIndex = string::npos;
-            endIndex = string::npos;
-            if (data.length() > 0) {
-                continue;
+        while (frameDecoder.next(messageText)) {
+            TRACE_SCOPE("receive");
+            if (m_capture != nullptr) {
+                m_capture->record(WireCaptureFormat::INBOUND, messageText.data(), messageText.size());
             }
+            m_eventHandler->handleMessageReceived(messageText, arrivalNs);
+            Metrics::handlerTime.record(realTimeNs() - readNs);
         }
 
-        int receivedCount = recv(m_socketFd, buffer, BUFFER_SIZE, 0);
+        message.msg_control = m_receiveTimestamps ? control : nullptr;
+        message.msg_controllen = m_receiveTimestamps ? sizeof(control) : 0;
+        int receivedCount = recvmsg(m_socketFd, &message, 0);
 
         if (receivedCount <= 0) {
-            close(m_socketFd);
+            std::lock_guard<Mutex> scopedLock(m_mutex);
+            closeSocket();
             return;
         }
+        readNs = realTimeNs();
+        arrivalNs = readNs;
+        if (m_receiveTimestamps) {
+            const uint64_t kernelNs = kernelTimestamp(message);
+            if ((kernelNs != 0) && (kernelNs <= readNs)) {
+                arrivalNs = kernelNs;
+                Metrics::socketQueueTime.record(readNs - kernelNs);
+            }
+        }
+        Metrics::bytesReceived.add(receivedCount);
 
-        buffer[receivedCount] = '\0';
-        string newData(buffer, receivedCount);
-        data.append(newData);
+        frameDecoder.append(buffer, receivedCount);
     }
 }
 
+void Communications::replayThread(double speed, Clock* clock) {
+    LOG_INFO("Started replay thread at {}x", speed);
+    Trace::setThreadName("replay");
+    ThreadProfile::apply(ThreadProfile::ROLE_RECEIVER);
+
+    // Pace the replay from its first record, or from the first frame sent if that came first
+    WireReplay::Record record;
+    if (!m_replay->next(record)) {
+        record.timestampNs = 0;
+        record.direction = WireCaptureFormat::INBOUND;
+    }
+    m_replay->rewind();
+    if (record.direction == WireCaptureFormat::OUTBOUND) {
+        std::unique_lock<Mutex> scopedLock(m_mutex);
+        m_sentControl.wait(scopedLock, [this] { return m_sent || m_closing; });
+    }
+    const Clock::Duration start = clock->now();
+    const uint64_t startTimestampNs = record.timestampNs;
+    uint64_t frameCount = 0;
+    string messageText;
+
+    while (!m_closing && m_replay->next(record)) {
+        if (record.direction != WireCaptureFormat::INBOUND) {
+            continue;
+        }
+        if ((speed > 0) && (record.timestampNs > startTimestampNs)) {
+            clock->sleepUntil(start + Clock::Duration(static_cast<int64_t>((record.timestampNs - startTimestampNs) / speed)));
+        }
+        TRACE_SCOPE("receive");
+        messageText.assign(record.data, record.size);
+        m_eventHandler->handleMessageReceived(messageText);
+        ++frameCount;
+    }
+    LOG_INFO("Replay finished after {} frames", frameCount);
+    m_eventHandler->handleConnectionLost();
+}
+
+/**
+ * Closes the socket once, whichever of the receiver and a failed send gets there first.  Called
+ * with m_mutex held.
+ */
+void Communications::closeSocket() {
+    if (m_socketFd != STATUS_FAILURE) {
+        close(m_socketFd);
+        m_socketFd = STATUS_FAILURE;
+    }
+}
@@ -0,0 +1,236 @@
+#include <algorithm>
+#include "Executor.hpp"
+#include "Metrics.hpp"
+#include "ThreadProfile.hpp"
+#include "Trace.hpp"
+
+namespace {
+    thread_local Executor* t_executor = nullptr;    // Executor whose worker the thread is, if any
+    thread_local uint32_t  t_workerIndex = 0;
+}
+
+Executor::Executor(Clock& clock, uint32_t workerCount)
+: m_clock(clock),
+  m_workers(),
+  m_nextWorker(0),
+  m_queuedCount(0),
+  m_stopping(false),
+  m_runInline(clock.isDiscrete()),
+  m_parkMutex(),
+  m_parkControl(),
+  m_parkedCount(0),
+  m_wakeCount(0),
+  m_timerMutex(),
+  m_timerControl(),
+  m_timers(),
+  m_timerThreadParked(false),
+  m_timerWakeup(),
+  m_timerThread(),
+  m_joinMutex() {
+    if (workerCount == 0) {
+        workerCount = std::max(std::thread::hardware_concurrency(), 1u);
+    }
+    nameLock(m_parkMutex, "executor", "park");
+    nameLock(m_timerMutex, "executor", "timers");
+    for (uint32_t index = 0; index < workerCount; ++index) {
+        m_workers.push_back(std::unique_ptr<Worker>(new Worker()));
+        nameLock(m_workers.back()->mutex, "executor", "worker " + std::to_string(index));
+    }
+    for (uint32_t index = 0; index < workerCount; ++index) {
+        m_workers[index]->thread.reset(m_clock.newThread(&Executor::runWorker, this, index));
+    }
+    m_timerThread.reset(m_clock.newThread(&Executor::runTimers, this));
+}
+
+Executor::~Executor() {
+    stop();
+    join();
+}
+
+void Executor::submit(Task task) {
+    if (m_stopping) {
+        return;
+    }
+    if (m_runInline) {
+        {
+            TRACE_SCOPE("task");
+            task();
+        }
+        Metrics::tasksExecuted.add();
+        return;
+    }
+    const uint32_t index = (t_executor == this)
+                         ? t_workerIndex
+                         : m_nextWorker.fetch_add(1, std::memory_order_relaxed) % m_workers.size();
+    push(index, std::move(task));
+}
+
+void Executor::schedule(Clock::Duration delay, Task task) {
+    const Clock::Duration dueTime = m_clock.now() + delay;
+    std::lock_guard<Mutex> scopedLock(m_timerMutex);
+    if (m_stopping) {
+        return;
+    }
+    const bool earliest = m_timers.empty() || (dueTime < m_timers.begin()->first);
+    m_timers.insert(std::make_pair(dueTime, std::move(task)));
+    if (m_timerThreadParked) {
+        m_timerThreadParked = false;
+        m_clock.released(1);
+        m_timerControl.notify_one();
+    }
+    else if (earliest) {
+        m_clock.wake(m_timerWakeup);
+    }
+}
+
+/**
+ * Parked threads are handed back to the clock as runnable so that they can detach from it on
+ * their way out.
+ */
+void Executor::stop() {
+    m_stopping = true;
+    {
+        std::lock_guard<Mutex> scopedLock(m_parkMutex);
+        if (m_parkedCount > 0) {
+            m_clock.released(m_parkedCount);
+            m_parkedCount = 0;
+        }
+        m_parkControl.notify_all();
+    }
+    {
+        std::lock_guard<Mutex> scopedLock(m_timerMutex);
+        m_timers.clear();
+        if (m_timerThreadParked) {
+            m_timerThreadParked = false;
+            m_clock.released(1);
+        }
+        m_timerControl.notify_all();
+    }
+    for (std::unique_ptr<Worker>& worker : m_workers) {
+        std::lock_guard<Mutex> scopedLock(worker->mutex);
+        m_queuedCount -= worker->tasks.size();
+        worker->tasks.clear();
+    }
+}
+
+void Executor::join() {
+    std::lock_guard<Mutex> scopedLock(m_joinMutex);
+    for (std::unique_ptr<Worker>& worker : m_workers) {
+        if (worker->thread->joinable()) {
+            worker->thread->join();
+        }
+    }
+    if (m_timerThread->joinable()) {
+        m_timerThread->join();
+    }
+}
+
+void Executor::push(uint32_t index, Task task) {
+    Worker& worker = *m_workers[index];
+    {
+        std::lock_guard<Mutex> scopedLock(worker.mutex);
+        worker.tasks.push_back(std::move(task));
+        ++m_queuedCount;
+    }
+    std::lock_guard<Mutex> scopedLock(m_parkMutex);
+    if (m_parkedCount > 0) {
+        --m_parkedCount;
+        ++m_wakeCount;
+        m_clock.released(1);
+        m_parkControl.notify_one();
+    }
+}
+
+/**
+ * Pops the newest task of the worker's own deque or, failing that, steals the oldest task of the
+ * next worker that has one.
+ */
+bool Executor::takeTask(uint32_t index, Task& task) {
+    {
+        Worker& worker = *m_workers[index];
+        std::lock_guard<Mutex> scopedLock(worker.mutex);
+        if (!worker.tasks.empty()) {
+            task = std::move(worker.tasks.back());
+            worker.tasks.pop_back();
+            --m_queuedCount;
+            return true;
+        }
+    }
+    for (uint32_t offset = 1; offset < m_workers.size(); ++offset) {
+        Worker& victim = *m_workers[(index + offset) % m_workers.size()];
+        std::lock_guard<Mutex> scopedLock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            --m_queuedCount;
+            Metrics::tasksStolen.add();
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * A worker parks only after finding every deque empty under the park lock, and push() takes the
+ * same lock after queuing, so a task is never left behind with every worker parked.
+ */
+void Executor::runWorker(uint32_t index) {
+    Trace::setThreadName("executor");
+    ThreadProfile::apply(ThreadProfile::ROLE_CONTROLLER);
+    t_executor = this;
+    t_workerIndex = index;
+    Task task;
+    while (!m_stopping) {
+        if (takeTask(index, task)) {
+            {
+                TRACE_SCOPE("task");
+                task();
+            }
+            task = nullptr;
+            Metrics::tasksExecuted.add();
+            continue;
+        }
+        std::unique_lock<Mutex> scopedLock(m_parkMutex);
+        if (m_stopping || (m_queuedCount > 0)) {
+            continue;
+        }
+        ++m_parkedCount;
+        m_clock.blocked();
+        m_parkControl.wait(scopedLock, [this] { return (m_wakeCount > 0) || m_stopping; });
+        if (m_wakeCount > 0) {
+            --m_wakeCount;
+        }
+    }
+    t_executor = nullptr;
+}
+
+/**
+ * Sleeps on the clock until the earliest timer is due; schedule() cuts the sleep short when it
+ * adds a timer that is due sooner.  With no timers at all the thread parks as blocked until
+ * schedule() adds one.
+ */
+void Executor::runTimers() {
+    Trace::setThreadName("executor timers");
+    std::unique_lock<Mutex> scopedLock(m_timerMutex);
+    while (!m_stopping) {
+        if (m_timers.empty()) {
+            m_timerThreadParked = true;
+            m_clock.blocked();
+            m_timerControl.wait(scopedLock, [this] { return !m_timerThreadParked; });
+            continue;
+        }
+        const Clock::Duration now = m_clock.now();
+        if (m_timers.begin()->first <= now) {
+            Task task(std::move(m_timers.begin()->second));
+            m_timers.erase(m_timers.begin());
+            scopedLock.unlock();
+            submit(std::move(task));
+            scopedLock.lock();
+            continue;
+        }
+        const Clock::Duration wakeTime = m_timers.begin()->first;
+        scopedLock.unlock();
+        m_clock.sleepUntil(wakeTime, m_timerWakeup);
+        scopedLock.lock();
+    }
+}
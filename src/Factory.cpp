@@ -1,10 +1,19 @@
 
+#include <time.h>
+#include <algorithm>
+#include <exception>
 #include <string>
-#include <iostream>
+#include <vector>
 #include "rapidjson/document.h"
 #include "rapidjson/writer.h"
 #include "rapidjson/stringbuffer.h"
 #include "Factory.hpp"
+#include "Log.hpp"
+#include "Metrics.hpp"
+#include "RuleEngine.hpp"
+#include "Station.hpp"
+#include "TagNames.hpp"
+#include "Trace.hpp"
 
 using namespace rapidjson;
 
@@ -20,86 +29,552 @@ public:
         
     }
     virtual void handleMessageReceived(std::string message) {
-        std::cout << "Received: " << message << std::endl;
+        LOG_DEBUG("Received frame of {} bytes", message.size());
+        LOG_SAMPLED(LOG_LEVEL_INFO, FRAME_LOG_INTERVAL, "Received: {}", message);
         m_factory->handleNewSensorValues(message);
         
     }
+    virtual void handleMessageReceived(std::string message, uint64_t arrivalNs) {
+        m_factory->setArrivalTime(arrivalNs);
+        handleMessageReceived(message);
+    }
     private:
+        static const uint32_t FRAME_LOG_INTERVAL = 100;     // Log one frame payload in this many
+
         Factory* m_factory;
 };
 
 Factory::Factory() 
-    : m_communications(new FactoryCommunicationsEventHandler(this)),
-      m_actuatorSerializerList(), m_sensorDeserializerList(), m_mutex() { 
+    : Factory(Clock::realTime()) {
+}
+
+Factory::Factory(Clock& clock)
+    : m_clock(clock),
+      m_eventHandler(new FactoryCommunicationsEventHandler(this)),
+      m_capture(),
+      m_communications(m_eventHandler.get()),
+      m_transport(&m_communications),
+      m_actuatorSerializerList(new ActuatorSerializerList()),
+      m_sensorRegistry(new SensorRegistry()),
+      m_registrationMutex(), m_pendingMutex(), m_pendingFrame(), m_flushing(false), m_outboundMutex(),
+      m_dispatchMutex(), m_changedSensors(), m_changedStations(), m_changedRuleEngines(), m_dispatchCount(0),
+      m_loadPending(false),
+      m_waitMutex(),
+      m_changeControl(),
+      m_changeCount(0),
+      m_publishedChangeCount(0),
+      m_waiterCount(0),
+      m_notifyTimeNs(0),
+      m_arrivalNs(0),
+      m_pipeline(),
+      m_executor(),
+      m_metricsCollector(Metrics::addCollector([this](std::ostream& output) { writeMetrics(output); })) {
+    m_pendingFrame.SetObject();
+    nameLock(m_registrationMutex, "factory", "registration");
+    nameLock(m_pendingMutex, "factory", "pending");
+    nameLock(m_outboundMutex, "factory", "outbound");
+    nameLock(m_dispatchMutex, "factory", "dispatch");
+    nameLock(m_waitMutex, "factory", "wait");
+}
+
+Factory::~Factory() {
+    Metrics::removeCollector(m_metricsCollector);
 }
 
 bool Factory::start() {
-    std::cout << "Waiting for connection to factory..." << std::endl;
-    bool success = m_communications.openSocket(IP_ADDRESS, TCP_PORT);
+    return start(IP_ADDRESS, TCP_PORT);
+}
+
+bool Factory::start(std::string ipAddress, uint32_t port) {
+    LOG_INFO("Waiting for connection to factory at {}:{}...", ipAddress, port);
+    bool success = m_communications.openSocket(ipAddress, port);
     if (success) {
-        std::cout << "Connection established!" << std::endl;
+        LOG_INFO("Connection established!");
     }
     else {
-        std::cerr << "Failed to make connection" << std::endl;
+        LOG_ERROR("Failed to make connection");
     }
     return success;
 }
 
+bool Factory::start(Transport& transport) {
+    if (m_pipeline) {
+        LOG_WARNING("The sensor pipeline hands frames to other threads; a discrete-event clock will not see them");
+    }
+    m_transport = &transport;
+    transport.connect(*m_eventHandler, m_clock);
+    LOG_INFO("Connected to in-process transport");
+    return true;
+}
+
+void Factory::enableReceiveTimestamps() {
+    m_communications.setReceiveTimestamps(true);
+}
+
+void Factory::setArrivalTime(uint64_t arrivalNs) {
+    m_arrivalNs.store(arrivalNs, std::memory_order_relaxed);
+}
+
+uint64_t Factory::getArrivalTime() const {
+    return m_arrivalNs.load(std::memory_order_relaxed);
+}
+
+bool Factory::startCapture(const std::string& capturePath) {
+    std::unique_ptr<WireCapture> capture(new WireCapture());
+    if (!capture->open(capturePath)) {
+        return false;
+    }
+    m_capture = std::move(capture);
+    m_communications.setCapture(m_capture.get());
+    return true;
+}
+
+bool Factory::startReplay(const std::string& capturePath, double speed) {
+    LOG_INFO("Replaying {}", capturePath);
+    return m_communications.openReplay(capturePath, speed, m_clock);
+}
+
+void Factory::waitUntilDisconnected() {
+    m_communications.waitUntilClosed();
+    if (m_capture) {
+        m_capture->flush();
+    }
+}
+
+Clock& Factory::getClock() {
+    return m_clock;
+}
+
 Factory& Factory::add(ActuatorSerializer* actuatorSerializer) {
-    std::lock_guard<std::mutex> scopedLock(m_mutex);
-    m_actuatorSerializerList.push_back(actuatorSerializer);
+    std::lock_guard<Mutex> scopedLock(m_registrationMutex);
+    std::shared_ptr<ActuatorSerializerList> actuatorSerializerList(
+        new ActuatorSerializerList(*m_actuatorSerializerList));
+    actuatorSerializerList->push_back(actuatorSerializer);
+    m_actuatorSerializerList = actuatorSerializerList;
     return *this;
 }
 
 Factory& Factory::add(SensorDeserializer* sensorDeserializer) {
-    std::lock_guard<std::mutex> scopedLock(m_mutex);
-    m_sensorDeserializerList.push_back(sensorDeserializer);
+    return add(sensorDeserializer, nullptr);
+}
+
+/**
+ * Registers a sensor under its tag name.  Sensors without a name read the whole frame.
+ */
+Factory& Factory::add(SensorDeserializer* sensorDeserializer, Station* station) {
+    const TagId tag = sensorDeserializer->getTag();
+    const SensorEntry entry = { sensorDeserializer, station, std::vector<RuleBinding>() };
+    std::lock_guard<Mutex> scopedLock(m_registrationMutex);
+    std::shared_ptr<SensorRegistry> sensorRegistry(new SensorRegistry(*m_sensorRegistry));
+    sensorRegistry->sensors.push_back(sensorDeserializer);
+    if (tag == TagNames::NO_TAG) {
+        sensorRegistry->untagged.push_back(entry);
+    }
+    else {
+        if (tag >= sensorRegistry->tags.size()) {
+            sensorRegistry->tags.resize(tag + 1);
+        }
+        std::vector<SensorEntry>& entries = sensorRegistry->tags[tag];
+        if (!entries.empty() && (entries.front().station != station)) {
+            LOG_WARNING("Tag {} is read by more than one station", TagNames::getName(tag));
+        }
+        entries.push_back(entry);
+    }
+    if ((station != nullptr) &&
+        (std::find(sensorRegistry->stations.begin(), sensorRegistry->stations.end(), station) ==
+         sensorRegistry->stations.end())) {
+        sensorRegistry->stations.push_back(station);
+    }
+    m_sensorRegistry = sensorRegistry;
+    return *this;
+}
+
+/**
+ * Binds each sensor input of a started rule engine to the sensor's registry entries.
+ */
+Factory& Factory::add(RuleEngine* ruleEngine) {
+    std::lock_guard<Mutex> scopedLock(m_registrationMutex);
+    std::shared_ptr<SensorRegistry> sensorRegistry(new SensorRegistry(*m_sensorRegistry));
+    for (uint32_t input = 0; input < ruleEngine->m_inputs.size(); ++input) {
+        const SensorDeserializer* sensor = ruleEngine->m_inputs[input].sensor;
+        if (sensor == nullptr) {
+            continue;
+        }
+        const RuleBinding binding = { ruleEngine, input };
+        bool bound = false;
+        for (std::vector<SensorEntry>& entries : sensorRegistry->tags) {
+            for (SensorEntry& entry : entries) {
+                if (entry.sensor == sensor) {
+                    entry.rules.push_back(binding);
+                    bound = true;
+                }
+            }
+        }
+        for (SensorEntry& entry : sensorRegistry->untagged) {
+            if (entry.sensor == sensor) {
+                entry.rules.push_back(binding);
+                bound = true;
+            }
+        }
+        if (!bound) {
+            LOG_WARNING("Rule input {} is not a registered sensor", ruleEngine->m_inputs[input].name);
+        }
+    }
+    m_sensorRegistry = sensorRegistry;
     return *this;
 }
 
 void Factory::applyChanges(std::list<ActuatorSerializer*>& actuatorSerializerList) {
-    rapidjson::Document jsonDocument;
-    jsonDocument.SetObject();
-    for (ActuatorSerializer* actuatorSerializer : actuatorSerializerList)
-        actuatorSerializer->serialize(jsonDocument, true);
+    TRACE_SCOPE("applyChanges");
+    Trace::endFlow();
+    {
+        std::lock_guard<Mutex> scopedLock(m_pendingMutex);
+        for (ActuatorSerializer* actuatorSerializer : actuatorSerializerList)
+            actuatorSerializer->serialize(m_pendingFrame, true);
+        if (m_flushing) {
+            Metrics::changesMerged.add();
+            return;
+        }
+        m_flushing = true;
+    }
+    flushChanges();
+}
+
+void Factory::applyChanges() {
+    TRACE_SCOPE("applyChanges");
+    Trace::endFlow();
+    std::shared_ptr<const ActuatorSerializerList> actuatorSerializerList = actuatorSerializers();
+    {
+        std::lock_guard<Mutex> scopedLock(m_pendingMutex);
+        for (ActuatorSerializer* actuatorSerializer : *actuatorSerializerList)
+            actuatorSerializer->serialize(m_pendingFrame, true);
+        if (m_flushing) {
+            Metrics::changesMerged.add();
+            return;
+        }
+        m_flushing = true;
+    }
+    flushChanges();
+}
+
+/**
+ * Sends the pending frame until no changes are left.  Only one thread flushes at a time, so frames
+ * leave in the order their changes were taken, and changes added while a frame is being sent go
+ * out together in the next one.  A failed send gives up the flush, so the next station to apply
+ * its changes sends whatever is still pending, and the error goes to the station that was sending.
+ */
+void Factory::flushChanges() {
+    try {
+        for (;;) {
+            rapidjson::Document jsonDocument;
+            jsonDocument.SetObject();
+            {
+                std::lock_guard<Mutex> scopedLock(m_pendingMutex);
+                if (m_pendingFrame.ObjectEmpty()) {
+                    m_flushing = false;
+                    return;
+                }
+                jsonDocument.Swap(m_pendingFrame);
+            }
 
-    rapidjson::StringBuffer buffer;
-    rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
-    jsonDocument.Accept(writer);
+            rapidjson::StringBuffer buffer;
+            rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+            jsonDocument.Accept(writer);
 
-    m_communications.sendMessage(buffer.GetString());
+            std::lock_guard<Mutex> scopedLock(m_outboundMutex);
+            sendMessage(buffer.GetString());
+        }
+    }
+    catch (const std::exception& exception) {
+        LOG_ERROR("Failed to send actuator changes: {}", exception.what());
+        std::lock_guard<Mutex> scopedLock(m_pendingMutex);
+        m_flushing = false;
+        throw;
+    }
 }
 
-void Factory::applyChanges() {
-    std::lock_guard<std::mutex> scopedLock(m_mutex);
-    rapidjson::Document jsonDocument;
-    jsonDocument.SetObject();
-    for (ActuatorSerializer* actuatorSerializer : m_actuatorSerializerList)
-        actuatorSerializer->serialize(jsonDocument, true);
+void Factory::enablePipeline(size_t capacity, bool conflation) {
+    if (!m_pipeline) {
+        m_pipeline.reset(new SensorPipeline(*this, capacity, conflation));
+    }
+}
 
-    rapidjson::StringBuffer buffer;
-    rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
-    jsonDocument.Accept(writer);
+const SensorPipeline* Factory::getPipeline() const {
+    return m_pipeline.get();
+}
+
+/**
+ * Starts the executor with the given number of workers, or one per CPU.  Does nothing if the
+ * executor is already running.
+ */
+void Factory::enableExecutor(uint32_t workerCount) {
+    std::lock_guard<Mutex> scopedLock(m_registrationMutex);
+    if (!m_executor) {
+        m_executor.reset(new Executor(m_clock, workerCount));
+        LOG_INFO("Executor started with {} workers", m_executor->getWorkerCount());
+    }
+}
 
-    m_communications.sendMessage(buffer.GetString());
+Executor& Factory::getExecutor() {
+    enableExecutor();
+    return *m_executor;
 }
+
 void Factory::handleNewSensorValues(std::string jsonString) {
-    std::lock_guard<std::mutex> scopedLock(m_mutex);
+    Metrics::framesReceived.add();
+    if (m_pipeline) {
+        m_pipeline->submit(jsonString);
+        return;
+    }
     rapidjson::Document jsonDocument;
-    jsonDocument.Parse(jsonString.c_str());
-    for (SensorDeserializer* sensorDeserializer : m_sensorDeserializerList) {
-        if (sensorDeserializer->deserialize(jsonDocument)) {
-            m_changeControl.notify_all();
+    {
+        TRACE_SCOPE("parse");
+        const uint64_t startNs = Metrics::nowNs();
+        jsonDocument.Parse(jsonString.c_str());
+        Metrics::parseTime.record(Metrics::nowNs() - startNs);
+    }
+    dispatchSensorValues(jsonDocument);
+}
+
+void Factory::dispatchSensorValues(const rapidjson::Document& jsonDocument) {
+    dispatchSensorValues(jsonDocument, nullptr);
+}
+
+void Factory::dispatchSensorValues(const rapidjson::Document& jsonDocument,
+                                   const ConflatedTagMap& conflatedTags) {
+    dispatchSensorValues(jsonDocument, &conflatedTags);
+}
+
+void Factory::dispatchSensorValues(const rapidjson::Document& jsonDocument,
+                                   const ConflatedTagMap* conflatedTags) {
+    std::shared_ptr<const SensorRegistry> registry = sensorRegistry();
+    std::lock_guard<Mutex> scopedLock(m_dispatchMutex);
+    TRACE_SCOPE("dispatch");
+    const uint64_t startNs = Metrics::nowNs();
+
+    // Apply the whole frame first, then wake each interested waiter and station once
+    m_changedSensors.clear();
+    m_changedStations.clear();
+    m_changedRuleEngines.clear();
+    ++m_dispatchCount;
+    if (jsonDocument.IsObject() && !registry->tags.empty()) {
+        for (rapidjson::Value::ConstMemberIterator member = jsonDocument.MemberBegin();
+             member != jsonDocument.MemberEnd(); ++member) {
+            const TagId tag = TagNames::find(member->name.GetString(), member->name.GetStringLength());
+            if ((tag >= registry->tags.size()) || registry->tags[tag].empty()) {
+                continue;
+            }
+            const ConflatedTag* conflatedTag = nullptr;
+            if (conflatedTags != nullptr) {
+                ConflatedTagMap::const_iterator conflated = conflatedTags->find(tag);
+                conflatedTag = (conflated != conflatedTags->end()) ? &conflated->second : nullptr;
+            }
+            for (const SensorEntry& entry : registry->tags[tag]) {
+                if (entry.sensor->deserialize(member->value, conflatedTag)) {
+                    sensorChanged(entry);
+                }
+            }
+        }
+    }
+    for (const SensorEntry& entry : registry->untagged) {
+        const bool changed = (conflatedTags == nullptr)
+                           ? entry.sensor->deserialize(jsonDocument)
+                           : entry.sensor->deserialize(jsonDocument, *conflatedTags);
+        if (changed) {
+            sensorChanged(entry);
         }
     }
+    // The answer to loadSensorValues() counts as a change even if the values were already known
+    const bool loadAnswered = m_loadPending.load(std::memory_order_relaxed) && m_loadPending.exchange(false);
+    if (m_changedSensors.empty() && !loadAnswered) {
+        Metrics::dispatchTime.record(Metrics::nowNs() - startNs);
+        return;
+    }
+
+    // Rules react before any waiter is woken
+    for (RuleEngine* ruleEngine : m_changedRuleEngines) {
+        ruleEngine->evaluate();
+    }
+
+    uint32_t releasedCount = 0;
+    {
+        std::lock_guard<Mutex> waitLock(m_waitMutex);
+        ++m_changeCount;
+        m_publishedChangeCount.store(m_changeCount, std::memory_order_release);
+        releasedCount = m_waiterCount;
+        m_waiterCount = 0;
+        m_notifyTimeNs = Metrics::nowNs();
+    }
+    Trace::beginFlow("sensor frame");
+    for (SensorDeserializer* sensorDeserializer : m_changedSensors) {
+        sensorDeserializer->notifyChange();
+    }
+    for (Station* station : m_changedStations) {
+        station->notifyChange();
+    }
+    if (releasedCount > 0) {
+        m_clock.released(releasedCount);
+        m_changeControl.notify_all();
+    }
+    Metrics::dispatchTime.record(Metrics::nowNs() - startNs);
+}
+
+/**
+ * Notes a changed sensor, and its station and rule engines the first time one of their sensors
+ * changes in this dispatch.  Called with m_dispatchMutex held.
+ */
+void Factory::sensorChanged(const SensorEntry& entry) {
+    m_changedSensors.push_back(entry.sensor);
+    if ((entry.station != nullptr) && (entry.station->m_dispatchCount != m_dispatchCount)) {
+        entry.station->m_dispatchCount = m_dispatchCount;
+        m_changedStations.push_back(entry.station);
+    }
+    for (const RuleBinding& binding : entry.rules) {
+        if (binding.engine->m_dispatchCount != m_dispatchCount) {
+            binding.engine->m_dispatchCount = m_dispatchCount;
+            m_changedRuleEngines.push_back(binding.engine);
+        }
+        binding.engine->sensorChanged(binding.input);
+    }
 }
 
 void Factory::loadSensorValues() {
-    m_communications.sendMessage("{\"Send Sensor Data\":true}");
-    waitForSensorChange();
+    std::unique_lock<Mutex> scopedLock(m_waitMutex);
+    const uint64_t changeCount = m_changeCount;
+    scopedLock.unlock();
+    m_loadPending = true;
+    {
+        std::lock_guard<Mutex> outboundLock(m_outboundMutex);
+        sendMessage("{\"Send Sensor Data\":true}");
+    }
+    scopedLock.lock();
+    waitForSensorChange(scopedLock, changeCount);
 }
 
 void Factory::waitForSensorChange() {
-    std::unique_lock<std::mutex> scopedLock(m_mutex);
-    m_changeControl.wait(scopedLock);
+    waitForSensorChange(WAIT_BLOCK);
+}
+
+void Factory::waitForSensorChange(WaitStrategy waitStrategy) {
+    std::unique_lock<Mutex> scopedLock(m_waitMutex);
+    waitForSensorChange(scopedLock, m_changeCount, waitStrategy);
+}
+
+void Factory::waitForSensorChange(std::unique_lock<Mutex>& scopedLock, uint64_t changeCount,
+                                  WaitStrategy waitStrategy) {
+    if (m_changeCount != changeCount) {
+        return;
+    }
+    TRACE_SCOPE("waitForSensorChange");
+    ++m_waiterCount;
+    m_clock.blocked();
+    if (waitStrategy != WAIT_BLOCK) {
+        scopedLock.unlock();
+        spinUntil(waitStrategy, [this, changeCount] {
+            return (m_publishedChangeCount.load(std::memory_order_acquire) != changeCount) || m_clock.isStopped();
+        });
+        scopedLock.lock();
+    }
+    m_changeControl.wait(scopedLock, [this, changeCount] {
+        return (m_changeCount != changeCount) || m_clock.isStopped();
+    });
+    if (m_changeCount == changeCount) {
+        throw Clock::Stopped();
+    }
+    Metrics::wakeLatency.record(Metrics::nowNs() - m_notifyTimeNs);
+    Trace::adoptFlow();
+}
+
+void Factory::stop() {
+    m_clock.stop();
+    {
+        std::lock_guard<Mutex> waitLock(m_waitMutex);
+    }
+    m_changeControl.notify_all();
+    std::shared_ptr<const SensorRegistry> registry = sensorRegistry();
+    for (SensorDeserializer* sensorDeserializer : registry->sensors) {
+        sensorDeserializer->notifyStop();
+    }
+    for (Station* station : registry->stations) {
+        station->notifyStop();
+    }
+    {
+        std::lock_guard<Mutex> scopedLock(m_registrationMutex);
+        if (m_executor) {
+            m_executor->stop();
+        }
+    }
+    m_transport->disconnect();
+}
+
+void Factory::sendMessage(const std::string& text) {
+    Metrics::framesSent.add();
+    m_transport->sendMessage(text);
+}
+
+void Factory::writeMetrics(std::ostream& output) const {
+    const uint64_t arrivalNs = getArrivalTime();
+    if (arrivalNs != 0) {
+        struct timespec time;
+        clock_gettime(CLOCK_REALTIME, &time);
+        const int64_t ageNs = static_cast<int64_t>(time.tv_sec) * 1000000000LL + time.tv_nsec - arrivalNs;
+        Metrics::writeHeader(output, "factoryio_sensor_data_age_seconds", "gauge",
+                             "Time since the latest sensor frame arrived");
+        Metrics::writeSample(output, "factoryio_sensor_data_age_seconds", {}, ageNs / 1e9);
+    }
+    std::shared_ptr<const SensorRegistry> registry = sensorRegistry();
+    Metrics::writeHeader(output, "factoryio_sensor_changes_total", "counter", "Value changes seen by each sensor");
+    for (SensorDeserializer* sensorDeserializer : registry->sensors) {
+        const std::string name = sensorDeserializer->getName();
+        if (!name.empty()) {
+            Metrics::writeSample(output, "factoryio_sensor_changes_total", { { "tag", name } },
+                                 sensorDeserializer->getChangeCount());
+        }
+    }
+    if (!m_pipeline) {
+        return;
+    }
+    const SensorPipeline::Statistics statistics = m_pipeline->getStatistics();
+    const std::pair<const char*, const SensorPipeline::StageStatistics*> stages[] = {
+        { "framing", &statistics.framing }, { "parsing", &statistics.parsing }, { "dispatch", &statistics.dispatch }
+    };
+    Metrics::writeHeader(output, "factoryio_pipeline_queue_depth", "gauge", "Frames waiting for each pipeline stage");
+    for (const auto& stage : stages) {
+        Metrics::writeSample(output, "factoryio_pipeline_queue_depth", { { "stage", stage.first } },
+                             stage.second->occupancy);
+    }
+    Metrics::writeHeader(output, "factoryio_pipeline_queue_depth_max", "gauge",
+                         "High-water mark of each pipeline stage's input ring");
+    for (const auto& stage : stages) {
+        Metrics::writeSample(output, "factoryio_pipeline_queue_depth_max", { { "stage", stage.first } },
+                             stage.second->maxOccupancy);
+    }
+    Metrics::writeHeader(output, "factoryio_pipeline_stalls_total", "counter",
+                         "Times a pipeline stage found its output ring full");
+    for (const auto& stage : stages) {
+        Metrics::writeSample(output, "factoryio_pipeline_stalls_total", { { "stage", stage.first } },
+                             stage.second->stalls);
+    }
+    Metrics::writeHeader(output, "factoryio_pipeline_merged_frames_total", "counter",
+                         "Frames conflated into a later one");
+    Metrics::writeSample(output, "factoryio_pipeline_merged_frames_total", {}, statistics.conflation.mergedFrames);
+    Metrics::writeHeader(output, "factoryio_pipeline_dropped_values_total", "counter",
+                         "Tag values overwritten by a later frame of the same merge");
+    Metrics::writeSample(output, "factoryio_pipeline_dropped_values_total", {}, statistics.conflation.droppedValues);
+    Metrics::writeHeader(output, "factoryio_pipeline_preserved_edges_total", "counter",
+                         "Boolean edges between merged frames passed on to the sensors");
+    Metrics::writeSample(output, "factoryio_pipeline_preserved_edges_total", {}, statistics.conflation.preservedEdges);
+    Metrics::writeHeader(output, "factoryio_pipeline_conflation_passes_total", "counter",
+                         "Backlogs merged into a single frame");
+    Metrics::writeSample(output, "factoryio_pipeline_conflation_passes_total", {}, statistics.conflation.passes);
+}
+
+std::shared_ptr<const Factory::ActuatorSerializerList> Factory::actuatorSerializers() const {
+    std::lock_guard<Mutex> scopedLock(m_registrationMutex);
+    return m_actuatorSerializerList;
+}
+
+std::shared_ptr<const Factory::SensorRegistry> Factory::sensorRegistry() const {
+    std::lock_guard<Mutex> scopedLock(m_registrationMutex);
+    return m_sensorRegistry;
 }
@@ -0,0 +1,250 @@
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <string.h>
+#include <chrono>
+#include "rapidjson/writer.h"
+#include "rapidjson/stringbuffer.h"
+#include "FactoryServer.hpp"
+#include "FrameDecoder.hpp"
+#include "Log.hpp"
+
+/**
+ * One controller connection: a reader thread applies actuator frames and answers sensor data
+ * requests, a streamer thread steps the scene and sends the sensor values that changed.
+ */
+class FactoryServer::Session {
+public:
+    Session(FactoryServer& server, int32_t socketFd, FactoryScene* scene)
+    : m_server(server), m_socketFd(socketFd), m_scene(scene), m_sceneMutex(), m_sendMutex(),
+      m_running(true), m_readerThread(nullptr), m_streamerThread(nullptr) {
+        m_readerThread = new std::thread(&Session::readerThread, this);
+        m_streamerThread = new std::thread(&Session::streamerThread, this);
+    }
+
+    ~Session() {
+        m_running = false;
+        shutdown(m_socketFd, SHUT_RDWR);
+        m_readerThread->join();
+        m_streamerThread->join();
+        close(m_socketFd);
+        delete m_readerThread;
+        delete m_streamerThread;
+        delete m_scene;
+    }
+
+    /**
+     * True once the controller has disconnected or a send has failed; the session only waits
+     * to be deleted.
+     */
+    bool isFinished() const {
+        return !m_running;
+    }
+
+private:
+    void readerThread() {
+        const int BUFFER_SIZE(64 * 1024);
+        char buffer[BUFFER_SIZE];
+        FrameDecoder frameDecoder;
+        std::string frameText;
+        rapidjson::Document frame;
+
+        while (m_running) {
+            ssize_t receivedCount = recv(m_socketFd, buffer, BUFFER_SIZE, 0);
+            if (receivedCount <= 0) {
+                break;
+            }
+            frameDecoder.append(buffer, receivedCount);
+            while (frameDecoder.next(frameText)) {
+                m_server.countIn(frameText.size());
+                frame.Parse(frameText.c_str());
+                if (frame.HasParseError() || !frame.IsObject()) {
+                    LOG_WARNING("Ignoring malformed frame: {}", frameText);
+                    continue;
+                }
+                rapidjson::Value::ConstMemberIterator request = frame.FindMember("Send Sensor Data");
+                if ((request != frame.MemberEnd()) && request->value.IsBool() && request->value.GetBool()) {
+                    sendSensorValues(false);
+                }
+                else {
+                    std::lock_guard<std::mutex> scopedLock(m_sceneMutex);
+                    m_scene->applyActuatorValues(frame);
+                }
+            }
+        }
+        m_running = false;
+    }
+
+    void streamerThread() {
+        typedef std::chrono::steady_clock Clock;
+        const double frameRate = m_server.m_frameRate;
+        const double timeScale = m_server.m_timeScale;
+        const bool paced = (frameRate > 0) && (timeScale > 0);
+        const Clock::duration period = paced
+            ? std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / (frameRate * timeScale)))
+            : Clock::duration::zero();
+        Clock::time_point previousStep = Clock::now();
+        Clock::time_point nextStep = previousStep + period;
+
+        while (m_running) {
+            if (paced) {
+                std::this_thread::sleep_until(nextStep);
+                nextStep += period;
+            }
+            const Clock::time_point now = Clock::now();
+            const double elapsedSeconds = (frameRate > 0)
+                ? 1.0 / frameRate
+                : std::chrono::duration<double>(now - previousStep).count() * ((timeScale > 0) ? timeScale : 1.0);
+            {
+                std::lock_guard<std::mutex> scopedLock(m_sceneMutex);
+                m_scene->step(elapsedSeconds);
+            }
+            previousStep = now;
+            sendSensorValues(true);
+        }
+    }
+
+    void sendSensorValues(bool changedOnly) {
+        rapidjson::Document frame;
+        frame.SetObject();
+        {
+            std::lock_guard<std::mutex> scopedLock(m_sceneMutex);
+            if (!m_scene->getSensorValues(frame, changedOnly) && changedOnly) {
+                return;
+            }
+        }
+        rapidjson::StringBuffer buffer;
+        rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+        frame.Accept(writer);
+        const std::string text = FrameDecoder::encode(std::string(buffer.GetString(), buffer.GetSize()));
+
+        std::lock_guard<std::mutex> scopedLock(m_sendMutex);
+        if (send(m_socketFd, text.c_str(), text.size(), MSG_NOSIGNAL) != static_cast<ssize_t>(text.size())) {
+            m_running = false;
+            return;
+        }
+        m_server.countOut(buffer.GetSize());
+    }
+
+    FactoryServer&      m_server;
+    int32_t             m_socketFd;
+    FactoryScene*       m_scene;
+    std::mutex          m_sceneMutex;
+    std::mutex          m_sendMutex;
+    std::atomic<bool>   m_running;
+    std::thread*        m_readerThread;
+    std::thread*        m_streamerThread;
+};
+
+FactoryServer::FactoryServer(SceneFactory sceneFactory, double frameRate, double timeScale)
+: m_sceneFactory(sceneFactory), m_frameRate(frameRate), m_timeScale(timeScale), m_listenFd(-1), m_port(0),
+  m_running(false), m_acceptorThread(nullptr), m_mutex(), m_sessions(), m_connections(0), m_framesIn(0),
+  m_bytesIn(0), m_framesOut(0), m_bytesOut(0) {
+}
+
+FactoryServer::~FactoryServer() {
+    stop();
+}
+
+bool FactoryServer::start(std::string ipAddress, uint32_t port) {
+    m_listenFd = socket(AF_INET, SOCK_STREAM, 0);
+    if (m_listenFd < 0) {
+        LOG_ERROR("failed to create socket");
+        return false;
+    }
+    int reuse = 1;
+    setsockopt(m_listenFd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = inet_addr(ipAddress.c_str());
+    address.sin_port = htons(port);
+    socklen_t addressSize = sizeof(address);
+    if ((bind(m_listenFd, (struct sockaddr *) &address, sizeof(address)) < 0) ||
+        (listen(m_listenFd, 4) < 0) ||
+        (getsockname(m_listenFd, (struct sockaddr *) &address, &addressSize) < 0)) {
+        LOG_ERROR("failed to listen on {}:{}", ipAddress, port);
+        close(m_listenFd);
+        m_listenFd = -1;
+        return false;
+    }
+    m_port = ntohs(address.sin_port);
+    m_running = true;
+    m_acceptorThread = new std::thread(&FactoryServer::acceptorThread, this);
+    LOG_INFO("Factory server listening on {}:{}", ipAddress, m_port);
+    return true;
+}
+
+void FactoryServer::stop() {
+    if (!m_running.exchange(false)) {
+        return;
+    }
+    shutdown(m_listenFd, SHUT_RDWR);
+    m_acceptorThread->join();
+    delete m_acceptorThread;
+    m_acceptorThread = nullptr;
+    close(m_listenFd);
+    m_listenFd = -1;
+
+    std::lock_guard<std::mutex> scopedLock(m_mutex);
+    for (Session* session : m_sessions) {
+        delete session;
+    }
+    m_sessions.clear();
+}
+
+FactoryServer::Statistics FactoryServer::getStatistics() const {
+    Statistics statistics;
+    statistics.connections = m_connections;
+    statistics.framesIn = m_framesIn;
+    statistics.bytesIn = m_bytesIn;
+    statistics.framesOut = m_framesOut;
+    statistics.bytesOut = m_bytesOut;
+    return statistics;
+}
+
+void FactoryServer::acceptorThread() {
+    while (m_running) {
+        int32_t socketFd = accept(m_listenFd, nullptr, nullptr);
+        if (socketFd < 0) {
+            continue;
+        }
+        int noDelay = 1;
+        setsockopt(socketFd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+        ++m_connections;
+        LOG_INFO("Accepted controller connection");
+
+        std::lock_guard<std::mutex> scopedLock(m_mutex);
+        reapSessions();
+        m_sessions.push_back(new Session(*this, socketFd, m_sceneFactory()));
+    }
+}
+
+/**
+ * Deletes the sessions whose controller has gone, which joins their threads and closes their
+ * sockets.  Called with m_mutex held.
+ */
+void FactoryServer::reapSessions() {
+    for (std::list<Session*>::iterator session = m_sessions.begin(); session != m_sessions.end(); ) {
+        if ((*session)->isFinished()) {
+            delete *session;
+            session = m_sessions.erase(session);
+        }
+        else {
+            ++session;
+        }
+    }
+}
+
+void FactoryServer::countIn(size_t bytes) {
+    m_framesIn.fetch_add(1, std::memory_order_relaxed);
+    m_bytesIn.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+void FactoryServer::countOut(size_t bytes) {
+    m_framesOut.fetch_add(1, std::memory_order_relaxed);
+    m_bytesOut.fetch_add(bytes, std::memory_order_relaxed);
+}
@@ -0,0 +1,45 @@
+#include "FrameDecoder.hpp"
+
+const std::string FrameDecoder::START_OF_TEXT = "\a\a";
+const std::string FrameDecoder::END_OF_TEXT = "\b\b";
+
+FrameDecoder::FrameDecoder()
+: m_data(), m_position(0) {
+}
+
+void FrameDecoder::append(const char* data, size_t size) {
+    // Drop consumed bytes once they make up most of the buffer so it does not grow without bound
+    if ((m_position > 0) && (m_position >= m_data.size() / 2)) {
+        m_data.erase(0, m_position);
+        m_position = 0;
+    }
+    m_data.append(data, size);
+}
+
+bool FrameDecoder::next(std::string& frameText) {
+    const size_t startIndex = m_data.find(START_OF_TEXT, m_position);
+    if (startIndex == std::string::npos) {
+        // Keep a trailing partial start marker
+        if (m_data.size() - m_position >= START_OF_TEXT.size()) {
+            m_position = m_data.size() - (START_OF_TEXT.size() - 1);
+        }
+        return false;
+    }
+    m_position = startIndex;
+
+    const size_t textIndex = startIndex + START_OF_TEXT.size();
+    const size_t endIndex = m_data.find(END_OF_TEXT, textIndex);
+    if (endIndex == std::string::npos) {
+        return false;
+    }
+    frameText.assign(m_data, textIndex, endIndex - textIndex);
+    m_position = endIndex + END_OF_TEXT.size();
+    return true;
+}
+
+std::string FrameDecoder::encode(const std::string& text) {
+    std::string frame;
+    frame.reserve(START_OF_TEXT.size() + text.size() + END_OF_TEXT.size());
+    frame.append(START_OF_TEXT).append(text).append(END_OF_TEXT);
+    return frame;
+}
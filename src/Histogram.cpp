@@ -0,0 +1,167 @@
+#include <math.h>
+#include <algorithm>
+#include <iomanip>
+#include "Histogram.hpp"
+
+namespace {
+
+    inline uint32_t floorLog2(uint64_t value) {
+        return 63 - __builtin_clzll(value);
+    }
+}
+
+Histogram::Histogram(uint64_t highestTrackableValue, uint32_t significantDigits)
+: m_highestTrackableValue(highestTrackableValue),
+  m_significantDigits(std::min(5u, std::max(1u, significantDigits))),
+  m_subBucketMagnitude(0), m_subBucketCount(0), m_subBucketHalfCount(0), m_counts(),
+  m_totalCount(0), m_max(0), m_sum(0), m_sumOfSquares(0) {
+    // Values up to twice 10^digits are counted exactly, which gives the precision everywhere else
+    const uint64_t largestExactValue = 2 * static_cast<uint64_t>(pow(10.0, m_significantDigits));
+    m_subBucketMagnitude = floorLog2(largestExactValue - 1) + 1;
+    m_subBucketCount = 1u << m_subBucketMagnitude;
+    m_subBucketHalfCount = m_subBucketCount / 2;
+    m_highestTrackableValue = std::max<uint64_t>(m_highestTrackableValue, m_subBucketCount);
+    m_counts.assign(indexOf(m_highestTrackableValue) + 1, 0);
+}
+
+void Histogram::record(uint64_t value) {
+    ++m_counts[indexOf(std::min(value, m_highestTrackableValue))];
+    ++m_totalCount;
+    m_max = std::max(m_max, value);
+    m_sum += value;
+    m_sumOfSquares += static_cast<double>(value) * value;
+}
+
+void Histogram::add(const Histogram& other) {
+    const size_t size = std::min(m_counts.size(), other.m_counts.size());
+    for (size_t index = 0; index < size; ++index) {
+        m_counts[index] += other.m_counts[index];
+    }
+    m_totalCount += other.m_totalCount;
+    m_max = std::max(m_max, other.m_max);
+    m_sum += other.m_sum;
+    m_sumOfSquares += other.m_sumOfSquares;
+}
+
+void Histogram::reset() {
+    std::fill(m_counts.begin(), m_counts.end(), 0);
+    m_totalCount = 0;
+    m_max = 0;
+    m_sum = 0;
+    m_sumOfSquares = 0;
+}
+
+uint64_t Histogram::getMin() const {
+    for (uint32_t index = 0; index < m_counts.size(); ++index) {
+        if (m_counts[index] > 0) {
+            return lowestValueAt(index);
+        }
+    }
+    return 0;
+}
+
+double Histogram::getMean() const {
+    return (m_totalCount == 0) ? 0 : m_sum / m_totalCount;
+}
+
+double Histogram::getStandardDeviation() const {
+    if (m_totalCount == 0) {
+        return 0;
+    }
+    const double mean = getMean();
+    return sqrt(std::max(0.0, m_sumOfSquares / m_totalCount - mean * mean));
+}
+
+uint64_t Histogram::getValueAtPercentile(double percentile) const {
+    if (m_totalCount == 0) {
+        return 0;
+    }
+    const double fraction = std::min(100.0, std::max(0.0, percentile)) / 100;
+    const uint64_t target = std::max<uint64_t>(1, static_cast<uint64_t>(ceil(fraction * m_totalCount)));
+    uint64_t cumulative = 0;
+    for (uint32_t index = 0; index < m_counts.size(); ++index) {
+        cumulative += m_counts[index];
+        if (cumulative >= target) {
+            return std::min(highestValueAt(index), m_max);
+        }
+    }
+    return m_max;
+}
+
+void Histogram::writePercentiles(std::ostream& output, double scale, uint32_t ticksPerHalfDistance) const {
+    const std::ios::fmtflags flags = output.flags();
+    const std::streamsize precision = output.precision();
+    output << std::fixed;
+    output << std::setw(12) << "Value" << " " << std::setw(14) << "Percentile" << " " << std::setw(10) << "TotalCount"
+           << " " << std::setw(14) << "1/(1-Percentile)" << std::endl << std::endl;
+
+    double percentile = 0;
+    uint64_t previousCumulative = 0;
+    while (m_totalCount > 0) {
+        const uint64_t value = getValueAtPercentile(percentile);
+        const uint64_t cumulative = countAtOrBelow(value);
+        const double fraction = static_cast<double>(cumulative) / m_totalCount;
+        if ((cumulative != previousCumulative) || (cumulative == m_totalCount)) {
+            output << std::setprecision(3) << std::setw(12) << value / scale
+                   << " " << std::setprecision(12) << fraction
+                   << " " << std::setw(10) << cumulative;
+            if (cumulative == m_totalCount) {
+                output << std::endl;
+                break;
+            }
+            output << " " << std::setprecision(2) << std::setw(14) << 1 / (1 - fraction) << std::endl;
+        }
+        previousCumulative = cumulative;
+
+        // Rows get denser as the percentile approaches 100, ticksPerHalfDistance per halving
+        const double halvings = floor(log2(100 / (100 - percentile))) + 1;
+        percentile += 100 / (ticksPerHalfDistance * pow(2.0, halvings));
+        // Skip ahead to the first percentile that reaches past the current value
+        percentile = std::max(percentile, std::min(100.0, 100.0 * cumulative / m_totalCount));
+    }
+    output << std::setprecision(3)
+           << "#[Mean    = " << std::setw(12) << getMean() / scale
+           << ", StdDeviation   = " << std::setw(12) << getStandardDeviation() / scale << "]" << std::endl
+           << "#[Max     = " << std::setw(12) << m_max / scale
+           << ", Total count    = " << std::setw(12) << m_totalCount << "]" << std::endl
+           << "#[Buckets = " << std::setw(12) << (m_counts.size() - m_subBucketHalfCount) / m_subBucketHalfCount
+           << ", SubBuckets     = " << std::setw(12) << m_subBucketCount << "]" << std::endl;
+    output.flags(flags);
+    output.precision(precision);
+}
+
+uint32_t Histogram::indexOf(uint64_t value) const {
+    if (value < m_subBucketCount) {
+        return static_cast<uint32_t>(value);
+    }
+    // Bucket b >= 1 holds [2^(magnitude - 1 + b), 2^(magnitude + b)) in half-count steps of 2^b
+    const uint32_t bucket = floorLog2(value) - (m_subBucketMagnitude - 1);
+    const uint32_t subBucket = static_cast<uint32_t>(value >> bucket);
+    return m_subBucketCount + (bucket - 1) * m_subBucketHalfCount + (subBucket - m_subBucketHalfCount);
+}
+
+uint64_t Histogram::lowestValueAt(uint32_t index) const {
+    if (index < m_subBucketCount) {
+        return index;
+    }
+    const uint32_t bucket = (index - m_subBucketCount) / m_subBucketHalfCount + 1;
+    const uint64_t subBucket = (index - m_subBucketCount) % m_subBucketHalfCount + m_subBucketHalfCount;
+    return subBucket << bucket;
+}
+
+uint64_t Histogram::highestValueAt(uint32_t index) const {
+    if (index < m_subBucketCount) {
+        return index;
+    }
+    const uint32_t bucket = (index - m_subBucketCount) / m_subBucketHalfCount + 1;
+    return lowestValueAt(index) + (1ULL << bucket) - 1;
+}
+
+uint64_t Histogram::countAtOrBelow(uint64_t value) const {
+    const uint32_t last = indexOf(std::min(value, m_highestTrackableValue));
+    uint64_t cumulative = 0;
+    for (uint32_t index = 0; index <= last; ++index) {
+        cumulative += m_counts[index];
+    }
+    return cumulative;
+}
@@ -0,0 +1,475 @@
+#include <stdio.h>
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "Log.hpp"
+#include "CacheAligned.hpp"
+
+std::atomic<int> Log::s_level(LOG_LEVEL_INFO);
+
+namespace {
+
+struct RecordHeader {
+    uint32_t    size;           // Bytes in the record, header included
+    uint8_t     level;
+    uint8_t     argumentCount;
+    uint16_t    reserved;
+    uint64_t    timestampNs;
+    const char* format;         // Always a string literal, so the pointer outlives the record
+};
+
+const uint32_t WRAP_MARKER = 0xFFFFFFFF;
+const size_t RECORD_ALIGNMENT = 8;
+
+inline size_t alignedSize(size_t size) {
+    return (size + RECORD_ALIGNMENT - 1) & ~(RECORD_ALIGNMENT - 1);
+}
+
+inline uint64_t timestampNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Log timestamps are printed relative to program start
+const uint64_t START_NS = timestampNs();
+
+/**
+ * Byte ring owned by one logging thread (the producer) and read by the drain thread (the
+ * consumer).  A record never straddles the end of the ring; the producer leaves a wrap marker and
+ * continues at the start instead.
+ */
+class LogBuffer : public CacheAligned {
+public:
+    static const size_t CAPACITY = 64 * 1024;
+
+    LogBuffer(uint32_t threadIndex)
+    : m_head(0), m_tail(0), m_abandoned(false), m_threadIndex(threadIndex) {
+    }
+
+    /**
+     * @param wasEmpty  Set if the ring held no record before this one, so the drain thread may be
+     *                  idle
+     */
+    bool push(const uint8_t* record, size_t size, bool& wasEmpty) {
+        size = alignedSize(size);
+        size_t tail = m_tail.load(std::memory_order_relaxed);
+        const size_t head = m_head.load(std::memory_order_acquire);
+        wasEmpty = (tail == head);
+        size_t position = tail % CAPACITY;
+        const size_t contiguous = CAPACITY - position;
+        const size_t needed = size + ((contiguous < size) ? contiguous : 0);
+        if (CAPACITY - (tail - head) < needed) {
+            return false;
+        }
+        if (contiguous < size) {
+            memcpy(&m_data[position], &WRAP_MARKER, sizeof(WRAP_MARKER));
+            tail += contiguous;
+            position = 0;
+        }
+        memcpy(&m_data[position], record, size);
+        m_tail.store(tail + size, std::memory_order_release);
+        return true;
+    }
+
+    const uint8_t* front() {
+        size_t head = m_head.load(std::memory_order_relaxed);
+        while (head != m_tail.load(std::memory_order_acquire)) {
+            const size_t position = head % CAPACITY;
+            uint32_t size;
+            memcpy(&size, &m_data[position], sizeof(size));
+            if (size != WRAP_MARKER) {
+                return &m_data[position];
+            }
+            head += CAPACITY - position;
+            m_head.store(head, std::memory_order_release);
+        }
+        return nullptr;
+    }
+
+    void pop(uint32_t size) {
+        m_head.store(m_head.load(std::memory_order_relaxed) + alignedSize(size),
+                     std::memory_order_release);
+    }
+
+    bool empty() const {
+        return m_head.load(std::memory_order_acquire) == m_tail.load(std::memory_order_acquire);
+    }
+
+    void abandon() {
+        m_abandoned = true;
+    }
+
+    bool abandoned() const {
+        return m_abandoned;
+    }
+
+    uint32_t getThreadIndex() const {
+        return m_threadIndex;
+    }
+
+private:
+    alignas(RECORD_ALIGNMENT) uint8_t m_data[CAPACITY];
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t>   m_head;
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t>   m_tail;
+    std::atomic<bool>                 m_abandoned;
+    const uint32_t                    m_threadIndex;
+};
+
+/**
+ * Back end shared by all threads: owns the buffers, the drain thread and the output file.
+ */
+class Logger {
+public:
+    static Logger& instance() {
+        static Logger logger;
+        return logger;
+    }
+
+    ~Logger() {
+        {
+            std::lock_guard<std::mutex> scopedLock(m_mutex);
+            m_running = false;
+            m_drainControl.notify_one();
+        }
+        m_drainThread.join();
+        for (LogBuffer* buffer : m_buffers) {
+            delete buffer;
+        }
+        if (m_file != stdout) {
+            fclose(m_file);
+        }
+        s_destroyed = true;
+    }
+
+    LogBuffer* registerThread() {
+        std::lock_guard<std::mutex> scopedLock(m_mutex);
+        LogBuffer* buffer = new LogBuffer(m_nextThreadIndex++);
+        m_buffers.push_back(buffer);
+        return buffer;
+    }
+
+    bool open(const std::string& path) {
+        FILE* file = fopen(path.c_str(), "a");
+        if (file == nullptr) {
+            return false;
+        }
+        std::lock_guard<std::mutex> scopedLock(m_fileMutex);
+        fflush(m_file);
+        if (m_file != stdout) {
+            fclose(m_file);
+        }
+        m_file = file;
+        return true;
+    }
+
+    void flush() {
+        std::unique_lock<std::mutex> scopedLock(m_mutex);
+        const uint64_t request = ++m_flushRequests;
+        m_drainControl.notify_one();
+        m_flushControl.wait(scopedLock, [this, request] { return m_flushesCompleted >= request; });
+    }
+
+    /**
+     * Called after a record goes into an empty ring.  The fence pairs with the one in
+     * drainThread(): either the drain thread sees the record before it parks, or this sees it
+     * parked.
+     */
+    void wakeDrain() {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (m_drainParked.load(std::memory_order_relaxed)) {
+            std::lock_guard<std::mutex> scopedLock(m_mutex);
+            m_drainWoken = true;
+            m_drainControl.notify_one();
+        }
+    }
+
+    void recordDrop() {
+        m_droppedCount.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    uint64_t getDroppedCount() const {
+        return m_droppedCount.load(std::memory_order_relaxed);
+    }
+
+    static bool destroyed() {
+        return s_destroyed;
+    }
+
+private:
+    Logger()
+    : m_mutex(), m_fileMutex(), m_flushControl(), m_drainControl(), m_buffers(), m_nextThreadIndex(0),
+      m_file(stdout), m_running(true), m_flushRequests(0), m_flushesCompleted(0), m_drainParked(false),
+      m_drainWoken(false), m_droppedCount(0), m_line(), m_drainThread(&Logger::drainThread, this) {
+    }
+
+    void drainThread() {
+        std::vector<LogBuffer*> buffers;
+        for (;;) {
+            bool running;
+            uint64_t flushRequests;
+            {
+                std::lock_guard<std::mutex> scopedLock(m_mutex);
+                running = m_running;
+                flushRequests = m_flushRequests;
+                releaseAbandonedBuffers();
+                buffers = m_buffers;
+            }
+
+            size_t drainedCount = 0;
+            {
+                std::lock_guard<std::mutex> scopedLock(m_fileMutex);
+                for (LogBuffer* buffer : buffers) {
+                    drainedCount += drain(*buffer);
+                }
+                if (drainedCount == 0) {
+                    fflush(m_file);
+                }
+            }
+            if (drainedCount > 0) {
+                continue;
+            }
+
+            {
+                std::lock_guard<std::mutex> scopedLock(m_mutex);
+                if (m_flushesCompleted < flushRequests) {
+                    m_flushesCompleted = flushRequests;
+                    m_flushControl.notify_all();
+                }
+            }
+            if (!running) {
+                return;
+            }
+            park(flushRequests);
+        }
+    }
+
+    /**
+     * Sleeps until a ring goes from empty to non-empty, flush() is called or the logger shuts
+     * down, unless a record arrived since the buffers were drained.
+     */
+    void park(uint64_t flushRequests) {
+        std::unique_lock<std::mutex> scopedLock(m_mutex);
+        m_drainParked.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        const bool empty = std::all_of(m_buffers.begin(), m_buffers.end(),
+                                       [](const LogBuffer* buffer) { return buffer->empty(); });
+        if (empty) {
+            m_drainControl.wait(scopedLock, [this, flushRequests] {
+                return m_drainWoken || !m_running || (m_flushRequests != flushRequests);
+            });
+        }
+        m_drainWoken = false;
+        m_drainParked.store(false, std::memory_order_relaxed);
+    }
+
+    // Called with m_mutex held; an abandoned buffer is freed once it has been drained
+    void releaseAbandonedBuffers() {
+        for (std::vector<LogBuffer*>::iterator buffer = m_buffers.begin(); buffer != m_buffers.end();) {
+            if ((*buffer)->abandoned() && (*buffer)->empty()) {
+                delete *buffer;
+                buffer = m_buffers.erase(buffer);
+            }
+            else {
+                ++buffer;
+            }
+        }
+    }
+
+    size_t drain(LogBuffer& buffer) {
+        size_t drainedCount = 0;
+        const uint8_t* record;
+        while ((record = buffer.front()) != nullptr) {
+            RecordHeader header;
+            memcpy(&header, record, sizeof(header));
+            format(record, header, buffer.getThreadIndex());
+            fwrite(m_line.data(), 1, m_line.size(), m_file);
+            buffer.pop(header.size);
+            ++drainedCount;
+        }
+        return drainedCount;
+    }
+
+    void format(const uint8_t* record, const RecordHeader& header, uint32_t threadIndex) {
+        static const char* LEVEL_NAMES[] = { "TRACE", "DEBUG", "INFO ", "WARN ", "ERROR" };
+        char prefix[64];
+        snprintf(prefix, sizeof(prefix), "[%12.6f] %s [t%u] ",
+                 (header.timestampNs - START_NS) / 1e9,
+                 LEVEL_NAMES[std::min<int>(header.level, LOG_LEVEL_ERROR)],
+                 threadIndex);
+        m_line.assign(prefix);
+
+        const uint8_t* argument = record + sizeof(header);
+        const uint8_t* end = record + header.size;
+        for (const char* format = header.format; *format != '\0'; ++format) {
+            if ((format[0] == '{') && (format[1] == '}') && (argument < end)) {
+                argument = appendArgument(argument);
+                ++format;
+            }
+            else {
+                m_line.push_back(*format);
+            }
+        }
+        m_line.push_back('\n');
+    }
+
+    const uint8_t* appendArgument(const uint8_t* argument) {
+        char text[32];
+        const uint8_t type = *argument++;
+        switch (type) {
+            case Log::ARGUMENT_SIGNED: {
+                int64_t value;
+                memcpy(&value, argument, sizeof(value));
+                snprintf(text, sizeof(text), "%lld", static_cast<long long>(value));
+                m_line.append(text);
+                return argument + sizeof(value);
+            }
+            case Log::ARGUMENT_UNSIGNED: {
+                uint64_t value;
+                memcpy(&value, argument, sizeof(value));
+                snprintf(text, sizeof(text), "%llu", static_cast<unsigned long long>(value));
+                m_line.append(text);
+                return argument + sizeof(value);
+            }
+            case Log::ARGUMENT_DOUBLE: {
+                double value;
+                memcpy(&value, argument, sizeof(value));
+                snprintf(text, sizeof(text), "%g", value);
+                m_line.append(text);
+                return argument + sizeof(value);
+            }
+            case Log::ARGUMENT_BOOL:
+                m_line.append((*argument != 0) ? "true" : "false");
+                return argument + 1;
+            default: {
+                uint16_t size;
+                memcpy(&size, argument, sizeof(size));
+                m_line.append(reinterpret_cast<const char*>(argument + sizeof(size)), size);
+                return argument + sizeof(size) + size;
+            }
+        }
+    }
+
+    static bool                 s_destroyed;
+
+    std::mutex                  m_mutex;            // Guards the buffer list and flush counters
+    std::mutex                  m_fileMutex;        // Guards the output file
+    std::condition_variable     m_flushControl;
+    std::condition_variable     m_drainControl;     // Wakes the idle drain thread
+    std::vector<LogBuffer*>     m_buffers;
+    uint32_t                    m_nextThreadIndex;
+    FILE*                       m_file;
+    bool                        m_running;
+    uint64_t                    m_flushRequests;
+    uint64_t                    m_flushesCompleted;
+    std::atomic<bool>           m_drainParked;      // The drain thread is about to wait or waiting
+    bool                        m_drainWoken;       // A producer woke the drain thread
+    std::atomic<uint64_t>       m_droppedCount;
+    std::string                 m_line;             // Formatting buffer of the drain thread
+    std::thread                 m_drainThread;
+};
+
+bool Logger::s_destroyed = false;
+
+/**
+ * Gives each thread its buffer on first use and hands it back to the logger when the thread ends.
+ */
+class ThreadBuffer {
+public:
+    ThreadBuffer() : m_buffer(nullptr) {
+    }
+
+    ~ThreadBuffer() {
+        if ((m_buffer != nullptr) && !Logger::destroyed()) {
+            m_buffer->abandon();
+        }
+    }
+
+    LogBuffer* get() {
+        if (m_buffer == nullptr) {
+            m_buffer = Logger::instance().registerThread();
+        }
+        return m_buffer;
+    }
+
+private:
+    LogBuffer* m_buffer;
+};
+
+thread_local ThreadBuffer t_threadBuffer;
+
+}
+
+Log::Record::Record(int level, const char* format)
+: size(sizeof(RecordHeader)) {
+    RecordHeader header;
+    header.size = sizeof(RecordHeader);
+    header.level = static_cast<uint8_t>(level);
+    header.argumentCount = 0;
+    header.reserved = 0;
+    header.timestampNs = timestampNs();
+    header.format = format;
+    memcpy(data, &header, sizeof(header));
+}
+
+void Log::Record::add(uint8_t type, const void* value, size_t valueSize) {
+    const size_t lengthSize = (type == ARGUMENT_STRING) ? sizeof(uint16_t) : 0;
+    if (size + 1 + lengthSize + valueSize > MAX_SIZE) {
+        return;
+    }
+    data[size++] = type;
+    if (type == ARGUMENT_STRING) {
+        const uint16_t length = static_cast<uint16_t>(valueSize);
+        memcpy(&data[size], &length, sizeof(length));
+        size += sizeof(length);
+    }
+    memcpy(&data[size], value, valueSize);
+    size += valueSize;
+
+    RecordHeader* header = reinterpret_cast<RecordHeader*>(data);
+    header->size = static_cast<uint32_t>(size);
+    ++header->argumentCount;
+}
+
+void Log::encodeString(Record& record, const char* value, size_t size) {
+    // Long strings are truncated so that the record, and the arguments after it, still fit
+    const size_t overhead = 1 + sizeof(uint16_t);
+    if (record.size + overhead >= Record::MAX_SIZE) {
+        return;
+    }
+    if (size > Record::MAX_STRING_SIZE) {
+        size = Record::MAX_STRING_SIZE;
+    }
+    if (size > Record::MAX_SIZE - record.size - overhead) {
+        size = Record::MAX_SIZE - record.size - overhead;
+    }
+    record.add(ARGUMENT_STRING, value, size);
+}
+
+void Log::commit(const Record& record) {
+    bool wasEmpty = false;
+    if (!t_threadBuffer.get()->push(record.data, record.size, wasEmpty)) {
+        Logger::instance().recordDrop();
+    }
+    else if (wasEmpty) {
+        Logger::instance().wakeDrain();
+    }
+}
+
+bool Log::open(const std::string& path) {
+    return Logger::instance().open(path);
+}
+
+void Log::setLevel(LogLevel level) {
+    s_level.store(level, std::memory_order_relaxed);
+}
+
+void Log::flush() {
+    Logger::instance().flush();
+}
+
+uint64_t Log::getDroppedCount() {
+    return Logger::instance().getDroppedCount();
+}
@@ -0,0 +1,31 @@
+#include "LoopbackTransport.hpp"
+
+LoopbackTransport::LoopbackTransport()
+: m_eventHandler(nullptr), m_outputHandler(), m_inboundMutex(), m_frameDecoder(), m_messageText(),
+  m_receivedCount(0), m_sentCount(0) {
+}
+
+void LoopbackTransport::connect(CommunicationsEventHandler& eventHandler, Clock& /* clock */) {
+    m_eventHandler = &eventHandler;
+    m_eventHandler->handleConnectionEstablished();
+}
+
+void LoopbackTransport::sendMessage(const std::string& text) {
+    ++m_sentCount;
+    if (m_outputHandler) {
+        m_outputHandler(text);
+    }
+}
+
+void LoopbackTransport::inject(const char* data, size_t size) {
+    std::lock_guard<std::mutex> scopedLock(m_inboundMutex);
+    m_frameDecoder.append(data, size);
+    while (m_frameDecoder.next(m_messageText)) {
+        ++m_receivedCount;
+        m_eventHandler->handleMessageReceived(m_messageText);
+    }
+}
+
+void LoopbackTransport::setOutputHandler(OutputHandler outputHandler) {
+    m_outputHandler = outputHandler;
+}
@@ -5,43 +5,355 @@
  * Created on May 30, 2018, 3:08 PM
  */
 
+#include <getopt.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
 #include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
 #include "Factory.hpp"
 #include "BasicPackingFactory.hpp"
 #include "BasicConveyorControl.hpp"
+#include "RuleConveyorControl.hpp"
+#include "ScanController.hpp"
 #include "SortingByWeightFactory.hpp"
+#include "PlantScenes.hpp"
+#include "SimulatedPlant.hpp"
+#include "ThreadProfile.hpp"
+#include "Log.hpp"
+#include "Metrics.hpp"
+#include "ProfiledMutex.hpp"
+#include "Trace.hpp"
 
-void basicConveyorControlDemo() {
-    Factory factory;
-    factory.start();
-    BasicConveyorControl basicConveyorControl1(factory, "Station 1 ", 3);
-//    BasicConveyorControl basicConveyorControl2(factory, "Station 2 ", 3);
-    basicConveyorControl1.start();
-//    basicConveyorControl2.start();
-    basicConveyorControl1.waitUntilDone();
-//    basicConveyorControl2.waitUntilDone();
+/**
+ * The demos start their controllers on a connected factory and, if asked to, block until the
+ * controllers finish.  Controllers are never destroyed: the conveyor and program controllers keep
+ * re-arming tasks on the factory's executor, and the packing and sorting factories keep their
+ * manager threads, until the process exits.
+ */
+std::vector<std::string> stationPrefixes(uint32_t stationCount) {
+    std::vector<std::string> prefixes;
+    for (uint32_t station = 1; station <= stationCount; ++station) {
+        prefixes.push_back("Station " + std::to_string(station) + " ");
+    }
+    return prefixes;
 }
 
-void basicPackingStationDemo() {
-    Factory factory;
-    factory.start();
-    BasicPackingFactory basicPackingStation(factory);
-    basicPackingStation.start();
-    basicPackingStation.waitUntilDone();
+void basicConveyorControlDemo(Factory& factory, bool waitUntilDone, uint32_t stationCount) {
+    std::vector<BasicConveyorControl*> basicConveyorControls;
+    for (const std::string& prefix : stationPrefixes(stationCount)) {
+        basicConveyorControls.push_back(new BasicConveyorControl(factory, prefix, 3));
+    }
+    for (BasicConveyorControl* basicConveyorControl : basicConveyorControls) {
+        basicConveyorControl->start();
+    }
+    if (waitUntilDone) {
+        for (BasicConveyorControl* basicConveyorControl : basicConveyorControls) {
+            basicConveyorControl->waitUntilDone();
+        }
+    }
+}
+
+void ruleConveyorControlDemo(Factory& factory, bool waitUntilDone, uint32_t stationCount) {
+    std::vector<RuleConveyorControl*> ruleConveyorControls;
+    for (const std::string& prefix : stationPrefixes(stationCount)) {
+        ruleConveyorControls.push_back(new RuleConveyorControl(factory, prefix, 3));
+    }
+    for (RuleConveyorControl* ruleConveyorControl : ruleConveyorControls) {
+        ruleConveyorControl->start();
+    }
+    if (waitUntilDone) {
+        ruleConveyorControls.front()->waitUntilDone();
+    }
+}
+
+/**
+ * Loads each program once per station in place of a built-in demo.
+ */
+bool programDemo(Factory& factory, bool waitUntilDone, uint32_t stationCount,
+                 const std::vector<std::string>& programPaths) {
+    ScanController* scanController = new ScanController(factory);
+    for (const std::string& prefix : stationPrefixes(stationCount)) {
+        for (const std::string& programPath : programPaths) {
+            if (!scanController->loadFile(programPath, prefix)) {
+                return false;
+            }
+        }
+    }
+    scanController->start();
+    if (waitUntilDone) {
+        scanController->waitUntilDone();
+    }
+    return true;
+}
+
+void basicPackingStationDemo(Factory& factory, bool waitUntilDone) {
+    BasicPackingFactory* basicPackingStation = new BasicPackingFactory(factory);
+    basicPackingStation->start();
+    if (waitUntilDone) {
+        basicPackingStation->waitUntilDone();
+    }
+}
+
+void weightSortingDemo(Factory& factory, bool waitUntilDone) {
+    SortingByWeightFactory* sortingByWeightFactory = new SortingByWeightFactory(factory);
+    if (waitUntilDone) {
+        sortingByWeightFactory->waitUntilDone();
+    }
+}
+
+bool runDemo(const std::string& demo, Factory& factory, bool waitUntilDone, uint32_t stationCount,
+             const std::vector<std::string>& programPaths) {
+    if (!programPaths.empty()) {
+        return programDemo(factory, waitUntilDone, stationCount, programPaths);
+    }
+    if (demo == "conveyor") {
+        basicConveyorControlDemo(factory, waitUntilDone, stationCount);
+    }
+    else if (demo == "conveyor-rules") {
+        ruleConveyorControlDemo(factory, waitUntilDone, stationCount);
+    }
+    else if (demo == "packing") {
+        basicPackingStationDemo(factory, waitUntilDone);
+    }
+    else if (demo == "sorting") {
+        weightSortingDemo(factory, waitUntilDone);
+    }
+    else {
+        return false;
+    }
+    return true;
 }
 
-void weightSortingDemo() {
+PlantScene* createScene(const std::string& demo, uint32_t stationCount) {
+    if (demo == "packing") {
+        return PlantScenes::createBasicPackingScene();
+    }
+    if (demo == "sorting") {
+        return PlantScenes::createSortingByWeightScene();
+    }
+    return PlantScenes::createBasicConveyorScene(stationPrefixes(stationCount));
+}
+
+/**
+ * Writes the trace, if tracing, and the lock profile, if locks are profiled, and leaves without
+ * unwinding the controllers, which cannot be stopped yet.
+ */
+void exitDemo(const std::string& tracePath) {
+    if (!tracePath.empty()) {
+        Trace::write(tracePath);
+    }
+#ifdef FACTORYIO_PROFILE_LOCKS
+    ProfiledMutex::writeReport(std::cerr);
+#endif
+    Log::flush();
+    _exit(0);
+}
+
+/**
+ * Runs a demo against its plant model for a fixed amount of clock time and reports what the plant
+ * saw.  The main thread registers with the clock because it sleeps on it.
+ */
+void simulateDemo(const std::string& demo, uint32_t stationCount, const std::vector<std::string>& programPaths,
+                  Clock& clock, double durationSeconds, const std::string& tracePath) {
+    PlantScene* scene = createScene(demo, stationCount);
+    SimulatedPlant plant(scene);
+    Factory factory(clock);
+    clock.attach();
+    factory.start(plant);
+    const std::chrono::steady_clock::time_point wallStart = std::chrono::steady_clock::now();
+    if (!runDemo(demo, factory, false, stationCount, programPaths)) {
+        exit(1);
+    }
+    // Wake just after the end so that everything due at the last instant has already settled
+    clock.sleepFor(std::chrono::duration_cast<Clock::Duration>(std::chrono::duration<double>(durationSeconds)) +
+                   Clock::Duration(1));
+    const double wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+
+    PlantScene::Statistics statistics;
+    plant.inspect([&statistics](FactoryScene& scene) {
+        statistics = static_cast<PlantScene&>(scene).getStatistics();
+    });
+    std::cout << "Simulated " << statistics.sceneTime << " s in " << wallSeconds << " s: "
+              << statistics.emitted << " emitted, " << statistics.removed << " removed, "
+              << statistics.picked << " picked, " << statistics.placed << " placed" << std::endl;
+    exitDemo(tracePath);
+}
+
+/**
+ * Runs a demo against the inbound frames of a capture instead of a connection; its outbound
+ * frames go nowhere.  At speed 0 the frames are dispatched as fast as they can be.
+ */
+void replayDemo(const std::string& demo, uint32_t stationCount, const std::vector<std::string>& programPaths,
+                const std::string& capturePath, double speed, const std::string& tracePath) {
     Factory factory;
-    factory.start();
-    SortingByWeightFactory sortingByWeightFactory(factory);
-    sortingByWeightFactory.waitUntilDone();
+    if (!factory.startReplay(capturePath, speed)) {
+        exit(1);
+    }
+    const std::chrono::steady_clock::time_point wallStart = std::chrono::steady_clock::now();
+    if (!runDemo(demo, factory, false, stationCount, programPaths)) {
+        exit(1);
+    }
+    factory.waitUntilDisconnected();
+    const double wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+    std::cout << "Replayed " << capturePath << " in " << wallSeconds << " s" << std::endl;
+    exitDemo(tracePath);
 }
-#include <iostream>
 
-int main() {
+void usage(const char* program) {
+    std::cerr << "usage: " << program << " [--demo conveyor|conveyor-rules|packing|sorting] [--capture file]"
+              << " [ip-address [port]]" << std::endl
+              << "       " << program << " --simulate [--demo conveyor|conveyor-rules|packing|sorting]"
+              << " [--clock real|scaled|discrete] [--scale factor] [--duration seconds]" << std::endl
+              << "       " << program << " --replay file [--demo conveyor|conveyor-rules|packing|sorting]"
+              << " [--speed factor]" << std::endl
+              << "Any form also takes [--metrics-port port] [--metrics-file file] [--trace file]"
+              << " [--thread-profile role:cpus:priority,...] [--mlockall]" << std::endl
+              << "The conveyor demos also take [--stations n]" << std::endl
+              << "[--program file.st] runs structured-text programs, once per station, instead of a demo;"
+              << " --demo then only picks the simulated scene" << std::endl
+              << "A connection also takes [--rx-timestamps]" << std::endl;
+}
+
+/**
+ * Usage: factoryio [--demo name] [--capture file] [ip-address [port]]
+ *        factoryio --simulate [--demo name] [--clock real|scaled|discrete] [--scale n] [--duration s]
+ *        factoryio --replay file [--demo name] [--speed n]
+ *
+ * --metrics-port serves the metrics to Prometheus on 127.0.0.1; --metrics-file writes them to a
+ * file each time the process receives SIGUSR1.  --trace records a Chrome trace, written to the
+ * file each time the process receives SIGUSR2 and when a simulation or replay ends.
+ * --rx-timestamps stamps inbound frames with their kernel arrival time.  --thread-profile pins
+ * and prioritizes the receiver, controller and writer threads (see ThreadProfile) and --mlockall
+ * locks the process in memory.  --stations runs a conveyor demo on stations "Station 1 " to
+ * "Station n " of the same scene.  The conveyor-rules demo runs the conveyor logic as rules that
+ * are evaluated as frames are dispatched (see RuleEngine).  --program, which can be repeated, loads
+ * structured-text programs into a ScanController instead of starting a demo, once for each station.
+ */
+int main(int argc, char* argv[]) {
+    std::string demo("conveyor");
+    bool simulate = false;
+    std::string clockName("discrete");
+    double scale = 100.0;
+    double durationSeconds = 3600.0;
+    std::string capturePath;
+    std::string replayPath;
+    double speed = 1.0;
+    uint32_t metricsPort = 0;
+    std::string metricsPath;
+    std::string tracePath;
+    bool receiveTimestamps = false;
+    bool lockMemory = false;
+    uint32_t stationCount = 1;
+    std::vector<std::string> programPaths;
+
+    const struct option options[] = {
+        { "demo",           required_argument, nullptr, 'd' },
+        { "simulate",       no_argument,       nullptr, 's' },
+        { "clock",          required_argument, nullptr, 'c' },
+        { "scale",          required_argument, nullptr, 'x' },
+        { "duration",       required_argument, nullptr, 't' },
+        { "capture",        required_argument, nullptr, 'w' },
+        { "replay",         required_argument, nullptr, 'r' },
+        { "speed",          required_argument, nullptr, 'v' },
+        { "metrics-port",   required_argument, nullptr, 'm' },
+        { "metrics-file",   required_argument, nullptr, 'f' },
+        { "trace",          required_argument, nullptr, 'e' },
+        { "rx-timestamps",  no_argument,       nullptr, 'k' },
+        { "thread-profile", required_argument, nullptr, 'p' },
+        { "mlockall",       no_argument,       nullptr, 'l' },
+        { "stations",       required_argument, nullptr, 'n' },
+        { "program",        required_argument, nullptr, 'g' },
+        { "help",           no_argument,       nullptr, 'h' },
+        { nullptr,          0,                 nullptr, 0 }
+    };
+    int option;
+    while ((option = getopt_long(argc, argv, "d:sc:x:t:w:r:v:m:f:e:kp:ln:g:h", options, nullptr)) != -1) {
+        switch (option) {
+            case 'd': demo = optarg; break;
+            case 's': simulate = true; break;
+            case 'c': clockName = optarg; break;
+            case 'x': scale = strtod(optarg, nullptr); break;
+            case 't': durationSeconds = strtod(optarg, nullptr); break;
+            case 'w': capturePath = optarg; break;
+            case 'r': replayPath = optarg; break;
+            case 'v': speed = strtod(optarg, nullptr); break;
+            case 'm': metricsPort = strtoul(optarg, nullptr, 10); break;
+            case 'f': metricsPath = optarg; break;
+            case 'e': tracePath = optarg; break;
+            case 'k': receiveTimestamps = true; break;
+            case 'p':
+                if (!ThreadProfile::configure(optarg)) {
+                    usage(argv[0]);
+                    return 1;
+                }
+                break;
+            case 'l': lockMemory = true; break;
+            case 'n': stationCount = std::max(strtoul(optarg, nullptr, 10), 1ul); break;
+            case 'g': programPaths.push_back(optarg); break;
+            default:
+                usage(argv[0]);
+                return (option == 'h') ? 0 : 1;
+        }
+    }
+
+    if (lockMemory) {
+        ThreadProfile::lockMemory();
+    }
+    if ((metricsPort != 0) && !Metrics::serve("127.0.0.1", metricsPort)) {
+        return 1;
+    }
+    if (!metricsPath.empty() && !Metrics::dumpOnSignal(SIGUSR1, metricsPath)) {
+        return 1;
+    }
+    if (!tracePath.empty()) {
+        Trace::enable();
+        if (!Metrics::onSignal(SIGUSR2, [tracePath] { Trace::write(tracePath); })) {
+            return 1;
+        }
+    }
+
 #ifdef KAJU
     std::cout << "hey kahu" << std::endl;
 #endif
-    basicConveyorControlDemo();
+    if (simulate) {
+        std::unique_ptr<Clock> clock;
+        if (clockName == "real") {
+            clock.reset(new RealTimeClock());
+        }
+        else if (clockName == "scaled") {
+            clock.reset(new ScaledClock(scale));
+        }
+        else if (clockName == "discrete") {
+            clock.reset(new DiscreteEventClock());
+        }
+        else {
+            usage(argv[0]);
+            return 1;
+        }
+        simulateDemo(demo, stationCount, programPaths, *clock, durationSeconds, tracePath);
+    }
+    if (!replayPath.empty()) {
+        replayDemo(demo, stationCount, programPaths, replayPath, speed, tracePath);
+    }
+
+    Factory factory;
+    if (receiveTimestamps) {
+        factory.enableReceiveTimestamps();
+    }
+    if (!capturePath.empty() && !factory.startCapture(capturePath)) {
+        return 1;
+    }
+    bool connected = (optind < argc)
+                   ? factory.start(argv[optind], (optind + 1 < argc) ? strtoul(argv[optind + 1], nullptr, 10) : 910)
+                   : factory.start();
+    if (!connected || !runDemo(demo, factory, true, stationCount, programPaths)) {
+        usage(argv[0]);
+        return 1;
+    }
     return 0;    
 }    
@@ -0,0 +1,337 @@
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <thread>
+#include "Metrics.hpp"
+#include "Log.hpp"
+
+namespace {
+
+    const int32_t STATUS_FAILURE(-1);
+
+    // Shards cover one minute at two significant digits, about 32 KB each
+    const uint64_t SHARD_HIGHEST_VALUE = 60000000000ULL;
+    const uint32_t SHARD_SIGNIFICANT_DIGITS = 2;
+
+    const double QUANTILES[] = { 0.5, 0.9, 0.99, 0.999, 1.0 };
+
+    struct Registry {
+        Registry()
+        : mutex(), counters(), histograms(), collectors(), nextCollectorId(1), nextCounterIndex(0),
+          nextHistogramIndex(0) {
+        }
+
+        std::mutex                              mutex;
+        std::vector<Counter*>                   counters;
+        std::vector<LatencyHistogram*>          histograms;
+        std::map<uint32_t, Metrics::Collector>  collectors;
+        uint32_t                                nextCollectorId;
+        std::atomic<uint32_t>                   nextCounterIndex;
+        std::atomic<uint32_t>                   nextHistogramIndex;
+    };
+
+    Registry& registry() {
+        static Registry s_registry;
+        return s_registry;
+    }
+
+    std::string escapeLabel(const std::string& value) {
+        std::string escaped;
+        for (char character : value) {
+            if (character == '\n') {
+                escaped += "\\n";
+            }
+            else {
+                if ((character == '\\') || (character == '"')) {
+                    escaped += '\\';
+                }
+                escaped += character;
+            }
+        }
+        return escaped;
+    }
+
+    void serverThread(int32_t listenFd) {
+        LOG_INFO("Started metrics server thread");
+        for (;;) {
+            const int32_t socketFd = accept(listenFd, nullptr, nullptr);
+            if (socketFd == STATUS_FAILURE) {
+                continue;
+            }
+            // Any request gets the metrics; read it so closing does not reset the connection
+            char request[4096];
+            recv(socketFd, request, sizeof(request), 0);
+            std::ostringstream body;
+            Metrics::write(body);
+            const std::string text = body.str();
+            std::ostringstream response;
+            response << "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: "
+                     << text.size() << "\r\nConnection: close\r\n\r\n" << text;
+            const std::string responseText = response.str();
+            send(socketFd, responseText.data(), responseText.size(), MSG_NOSIGNAL);
+            close(socketFd);
+        }
+    }
+
+    // Signal handlers only write the signal number to a pipe; a thread runs the actions
+    int32_t s_signalPipe[2] = { STATUS_FAILURE, STATUS_FAILURE };
+    std::mutex s_signalMutex;
+    std::map<int, std::function<void()> > s_signalActions;
+
+    void signalHandler(int signal) {
+        const unsigned char byte = signal;
+        const ssize_t ignored = write(s_signalPipe[1], &byte, sizeof(byte));
+        (void) ignored;
+    }
+
+    void signalThread() {
+        unsigned char byte;
+        while (read(s_signalPipe[0], &byte, sizeof(byte)) > 0) {
+            std::function<void()> action;
+            {
+                std::lock_guard<std::mutex> scopedLock(s_signalMutex);
+                action = s_signalActions[byte];
+            }
+            if (action) {
+                action();
+            }
+        }
+    }
+}
+
+Counter Metrics::framesReceived("factoryio_received_frames_total", "Sensor frames received from the scene");
+Counter Metrics::framesSent("factoryio_sent_frames_total", "Frames sent to the scene");
+Counter Metrics::bytesReceived("factoryio_received_bytes_total", "Bytes received on the socket");
+Counter Metrics::bytesSent("factoryio_sent_bytes_total", "Bytes sent on the socket");
+Counter Metrics::changesMerged("factoryio_merged_changes_total",
+                               "Station flushes whose changes joined the next outbound frame");
+Counter Metrics::tasksExecuted("factoryio_executor_tasks_total", "Station tasks run by the executor");
+Counter Metrics::tasksStolen("factoryio_executor_steals_total", "Station tasks taken from another worker's deque");
+Counter Metrics::rulesEvaluated("factoryio_rules_evaluated_total", "Rules whose inputs changed and were evaluated");
+Counter Metrics::rulesFired("factoryio_rules_fired_total", "Rules whose actions ran");
+Counter Metrics::scanOverruns("factoryio_scan_overruns_total", "Program scans that started after the next was due");
+LatencyHistogram Metrics::parseTime("factoryio_frame_parse_seconds", "Time to parse an inbound frame");
+LatencyHistogram Metrics::dispatchTime("factoryio_frame_dispatch_seconds",
+                                       "Time to apply an inbound frame to the sensors and wake waiters");
+LatencyHistogram Metrics::sendBlockedTime("factoryio_send_blocked_seconds", "Time spent in send()");
+LatencyHistogram Metrics::socketQueueTime("factoryio_socket_queue_seconds",
+                                          "Time inbound data waited in the socket buffer, from kernel timestamps");
+LatencyHistogram Metrics::handlerTime("factoryio_frame_handler_seconds",
+                                      "Time from reading an inbound frame to its handler returning");
+LatencyHistogram Metrics::wakeLatency("factoryio_waiter_wake_seconds",
+                                      "Time from a sensor change being notified to a waiting thread running");
+LatencyHistogram Metrics::scanTime("factoryio_scan_seconds", "Time to scan every loaded control program once");
+
+Counter::Shard::Shard()
+: value(0) {
+}
+
+Counter::Counter(const char* name, const char* help)
+: m_name(name), m_help(help), m_index(registry().nextCounterIndex++), m_mutex(), m_shards() {
+    Metrics::registerCounter(this);
+}
+
+uint64_t Counter::get() const {
+    uint64_t sum = 0;
+    std::lock_guard<std::mutex> scopedLock(m_mutex);
+    for (const std::unique_ptr<Shard>& shard : m_shards) {
+        sum += shard->value.load(std::memory_order_relaxed);
+    }
+    return sum;
+}
+
+Counter::Shard& Counter::localShard() {
+    // Shards outlive their threads, so a thread's table only ever points at live shards
+    static thread_local std::vector<Shard*> t_shards;
+    if (t_shards.size() <= m_index) {
+        t_shards.resize(m_index + 1, nullptr);
+    }
+    if (t_shards[m_index] == nullptr) {
+        std::lock_guard<std::mutex> scopedLock(m_mutex);
+        m_shards.emplace_back(new Shard());
+        t_shards[m_index] = m_shards.back().get();
+    }
+    return *t_shards[m_index];
+}
+
+LatencyHistogram::Shard::Shard()
+: mutex(), histogram(SHARD_HIGHEST_VALUE, SHARD_SIGNIFICANT_DIGITS) {
+}
+
+LatencyHistogram::LatencyHistogram(const char* name, const char* help)
+: m_name(name), m_help(help), m_index(registry().nextHistogramIndex++), m_mutex(), m_shards() {
+    Metrics::registerHistogram(this);
+}
+
+void LatencyHistogram::record(uint64_t nanoseconds) {
+    Shard& shard = localShard();
+    std::lock_guard<std::mutex> scopedLock(shard.mutex);
+    shard.histogram.record(nanoseconds);
+}
+
+Histogram LatencyHistogram::snapshot() const {
+    Histogram merged(SHARD_HIGHEST_VALUE, SHARD_SIGNIFICANT_DIGITS);
+    std::lock_guard<std::mutex> scopedLock(m_mutex);
+    for (const std::unique_ptr<Shard>& shard : m_shards) {
+        std::lock_guard<std::mutex> shardLock(shard->mutex);
+        merged.add(shard->histogram);
+    }
+    return merged;
+}
+
+LatencyHistogram::Shard& LatencyHistogram::localShard() {
+    // Shards outlive their threads, so a thread's table only ever points at live shards
+    static thread_local std::vector<Shard*> t_shards;
+    if (t_shards.size() <= m_index) {
+        t_shards.resize(m_index + 1, nullptr);
+    }
+    if (t_shards[m_index] == nullptr) {
+        std::lock_guard<std::mutex> scopedLock(m_mutex);
+        m_shards.emplace_back(new Shard());
+        t_shards[m_index] = m_shards.back().get();
+    }
+    return *t_shards[m_index];
+}
+
+uint32_t Metrics::addCollector(Collector collector) {
+    Registry& metrics = registry();
+    std::lock_guard<std::mutex> scopedLock(metrics.mutex);
+    const uint32_t id = metrics.nextCollectorId++;
+    metrics.collectors[id] = collector;
+    return id;
+}
+
+void Metrics::removeCollector(uint32_t id) {
+    Registry& metrics = registry();
+    std::lock_guard<std::mutex> scopedLock(metrics.mutex);
+    metrics.collectors.erase(id);
+}
+
+void Metrics::write(std::ostream& output) {
+    Registry& metrics = registry();
+    std::lock_guard<std::mutex> scopedLock(metrics.mutex);
+    const std::vector<std::pair<std::string, std::string> > noLabels;
+    for (Counter* counter : metrics.counters) {
+        writeHeader(output, counter->getName(), "counter", counter->getHelp());
+        writeSample(output, counter->getName(), noLabels, counter->get());
+    }
+    for (LatencyHistogram* latencyHistogram : metrics.histograms) {
+        const Histogram histogram = latencyHistogram->snapshot();
+        const std::string name = latencyHistogram->getName();
+        writeHeader(output, name.c_str(), "summary", latencyHistogram->getHelp());
+        for (double quantile : QUANTILES) {
+            std::ostringstream quantileText;
+            quantileText << quantile;
+            writeSample(output, name.c_str(), { { "quantile", quantileText.str() } },
+                        histogram.getValueAtPercentile(quantile * 100) / 1e9);
+        }
+        writeSample(output, (name + "_sum").c_str(), noLabels, histogram.getMean() * histogram.getTotalCount() / 1e9);
+        writeSample(output, (name + "_count").c_str(), noLabels, histogram.getTotalCount());
+    }
+    for (const std::pair<const uint32_t, Collector>& collector : metrics.collectors) {
+        collector.second(output);
+    }
+}
+
+void Metrics::writeHeader(std::ostream& output, const char* name, const char* type, const char* help) {
+    output << "# HELP " << name << " " << help << "\n# TYPE " << name << " " << type << "\n";
+}
+
+void Metrics::writeSample(std::ostream& output, const char* name,
+                          const std::vector<std::pair<std::string, std::string> >& labels, double value) {
+    output << name;
+    if (!labels.empty()) {
+        output << "{";
+        for (size_t index = 0; index < labels.size(); ++index) {
+            output << ((index > 0) ? "," : "") << labels[index].first << "=\"" << escapeLabel(labels[index].second)
+                   << "\"";
+        }
+        output << "}";
+    }
+    output << " " << value << "\n";
+}
+
+bool Metrics::serve(const std::string& ipAddress, uint32_t port) {
+    const int32_t listenFd = socket(AF_INET, SOCK_STREAM, 0);
+    if (listenFd == STATUS_FAILURE) {
+        LOG_ERROR("failed to create metrics socket");
+        return false;
+    }
+    const int reuse = 1;
+    setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = inet_addr(ipAddress.c_str());
+    address.sin_port = htons(port);
+    if ((bind(listenFd, (struct sockaddr*) &address, sizeof(address)) == STATUS_FAILURE) ||
+        (listen(listenFd, 4) == STATUS_FAILURE)) {
+        LOG_ERROR("failed to listen for metrics requests on {}:{}", ipAddress, port);
+        close(listenFd);
+        return false;
+    }
+    new std::thread(serverThread, listenFd);
+    LOG_INFO("Serving metrics on {}:{}", ipAddress, port);
+    return true;
+}
+
+bool Metrics::dumpOnSignal(int signal, const std::string& path) {
+    if (!onSignal(signal, [path] {
+            // Write a temporary file and rename it so readers never see a partial dump
+            const std::string temporaryPath = path + ".tmp";
+            {
+                std::ofstream output(temporaryPath.c_str());
+                write(output);
+            }
+            if (rename(temporaryPath.c_str(), path.c_str()) != 0) {
+                LOG_ERROR("failed to write metrics to {}", path);
+            }
+        })) {
+        return false;
+    }
+    LOG_INFO("Writing metrics to {} on signal {}", path, signal);
+    return true;
+}
+
+bool Metrics::onSignal(int signal, std::function<void()> action) {
+    std::lock_guard<std::mutex> scopedLock(s_signalMutex);
+    if (s_signalPipe[0] == STATUS_FAILURE) {
+        if (pipe(s_signalPipe) == STATUS_FAILURE) {
+            LOG_ERROR("failed to create signal pipe");
+            return false;
+        }
+        fcntl(s_signalPipe[1], F_SETFL, O_NONBLOCK);
+        new std::thread(signalThread);
+    }
+    struct sigaction signalAction;
+    memset(&signalAction, 0, sizeof(signalAction));
+    signalAction.sa_handler = signalHandler;
+    sigemptyset(&signalAction.sa_mask);
+    signalAction.sa_flags = SA_RESTART;
+    if (sigaction(signal, &signalAction, nullptr) == STATUS_FAILURE) {
+        LOG_ERROR("failed to install handler for signal {}", signal);
+        return false;
+    }
+    s_signalActions[signal] = action;
+    return true;
+}
+
+void Metrics::registerCounter(Counter* counter) {
+    Registry& metrics = registry();
+    std::lock_guard<std::mutex> scopedLock(metrics.mutex);
+    metrics.counters.push_back(counter);
+}
+
+void Metrics::registerHistogram(LatencyHistogram* histogram) {
+    Registry& metrics = registry();
+    std::lock_guard<std::mutex> scopedLock(metrics.mutex);
+    metrics.histograms.push_back(histogram);
+}
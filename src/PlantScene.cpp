@@ -0,0 +1,441 @@
+#include <math.h>
+#include <algorithm>
+#include <limits>
+#include "PlantScene.hpp"
+
+const double PlantScene::MAX_STEP = 0.005;
+const double PlantScene::ITEM_GAP = 0.01;
+
+PlantScene::PlantScene(uint32_t seed)
+: m_actuatorIndex(), m_actuatorNames(), m_actuatorValues(), m_conveyors(), m_emitters(), m_removers(),
+  m_stops(), m_sensors(), m_pickAndPlaces(), m_items(), m_leadTimes(), m_random(seed), m_statistics() {
+}
+
+uint32_t PlantScene::addConveyor(std::string forwardTag, double length, double speed, std::string backwardTag) {
+    Conveyor conveyor;
+    conveyor.forwardTag = actuator(forwardTag);
+    conveyor.backwardTag = backwardTag.empty() ? conveyor.forwardTag : actuator(backwardTag);
+    conveyor.length = length;
+    conveyor.speed = speed;
+    conveyor.next = -1;
+    conveyor.remover = -1;
+    conveyor.sorter = false;
+    conveyor.leftTag = 0;
+    conveyor.rightTag = 0;
+    conveyor.left = -1;
+    conveyor.right = -1;
+    conveyor.busyTime = 0;
+    m_conveyors.push_back(conveyor);
+    return m_conveyors.size() - 1;
+}
+
+void PlantScene::connect(uint32_t from, uint32_t to) {
+    m_conveyors[from].next = to;
+}
+
+void PlantScene::addWheelSorter(uint32_t sorter, std::string leftTag, std::string rightTag,
+                                uint32_t left, uint32_t right, uint32_t straight) {
+    Conveyor& conveyor = m_conveyors[sorter];
+    conveyor.sorter = true;
+    conveyor.leftTag = actuator(leftTag);
+    conveyor.rightTag = actuator(rightTag);
+    conveyor.left = left;
+    conveyor.right = right;
+    conveyor.next = straight;
+}
+
+void PlantScene::addEmitter(std::string tag, uint32_t conveyor, double itemLength, double minimumWeight,
+                            double maximumWeight, double interval, double meanExtraInterval) {
+    Emitter emitter;
+    emitter.tag = actuator(tag);
+    emitter.conveyor = conveyor;
+    emitter.itemLength = itemLength;
+    emitter.minimumWeight = minimumWeight;
+    emitter.maximumWeight = maximumWeight;
+    emitter.interval = interval;
+    emitter.meanExtraInterval = meanExtraInterval;
+    emitter.nextInterval = interval;
+    emitter.idleTime = interval;
+    m_emitters.push_back(emitter);
+}
+
+void PlantScene::addRemover(std::string tag, uint32_t conveyor) {
+    Remover remover;
+    remover.tag = actuator(tag);
+    remover.count = 0;
+    m_removers.push_back(remover);
+    m_conveyors[conveyor].remover = m_removers.size() - 1;
+}
+
+void PlantScene::addStop(std::string tag, uint32_t conveyor, double position) {
+    Stop stop;
+    stop.tag = actuator(tag);
+    stop.conveyor = conveyor;
+    stop.position = position;
+    m_stops.push_back(stop);
+}
+
+void PlantScene::addBeamSensor(std::string tag, uint32_t conveyor, double position) {
+    sensor(tag, SENSOR_BEAM, conveyor, position, 1);
+}
+
+void PlantScene::addPresenceSensor(std::string tag, uint32_t conveyor, double position) {
+    sensor(tag, SENSOR_PRESENCE, conveyor, position, 0);
+}
+
+void PlantScene::addScale(std::string tag, uint32_t conveyor) {
+    sensor(tag, SENSOR_WEIGHT, conveyor, 0, 0);
+}
+
+void PlantScene::addPickAndPlace(std::string name, const PickAndPlaceLayout& layout) {
+    PickAndPlace pickAndPlace;
+    pickAndPlace.layout = layout;
+    pickAndPlace.x.setpointTag = actuator(name + " Set X");
+    pickAndPlace.x.sensor = sensor(name + " X", SENSOR_POSITION, 0, 0, 0);
+    pickAndPlace.x.position = 0;
+    pickAndPlace.y.setpointTag = actuator(name + " Set Y");
+    pickAndPlace.y.sensor = sensor(name + " Y", SENSOR_POSITION, 0, 0, 0);
+    pickAndPlace.y.position = 0;
+    pickAndPlace.z.setpointTag = actuator(name + " Set Z");
+    pickAndPlace.z.sensor = sensor(name + " Z", SENSOR_POSITION, 0, 0, 0);
+    pickAndPlace.z.position = 0;
+    pickAndPlace.grabTag = actuator(name + " Grab");
+    pickAndPlace.rotateTag = actuator(name + " Rotate");
+    pickAndPlace.itemDetectedSensor = sensor(name + " Item Detected", SENSOR_GRIPPER, 0, 0, 0);
+    pickAndPlace.rotateLimitSensor = sensor(name + " Rotate Limit", SENSOR_LIMIT, 0, 0, 0);
+    pickAndPlace.rotation = 0;
+    pickAndPlace.holding = false;
+    m_pickAndPlaces.push_back(pickAndPlace);
+}
+
+void PlantScene::applyActuatorValues(const rapidjson::Document& frame) {
+    if (!frame.IsObject()) {
+        return;
+    }
+    for (rapidjson::Value::ConstMemberIterator member = frame.MemberBegin(); member != frame.MemberEnd(); ++member) {
+        std::unordered_map<std::string, uint32_t>::const_iterator tag =
+            m_actuatorIndex.find(std::string(member->name.GetString(), member->name.GetStringLength()));
+        if (tag == m_actuatorIndex.end()) {
+            continue;
+        }
+        if (member->value.IsBool()) {
+            m_actuatorValues[tag->second] = member->value.GetBool() ? 1 : 0;
+        }
+        else if (member->value.IsNumber()) {
+            m_actuatorValues[tag->second] = member->value.GetDouble();
+        }
+    }
+}
+
+void PlantScene::step(double elapsedSeconds) {
+    while (elapsedSeconds > 0) {
+        double stepSeconds = std::min(elapsedSeconds, MAX_STEP);
+        move(stepSeconds);
+        elapsedSeconds -= stepSeconds;
+        m_statistics.sceneTime += stepSeconds;
+    }
+}
+
+bool PlantScene::getSensorValues(rapidjson::Document& frame, bool changedOnly) {
+    bool added = false;
+    for (Sensor& sensor : m_sensors) {
+        if (!changedOnly || sensor.changed) {
+            rapidjson::GenericStringRef<char> name(sensor.name.c_str());
+            if ((sensor.kind == SENSOR_WEIGHT) || (sensor.kind == SENSOR_POSITION)) {
+                frame.AddMember(name, static_cast<float>(sensor.value), frame.GetAllocator());
+            }
+            else {
+                frame.AddMember(name, sensor.value != 0, frame.GetAllocator());
+            }
+            sensor.changed = false;
+            added = true;
+        }
+    }
+    return added;
+}
+
+double PlantScene::getUtilization() const {
+    if (m_conveyors.empty() || (m_statistics.sceneTime <= 0)) {
+        return 0;
+    }
+    double busyTime = 0;
+    for (const Conveyor& conveyor : m_conveyors) {
+        busyTime += conveyor.busyTime;
+    }
+    return busyTime / (m_conveyors.size() * m_statistics.sceneTime);
+}
+
+uint64_t PlantScene::getRemovedCount(const std::string& tag) const {
+    std::unordered_map<std::string, uint32_t>::const_iterator index = m_actuatorIndex.find(tag);
+    if (index != m_actuatorIndex.end()) {
+        for (const Remover& remover : m_removers) {
+            if (remover.tag == index->second) {
+                return remover.count;
+            }
+        }
+    }
+    return 0;
+}
+
+uint32_t PlantScene::actuator(const std::string& tag) {
+    std::unordered_map<std::string, uint32_t>::const_iterator index = m_actuatorIndex.find(tag);
+    if (index != m_actuatorIndex.end()) {
+        return index->second;
+    }
+    m_actuatorNames.push_back(tag);
+    m_actuatorValues.push_back(0);
+    m_actuatorIndex[tag] = m_actuatorNames.size() - 1;
+    return m_actuatorNames.size() - 1;
+}
+
+uint32_t PlantScene::sensor(const std::string& name, SensorKind kind, uint32_t conveyor, double position, double value) {
+    Sensor sensor;
+    sensor.name = name;
+    sensor.kind = kind;
+    sensor.conveyor = conveyor;
+    sensor.position = position;
+    sensor.value = value;
+    sensor.changed = true;
+    m_sensors.push_back(sensor);
+    return m_sensors.size() - 1;
+}
+
+int32_t PlantScene::nextConveyor(uint32_t conveyor) const {
+    const Conveyor& from = m_conveyors[conveyor];
+    if (from.sorter) {
+        if (isOn(from.leftTag)) {
+            return from.left;
+        }
+        if (isOn(from.rightTag)) {
+            return from.right;
+        }
+    }
+    return from.next;
+}
+
+int32_t PlantScene::findItem(uint32_t conveyor, double position) const {
+    for (size_t index = 0; index < m_items.size(); ++index) {
+        if (covers(m_items[index], conveyor, position)) {
+            return index;
+        }
+    }
+    return -1;
+}
+
+/**
+ * An item covers a point of a conveyor when it lies over it, including items that straddle the
+ * joint between the conveyor and the one before or after it.
+ */
+bool PlantScene::covers(const Item& item, uint32_t conveyor, double position) const {
+    const double halfLength = item.length / 2;
+    if (item.conveyor == conveyor) {
+        return fabs(item.position - position) < halfLength;
+    }
+    if (nextConveyor(item.conveyor) == static_cast<int32_t>(conveyor)) {
+        return fabs(item.position - (position + m_conveyors[item.conveyor].length)) < halfLength;
+    }
+    if (nextConveyor(conveyor) == static_cast<int32_t>(item.conveyor)) {
+        return fabs(item.position + m_conveyors[conveyor].length - position) < halfLength;
+    }
+    return false;
+}
+
+void PlantScene::move(double elapsedSeconds) {
+    moveItems(elapsedSeconds);
+    emitItems(elapsedSeconds);
+    for (PickAndPlace& pickAndPlace : m_pickAndPlaces) {
+        movePickAndPlace(pickAndPlace, elapsedSeconds);
+    }
+    updateSensors();
+}
+
+/**
+ * Moves every item by the distance its conveyor travels, without letting it run into the item
+ * ahead of it (on the same or the next conveyor), past a raised stop, or off the end of a line
+ * that has no active remover.
+ */
+void PlantScene::moveItems(double elapsedSeconds) {
+    for (size_t conveyor = 0; conveyor < m_conveyors.size(); ++conveyor) {
+        if (isOn(m_conveyors[conveyor].forwardTag) || isOn(m_conveyors[conveyor].backwardTag)) {
+            for (const Item& item : m_items) {
+                if (item.conveyor == conveyor) {
+                    m_conveyors[conveyor].busyTime += elapsedSeconds;
+                    break;
+                }
+            }
+        }
+    }
+    for (size_t index = 0; index < m_items.size();) {
+        Item& item = m_items[index];
+        const Conveyor& conveyor = m_conveyors[item.conveyor];
+        double velocity = 0;
+        if (isOn(conveyor.forwardTag)) {
+            velocity = conveyor.speed;
+        }
+        else if ((conveyor.backwardTag != conveyor.forwardTag) && isOn(conveyor.backwardTag)) {
+            velocity = -conveyor.speed;
+        }
+        if (velocity == 0) {
+            ++index;
+            continue;
+        }
+
+        const double halfLength = item.length / 2;
+        const int32_t next = nextConveyor(item.conveyor);
+        if (velocity > 0) {
+            double frontLimit = std::numeric_limits<double>::max();
+            for (const Item& other : m_items) {
+                if ((other.conveyor == item.conveyor) && (other.position > item.position)) {
+                    frontLimit = std::min(frontLimit, other.position - other.length / 2 - ITEM_GAP);
+                }
+                else if (static_cast<int32_t>(other.conveyor) == next) {
+                    frontLimit = std::min(frontLimit, conveyor.length + other.position - other.length / 2 - ITEM_GAP);
+                }
+            }
+            for (const Stop& stop : m_stops) {
+                if ((stop.conveyor == item.conveyor) && isOn(stop.tag) &&
+                    (item.position + halfLength <= stop.position + ITEM_GAP)) {
+                    frontLimit = std::min(frontLimit, stop.position);
+                }
+            }
+            const bool removing = (conveyor.remover >= 0) && isOn(m_removers[conveyor.remover].tag);
+            if ((next < 0) && !removing) {
+                frontLimit = std::min(frontLimit, conveyor.length);
+            }
+            double front = std::min(item.position + halfLength + velocity * elapsedSeconds, frontLimit);
+            item.position = std::max(item.position, front - halfLength);
+
+            if (item.position >= conveyor.length) {
+                if (next >= 0) {
+                    item.position -= conveyor.length;
+                    item.conveyor = next;
+                }
+                else {
+                    ++m_removers[conveyor.remover].count;
+                    ++m_statistics.removed;
+                    m_leadTimes.push_back(m_statistics.sceneTime - item.emittedTime);
+                    m_items.erase(m_items.begin() + index);
+                    continue;
+                }
+            }
+        }
+        else {
+            double rearLimit = 0;
+            for (const Item& other : m_items) {
+                if ((other.conveyor == item.conveyor) && (other.position < item.position)) {
+                    rearLimit = std::max(rearLimit, other.position + other.length / 2 + ITEM_GAP);
+                }
+            }
+            double rear = std::max(item.position - halfLength + velocity * elapsedSeconds, rearLimit);
+            item.position = std::min(item.position, rear + halfLength);
+        }
+        ++index;
+    }
+}
+
+void PlantScene::emitItems(double elapsedSeconds) {
+    for (Emitter& emitter : m_emitters) {
+        emitter.idleTime += elapsedSeconds;
+        if (!isOn(emitter.tag) || (emitter.idleTime < emitter.nextInterval)) {
+            continue;
+        }
+        bool clear = true;
+        for (const Item& item : m_items) {
+            if ((item.conveyor == emitter.conveyor) && (item.position - item.length / 2 < emitter.itemLength + ITEM_GAP)) {
+                clear = false;
+                break;
+            }
+        }
+        if (clear) {
+            std::uniform_real_distribution<double> weight(emitter.minimumWeight, emitter.maximumWeight);
+            Item item;
+            item.conveyor = emitter.conveyor;
+            item.position = emitter.itemLength / 2;
+            item.length = emitter.itemLength;
+            item.weight = weight(m_random);
+            item.load = 0;
+            item.emittedTime = m_statistics.sceneTime;
+            m_items.push_back(item);
+            emitter.idleTime = 0;
+            emitter.nextInterval = emitter.interval;
+            if (emitter.meanExtraInterval > 0) {
+                std::exponential_distribution<double> extraInterval(1 / emitter.meanExtraInterval);
+                emitter.nextInterval += extraInterval(m_random);
+            }
+            ++m_statistics.emitted;
+        }
+    }
+}
+
+/**
+ * Drives the axes towards their set points, picks up the item under the gripper when grab is
+ * switched on over the pick-up point, and loads it onto the item at the drop-off point (or drops
+ * it on the floor) when grab is switched off.
+ */
+void PlantScene::movePickAndPlace(PickAndPlace& pickAndPlace, double elapsedSeconds) {
+    const PickAndPlaceLayout& layout = pickAndPlace.layout;
+    const double travel = layout.axisSpeed * elapsedSeconds;
+    Axis* axes[] = { &pickAndPlace.x, &pickAndPlace.y, &pickAndPlace.z };
+    for (Axis* axis : axes) {
+        double setpoint = m_actuatorValues[axis->setpointTag];
+        axis->position += std::max(-travel, std::min(travel, setpoint - axis->position));
+        setSensor(m_sensors[axis->sensor], axis->position);
+    }
+    double rotationTarget = isOn(pickAndPlace.rotateTag) ? 1 : 0;
+    const double rotationStep = 2 * elapsedSeconds;
+    pickAndPlace.rotation += std::max(-rotationStep, std::min(rotationStep, rotationTarget - pickAndPlace.rotation));
+    setSensor(m_sensors[pickAndPlace.rotateLimitSensor], (pickAndPlace.rotation >= 1) ? 1 : 0);
+
+    const bool overPickUp = (fabs(pickAndPlace.x.position - layout.pickX) <= layout.tolerance) &&
+                            (fabs(pickAndPlace.y.position - layout.pickY) <= layout.tolerance) &&
+                            (pickAndPlace.z.position >= layout.pickZ - layout.tolerance);
+    const int32_t pickUpItem = overPickUp ? findItem(layout.pickConveyor, layout.pickPosition) : -1;
+    if (isOn(pickAndPlace.grabTag) && !pickAndPlace.holding && (pickUpItem >= 0)) {
+        pickAndPlace.heldItem = m_items[pickUpItem];
+        pickAndPlace.holding = true;
+        m_items.erase(m_items.begin() + pickUpItem);
+        ++m_statistics.picked;
+    }
+    else if (!isOn(pickAndPlace.grabTag) && pickAndPlace.holding) {
+        int32_t placeItem = findItem(layout.placeConveyor, layout.placePosition);
+        if (placeItem >= 0) {
+            m_items[placeItem].weight += pickAndPlace.heldItem.weight;
+            ++m_items[placeItem].load;
+            ++m_statistics.placed;
+        }
+        pickAndPlace.holding = false;
+    }
+    setSensor(m_sensors[pickAndPlace.itemDetectedSensor], (pickAndPlace.holding || (pickUpItem >= 0)) ? 1 : 0);
+}
+
+void PlantScene::updateSensors() {
+    for (Sensor& sensor : m_sensors) {
+        switch (sensor.kind) {
+            case SENSOR_BEAM:
+                setSensor(sensor, (findItem(sensor.conveyor, sensor.position) >= 0) ? 0 : 1);
+                break;
+            case SENSOR_PRESENCE:
+                setSensor(sensor, (findItem(sensor.conveyor, sensor.position) >= 0) ? 1 : 0);
+                break;
+            case SENSOR_WEIGHT: {
+                double weight = 0;
+                for (const Item& item : m_items) {
+                    if (item.conveyor == sensor.conveyor) {
+                        weight += item.weight;
+                    }
+                }
+                setSensor(sensor, weight);
+                break;
+            }
+            default:
+                break;
+        }
+    }
+}
+
+void PlantScene::setSensor(Sensor& sensor, double value) {
+    if (value != sensor.value) {
+        sensor.value = value;
+        sensor.changed = true;
+    }
+}
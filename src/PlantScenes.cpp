@@ -0,0 +1,81 @@
+#include "PlantScenes.hpp"
+
+namespace {
+    const double ROLLER_CONVEYOR_SPEED = 0.5;   // m/s
+    const double SCALE_SPEED = 0.6;             // m/s
+    const double BOX_LENGTH = 0.4;              // m
+    const double PALLET_LENGTH = 1.2;           // m
+}
+
+PlantScene* PlantScenes::createBasicConveyorScene(std::string stationPrefix, uint32_t seed, double meanArrivalDelay) {
+    return createBasicConveyorScene(std::vector<std::string>(1, stationPrefix), seed, meanArrivalDelay);
+}
+
+PlantScene* PlantScenes::createBasicConveyorScene(const std::vector<std::string>& stationPrefixes, uint32_t seed,
+                                                  double meanArrivalDelay) {
+    PlantScene* scene = new PlantScene(seed);
+    for (const std::string& stationPrefix : stationPrefixes) {
+        uint32_t entryConveyor = scene->addConveyor(stationPrefix + "Entry Conveyor", 4.0, ROLLER_CONVEYOR_SPEED);
+        uint32_t exitConveyor = scene->addConveyor(stationPrefix + "Exit Conveyor", 4.0, ROLLER_CONVEYOR_SPEED);
+        scene->connect(entryConveyor, exitConveyor);
+        scene->addEmitter(stationPrefix + "Emitter", entryConveyor, BOX_LENGTH, 1.0, 5.0, 2.0, meanArrivalDelay);
+        scene->addRemover(stationPrefix + "Remover", exitConveyor);
+        scene->addBeamSensor(stationPrefix + "At Entry", entryConveyor, 1.0);
+        scene->addBeamSensor(stationPrefix + "At Exit", exitConveyor, 3.5);
+    }
+    return scene;
+}
+
+PlantScene* PlantScenes::createBasicPackingScene(uint32_t seed, double meanArrivalDelay) {
+    PlantScene* scene = new PlantScene(seed);
+
+    uint32_t palletEntryConveyor = scene->addConveyor("Pallet Entry Conveyor", 6.0, ROLLER_CONVEYOR_SPEED);
+    uint32_t palletExitConveyor = scene->addConveyor("Pallet Exit Conveyor", 4.0, ROLLER_CONVEYOR_SPEED);
+    scene->connect(palletEntryConveyor, palletExitConveyor);
+    scene->addEmitter("Pallet Emitter", palletEntryConveyor, PALLET_LENGTH, 15.0, 25.0, 1.0, meanArrivalDelay);
+    scene->addRemover("Pallet Remover", palletExitConveyor);
+    scene->addBeamSensor("Pallet At Entry", palletEntryConveyor, 0.8);
+    scene->addStop("Pallet Roller Stop", palletEntryConveyor, 4.0);
+    scene->addBeamSensor("Pallet At Packing Location", palletEntryConveyor, 3.5);
+
+    uint32_t boxConveyor = scene->addConveyor("Box Conveyor", 3.0, ROLLER_CONVEYOR_SPEED);
+    scene->addEmitter("Box Emitter", boxConveyor, BOX_LENGTH, 1.0, 5.0, 1.0, meanArrivalDelay);
+    scene->addBeamSensor("Box At Entry", boxConveyor, 0.3);
+    scene->addStop("Box Stop Blade", boxConveyor, 2.5);
+    scene->addBeamSensor("Box At Packing Location", boxConveyor, 2.3);
+
+    PlantScene::PickAndPlaceLayout layout;
+    layout.pickX = 7.7;
+    layout.pickY = 5.3;
+    layout.pickZ = 5.5;
+    layout.pickConveyor = boxConveyor;
+    layout.pickPosition = 2.15;
+    layout.placeConveyor = palletEntryConveyor;
+    layout.placePosition = 3.0;
+    layout.axisSpeed = 4.0;
+    layout.tolerance = 0.3;
+    scene->addPickAndPlace("Pick and Place", layout);
+    return scene;
+}
+
+PlantScene* PlantScenes::createSortingByWeightScene(uint32_t seed, double meanArrivalDelay) {
+    PlantScene* scene = new PlantScene(seed);
+    uint32_t entryConveyor = scene->addConveyor("Entry Conveyor", 4.0, ROLLER_CONVEYOR_SPEED);
+    uint32_t conveyorScale = scene->addConveyor("Conveyor Scale Forward", 2.0, SCALE_SPEED, "Conveyor Scale Backward");
+    uint32_t wheelSorter = scene->addConveyor("Wheel Sorter Forward", 0.6, ROLLER_CONVEYOR_SPEED);
+    uint32_t leftConveyor = scene->addConveyor("Left Conveyor", 3.0, ROLLER_CONVEYOR_SPEED);
+    uint32_t rightConveyor = scene->addConveyor("Right Conveyor", 3.0, ROLLER_CONVEYOR_SPEED);
+    uint32_t backConveyor = scene->addConveyor("Back Conveyor", 3.0, ROLLER_CONVEYOR_SPEED);
+    scene->connect(entryConveyor, conveyorScale);
+    scene->connect(conveyorScale, wheelSorter);
+    scene->addWheelSorter(wheelSorter, "Wheel Sorter Left", "Wheel Sorter Right", leftConveyor, rightConveyor,
+                          backConveyor);
+    scene->addEmitter("Emitter", entryConveyor, BOX_LENGTH, 1.0, 20.0, 3.0, meanArrivalDelay);
+    scene->addRemover("Left Remover", leftConveyor);
+    scene->addRemover("Right Remover", rightConveyor);
+    scene->addRemover("Back Remover", backConveyor);
+    scene->addBeamSensor("Entry Sensor", entryConveyor, 3.0);
+    scene->addPresenceSensor("Scale Sensor", conveyorScale, 1.0);
+    scene->addScale("Conveyor Scale Weight", conveyorScale);
+    return scene;
+}
@@ -0,0 +1,214 @@
+#include <algorithm>
+#include <iomanip>
+#include <map>
+#include <set>
+#include <sstream>
+#include <vector>
+#include "ProfiledMutex.hpp"
+#include "Metrics.hpp"
+
+namespace {
+
+    // Waits and holds of up to ten seconds at two significant digits, about 28 KB per histogram
+    const uint64_t HIGHEST_TIME_NS = 10000000000ULL;
+    const uint32_t SIGNIFICANT_DIGITS = 2;
+
+    const double QUANTILES[] = { 0.5, 0.99, 1.0 };
+
+    typedef std::pair<std::string, std::string> LockName;     // Kind and label
+}
+
+/**
+ * Every live ProfiledMutex, plus the totals of those already destroyed.
+ */
+class LockRegistry {
+public:
+    struct Totals {
+        Totals()
+        : acquisitions(0), contendedAcquisitions(0), waitTimes(HIGHEST_TIME_NS, SIGNIFICANT_DIGITS),
+          holdTimes(HIGHEST_TIME_NS, SIGNIFICANT_DIGITS) {
+        }
+
+        uint64_t    acquisitions;
+        uint64_t    contendedAcquisitions;
+        Histogram   waitTimes;
+        Histogram   holdTimes;
+    };
+
+    static LockRegistry& instance() {
+        static LockRegistry s_registry;
+        return s_registry;
+    }
+
+    void add(ProfiledMutex* mutex) {
+        // Outside m_mutex, which the collector takes under the metrics registry's lock
+        std::call_once(m_collectorFlag, [this] {
+            Metrics::addCollector([this](std::ostream& output) { writeMetrics(output); });
+        });
+        std::lock_guard<std::mutex> scopedLock(m_mutex);
+        m_locks.insert(mutex);
+    }
+
+    void remove(ProfiledMutex* mutex) {
+        std::lock_guard<std::mutex> scopedLock(m_mutex);
+        m_locks.erase(mutex);
+        addTo(m_retired[name(*mutex)], *mutex);
+    }
+
+    /**
+     * Numbers the locks of a kind that have no label of their own.
+     */
+    uint32_t nextNumber(const char* kind) {
+        std::lock_guard<std::mutex> scopedLock(m_mutex);
+        return ++m_unlabelledCounts[kind];
+    }
+
+    /**
+     * Totals of every lock ever created, by kind and label.
+     */
+    std::map<LockName, Totals> collect() {
+        std::lock_guard<std::mutex> scopedLock(m_mutex);
+        std::map<LockName, Totals> totals = m_retired;
+        for (ProfiledMutex* mutex : m_locks) {
+            // The statistics only change under the lock; take it without counting the acquisition
+            std::lock_guard<std::mutex> mutexLock(mutex->m_mutex);
+            addTo(totals[name(*mutex)], *mutex);
+        }
+        return totals;
+    }
+
+private:
+    LockRegistry()
+    : m_mutex(), m_locks(), m_retired(), m_unlabelledCounts(), m_collectorFlag() {
+    }
+
+    static LockName name(const ProfiledMutex& mutex) {
+        return LockName(mutex.m_kind, mutex.m_label);
+    }
+
+    static void addTo(Totals& totals, const ProfiledMutex& mutex) {
+        totals.acquisitions += mutex.m_acquisitions;
+        totals.contendedAcquisitions += mutex.m_contendedAcquisitions;
+        totals.waitTimes.add(mutex.m_waitTimes);
+        totals.holdTimes.add(mutex.m_holdTimes);
+    }
+
+    void writeMetrics(std::ostream& output) {
+        const std::map<LockName, Totals> totals = collect();
+        Metrics::writeHeader(output, "factoryio_lock_acquisitions_total", "counter", "Acquisitions of each lock");
+        for (const std::pair<const LockName, Totals>& lock : totals) {
+            Metrics::writeSample(output, "factoryio_lock_acquisitions_total",
+                                 { { "lock", lock.first.first }, { "tag", lock.first.second } },
+                                 lock.second.acquisitions);
+        }
+        Metrics::writeHeader(output, "factoryio_lock_contended_total", "counter",
+                             "Acquisitions of each lock that had to wait");
+        for (const std::pair<const LockName, Totals>& lock : totals) {
+            Metrics::writeSample(output, "factoryio_lock_contended_total",
+                                 { { "lock", lock.first.first }, { "tag", lock.first.second } },
+                                 lock.second.contendedAcquisitions);
+        }
+        writeSummary(output, "factoryio_lock_wait_seconds", "Time spent waiting for each contended lock",
+                     totals, &Totals::waitTimes);
+        writeSummary(output, "factoryio_lock_hold_seconds", "Time each lock was held", totals, &Totals::holdTimes);
+    }
+
+    static void writeSummary(std::ostream& output, const char* name, const char* help,
+                             const std::map<LockName, Totals>& totals, Histogram Totals::* histogram) {
+        const std::string sumName = std::string(name) + "_sum";
+        const std::string countName = std::string(name) + "_count";
+        Metrics::writeHeader(output, name, "summary", help);
+        for (const std::pair<const LockName, Totals>& lock : totals) {
+            const Histogram& times = lock.second.*histogram;
+            for (double quantile : QUANTILES) {
+                std::ostringstream quantileText;
+                quantileText << quantile;
+                Metrics::writeSample(output, name, { { "lock", lock.first.first }, { "tag", lock.first.second },
+                                                     { "quantile", quantileText.str() } },
+                                     times.getValueAtPercentile(quantile * 100) / 1e9);
+            }
+            Metrics::writeSample(output, sumName.c_str(), { { "lock", lock.first.first }, { "tag", lock.first.second } },
+                                 times.getMean() * times.getTotalCount() / 1e9);
+            Metrics::writeSample(output, countName.c_str(), { { "lock", lock.first.first }, { "tag", lock.first.second } },
+                                 times.getTotalCount());
+        }
+    }
+
+    std::mutex                      m_mutex;
+    std::set<ProfiledMutex*>        m_locks;
+    std::map<LockName, Totals>      m_retired;          // Destroyed locks
+    std::map<std::string, uint32_t> m_unlabelledCounts; // By kind
+    std::once_flag                  m_collectorFlag;
+};
+
+ProfiledMutex::ProfiledMutex()
+: m_mutex(), m_kind("unnamed"), m_label(), m_acquisitions(0),
+  m_contendedAcquisitions(0), m_waitTimes(HIGHEST_TIME_NS, SIGNIFICANT_DIGITS),
+  m_holdTimes(HIGHEST_TIME_NS, SIGNIFICANT_DIGITS), m_lockedNs(0) {
+    LockRegistry::instance().add(this);
+}
+
+ProfiledMutex::~ProfiledMutex() {
+    LockRegistry::instance().remove(this);
+}
+
+void ProfiledMutex::lock() {
+    if (!m_mutex.try_lock()) {
+        const uint64_t startNs = Metrics::nowNs();
+        m_mutex.lock();
+        m_lockedNs = Metrics::nowNs();
+        ++m_contendedAcquisitions;
+        m_waitTimes.record(m_lockedNs - startNs);
+    }
+    else {
+        m_lockedNs = Metrics::nowNs();
+    }
+    ++m_acquisitions;
+}
+
+bool ProfiledMutex::try_lock() {
+    if (!m_mutex.try_lock()) {
+        return false;
+    }
+    m_lockedNs = Metrics::nowNs();
+    ++m_acquisitions;
+    return true;
+}
+
+void ProfiledMutex::unlock() {
+    m_holdTimes.record(Metrics::nowNs() - m_lockedNs);
+    m_mutex.unlock();
+}
+
+void ProfiledMutex::setName(const char* kind, const std::string& label) {
+    const std::string name = label.empty() ? std::to_string(LockRegistry::instance().nextNumber(kind)) : label;
+    std::lock_guard<std::mutex> scopedLock(m_mutex);
+    m_kind = kind;
+    m_label = name;
+}
+
+void ProfiledMutex::writeReport(std::ostream& output) {
+    const std::map<LockName, LockRegistry::Totals> totals = LockRegistry::instance().collect();
+    std::vector<std::pair<double, LockName> > order;
+    for (const std::pair<const LockName, LockRegistry::Totals>& lock : totals) {
+        const Histogram& waitTimes = lock.second.waitTimes;
+        order.push_back(std::make_pair(waitTimes.getMean() * waitTimes.getTotalCount(), lock.first));
+    }
+    std::sort(order.rbegin(), order.rend());
+
+    output << std::left << std::setw(16) << "lock" << std::setw(32) << "tag" << std::right
+           << std::setw(12) << "acquired" << std::setw(11) << "contended" << std::setw(12) << "wait ms"
+           << std::setw(12) << "wait p99 us" << std::setw(12) << "hold p50 us" << std::setw(12) << "hold p99 us"
+           << std::setw(12) << "hold max us" << std::endl;
+    output << std::fixed << std::setprecision(1);
+    for (const std::pair<double, LockName>& entry : order) {
+        const LockRegistry::Totals& lock = totals.at(entry.second);
+        output << std::left << std::setw(16) << entry.second.first << std::setw(32) << entry.second.second
+               << std::right << std::setw(12) << lock.acquisitions << std::setw(11) << lock.contendedAcquisitions
+               << std::setw(12) << entry.first / 1e6
+               << std::setw(12) << lock.waitTimes.getValueAtPercentile(99) / 1e3
+               << std::setw(12) << lock.holdTimes.getValueAtPercentile(50) / 1e3
+               << std::setw(12) << lock.holdTimes.getValueAtPercentile(99) / 1e3
+               << std::setw(12) << lock.holdTimes.getMax() / 1e3 << std::endl;
+    }
+}
@@ -0,0 +1,153 @@
+#include <math.h>
+#include "ProgramVm.hpp"
+
+ProgramVm::ProgramVm(const ControlProgram& program)
+: m_program(program),
+  m_variables(program.variables.size()),
+  m_state(program.stateCount),
+  m_stack(program.maxStackDepth + 1) {
+    reset();
+}
+
+void ProgramVm::reset() {
+    for (size_t index = 0; index < m_variables.size(); ++index) {
+        m_variables[index] = m_program.variables[index].initialValue;
+    }
+    for (double& state : m_state) {
+        state = -1;
+    }
+}
+
+/**
+ * A switch over the opcodes, with the top of the stack kept in a pointer.  Booleans are
+ * normalized to 0 or 1 by the operations that produce them, so stores never need to.
+ */
+uint32_t ProgramVm::scan(double nowMs) {
+    const ControlProgram::Instruction* const code = m_program.code.data();
+    const double* const constants = m_program.constants.data();
+    double* const variables = m_variables.data();
+    double* const state = m_state.data();
+    double* top = m_stack.data();
+    uint32_t pc = 0;
+    uint32_t executedCount = 0;
+    for (;;) {
+        const ControlProgram::Instruction& instruction = code[pc++];
+        ++executedCount;
+        switch (instruction.opcode) {
+            case ControlProgram::OP_PUSH:
+                *top++ = constants[instruction.operand];
+                break;
+            case ControlProgram::OP_LOAD:
+                *top++ = variables[instruction.operand];
+                break;
+            case ControlProgram::OP_STORE:
+                variables[instruction.operand] = *--top;
+                break;
+            case ControlProgram::OP_ADD:
+                --top;
+                top[-1] += *top;
+                break;
+            case ControlProgram::OP_SUBTRACT:
+                --top;
+                top[-1] -= *top;
+                break;
+            case ControlProgram::OP_MULTIPLY:
+                --top;
+                top[-1] *= *top;
+                break;
+            case ControlProgram::OP_DIVIDE:
+                --top;
+                top[-1] = (*top != 0) ? top[-1] / *top : 0;
+                break;
+            case ControlProgram::OP_DIVIDE_INT:
+                --top;
+                top[-1] = (*top != 0) ? trunc(top[-1] / *top) : 0;
+                break;
+            case ControlProgram::OP_MODULO:
+                --top;
+                top[-1] = (*top != 0) ? fmod(top[-1], *top) : 0;
+                break;
+            case ControlProgram::OP_NEGATE:
+                top[-1] = -top[-1];
+                break;
+            case ControlProgram::OP_NOT:
+                top[-1] = (top[-1] == 0) ? 1 : 0;
+                break;
+            case ControlProgram::OP_AND:
+                --top;
+                top[-1] = ((top[-1] != 0) && (*top != 0)) ? 1 : 0;
+                break;
+            case ControlProgram::OP_OR:
+                --top;
+                top[-1] = ((top[-1] != 0) || (*top != 0)) ? 1 : 0;
+                break;
+            case ControlProgram::OP_XOR:
+                --top;
+                top[-1] = ((top[-1] != 0) != (*top != 0)) ? 1 : 0;
+                break;
+            case ControlProgram::OP_EQUAL:
+                --top;
+                top[-1] = (top[-1] == *top) ? 1 : 0;
+                break;
+            case ControlProgram::OP_NOT_EQUAL:
+                --top;
+                top[-1] = (top[-1] != *top) ? 1 : 0;
+                break;
+            case ControlProgram::OP_LESS:
+                --top;
+                top[-1] = (top[-1] < *top) ? 1 : 0;
+                break;
+            case ControlProgram::OP_LESS_EQUAL:
+                --top;
+                top[-1] = (top[-1] <= *top) ? 1 : 0;
+                break;
+            case ControlProgram::OP_GREATER:
+                --top;
+                top[-1] = (top[-1] > *top) ? 1 : 0;
+                break;
+            case ControlProgram::OP_GREATER_EQUAL:
+                --top;
+                top[-1] = (top[-1] >= *top) ? 1 : 0;
+                break;
+            case ControlProgram::OP_RISING: {
+                const double input = (top[-1] != 0) ? 1 : 0;
+                double& previous = state[instruction.operand];
+                top[-1] = ((previous == 0) && (input != 0)) ? 1 : 0;
+                previous = input;
+                break;
+            }
+            case ControlProgram::OP_FALLING: {
+                const double input = (top[-1] != 0) ? 1 : 0;
+                double& previous = state[instruction.operand];
+                top[-1] = ((previous == 1) && (input == 0)) ? 1 : 0;
+                previous = input;
+                break;
+            }
+            case ControlProgram::OP_ON_DELAY: {
+                const double preset = *--top;
+                double& start = state[instruction.operand];
+                if (top[-1] == 0) {
+                    start = -1;
+                    top[-1] = 0;
+                }
+                else {
+                    if (start < 0) {
+                        start = nowMs;
+                    }
+                    top[-1] = (nowMs - start >= preset) ? 1 : 0;
+                }
+                break;
+            }
+            case ControlProgram::OP_JUMP:
+                pc = instruction.operand;
+                break;
+            case ControlProgram::OP_JUMP_IF_FALSE:
+                if (*--top == 0) {
+                    pc = instruction.operand;
+                }
+                break;
+            case ControlProgram::OP_END:
+                return executedCount;
+        }
+    }
+}
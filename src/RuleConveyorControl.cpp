@@ -0,0 +1,58 @@
+#include "RuleConveyorControl.hpp"
+#include "Log.hpp"
+
+/**
+ * A box has passed a sensor when the beam it interrupted is restored.
+ */
+RuleConveyorControl::RuleConveyorControl(Factory& factory, std::string stationPrefix, int32_t maxBoxCount)
+: m_factory(factory),
+  m_station(factory, stationPrefix),
+  m_emitter(m_station, "Emitter"),
+  m_remover(m_station, "Remover"),
+  m_entryConveyor(m_station, "Entry Conveyor"),
+  m_exitConveyor(m_station, "Exit Conveyor"),
+  m_entrySensor(m_station, "At Entry"),
+  m_exitSensor(m_station, "At Exit"),
+  m_rules(m_station),
+  m_started(false) {
+    const RuleEngine::Input entry = m_rules.input(m_entrySensor);
+    const RuleEngine::Input exit = m_rules.input(m_exitSensor);
+    const RuleEngine::Input boxes = m_rules.counter("boxes");
+    m_rules.when({ RuleEngine::rising(entry) }).add(boxes, 1);
+    m_rules.when({ RuleEngine::rising(entry), RuleEngine::compare(boxes, RuleEngine::GREATER_EQUAL, maxBoxCount) })
+           .set(m_emitter, false);
+    m_rules.when({ RuleEngine::rising(exit) }).add(boxes, -1).set(m_emitter, true);
+}
+
+void RuleConveyorControl::start() {
+    m_factory.loadSensorValues();
+    if (!m_started) {
+        m_started = true;
+        m_emitter.setOn(true);
+        m_remover.setOn(true);
+        m_entryConveyor.setOn(true);
+        m_exitConveyor.setOn(true);
+        m_station.applyChanges();
+        m_rules.start();
+    }
+    else {
+        LOG_ERROR("Nice try buddy!");
+    }
+}
+
+void RuleConveyorControl::stop() {
+    m_factory.stop();
+}
+
+/**
+ * Returns once the factory has been stopped.
+ */
+void RuleConveyorControl::waitUntilDone() {
+    try {
+        for (;;) {
+            m_station.waitForSensorChange();
+        }
+    }
+    catch (const Clock::Stopped&) {
+    }
+}
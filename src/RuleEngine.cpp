@@ -0,0 +1,397 @@
+#include <algorithm>
+#include "RuleEngine.hpp"
+#include "Executor.hpp"
+#include "Log.hpp"
+#include "Metrics.hpp"
+#include "Station.hpp"
+
+const uint32_t RuleEngine::MAX_PASSES = 16;
+const uint32_t RuleEngine::NO_EDGE = UINT32_MAX;
+
+RuleEngine::Actions& RuleEngine::Actions::set(ActuatorSerializer& actuator, double value) {
+    const Action action = { Action::SET, &actuator, 0, value };
+    m_engine.m_actions.push_back(action);
+    ++m_engine.m_rules.back().actionCount;
+    return *this;
+}
+
+RuleEngine::Actions& RuleEngine::Actions::add(Input counter, double delta) {
+    const Action action = { Action::ADD, nullptr, counter, delta };
+    m_engine.m_actions.push_back(action);
+    ++m_engine.m_rules.back().actionCount;
+    return *this;
+}
+
+RuleEngine::Actions& RuleEngine::Actions::assign(Input counter, double value) {
+    const Action action = { Action::ASSIGN, nullptr, counter, value };
+    m_engine.m_actions.push_back(action);
+    ++m_engine.m_rules.back().actionCount;
+    return *this;
+}
+
+RuleEngine::RuleEngine(Station& station)
+: m_station(station),
+  m_inputs(),
+  m_conditions(),
+  m_actions(),
+  m_rules(),
+  m_dependents(),
+  m_timerDependents(),
+  m_dirtyRules(),
+  m_nextDirtyRules(),
+  m_changedInputs(),
+  m_actuatorsChanged(false),
+  m_started(false),
+  m_dispatchCount(0),
+  m_mutex() {
+    nameLock(m_mutex, "rules", station.getPrefix());
+}
+
+RuleEngine::Input RuleEngine::input(SensorDeserializer& sensor) {
+    for (Input index = 0; index < m_inputs.size(); ++index) {
+        if (m_inputs[index].sensor == &sensor) {
+            return index;
+        }
+    }
+    return addInput(INPUT_SENSOR, &sensor, sensor.getName(), 0);
+}
+
+RuleEngine::Input RuleEngine::counter(const std::string& name, double value) {
+    return addInput(INPUT_COUNTER, nullptr, name, value);
+}
+
+RuleEngine::Input RuleEngine::onDelay(Input source, Clock::Duration delay) {
+    const Input timer = addInput(INPUT_TIMER, nullptr, m_inputs[source].name + " on delay", 0);
+    m_inputs[timer].source = source;
+    m_inputs[timer].delay = delay;
+    return timer;
+}
+
+RuleEngine::Condition RuleEngine::rising(Input input) {
+    const Condition condition = { Condition::RISING, input, EQUAL, 0 };
+    return condition;
+}
+
+RuleEngine::Condition RuleEngine::falling(Input input) {
+    const Condition condition = { Condition::FALLING, input, EQUAL, 0 };
+    return condition;
+}
+
+RuleEngine::Condition RuleEngine::compare(Input input, Comparison comparison, double value) {
+    const Condition condition = { Condition::COMPARE, input, comparison, value };
+    return condition;
+}
+
+/**
+ * Only the first edge condition of a rule triggers it; any others are ignored with a warning.
+ */
+RuleEngine::Actions RuleEngine::when(std::initializer_list<Condition> conditions) {
+    if (m_started) {
+        LOG_ERROR("Rules of station {} cannot be changed once started", m_station.getPrefix());
+    }
+    Rule rule = { static_cast<uint32_t>(m_conditions.size()), static_cast<uint32_t>(conditions.size()),
+                  static_cast<uint32_t>(m_actions.size()), 0, NO_EDGE, 0, false, false };
+    for (const Condition& condition : conditions) {
+        if (condition.kind != Condition::COMPARE) {
+            if (rule.edgeCondition == NO_EDGE) {
+                rule.edgeCondition = static_cast<uint32_t>(m_conditions.size());
+            }
+            else {
+                LOG_WARNING("Rule {} of station {} has more than one edge condition", m_rules.size(),
+                            m_station.getPrefix());
+            }
+        }
+        m_conditions.push_back(condition);
+    }
+    m_rules.push_back(rule);
+    return Actions(*this);
+}
+
+/**
+ * Builds the dependency index: for each input, the rules with a condition on it and the timers
+ * that follow it, as slices of two flat arrays.
+ */
+void RuleEngine::start() {
+    bool actuatorsChanged = false;
+    {
+        std::lock_guard<Mutex> scopedLock(m_mutex);
+        if (m_started) {
+            LOG_ERROR("Rules of station {} already started", m_station.getPrefix());
+            return;
+        }
+        std::vector<std::vector<uint32_t>> dependents(m_inputs.size());
+        for (uint32_t index = 0; index < m_rules.size(); ++index) {
+            const Rule& rule = m_rules[index];
+            for (uint32_t condition = rule.firstCondition; condition < rule.firstCondition + rule.conditionCount;
+                 ++condition) {
+                std::vector<uint32_t>& rules = dependents[m_conditions[condition].input];
+                if (rules.empty() || (rules.back() != index)) {
+                    rules.push_back(index);
+                }
+            }
+        }
+        std::vector<std::vector<Input>> timers(m_inputs.size());
+        for (Input index = 0; index < m_inputs.size(); ++index) {
+            if (m_inputs[index].kind == INPUT_TIMER) {
+                timers[m_inputs[index].source].push_back(index);
+            }
+        }
+        for (Input index = 0; index < m_inputs.size(); ++index) {
+            InputState& input = m_inputs[index];
+            input.firstDependent = static_cast<uint32_t>(m_dependents.size());
+            input.dependentCount = static_cast<uint32_t>(dependents[index].size());
+            m_dependents.insert(m_dependents.end(), dependents[index].begin(), dependents[index].end());
+            input.firstTimer = static_cast<uint32_t>(m_timerDependents.size());
+            input.timerCount = static_cast<uint32_t>(timers[index].size());
+            m_timerDependents.insert(m_timerDependents.end(), timers[index].begin(), timers[index].end());
+            if (input.sensor != nullptr) {
+                input.changeCount = input.sensor->getChangeCount();
+                input.value = input.sensor->getNumericValue();
+            }
+        }
+        m_started = true;
+        m_station.add(this);
+
+        for (uint32_t index = 0; index < m_rules.size(); ++index) {
+            m_rules[index].dirty = true;
+            m_nextDirtyRules.push_back(index);
+        }
+        for (Input index = 0; index < m_inputs.size(); ++index) {
+            updateTimers(index);
+        }
+        runRules();
+        actuatorsChanged = m_actuatorsChanged;
+        m_actuatorsChanged = false;
+        LOG_INFO("Started {} rules over {} inputs for station {}", m_rules.size(), m_inputs.size(),
+                 m_station.getPrefix());
+    }
+    if (actuatorsChanged) {
+        m_station.applyChanges();
+    }
+}
+
+RuleEngine::Input RuleEngine::addInput(InputKind kind, SensorDeserializer* sensor, const std::string& name,
+                                       double value) {
+    const InputState input = { kind, sensor, name, value, 0, 0, 0, 0, Clock::Duration::zero(), 0, 0, 0, 0, 0,
+                               false, false };
+    m_inputs.push_back(input);
+    return static_cast<Input>(m_inputs.size() - 1);
+}
+
+/**
+ * Notes a sensor changed by the frame being dispatched.  Called by the factory with its dispatch
+ * lock held, which is all that guards m_changedInputs.
+ */
+void RuleEngine::sensorChanged(Input input) {
+    if (!m_inputs[input].changedPending) {
+        m_inputs[input].changedPending = true;
+        m_changedInputs.push_back(input);
+    }
+}
+
+/**
+ * Called by the factory once the frame has been applied, with its dispatch lock held.
+ */
+void RuleEngine::evaluate() {
+    bool actuatorsChanged = false;
+    {
+        std::lock_guard<Mutex> scopedLock(m_mutex);
+        for (Input input : m_changedInputs) {
+            m_inputs[input].changedPending = false;
+            refreshSensor(input);
+        }
+        m_changedInputs.clear();
+        runRules();
+        actuatorsChanged = m_actuatorsChanged;
+        m_actuatorsChanged = false;
+    }
+    if (actuatorsChanged) {
+        m_station.applyChanges();
+    }
+}
+
+void RuleEngine::expireTimer(Input timer, uint64_t generation) {
+    bool actuatorsChanged = false;
+    {
+        std::lock_guard<Mutex> scopedLock(m_mutex);
+        InputState& input = m_inputs[timer];
+        if (!input.armed || (input.generation != generation)) {
+            return;
+        }
+        input.armed = false;
+        setInputValue(timer, 1);
+        runRules();
+        actuatorsChanged = m_actuatorsChanged;
+        m_actuatorsChanged = false;
+    }
+    if (actuatorsChanged) {
+        m_station.applyChanges();
+    }
+}
+
+/**
+ * Reads the sensor's value and the edges it saw.  A boolean tag that was conflated may have
+ * changed more than once; its edges alternate from the previous value.
+ */
+void RuleEngine::refreshSensor(Input index) {
+    InputState& input = m_inputs[index];
+    const double value = input.sensor->getNumericValue();
+    const uint64_t changeCount = input.sensor->getChangeCount();
+    const uint64_t edgeCount = changeCount - input.changeCount;
+    input.changeCount = changeCount;
+    if (edgeCount <= 1) {
+        setInputValue(index, value);
+        return;
+    }
+    const uint64_t risingCount = (input.value != 0) ? edgeCount / 2 : (edgeCount + 1) / 2;
+    input.risingCount += risingCount;
+    input.fallingCount += edgeCount - risingCount;
+    input.value = value;
+    inputChanged(index);
+}
+
+void RuleEngine::setInputValue(Input index, double value) {
+    InputState& input = m_inputs[index];
+    if (value == input.value) {
+        return;
+    }
+    if ((input.value == 0) && (value != 0)) {
+        ++input.risingCount;
+    }
+    else if ((input.value != 0) && (value == 0)) {
+        ++input.fallingCount;
+    }
+    input.value = value;
+    inputChanged(index);
+}
+
+/**
+ * Queues the input's rules for the next pass unless they are already waiting in this one.
+ */
+void RuleEngine::inputChanged(Input index) {
+    const InputState& input = m_inputs[index];
+    for (uint32_t dependent = input.firstDependent; dependent < input.firstDependent + input.dependentCount;
+         ++dependent) {
+        Rule& rule = m_rules[m_dependents[dependent]];
+        if (!rule.dirty) {
+            rule.dirty = true;
+            m_nextDirtyRules.push_back(m_dependents[dependent]);
+        }
+    }
+    updateTimers(index);
+}
+
+/**
+ * An on-delay timer restarts whenever its source falls, even within a conflated pulse, and is
+ * armed while its source is nonzero and it has not expired.
+ */
+void RuleEngine::updateTimers(Input index) {
+    const InputState& source = m_inputs[index];
+    for (uint32_t timerIndex = source.firstTimer; timerIndex < source.firstTimer + source.timerCount; ++timerIndex) {
+        const Input timer = m_timerDependents[timerIndex];
+        InputState& input = m_inputs[timer];
+        if ((source.value == 0) || (source.fallingCount != input.changeCount)) {
+            ++input.generation;
+            input.armed = false;
+            input.changeCount = source.fallingCount;
+            setInputValue(timer, 0);
+        }
+        if ((source.value != 0) && !input.armed && (input.value == 0)) {
+            input.armed = true;
+            const uint64_t generation = input.generation;
+            m_station.getExecutor().schedule(input.delay, [this, timer, generation] {
+                expireTimer(timer, generation);
+            });
+        }
+    }
+}
+
+/**
+ * Evaluates the dirty rules in declaration order, then the rules they dirtied, and so on.
+ */
+void RuleEngine::runRules() {
+    uint32_t passCount = 0;
+    while (!m_nextDirtyRules.empty()) {
+        if (++passCount > MAX_PASSES) {
+            LOG_WARNING("Rules of station {} still changing after {} passes", m_station.getPrefix(), MAX_PASSES);
+            for (uint32_t index : m_nextDirtyRules) {
+                m_rules[index].dirty = false;
+            }
+            m_nextDirtyRules.clear();
+            return;
+        }
+        m_dirtyRules.swap(m_nextDirtyRules);
+        m_nextDirtyRules.clear();
+        std::sort(m_dirtyRules.begin(), m_dirtyRules.end());
+        for (uint32_t index : m_dirtyRules) {
+            m_rules[index].dirty = false;
+            evaluateRule(index);
+        }
+        m_dirtyRules.clear();
+    }
+}
+
+void RuleEngine::evaluateRule(uint32_t index) {
+    Rule& rule = m_rules[index];
+    Metrics::rulesEvaluated.add();
+    if (rule.edgeCondition == NO_EDGE) {
+        const bool conditionsHeld = levelConditionsHold(rule);
+        const bool fires = conditionsHeld && !rule.conditionsHeld;
+        rule.conditionsHeld = conditionsHeld;
+        if (fires) {
+            fire(rule);
+        }
+        return;
+    }
+    const Condition& edge = m_conditions[rule.edgeCondition];
+    const InputState& input = m_inputs[edge.input];
+    const uint64_t edgeCount = (edge.kind == Condition::RISING) ? input.risingCount : input.fallingCount;
+    while (rule.consumedEdges < edgeCount) {
+        ++rule.consumedEdges;
+        if (levelConditionsHold(rule)) {
+            fire(rule);
+        }
+    }
+}
+
+bool RuleEngine::levelConditionsHold(const Rule& rule) const {
+    for (uint32_t index = rule.firstCondition; index < rule.firstCondition + rule.conditionCount; ++index) {
+        const Condition& condition = m_conditions[index];
+        if (condition.kind != Condition::COMPARE) {
+            continue;
+        }
+        const double value = m_inputs[condition.input].value;
+        bool holds = false;
+        switch (condition.comparison) {
+            case EQUAL:         holds = (value == condition.value); break;
+            case NOT_EQUAL:     holds = (value != condition.value); break;
+            case LESS:          holds = (value < condition.value); break;
+            case LESS_EQUAL:    holds = (value <= condition.value); break;
+            case GREATER:       holds = (value > condition.value); break;
+            case GREATER_EQUAL: holds = (value >= condition.value); break;
+        }
+        if (!holds) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void RuleEngine::fire(const Rule& rule) {
+    Metrics::rulesFired.add();
+    for (uint32_t index = rule.firstAction; index < rule.firstAction + rule.actionCount; ++index) {
+        const Action& action = m_actions[index];
+        switch (action.kind) {
+            case Action::SET:
+                action.actuator->setNumericValue(action.value);
+                m_actuatorsChanged = true;
+                break;
+            case Action::ADD:
+                setInputValue(action.counter, m_inputs[action.counter].value + action.value);
+                break;
+            case Action::ASSIGN:
+                setInputValue(action.counter, action.value);
+                break;
+        }
+    }
+}
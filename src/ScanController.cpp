@@ -0,0 +1,147 @@
+#include <functional>
+#include "ScanController.hpp"
+#include "Actuators.hpp"
+#include "Log.hpp"
+#include "Metrics.hpp"
+#include "Sensors.hpp"
+#include "StructuredText.hpp"
+
+const Clock::Duration ScanController::DEFAULT_PERIOD = std::chrono::milliseconds(10);
+
+/**
+ * Creates a sensor for each input and an actuator for each output, typed after the variable; an
+ * output starts at the variable's initial value, which the first flush sends.
+ */
+ScanController::LoadedProgram::LoadedProgram(Factory& factory, const std::string& stationPrefix,
+                                             const ControlProgram& compiled)
+: program(compiled), vm(program), station(factory, stationPrefix), sensors(), actuators(), inputs(), outputs() {
+    for (uint32_t index = 0; index < program.variables.size(); ++index) {
+        const ControlProgram::Variable& variable = program.variables[index];
+        if (variable.binding == ControlProgram::BINDING_INPUT) {
+            switch (variable.type) {
+                case ControlProgram::TYPE_BOOL:
+                    sensors.push_back(std::unique_ptr<SensorDeserializer>(
+                        new Sensor<bool>(station, variable.tag, false)));
+                    break;
+                case ControlProgram::TYPE_INT:
+                    sensors.push_back(std::unique_ptr<SensorDeserializer>(
+                        new Sensor<int32_t>(station, variable.tag, 0)));
+                    break;
+                case ControlProgram::TYPE_REAL:
+                    sensors.push_back(std::unique_ptr<SensorDeserializer>(
+                        new Sensor<float>(station, variable.tag, 0)));
+                    break;
+            }
+            inputs.push_back(std::make_pair(sensors.back().get(), index));
+        }
+        else if (variable.binding == ControlProgram::BINDING_OUTPUT) {
+            switch (variable.type) {
+                case ControlProgram::TYPE_BOOL:
+                    actuators.push_back(std::unique_ptr<ActuatorSerializer>(
+                        new Actuator<bool>(station, variable.tag, variable.initialValue != 0)));
+                    break;
+                case ControlProgram::TYPE_INT:
+                    actuators.push_back(std::unique_ptr<ActuatorSerializer>(
+                        new Actuator<int32_t>(station, variable.tag, static_cast<int32_t>(variable.initialValue))));
+                    break;
+                case ControlProgram::TYPE_REAL:
+                    actuators.push_back(std::unique_ptr<ActuatorSerializer>(
+                        new Actuator<float>(station, variable.tag, static_cast<float>(variable.initialValue))));
+                    break;
+            }
+            outputs.push_back(std::make_pair(actuators.back().get(), index));
+        }
+    }
+}
+
+ScanController::ScanController(Factory& factory, Clock::Duration period)
+: m_factory(factory),
+  m_period(period),
+  m_nextScan(),
+  m_programs(),
+  m_actuatorList(),
+  m_started(false),
+  m_mutex() {
+    nameLock(m_mutex, "scan controller", "programs");
+}
+
+bool ScanController::load(const std::string& source, const std::string& sourceName,
+                          const std::string& stationPrefix) {
+    ControlProgram program;
+    return StructuredText::compile(source, sourceName, program) && add(program, stationPrefix);
+}
+
+bool ScanController::loadFile(const std::string& path, const std::string& stationPrefix) {
+    ControlProgram program;
+    return StructuredText::compileFile(path, program) && add(program, stationPrefix);
+}
+
+bool ScanController::add(const ControlProgram& program, const std::string& stationPrefix) {
+    std::unique_ptr<LoadedProgram> loadedProgram(new LoadedProgram(m_factory, stationPrefix, program));
+    std::lock_guard<Mutex> scopedLock(m_mutex);
+    for (const std::unique_ptr<ActuatorSerializer>& actuator : loadedProgram->actuators) {
+        m_actuatorList.push_back(actuator.get());
+    }
+    m_programs.push_back(std::move(loadedProgram));
+    LOG_INFO("Loaded {} for station {}", program.name, stationPrefix);
+    return true;
+}
+
+void ScanController::start() {
+    m_factory.loadSensorValues();
+    if (!m_started) {
+        m_started = true;
+        m_nextScan = m_factory.getClock().now();
+        m_factory.getExecutor().submit(std::bind(&ScanController::scan, this));
+    }
+    else {
+        LOG_ERROR("Nice try buddy!");
+    }
+}
+
+void ScanController::stop() {
+    m_factory.stop();
+}
+
+void ScanController::waitUntilDone() {
+    m_factory.getExecutor().join();
+}
+
+uint32_t ScanController::getProgramCount() const {
+    std::lock_guard<Mutex> scopedLock(m_mutex);
+    return static_cast<uint32_t>(m_programs.size());
+}
+
+/**
+ * One scan cycle: input image, program, output image, one flush.  Scans are due every period
+ * from the first one; a scan that starts after the next was due skips ahead instead of running
+ * the missed ones back to back.
+ */
+void ScanController::scan() {
+    Clock& clock = m_factory.getClock();
+    const Clock::Duration now = clock.now();
+    const double nowMs = std::chrono::duration<double, std::milli>(now).count();
+    const uint64_t startNs = Metrics::nowNs();
+    {
+        std::lock_guard<Mutex> scopedLock(m_mutex);
+        for (std::unique_ptr<LoadedProgram>& loadedProgram : m_programs) {
+            ProgramVm& vm = loadedProgram->vm;
+            for (const std::pair<SensorDeserializer*, uint32_t>& input : loadedProgram->inputs) {
+                vm.setVariable(input.second, input.first->getNumericValue());
+            }
+            vm.scan(nowMs);
+            for (const std::pair<ActuatorSerializer*, uint32_t>& output : loadedProgram->outputs) {
+                output.first->setNumericValue(vm.getVariable(output.second));
+            }
+        }
+        m_factory.applyChanges(m_actuatorList);
+    }
+    Metrics::scanTime.record(Metrics::nowNs() - startNs);
+
+    m_nextScan += m_period;
+    if (m_nextScan <= now) {
+        Metrics::scanOverruns.add();
+        m_nextScan = now + m_period;
+    }
+    m_factory.getExecutor().schedule(m_nextScan - clock.now(), std::bind(&ScanController::scan, this));
+}
@@ -0,0 +1,303 @@
+#include "SensorPipeline.hpp"
+#include "Factory.hpp"
+#include "Metrics.hpp"
+#include "ThreadProfile.hpp"
+#include "Trace.hpp"
+
+SensorPipeline::SensorPipeline(Factory& factory, size_t capacity, bool conflation)
+: m_factory(factory),
+  m_frameRing(capacity),
+  m_documentRing(capacity),
+  m_framingCounters(),
+  m_parsingCounters(),
+  m_dispatchCounters(),
+  m_conflation(conflation),
+  m_mergedAllocator(m_mergedBuffer, MERGE_BUFFER_SIZE),
+  m_mergedDocument(&m_mergedAllocator),
+  m_mergedIndex(),
+  m_conflatedTags(),
+  m_conflationPasses(0),
+  m_mergedFrames(0),
+  m_droppedValues(0),
+  m_preservedEdges(0),
+  m_running(true),
+  m_parkMutex(),
+  m_parkControl(),
+  m_parkedCount(0),
+  m_parserThread(nullptr),
+  m_dispatcherThread(nullptr) {
+    nameLock(m_parkMutex, "sensor pipeline", "park");
+    m_parserThread = new std::thread(&SensorPipeline::parserThread, this);
+    m_dispatcherThread = new std::thread(&SensorPipeline::dispatcherThread, this);
+}
+
+SensorPipeline::~SensorPipeline() {
+    m_running = false;
+    {
+        std::lock_guard<Mutex> scopedLock(m_parkMutex);
+        m_parkControl.notify_all();
+    }
+    m_parserThread->join();
+    m_dispatcherThread->join();
+    delete m_parserThread;
+    delete m_dispatcherThread;
+}
+
+void SensorPipeline::submit(const std::string& frameText) {
+    const SteadyClock::time_point startTime = SteadyClock::now();
+    FrameSlot* slot = m_frameRing.claim();
+    if (slot == nullptr) {
+        m_framingCounters.recordStall();
+        uint32_t idleCount = 0;
+        while ((slot = m_frameRing.claim()) == nullptr) {
+            if (!m_running) {
+                return;
+            }
+            backOff(idleCount, [this] { return (m_frameRing.claim() != nullptr) || !m_running; });
+        }
+    }
+    slot->text.assign(frameText);
+    slot->queuedTime = SteadyClock::now();
+    m_frameRing.publish();
+    wakeParked();
+    m_framingCounters.record(startTime, startTime, slot->queuedTime, 0);
+}
+
+SensorPipeline::Statistics SensorPipeline::getStatistics() const {
+    Statistics statistics;
+    statistics.framing = m_framingCounters.get(0, 0);
+    statistics.parsing = m_parsingCounters.get(m_frameRing.size(), m_frameRing.capacity());
+    statistics.dispatch = m_dispatchCounters.get(m_documentRing.size(), m_documentRing.capacity());
+    statistics.conflation.passes = m_conflationPasses.load(std::memory_order_relaxed);
+    statistics.conflation.mergedFrames = m_mergedFrames.load(std::memory_order_relaxed);
+    statistics.conflation.droppedValues = m_droppedValues.load(std::memory_order_relaxed);
+    statistics.conflation.preservedEdges = m_preservedEdges.load(std::memory_order_relaxed);
+    return statistics;
+}
+
+void SensorPipeline::parserThread() {
+    Trace::setThreadName("parser");
+    ThreadProfile::apply(ThreadProfile::ROLE_RECEIVER);
+    uint32_t idleCount = 0;
+    while (m_running) {
+        FrameSlot* frame = m_frameRing.front();
+        if (frame == nullptr) {
+            backOff(idleCount, [this] { return (m_frameRing.front() != nullptr) || !m_running; });
+            continue;
+        }
+        idleCount = 0;
+
+        DocumentSlot* slot = nullptr;
+        while (((slot = m_documentRing.claim()) == nullptr) && m_running) {
+            backOff(idleCount, [this] { return (m_documentRing.claim() != nullptr) || !m_running; });
+        }
+        if (slot == nullptr) {
+            return;
+        }
+        idleCount = 0;
+
+        const size_t occupancy = m_frameRing.size();
+        const SteadyClock::time_point startTime = SteadyClock::now();
+        slot->allocator.Clear();
+        {
+            TRACE_SCOPE("parse");
+            slot->document.Parse(frame->text.c_str());
+        }
+        const SteadyClock::time_point queuedTime = frame->queuedTime;
+        m_frameRing.release();
+
+        slot->queuedTime = SteadyClock::now();
+        m_documentRing.publish();
+        wakeParked();
+        Metrics::parseTime.record(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            slot->queuedTime - startTime).count());
+        m_parsingCounters.record(queuedTime, startTime, slot->queuedTime, occupancy);
+    }
+}
+
+void SensorPipeline::dispatcherThread() {
+    Trace::setThreadName("dispatcher");
+    ThreadProfile::apply(ThreadProfile::ROLE_RECEIVER);
+    uint32_t idleCount = 0;
+    while (m_running) {
+        DocumentSlot* slot = m_documentRing.front();
+        if (slot == nullptr) {
+            backOff(idleCount, [this] { return (m_documentRing.front() != nullptr) || !m_running; });
+            continue;
+        }
+        idleCount = 0;
+
+        const size_t occupancy = m_documentRing.size();
+        if (m_conflation && (occupancy > 1)) {
+            dispatchConflated(occupancy);
+            continue;
+        }
+        const SteadyClock::time_point startTime = SteadyClock::now();
+        if (!slot->document.HasParseError()) {
+            m_factory.dispatchSensorValues(slot->document);
+        }
+        const SteadyClock::time_point queuedTime = slot->queuedTime;
+        m_documentRing.release();
+        wakeParked();
+        m_dispatchCounters.record(queuedTime, startTime, SteadyClock::now(), occupancy);
+    }
+}
+
+/**
+ * Merges the oldest frames of the backlog into one document, last writer wins per tag, and
+ * dispatches it.  For the boolean tags that were interned by a sensor, the first value and the
+ * edges between merged frames are recorded so sensors can account for pulses the merge flattened.
+ *
+ * @param frameCount    Number of queued documents to merge
+ */
+void SensorPipeline::dispatchConflated(size_t frameCount) {
+    const SteadyClock::time_point startTime = SteadyClock::now();
+    const SteadyClock::time_point queuedTime = m_documentRing.front()->queuedTime;
+
+    m_mergedAllocator.Clear();
+    m_mergedDocument.SetObject();
+    m_mergedIndex.clear();
+    m_conflatedTags.clear();
+    uint64_t droppedValues = 0;
+    uint64_t preservedEdges = 0;
+
+    for (size_t index = 0; index < frameCount; ++index) {
+        const rapidjson::Document& document = m_documentRing.peek(index)->document;
+        if (document.HasParseError() || !document.IsObject()) {
+            continue;
+        }
+        for (rapidjson::Value::ConstMemberIterator member = document.MemberBegin();
+             member != document.MemberEnd(); ++member) {
+            const std::string name(member->name.GetString(), member->name.GetStringLength());
+            MemberIndex::iterator merged = m_mergedIndex.find(name);
+            if (merged == m_mergedIndex.end()) {
+                const MergedMember mergedMember = {
+                    m_mergedDocument.MemberCount(), TagNames::find(name.data(), name.size())
+                };
+                m_mergedIndex[name] = mergedMember;
+                rapidjson::Value mergedName(member->name, m_mergedAllocator);
+                rapidjson::Value mergedValue(member->value, m_mergedAllocator);
+                m_mergedDocument.AddMember(mergedName, mergedValue, m_mergedAllocator);
+                if (member->value.IsBool() && (mergedMember.tag != TagNames::NO_TAG)) {
+                    ConflatedTag conflatedTag = { member->value.GetBool(), 0 };
+                    m_conflatedTags[mergedMember.tag] = conflatedTag;
+                }
+                continue;
+            }
+
+            rapidjson::Value& mergedValue = (m_mergedDocument.MemberBegin() + merged->second.index)->value;
+            ++droppedValues;
+            if (mergedValue.IsBool() && member->value.IsBool() &&
+                (mergedValue.GetBool() != member->value.GetBool())) {
+                ConflatedTagMap::iterator conflatedTag = m_conflatedTags.find(merged->second.tag);
+                if (conflatedTag != m_conflatedTags.end()) {
+                    ++conflatedTag->second.edgeCount;
+                    ++preservedEdges;
+                }
+            }
+            mergedValue.CopyFrom(member->value, m_mergedAllocator);
+        }
+    }
+    m_documentRing.release(frameCount);
+    wakeParked();
+
+    m_factory.dispatchSensorValues(m_mergedDocument, m_conflatedTags);
+    m_dispatchCounters.record(queuedTime, startTime, SteadyClock::now(), frameCount);
+    increment(m_conflationPasses, 1);
+    increment(m_mergedFrames, frameCount - 1);
+    increment(m_droppedValues, droppedValues);
+    increment(m_preservedEdges, preservedEdges);
+}
+
+// Only the dispatcher writes the conflation counters
+void SensorPipeline::increment(std::atomic<uint64_t>& counter, uint64_t amount) {
+    counter.store(counter.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+}
+
+/**
+ * Idle strategy shared by all stages: spin briefly, then yield, then park until another stage
+ * publishes or releases a slot, so an idle pipeline uses no CPU at all.
+ *
+ * A stage counts itself as parked before it checks its ring under the park lock, and wakeParked()
+ * looks at that count only after moving the ring, so a wake-up is never lost between the two.
+ *
+ * @param ready     Returns true once the stage can go on
+ */
+template<typename Ready>
+void SensorPipeline::backOff(uint32_t& idleCount, Ready ready) {
+    const uint32_t SPIN_LIMIT = 100;
+    const uint32_t YIELD_LIMIT = 200;
+    if (idleCount < SPIN_LIMIT) {
+        ++idleCount;
+    }
+    else if (idleCount < YIELD_LIMIT) {
+        ++idleCount;
+        std::this_thread::yield();
+    }
+    else {
+        std::unique_lock<Mutex> scopedLock(m_parkMutex);
+        m_parkedCount.fetch_add(1);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        m_parkControl.wait(scopedLock, ready);
+        m_parkedCount.fetch_sub(1);
+    }
+}
+
+/**
+ * Wakes any parked stage after a ring has moved.  Costs a fence, and the lock only when a stage
+ * is parked.
+ */
+void SensorPipeline::wakeParked() {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (m_parkedCount.load(std::memory_order_relaxed) > 0) {
+        std::lock_guard<Mutex> scopedLock(m_parkMutex);
+        m_parkControl.notify_all();
+    }
+}
+
+SensorPipeline::StageCounters::StageCounters()
+: m_frames(0), m_totalQueueWaitNs(0), m_maxQueueWaitNs(0), m_totalServiceNs(0), m_maxServiceNs(0),
+  m_stalls(0), m_maxOccupancy(0) {
+}
+
+void SensorPipeline::StageCounters::record(SteadyClock::time_point queuedTime, SteadyClock::time_point startTime,
+                                           SteadyClock::time_point endTime, size_t occupancy) {
+    const uint64_t queueWaitNs =
+        std::chrono::duration_cast<std::chrono::nanoseconds>(startTime - queuedTime).count();
+    const uint64_t serviceNs =
+        std::chrono::duration_cast<std::chrono::nanoseconds>(endTime - startTime).count();
+    m_frames.store(m_frames.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    m_totalQueueWaitNs.store(m_totalQueueWaitNs.load(std::memory_order_relaxed) + queueWaitNs,
+                             std::memory_order_relaxed);
+    m_totalServiceNs.store(m_totalServiceNs.load(std::memory_order_relaxed) + serviceNs,
+                           std::memory_order_relaxed);
+    storeMax(m_maxQueueWaitNs, queueWaitNs);
+    storeMax(m_maxServiceNs, serviceNs);
+    storeMax(m_maxOccupancy, occupancy);
+}
+
+void SensorPipeline::StageCounters::recordStall() {
+    m_stalls.store(m_stalls.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+SensorPipeline::StageStatistics SensorPipeline::StageCounters::get(size_t occupancy,
+                                                                   size_t capacity) const {
+    StageStatistics statistics;
+    statistics.frames = m_frames.load(std::memory_order_relaxed);
+    statistics.totalQueueWaitNs = m_totalQueueWaitNs.load(std::memory_order_relaxed);
+    statistics.maxQueueWaitNs = m_maxQueueWaitNs.load(std::memory_order_relaxed);
+    statistics.totalServiceNs = m_totalServiceNs.load(std::memory_order_relaxed);
+    statistics.maxServiceNs = m_maxServiceNs.load(std::memory_order_relaxed);
+    statistics.stalls = m_stalls.load(std::memory_order_relaxed);
+    statistics.occupancy = occupancy;
+    statistics.maxOccupancy = m_maxOccupancy.load(std::memory_order_relaxed);
+    statistics.capacity = capacity;
+    return statistics;
+}
+
+// Only the owning stage writes its counters, so a plain load/compare/store is enough
+void SensorPipeline::StageCounters::storeMax(std::atomic<uint64_t>& maximum, uint64_t value) {
+    if (value > maximum.load(std::memory_order_relaxed)) {
+        maximum.store(value, std::memory_order_relaxed);
+    }
+}
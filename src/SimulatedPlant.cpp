@@ -0,0 +1,71 @@
+#include "rapidjson/document.h"
+#include "rapidjson/writer.h"
+#include "rapidjson/stringbuffer.h"
+#include "SimulatedPlant.hpp"
+
+SimulatedPlant::SimulatedPlant(FactoryScene* scene, double frameRate)
+: m_scene(scene),
+  m_period(std::chrono::duration_cast<Clock::Duration>(std::chrono::duration<double>(1.0 / frameRate))),
+  m_eventHandler(nullptr), m_clock(nullptr), m_stepperThread(nullptr), m_mutex() {
+}
+
+void SimulatedPlant::connect(CommunicationsEventHandler& eventHandler, Clock& clock) {
+    m_eventHandler = &eventHandler;
+    m_clock = &clock;
+    m_eventHandler->handleConnectionEstablished();
+    m_stepperThread = clock.newThread(&SimulatedPlant::stepperThread, this);
+}
+
+void SimulatedPlant::disconnect() {
+    if (m_stepperThread != nullptr) {
+        m_stepperThread->join();
+        delete m_stepperThread;
+        m_stepperThread = nullptr;
+    }
+}
+
+void SimulatedPlant::sendMessage(const std::string& text) {
+    rapidjson::Document frame;
+    frame.Parse(text.c_str());
+    if (frame.HasParseError() || !frame.IsObject()) {
+        return;
+    }
+    rapidjson::Value::ConstMemberIterator request = frame.FindMember("Send Sensor Data");
+    if ((request != frame.MemberEnd()) && request->value.IsBool() && request->value.GetBool()) {
+        sendSensorValues(false);
+    }
+    else {
+        std::lock_guard<std::mutex> scopedLock(m_mutex);
+        m_scene->applyActuatorValues(frame);
+    }
+}
+
+void SimulatedPlant::stepperThread() {
+    Clock& clock = *m_clock;
+    const double stepSeconds = std::chrono::duration<double>(m_period).count();
+    Clock::Duration nextStep = clock.now() + m_period;
+    for (;;) {
+        clock.sleepUntil(nextStep);
+        nextStep += m_period;
+        {
+            std::lock_guard<std::mutex> scopedLock(m_mutex);
+            m_scene->step(stepSeconds);
+        }
+        sendSensorValues(true);
+    }
+}
+
+void SimulatedPlant::sendSensorValues(bool changedOnly) {
+    rapidjson::Document frame;
+    frame.SetObject();
+    {
+        std::lock_guard<std::mutex> scopedLock(m_mutex);
+        if (!m_scene->getSensorValues(frame, changedOnly) && changedOnly) {
+            return;
+        }
+    }
+    rapidjson::StringBuffer buffer;
+    rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+    frame.Accept(writer);
+    m_eventHandler->handleMessageReceived(buffer.GetString());
+}
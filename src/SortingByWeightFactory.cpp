@@ -1,42 +1,44 @@
+#include <chrono>
 #include "SortingByWeightFactory.hpp"
-#include <unistd.h>
+#include "ThreadProfile.hpp"
 
 SortingByWeightFactory::SortingByWeightFactory(Factory& factory) 
 : m_factory(factory),
-  m_station(factory),
-  m_emitter(m_station, "Emitter"),
-  m_leftRemover(m_station, "Left Remover"),
-  m_rightRemover(m_station, "Right Remover"),
-  m_backRemover(m_station, "Back Remover"),
-  m_entryConveyor(m_station, "Entry Conveyor"),
-  m_backConveyor(m_station, "Back Conveyor"),  
-  m_leftConveyor(m_station, "Left Conveyor"),
-  m_rightConveyor(m_station, "Right Conveyor"),
-  m_conveyorScale(m_station, "Conveyor Scale"),
-  m_popUpWheelSorter(m_station, "Wheel Sorter"),
-  m_entrySensor(m_station, "Entry Sensor"),
-  m_scaleSensor(m_station, "Scale Sensor"),
-  m_managerThread(new std::thread(&SortingByWeightFactory::sortingManager, this)) {
+  m_clock(factory.getClock()),
+  m_cell(factory),
+  m_managerThread(m_clock.newThread(&SortingByWeightFactory::sortingManager, this)) {
 }     
         
 void SortingByWeightFactory::sortingManager() {
-  m_backConveyor.setOn(true); 
-  m_leftConveyor.setOn(true); 
-  m_rightConveyor.setOn(true); 
-  m_leftRemover.setOn(true); 
-  m_rightRemover.setOn(true); 
-  m_backRemover.setOn(true); 
-  
-  m_emitter.setOn(true);
-  m_entryConveyor.setOn(true);
-  m_conveyorScale.setRotation(ROTATION_FORWARD);
-  m_popUpWheelSorter.rotateWheels(true);
-  m_popUpWheelSorter.setDirection(DIRECTION_STRAIGHT);
-  m_station.applyChanges();
-  sleep(1000);
+  ThreadProfile::apply(ThreadProfile::ROLE_CONTROLLER);
+  m_cell.set<SortingByWeightCell::BACK_CONVEYOR>(true);
+  m_cell.set<SortingByWeightCell::LEFT_CONVEYOR>(true);
+  m_cell.set<SortingByWeightCell::RIGHT_CONVEYOR>(true);
+  m_cell.set<SortingByWeightCell::LEFT_REMOVER>(true);
+  m_cell.set<SortingByWeightCell::RIGHT_REMOVER>(true);
+  m_cell.set<SortingByWeightCell::BACK_REMOVER>(true);
+
+  m_cell.set<SortingByWeightCell::EMITTER>(true);
+  m_cell.set<SortingByWeightCell::ENTRY_CONVEYOR>(true);
+  m_cell.set<SortingByWeightCell::SCALE_FORWARD>(true);
+  m_cell.set<SortingByWeightCell::SORTER_FORWARD>(true);
+  m_cell.applyChanges();
+  m_clock.sleepFor(std::chrono::seconds(1000));
+}
+
+/**
+ * A station that is still running stops the whole factory before its thread is joined.
+ */
+SortingByWeightFactory::~SortingByWeightFactory() {
+    if (m_managerThread->joinable()) {
+        m_factory.stop();
+    }
+    waitUntilDone();
 }
 
 void SortingByWeightFactory::waitUntilDone() {
-    m_managerThread->join();
+    if (m_managerThread->joinable()) {
+        m_managerThread->join();
+    }
 }
        
@@ -0,0 +1,71 @@
+#include "Station.hpp"
+#include "Metrics.hpp"
+#include "Trace.hpp"
+
+Station::Station(Factory& factory, std::string prefix)
+: m_factory(factory),
+  m_prefix(prefix),
+  m_actuatorList(),
+  m_mutex(),
+  m_waitStrategy(WAIT_BLOCK),
+  m_waitMutex(),
+  m_changeControl(),
+  m_changeCount(0),
+  m_publishedChangeCount(0),
+  m_waiterCount(0),
+  m_notifyTimeNs(0),
+  m_dispatchCount(0) {
+    nameLock(m_mutex, "station", m_prefix);
+    nameLock(m_waitMutex, "station wait", m_prefix);
+}
+
+void Station::waitForSensorChange() {
+    std::unique_lock<Mutex> scopedLock(m_waitMutex);
+    const uint64_t changeCount = m_changeCount;
+    TRACE_SCOPE("waitForSensorChange");
+    ++m_waiterCount;
+    getClock().blocked();
+    const WaitStrategy waitStrategy = getWaitStrategy();
+    if (waitStrategy != WAIT_BLOCK) {
+        scopedLock.unlock();
+        spinUntil(waitStrategy, [this, changeCount] {
+            return (m_publishedChangeCount.load(std::memory_order_acquire) != changeCount) ||
+                   getClock().isStopped();
+        });
+        scopedLock.lock();
+    }
+    m_changeControl.wait(scopedLock, [this, changeCount] {
+        return (m_changeCount != changeCount) || getClock().isStopped();
+    });
+    if (m_changeCount == changeCount) {
+        throw Clock::Stopped();
+    }
+    Metrics::wakeLatency.record(Metrics::nowNs() - m_notifyTimeNs);
+    Trace::adoptFlow();
+}
+
+/**
+ * Called by the factory once per dispatched frame that changed one of the station's sensors.
+ */
+void Station::notifyChange() {
+    uint32_t releasedCount = 0;
+    {
+        std::lock_guard<Mutex> scopedLock(m_waitMutex);
+        ++m_changeCount;
+        m_publishedChangeCount.store(m_changeCount, std::memory_order_release);
+        releasedCount = m_waiterCount;
+        m_waiterCount = 0;
+        m_notifyTimeNs = Metrics::nowNs();
+    }
+    if (releasedCount > 0) {
+        getClock().released(releasedCount);
+        m_changeControl.notify_all();
+    }
+}
+
+void Station::notifyStop() {
+    {
+        std::lock_guard<Mutex> scopedLock(m_waitMutex);
+    }
+    m_changeControl.notify_all();
+}
@@ -0,0 +1,673 @@
+#include <ctype.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <unordered_map>
+#include "StructuredText.hpp"
+#include "Log.hpp"
+
+namespace {
+    struct CompileError {
+        uint32_t    line;
+        std::string message;
+    };
+
+    struct Token {
+        enum Kind {
+            TOKEN_END,
+            TOKEN_IDENTIFIER,   // Also keywords; word holds the upper-case spelling
+            TOKEN_NUMBER,
+            TOKEN_STRING,
+            TOKEN_SYMBOL
+        };
+
+        Kind        kind;
+        std::string text;
+        std::string word;
+        double      number;
+        bool        integer;        // A number without a fraction or exponent, or a time
+        uint32_t    line;
+    };
+
+    std::string upperCase(const std::string& text) {
+        std::string upper(text);
+        for (char& character : upper) {
+            character = static_cast<char>(toupper(static_cast<unsigned char>(character)));
+        }
+        return upper;
+    }
+
+    /**
+     * Splits the source into tokens, dropping comments.
+     */
+    class Lexer {
+    public:
+        explicit Lexer(const std::string& source)
+        : m_source(source), m_position(0), m_line(1) {
+        }
+
+        Token next() {
+            skipSpaceAndComments();
+            Token token = { Token::TOKEN_END, std::string(), std::string(), 0, false, m_line };
+            if (m_position >= m_source.size()) {
+                return token;
+            }
+            const char character = m_source[m_position];
+            if (isalpha(static_cast<unsigned char>(character)) || (character == '_')) {
+                const size_t start = m_position;
+                while ((m_position < m_source.size()) &&
+                       (isalnum(static_cast<unsigned char>(m_source[m_position])) || (m_source[m_position] == '_'))) {
+                    ++m_position;
+                }
+                token.text = m_source.substr(start, m_position - start);
+                token.word = upperCase(token.text);
+                if ((m_position < m_source.size()) && (m_source[m_position] == '#') &&
+                    ((token.word == "T") || (token.word == "TIME"))) {
+                    ++m_position;
+                    return time(token);
+                }
+                token.kind = Token::TOKEN_IDENTIFIER;
+                return token;
+            }
+            if (isdigit(static_cast<unsigned char>(character))) {
+                const char* start = m_source.c_str() + m_position;
+                char* end = nullptr;
+                token.kind = Token::TOKEN_NUMBER;
+                token.number = strtod(start, &end);
+                token.text = std::string(start, static_cast<size_t>(end - start));
+                token.integer = (token.text.find_first_of(".eE") == std::string::npos);
+                m_position += end - start;
+                return token;
+            }
+            if (character == '"') {
+                const size_t end = m_source.find('"', m_position + 1);
+                if (end == std::string::npos) {
+                    throw CompileError{ m_line, "unterminated string" };
+                }
+                token.kind = Token::TOKEN_STRING;
+                token.text = m_source.substr(m_position + 1, end - m_position - 1);
+                m_position = end + 1;
+                return token;
+            }
+            static const char* const PAIRS[] = { ":=", "<>", "<=", ">=" };
+            token.kind = Token::TOKEN_SYMBOL;
+            for (const char* pair : PAIRS) {
+                if (m_source.compare(m_position, 2, pair) == 0) {
+                    token.text = pair;
+                    m_position += 2;
+                    return token;
+                }
+            }
+            if (std::string(";:(),=<>+-*/&").find(character) == std::string::npos) {
+                throw CompileError{ m_line, std::string("unexpected character '") + character + "'" };
+            }
+            token.text = std::string(1, character);
+            ++m_position;
+            return token;
+        }
+
+    private:
+        void skipSpaceAndComments() {
+            while (m_position < m_source.size()) {
+                const char character = m_source[m_position];
+                if (character == '\n') {
+                    ++m_line;
+                    ++m_position;
+                }
+                else if (isspace(static_cast<unsigned char>(character))) {
+                    ++m_position;
+                }
+                else if (m_source.compare(m_position, 2, "//") == 0) {
+                    m_position = m_source.find('\n', m_position);
+                    if (m_position == std::string::npos) {
+                        m_position = m_source.size();
+                    }
+                }
+                else if (m_source.compare(m_position, 2, "(*") == 0) {
+                    const size_t end = m_source.find("*)", m_position + 2);
+                    if (end == std::string::npos) {
+                        throw CompileError{ m_line, "unterminated comment" };
+                    }
+                    for (size_t index = m_position; index < end; ++index) {
+                        m_line += (m_source[index] == '\n') ? 1 : 0;
+                    }
+                    m_position = end + 2;
+                }
+                else {
+                    return;
+                }
+            }
+        }
+
+        /**
+         * A duration after T#, as one or more numbers with units, in milliseconds.
+         */
+        Token time(Token token) {
+            token.kind = Token::TOKEN_NUMBER;
+            token.integer = true;
+            bool empty = true;
+            while ((m_position < m_source.size()) && isdigit(static_cast<unsigned char>(m_source[m_position]))) {
+                const char* start = m_source.c_str() + m_position;
+                char* end = nullptr;
+                const double amount = strtod(start, &end);
+                m_position += end - start;
+                size_t unitEnd = m_position;
+                while ((unitEnd < m_source.size()) && isalpha(static_cast<unsigned char>(m_source[unitEnd]))) {
+                    ++unitEnd;
+                }
+                const std::string unit = upperCase(m_source.substr(m_position, unitEnd - m_position));
+                m_position = unitEnd;
+                double scale = 0;
+                if (unit == "MS") {
+                    scale = 1;
+                }
+                else if (unit == "S") {
+                    scale = 1000;
+                }
+                else if (unit == "M") {
+                    scale = 60000;
+                }
+                else if (unit == "H") {
+                    scale = 3600000;
+                }
+                else {
+                    throw CompileError{ m_line, "unknown time unit '" + unit + "'" };
+                }
+                token.number += amount * scale;
+                empty = false;
+                if ((m_position < m_source.size()) && (m_source[m_position] == '_')) {
+                    ++m_position;
+                }
+            }
+            if (empty) {
+                throw CompileError{ m_line, "empty time literal" };
+            }
+            token.text = "T#";
+            return token;
+        }
+
+        const std::string&  m_source;
+        size_t              m_position;
+        uint32_t            m_line;
+    };
+
+    /**
+     * Recursive descent over the tokens, emitting code as it goes.  Expression parsers return the
+     * type of the value they left on the stack.
+     */
+    class Compiler {
+    public:
+        Compiler(const std::string& source, ControlProgram& program)
+        : m_lexer(source), m_token(), m_program(program), m_names(), m_depth(0) {
+            m_program = ControlProgram();
+            m_program.stateCount = 0;
+            m_program.maxStackDepth = 0;
+            advance();
+        }
+
+        void compileProgram() {
+            expectWord("PROGRAM");
+            m_program.name = expectIdentifier();
+            while ((m_token.word == "VAR") || (m_token.word == "VAR_INPUT") || (m_token.word == "VAR_OUTPUT")) {
+                variableBlock();
+            }
+            statements();
+            expectWord("END_PROGRAM");
+            if (m_token.kind != Token::TOKEN_END) {
+                fail("unexpected '" + m_token.text + "' after END_PROGRAM");
+            }
+            emit(ControlProgram::OP_END);
+        }
+
+    private:
+        typedef ControlProgram::Type Type;
+
+        void advance() {
+            m_token = m_lexer.next();
+        }
+
+        void fail(const std::string& message) {
+            throw CompileError{ m_token.line, message };
+        }
+
+        bool acceptWord(const char* word) {
+            if ((m_token.kind == Token::TOKEN_IDENTIFIER) && (m_token.word == word)) {
+                advance();
+                return true;
+            }
+            return false;
+        }
+
+        bool acceptSymbol(const char* symbol) {
+            if ((m_token.kind == Token::TOKEN_SYMBOL) && (m_token.text == symbol)) {
+                advance();
+                return true;
+            }
+            return false;
+        }
+
+        void expectWord(const char* word) {
+            if (!acceptWord(word)) {
+                fail(std::string("expected ") + word + " but found '" + m_token.text + "'");
+            }
+        }
+
+        void expectSymbol(const char* symbol) {
+            if (!acceptSymbol(symbol)) {
+                fail(std::string("expected '") + symbol + "' but found '" + m_token.text + "'");
+            }
+        }
+
+        std::string expectIdentifier() {
+            if ((m_token.kind != Token::TOKEN_IDENTIFIER) || isKeyword(m_token.word)) {
+                fail("expected a name but found '" + m_token.text + "'");
+            }
+            const std::string name = m_token.text;
+            advance();
+            return name;
+        }
+
+        static bool isKeyword(const std::string& word) {
+            static const char* const KEYWORDS[] = {
+                "PROGRAM", "END_PROGRAM", "VAR", "VAR_INPUT", "VAR_OUTPUT", "END_VAR", "AT", "BOOL", "INT",
+                "REAL", "TIME", "TRUE", "FALSE", "IF", "THEN", "ELSIF", "ELSE", "END_IF", "AND", "OR", "XOR",
+                "NOT", "MOD", "R_TRIG", "F_TRIG", "TON"
+            };
+            for (const char* keyword : KEYWORDS) {
+                if (word == keyword) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        void variableBlock() {
+            const ControlProgram::Binding binding = (m_token.word == "VAR_INPUT") ? ControlProgram::BINDING_INPUT
+                                                  : (m_token.word == "VAR_OUTPUT") ? ControlProgram::BINDING_OUTPUT
+                                                  : ControlProgram::BINDING_NONE;
+            advance();
+            while (!acceptWord("END_VAR")) {
+                ControlProgram::Variable variable;
+                variable.name = expectIdentifier();
+                variable.binding = binding;
+                variable.initialValue = 0;
+                if (acceptWord("AT")) {
+                    if (m_token.kind != Token::TOKEN_STRING) {
+                        fail("expected a tag name in quotes after AT");
+                    }
+                    variable.tag = m_token.text;
+                    advance();
+                }
+                if ((binding != ControlProgram::BINDING_NONE) && variable.tag.empty()) {
+                    fail("input or output " + variable.name + " needs AT \"tag\"");
+                }
+                expectSymbol(":");
+                variable.type = typeName();
+                if (acceptSymbol(":=")) {
+                    variable.initialValue = literal(variable.type);
+                }
+                expectSymbol(";");
+                const std::string key = upperCase(variable.name);
+                if (m_names.count(key) > 0) {
+                    fail(variable.name + " is declared twice");
+                }
+                m_names[key] = static_cast<uint32_t>(m_program.variables.size());
+                m_program.variables.push_back(variable);
+            }
+        }
+
+        Type typeName() {
+            if (acceptWord("BOOL")) {
+                return ControlProgram::TYPE_BOOL;
+            }
+            if (acceptWord("INT") || acceptWord("TIME")) {
+                return ControlProgram::TYPE_INT;
+            }
+            if (acceptWord("REAL")) {
+                return ControlProgram::TYPE_REAL;
+            }
+            fail("expected BOOL, INT, REAL or TIME but found '" + m_token.text + "'");
+            return ControlProgram::TYPE_BOOL;
+        }
+
+        double literal(Type type) {
+            if (type == ControlProgram::TYPE_BOOL) {
+                if (acceptWord("TRUE")) {
+                    return 1;
+                }
+                if (acceptWord("FALSE")) {
+                    return 0;
+                }
+                fail("expected TRUE or FALSE");
+            }
+            const bool negative = acceptSymbol("-");
+            if ((m_token.kind != Token::TOKEN_NUMBER) || ((type == ControlProgram::TYPE_INT) && !m_token.integer)) {
+                fail("expected a number but found '" + m_token.text + "'");
+            }
+            const double value = negative ? -m_token.number : m_token.number;
+            advance();
+            return value;
+        }
+
+        bool atBlockEnd() const {
+            return (m_token.kind == Token::TOKEN_END) ||
+                   ((m_token.kind == Token::TOKEN_IDENTIFIER) &&
+                    ((m_token.word == "END_IF") || (m_token.word == "ELSIF") || (m_token.word == "ELSE") ||
+                     (m_token.word == "END_PROGRAM")));
+        }
+
+        void statements() {
+            while (!atBlockEnd()) {
+                if (acceptSymbol(";")) {
+                    continue;
+                }
+                if (acceptWord("IF")) {
+                    ifStatement();
+                }
+                else {
+                    assignment();
+                }
+            }
+        }
+
+        void ifStatement() {
+            std::vector<size_t> endJumps;
+            for (;;) {
+                condition();
+                expectWord("THEN");
+                const size_t skip = emit(ControlProgram::OP_JUMP_IF_FALSE);
+                statements();
+                if ((m_token.word == "ELSIF") || (m_token.word == "ELSE")) {
+                    endJumps.push_back(emit(ControlProgram::OP_JUMP));
+                }
+                patch(skip);
+                if (!acceptWord("ELSIF")) {
+                    break;
+                }
+            }
+            if (acceptWord("ELSE")) {
+                statements();
+            }
+            expectWord("END_IF");
+            acceptSymbol(";");
+            for (size_t jump : endJumps) {
+                patch(jump);
+            }
+        }
+
+        void condition() {
+            if (expression() != ControlProgram::TYPE_BOOL) {
+                fail("condition is not BOOL");
+            }
+        }
+
+        void assignment() {
+            const std::string name = expectIdentifier();
+            const uint32_t index = lookup(name);
+            const ControlProgram::Variable& variable = m_program.variables[index];
+            if (variable.binding == ControlProgram::BINDING_INPUT) {
+                fail(name + " is an input and cannot be assigned");
+            }
+            expectSymbol(":=");
+            const Type type = expression();
+            const Type target = m_program.variables[index].type;
+            if ((target != type) && !((target == ControlProgram::TYPE_REAL) && (type == ControlProgram::TYPE_INT))) {
+                fail("cannot assign " + typeText(type) + " to " + typeText(target) + " " + name);
+            }
+            emit(ControlProgram::OP_STORE, index);
+            expectSymbol(";");
+        }
+
+        Type expression() {
+            Type type = xorExpression();
+            while (acceptWord("OR")) {
+                type = logical(type, xorExpression(), ControlProgram::OP_OR);
+            }
+            return type;
+        }
+
+        Type xorExpression() {
+            Type type = andExpression();
+            while (acceptWord("XOR")) {
+                type = logical(type, andExpression(), ControlProgram::OP_XOR);
+            }
+            return type;
+        }
+
+        Type andExpression() {
+            Type type = comparison();
+            while (acceptWord("AND") || acceptSymbol("&")) {
+                type = logical(type, comparison(), ControlProgram::OP_AND);
+            }
+            return type;
+        }
+
+        Type comparison() {
+            const Type left = additive();
+            static const std::pair<const char*, ControlProgram::Opcode> OPERATORS[] = {
+                { "=", ControlProgram::OP_EQUAL }, { "<>", ControlProgram::OP_NOT_EQUAL },
+                { "<", ControlProgram::OP_LESS }, { "<=", ControlProgram::OP_LESS_EQUAL },
+                { ">", ControlProgram::OP_GREATER }, { ">=", ControlProgram::OP_GREATER_EQUAL }
+            };
+            for (const auto& comparisonOperator : OPERATORS) {
+                if (acceptSymbol(comparisonOperator.first)) {
+                    const Type right = additive();
+                    const bool equality = (comparisonOperator.second == ControlProgram::OP_EQUAL) ||
+                                          (comparisonOperator.second == ControlProgram::OP_NOT_EQUAL);
+                    const bool bothBool = (left == ControlProgram::TYPE_BOOL) && (right == ControlProgram::TYPE_BOOL);
+                    if (!(numeric(left) && numeric(right)) && !(equality && bothBool)) {
+                        fail(std::string("cannot compare ") + typeText(left) + " with " + typeText(right));
+                    }
+                    emit(comparisonOperator.second);
+                    return ControlProgram::TYPE_BOOL;
+                }
+            }
+            return left;
+        }
+
+        Type additive() {
+            Type type = multiplicative();
+            for (;;) {
+                if (acceptSymbol("+")) {
+                    type = arithmetic(type, multiplicative(), ControlProgram::OP_ADD);
+                }
+                else if (acceptSymbol("-")) {
+                    type = arithmetic(type, multiplicative(), ControlProgram::OP_SUBTRACT);
+                }
+                else {
+                    return type;
+                }
+            }
+        }
+
+        Type multiplicative() {
+            Type type = unary();
+            for (;;) {
+                if (acceptSymbol("*")) {
+                    type = arithmetic(type, unary(), ControlProgram::OP_MULTIPLY);
+                }
+                else if (acceptSymbol("/")) {
+                    const Type right = unary();
+                    const bool integer = (type == ControlProgram::TYPE_INT) && (right == ControlProgram::TYPE_INT);
+                    type = arithmetic(type, right, integer ? ControlProgram::OP_DIVIDE_INT : ControlProgram::OP_DIVIDE);
+                }
+                else if (acceptWord("MOD")) {
+                    type = arithmetic(type, unary(), ControlProgram::OP_MODULO);
+                }
+                else {
+                    return type;
+                }
+            }
+        }
+
+        Type unary() {
+            if (acceptWord("NOT")) {
+                if (unary() != ControlProgram::TYPE_BOOL) {
+                    fail("NOT needs a BOOL");
+                }
+                emit(ControlProgram::OP_NOT);
+                return ControlProgram::TYPE_BOOL;
+            }
+            if (acceptSymbol("-")) {
+                const Type type = unary();
+                if (!numeric(type)) {
+                    fail("cannot negate a BOOL");
+                }
+                emit(ControlProgram::OP_NEGATE);
+                return type;
+            }
+            return primary();
+        }
+
+        Type primary() {
+            if (m_token.kind == Token::TOKEN_NUMBER) {
+                const Type type = m_token.integer ? ControlProgram::TYPE_INT : ControlProgram::TYPE_REAL;
+                emit(ControlProgram::OP_PUSH, constant(m_token.number));
+                advance();
+                return type;
+            }
+            if (acceptSymbol("(")) {
+                const Type type = expression();
+                expectSymbol(")");
+                return type;
+            }
+            if ((m_token.word == "TRUE") || (m_token.word == "FALSE")) {
+                emit(ControlProgram::OP_PUSH, constant((m_token.word == "TRUE") ? 1 : 0));
+                advance();
+                return ControlProgram::TYPE_BOOL;
+            }
+            if ((m_token.word == "R_TRIG") || (m_token.word == "F_TRIG") || (m_token.word == "TON")) {
+                return call();
+            }
+            const uint32_t index = lookup(expectIdentifier());
+            emit(ControlProgram::OP_LOAD, index);
+            return m_program.variables[index].type;
+        }
+
+        Type call() {
+            const std::string function = m_token.word;
+            advance();
+            expectSymbol("(");
+            if (expression() != ControlProgram::TYPE_BOOL) {
+                fail(function + " needs a BOOL input");
+            }
+            ControlProgram::Opcode opcode = (function == "R_TRIG") ? ControlProgram::OP_RISING
+                                          : (function == "F_TRIG") ? ControlProgram::OP_FALLING
+                                          : ControlProgram::OP_ON_DELAY;
+            if (opcode == ControlProgram::OP_ON_DELAY) {
+                expectSymbol(",");
+                if (expression() != ControlProgram::TYPE_INT) {
+                    fail("TON needs a TIME preset");
+                }
+            }
+            expectSymbol(")");
+            emit(opcode, m_program.stateCount++);
+            return ControlProgram::TYPE_BOOL;
+        }
+
+        Type logical(Type left, Type right, ControlProgram::Opcode opcode) {
+            if ((left != ControlProgram::TYPE_BOOL) || (right != ControlProgram::TYPE_BOOL)) {
+                fail("logical operators need BOOL operands");
+            }
+            emit(opcode);
+            return ControlProgram::TYPE_BOOL;
+        }
+
+        Type arithmetic(Type left, Type right, ControlProgram::Opcode opcode) {
+            if (!numeric(left) || !numeric(right)) {
+                fail("arithmetic needs INT or REAL operands");
+            }
+            emit(opcode);
+            return ((left == ControlProgram::TYPE_REAL) || (right == ControlProgram::TYPE_REAL))
+                 ? ControlProgram::TYPE_REAL : ControlProgram::TYPE_INT;
+        }
+
+        static bool numeric(Type type) {
+            return type != ControlProgram::TYPE_BOOL;
+        }
+
+        static std::string typeText(Type type) {
+            return (type == ControlProgram::TYPE_BOOL) ? "BOOL" : (type == ControlProgram::TYPE_INT) ? "INT" : "REAL";
+        }
+
+        uint32_t lookup(const std::string& name) {
+            std::unordered_map<std::string, uint32_t>::const_iterator variable = m_names.find(upperCase(name));
+            if (variable == m_names.end()) {
+                fail(name + " is not declared");
+            }
+            return variable->second;
+        }
+
+        uint32_t constant(double value) {
+            for (uint32_t index = 0; index < m_program.constants.size(); ++index) {
+                if (m_program.constants[index] == value) {
+                    return index;
+                }
+            }
+            m_program.constants.push_back(value);
+            return static_cast<uint32_t>(m_program.constants.size() - 1);
+        }
+
+        /**
+         * Appends an instruction and tracks how deep it leaves the stack.
+         */
+        size_t emit(ControlProgram::Opcode opcode, uint32_t operand = 0) {
+            switch (opcode) {
+                case ControlProgram::OP_PUSH:
+                case ControlProgram::OP_LOAD:
+                    ++m_depth;
+                    break;
+                case ControlProgram::OP_NEGATE:
+                case ControlProgram::OP_NOT:
+                case ControlProgram::OP_RISING:
+                case ControlProgram::OP_FALLING:
+                case ControlProgram::OP_JUMP:
+                case ControlProgram::OP_END:
+                    break;
+                default:
+                    --m_depth;
+                    break;
+            }
+            m_program.maxStackDepth = std::max(m_program.maxStackDepth, m_depth);
+            const ControlProgram::Instruction instruction = { opcode, operand };
+            m_program.code.push_back(instruction);
+            return m_program.code.size() - 1;
+        }
+
+        void patch(size_t jump) {
+            m_program.code[jump].operand = static_cast<uint32_t>(m_program.code.size());
+        }
+
+        Lexer                                       m_lexer;
+        Token                                       m_token;
+        ControlProgram&                             m_program;
+        std::unordered_map<std::string, uint32_t>   m_names;    // Upper-case name to variable index
+        uint32_t                                    m_depth;
+    };
+}
+
+bool StructuredText::compile(const std::string& source, const std::string& sourceName, ControlProgram& program) {
+    try {
+        Compiler compiler(source, program);
+        compiler.compileProgram();
+    }
+    catch (const CompileError& error) {
+        LOG_ERROR("{}:{}: {}", sourceName, error.line, error.message);
+        return false;
+    }
+    LOG_INFO("Compiled {} from {}: {} instructions, {} variables", program.name, sourceName, program.code.size(),
+             program.variables.size());
+    return true;
+}
+
+bool StructuredText::compileFile(const std::string& path, ControlProgram& program) {
+    std::ifstream input(path);
+    if (!input) {
+        LOG_ERROR("Cannot read {}", path);
+        return false;
+    }
+    std::stringstream source;
+    source << input.rdbuf();
+    return compile(source.str(), path, program);
+}
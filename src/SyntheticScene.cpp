@@ -0,0 +1,42 @@
+#include "SyntheticScene.hpp"
+
+SyntheticScene::SyntheticScene(uint32_t tagCount, uint32_t tagsPerStep, std::string prefix)
+: m_tagNames(), m_values(tagCount, false), m_changed(tagCount, true), m_tagsPerStep(tagsPerStep),
+  m_nextTag(0), m_actuatorFrameCount(0) {
+    for (uint32_t tag = 0; tag < tagCount; ++tag) {
+        m_tagNames.push_back(prefix + std::to_string(tag));
+    }
+}
+
+SyntheticScene::SyntheticScene(const std::vector<std::string>& tagNames, uint32_t tagsPerStep)
+: m_tagNames(tagNames), m_values(tagNames.size(), false), m_changed(tagNames.size(), true),
+  m_tagsPerStep(tagsPerStep), m_nextTag(0), m_actuatorFrameCount(0) {
+}
+
+void SyntheticScene::applyActuatorValues(const rapidjson::Document& /* frame */) {
+    ++m_actuatorFrameCount;
+}
+
+void SyntheticScene::step(double /* elapsedSeconds */) {
+    if (m_tagNames.empty()) {
+        return;
+    }
+    for (uint32_t count = 0; count < m_tagsPerStep; ++count) {
+        m_values[m_nextTag] = !m_values[m_nextTag];
+        m_changed[m_nextTag] = true;
+        m_nextTag = (m_nextTag + 1) % m_tagNames.size();
+    }
+}
+
+bool SyntheticScene::getSensorValues(rapidjson::Document& frame, bool changedOnly) {
+    bool added = false;
+    for (size_t tag = 0; tag < m_tagNames.size(); ++tag) {
+        if (!changedOnly || m_changed[tag]) {
+            rapidjson::GenericStringRef<char> name(m_tagNames[tag].c_str());
+            frame.AddMember(name, static_cast<bool>(m_values[tag]), frame.GetAllocator());
+            m_changed[tag] = false;
+            added = true;
+        }
+    }
+    return added;
+}
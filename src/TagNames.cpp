@@ -0,0 +1,203 @@
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "TagNames.hpp"
+#include "Log.hpp"
+
+namespace {
+
+    // Entries are kept in fixed segments so that adding one never moves another
+    const uint32_t SEGMENT_BITS = 10;
+    const uint32_t SEGMENT_SIZE = 1u << SEGMENT_BITS;
+    const uint32_t MAX_SEGMENTS = 4096;             // About four million names
+    const size_t ARENA_BLOCK_SIZE = 64 * 1024;
+    const uint32_t INITIAL_CAPACITY = 256;          // Slots of the first table
+
+    const uint32_t FNV_OFFSET_BASIS = 2166136261u;
+    const uint32_t FNV_PRIME = 16777619u;
+
+    struct Entry {
+        const char* name;       // In the arena
+        uint32_t    length;
+        uint32_t    hash;
+    };
+
+    /**
+     * Open-addressed table of ids with linear probing, kept at most half full.  A slot holds one
+     * more than an id, or 0 while it is empty.
+     */
+    struct Table {
+        explicit Table(uint32_t capacity)
+        : mask(capacity - 1), slots(new std::atomic<uint32_t>[capacity]) {
+            for (uint32_t index = 0; index < capacity; ++index) {
+                slots[index].store(0, std::memory_order_relaxed);
+            }
+        }
+
+        uint32_t                                    mask;
+        std::unique_ptr<std::atomic<uint32_t>[]>    slots;
+    };
+
+    struct Interner {
+        Interner()
+        : mutex(), table(), tables(), segments(), segmentBlocks(), count(0), arenaBlocks(), arenaNext(nullptr),
+          arenaLeft(0) {
+            tables.push_back(std::unique_ptr<Table>(new Table(INITIAL_CAPACITY)));
+            table.store(tables.back().get(), std::memory_order_release);
+            for (std::atomic<Entry*>& segment : segments) {
+                segment.store(nullptr, std::memory_order_relaxed);
+            }
+        }
+
+        std::mutex                              mutex;          // Serializes additions
+        std::atomic<Table*>                     table;          // The table new lookups probe
+        std::vector<std::unique_ptr<Table>>     tables;         // Every table, as readers may still probe an old one
+        std::atomic<Entry*>                     segments[MAX_SEGMENTS];
+        std::vector<std::unique_ptr<Entry[]>>   segmentBlocks;
+        std::atomic<uint32_t>                   count;
+        std::vector<std::unique_ptr<char[]>>    arenaBlocks;
+        char*                                   arenaNext;      // Free space of the last block
+        size_t                                  arenaLeft;
+    };
+
+    Interner& interner() {
+        static Interner s_interner;
+        return s_interner;
+    }
+
+    uint32_t hashName(const char* name, size_t length) {
+        uint32_t hash = FNV_OFFSET_BASIS;
+        for (size_t index = 0; index < length; ++index) {
+            hash = (hash ^ static_cast<uint8_t>(name[index])) * FNV_PRIME;
+        }
+        return hash;
+    }
+
+    uint32_t firstSlot(uint32_t hash, uint32_t mask) {
+        return (hash ^ (hash >> 16)) & mask;
+    }
+
+    const Entry& entry(const Interner& names, TagId tag) {
+        return names.segments[tag >> SEGMENT_BITS].load(std::memory_order_acquire)[tag & (SEGMENT_SIZE - 1)];
+    }
+
+    /**
+     * Looks a name up in a table.
+     *
+     * @param slot  Set to the empty slot that ended the search if the name is not found
+     *
+     * @return the name's id, or NO_TAG
+     */
+    TagId probe(const Interner& names, const Table& table, const char* name, size_t length, uint32_t hash,
+                uint32_t& slot) {
+        for (slot = firstSlot(hash, table.mask); ; slot = (slot + 1) & table.mask) {
+            const uint32_t value = table.slots[slot].load(std::memory_order_acquire);
+            if (value == 0) {
+                return TagNames::NO_TAG;
+            }
+            const Entry& candidate = entry(names, value - 1);
+            if ((candidate.hash == hash) && (candidate.length == length) &&
+                (memcmp(candidate.name, name, length) == 0)) {
+                return value - 1;
+            }
+        }
+    }
+
+    /**
+     * Copies a name into the arena.  Called with the interner's mutex held.
+     */
+    const char* store(Interner& names, const char* name, size_t length) {
+        if (names.arenaLeft < length + 1) {
+            const size_t blockSize = std::max(ARENA_BLOCK_SIZE, length + 1);
+            names.arenaBlocks.push_back(std::unique_ptr<char[]>(new char[blockSize]));
+            names.arenaNext = names.arenaBlocks.back().get();
+            names.arenaLeft = blockSize;
+        }
+        char* copy = names.arenaNext;
+        memcpy(copy, name, length);
+        copy[length] = '\0';
+        names.arenaNext += length + 1;
+        names.arenaLeft -= length + 1;
+        return copy;
+    }
+
+    /**
+     * Replaces the table with one twice its size holding the first count ids.  Called with the
+     * interner's mutex held.
+     */
+    void grow(Interner& names, uint32_t count) {
+        const Table& oldTable = *names.table.load(std::memory_order_relaxed);
+        std::unique_ptr<Table> table(new Table((oldTable.mask + 1) * 2));
+        for (TagId tag = 0; tag < count; ++tag) {
+            uint32_t slot = firstSlot(entry(names, tag).hash, table->mask);
+            while (table->slots[slot].load(std::memory_order_relaxed) != 0) {
+                slot = (slot + 1) & table->mask;
+            }
+            table->slots[slot].store(tag + 1, std::memory_order_relaxed);
+        }
+        names.table.store(table.get(), std::memory_order_release);
+        names.tables.push_back(std::move(table));
+    }
+}
+
+TagId TagNames::intern(const char* name, size_t length) {
+    Interner& names = interner();
+    const uint32_t hash = hashName(name, length);
+    uint32_t slot = 0;
+    TagId tag = probe(names, *names.table.load(std::memory_order_acquire), name, length, hash, slot);
+    if (tag != NO_TAG) {
+        return tag;
+    }
+
+    // Another thread may have added the name since
+    std::lock_guard<std::mutex> scopedLock(names.mutex);
+    Table* table = names.table.load(std::memory_order_relaxed);
+    tag = probe(names, *table, name, length, hash, slot);
+    if (tag != NO_TAG) {
+        return tag;
+    }
+    tag = names.count.load(std::memory_order_relaxed);
+    if (tag >= MAX_SEGMENTS * SEGMENT_SIZE) {
+        LOG_ERROR("Too many tag names to intern {}", std::string(name, length));
+        return NO_TAG;
+    }
+    Entry* segment = names.segments[tag >> SEGMENT_BITS].load(std::memory_order_relaxed);
+    if (segment == nullptr) {
+        names.segmentBlocks.push_back(std::unique_ptr<Entry[]>(new Entry[SEGMENT_SIZE]));
+        segment = names.segmentBlocks.back().get();
+        names.segments[tag >> SEGMENT_BITS].store(segment, std::memory_order_release);
+    }
+    const Entry newEntry = { store(names, name, length), static_cast<uint32_t>(length), hash };
+    segment[tag & (SEGMENT_SIZE - 1)] = newEntry;
+    names.count.store(tag + 1, std::memory_order_release);
+
+    // The name is published by its slot, or by the larger table that includes it
+    if (2 * (tag + 1) > table->mask + 1) {
+        grow(names, tag + 1);
+    }
+    else {
+        table->slots[slot].store(tag + 1, std::memory_order_release);
+    }
+    return tag;
+}
+
+TagId TagNames::find(const char* name, size_t length) {
+    const Interner& names = interner();
+    uint32_t slot = 0;
+    return probe(names, *names.table.load(std::memory_order_acquire), name, length, hashName(name, length), slot);
+}
+
+const char* TagNames::getName(TagId tag) {
+    return (tag != NO_TAG) ? entry(interner(), tag).name : "";
+}
+
+uint32_t TagNames::getLength(TagId tag) {
+    return (tag != NO_TAG) ? entry(interner(), tag).length : 0;
+}
+
+uint32_t TagNames::getCount() {
+    return interner().count.load(std::memory_order_acquire);
+}
@@ -0,0 +1,129 @@
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sstream>
+#include "ThreadProfile.hpp"
+#include "Log.hpp"
+
+ThreadProfile::Settings ThreadProfile::s_settings[ThreadProfile::ROLE_COUNT];
+
+namespace {
+
+    const char* const ROLE_NAMES[ThreadProfile::ROLE_COUNT] = { "receiver", "controller", "writer" };
+
+    // Touched when a thread applies its profile; well within the default 8 MB stack
+    const size_t PREFAULT_STACK_SIZE = 256 * 1024;
+
+    void __attribute__((noinline)) prefaultStack() {
+        volatile char stack[PREFAULT_STACK_SIZE];
+        for (size_t offset = 0; offset < PREFAULT_STACK_SIZE; offset += 4096) {
+            stack[offset] = 0;
+        }
+        (void) stack;
+    }
+
+    bool parseCpus(const std::string& text, std::vector<int>& cpus) {
+        if (text == "*") {
+            return true;
+        }
+        std::stringstream stream(text);
+        std::string range;
+        while (std::getline(stream, range, '+')) {
+            char* end = nullptr;
+            const long first = strtol(range.c_str(), &end, 10);
+            long last = first;
+            if (*end == '-') {
+                last = strtol(end + 1, &end, 10);
+            }
+            if ((*end != '\0') || range.empty() || (first < 0) || (last < first) || (last >= CPU_SETSIZE)) {
+                return false;
+            }
+            for (long cpu = first; cpu <= last; ++cpu) {
+                cpus.push_back(cpu);
+            }
+        }
+        return !cpus.empty();
+    }
+}
+
+void ThreadProfile::configure(Role role, const Settings& settings) {
+    s_settings[role] = settings;
+    s_settings[role].configured = true;
+}
+
+bool ThreadProfile::configure(const std::string& specification) {
+    Settings settings[ROLE_COUNT];
+    std::stringstream stream(specification);
+    std::string entry;
+    while (std::getline(stream, entry, ',')) {
+        std::stringstream fields(entry);
+        std::string roleName;
+        std::string cpus;
+        std::string priority;
+        if (!std::getline(fields, roleName, ':') || !std::getline(fields, cpus, ':') ||
+            !std::getline(fields, priority, ':')) {
+            return false;
+        }
+        int role = 0;
+        while ((role < ROLE_COUNT) && (roleName != ROLE_NAMES[role])) {
+            ++role;
+        }
+        if (role == ROLE_COUNT) {
+            return false;
+        }
+        char* end = nullptr;
+        settings[role].priority = strtol(priority.c_str(), &end, 10);
+        if ((*end != '\0') || !parseCpus(cpus, settings[role].cpus) || (settings[role].priority < 0) ||
+            (settings[role].priority > sched_get_priority_max(SCHED_FIFO))) {
+            return false;
+        }
+        settings[role].configured = true;
+    }
+    for (int role = 0; role < ROLE_COUNT; ++role) {
+        if (settings[role].configured) {
+            s_settings[role] = settings[role];
+        }
+    }
+    return true;
+}
+
+bool ThreadProfile::lockMemory() {
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0) {
+        LOG_WARNING("mlockall failed ({}); pages may be swapped out", strerror(errno));
+        return false;
+    }
+    LOG_INFO("Locked process memory");
+    return true;
+}
+
+void ThreadProfile::apply(Role role) {
+    const Settings& settings = s_settings[role];
+    if (!settings.configured) {
+        return;
+    }
+    if (!settings.cpus.empty()) {
+        cpu_set_t cpuSet;
+        CPU_ZERO(&cpuSet);
+        for (int cpu : settings.cpus) {
+            CPU_SET(cpu, &cpuSet);
+        }
+        const int result = pthread_setaffinity_np(pthread_self(), sizeof(cpuSet), &cpuSet);
+        if (result != 0) {
+            LOG_WARNING("cannot pin {} thread: {}", ROLE_NAMES[role], strerror(result));
+        }
+    }
+    if (settings.priority > 0) {
+        struct sched_param parameters;
+        memset(&parameters, 0, sizeof(parameters));
+        parameters.sched_priority = settings.priority;
+        const int result = pthread_setschedparam(pthread_self(), SCHED_FIFO, &parameters);
+        if (result != 0) {
+            LOG_WARNING("cannot run {} thread at SCHED_FIFO {}: {}", ROLE_NAMES[role], settings.priority,
+                        strerror(result));
+        }
+    }
+    prefaultStack();
+}
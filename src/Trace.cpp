@@ -0,0 +1,210 @@
+#include <unistd.h>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "Trace.hpp"
+#include "Log.hpp"
+#include "Metrics.hpp"
+
+std::atomic<bool> Trace::s_enabled(false);
+
+namespace {
+
+    enum Phase {
+        PHASE_COMPLETE = 'X',
+        PHASE_FLOW_START = 's',
+        PHASE_FLOW_STEP = 't',
+        PHASE_FLOW_END = 'f'
+    };
+
+    struct Event {
+        const char* name;
+        uint64_t    timestampNs;
+        uint64_t    durationNs;
+        uint64_t    flowId;
+        char        phase;
+    };
+
+    /**
+     * Events of one thread.  Only the owning thread records; the lock keeps write() from reading
+     * a half-written event.
+     */
+    struct ThreadTrace {
+        explicit ThreadTrace(uint32_t threadId)
+        : mutex(), threadId(threadId), name(nullptr), events(), next(0), wrapped(false), flowId(0), flowName(nullptr) {
+        }
+
+        void record(const Event& event, size_t capacity) {
+            std::lock_guard<std::mutex> scopedLock(mutex);
+            if (events.size() != capacity) {
+                events.assign(capacity, Event());
+                next = 0;
+                wrapped = false;
+            }
+            events[next] = event;
+            if (++next == events.size()) {
+                next = 0;
+                wrapped = true;
+            }
+        }
+
+        std::mutex          mutex;
+        uint32_t            threadId;
+        const char*         name;
+        std::vector<Event>  events;     // Ring of the latest events
+        size_t              next;       // Slot the next event goes into
+        bool                wrapped;
+        uint64_t            flowId;     // Flow adopted by the thread, or 0
+        const char*         flowName;
+    };
+
+    struct Tracer {
+        Tracer()
+        : mutex(), threads(), capacity(Trace::DEFAULT_CAPACITY), nextFlowId(1), latestFlowId(0), latestFlowName(nullptr) {
+        }
+
+        ThreadTrace* registerThread() {
+            std::lock_guard<std::mutex> scopedLock(mutex);
+            // Kept after the thread ends so its events can still be written
+            threads.emplace_back(new ThreadTrace(threads.size() + 1));
+            return threads.back().get();
+        }
+
+        std::mutex                                  mutex;
+        std::vector<std::unique_ptr<ThreadTrace> >  threads;
+        std::atomic<size_t>                         capacity;
+        std::atomic<uint64_t>                       nextFlowId;
+        std::atomic<uint64_t>                       latestFlowId;
+        std::atomic<const char*>                    latestFlowName;
+    };
+
+    Tracer& tracer() {
+        static Tracer s_tracer;
+        return s_tracer;
+    }
+
+    ThreadTrace& threadTrace() {
+        static thread_local ThreadTrace* t_threadTrace = nullptr;
+        if (t_threadTrace == nullptr) {
+            t_threadTrace = tracer().registerThread();
+        }
+        return *t_threadTrace;
+    }
+
+    void record(const char* name, Phase phase, uint64_t timestampNs, uint64_t durationNs, uint64_t flowId) {
+        Event event;
+        event.name = name;
+        event.timestampNs = timestampNs;
+        event.durationNs = durationNs;
+        event.flowId = flowId;
+        event.phase = phase;
+        threadTrace().record(event, tracer().capacity.load(std::memory_order_relaxed));
+    }
+
+    void writeEvent(std::ostream& output, const Event& event, uint32_t threadId, pid_t processId) {
+        output << ",\n{\"name\":\"" << event.name << "\",\"cat\":\"factoryio\",\"ph\":\"" << event.phase
+               << "\",\"ts\":" << event.timestampNs / 1000.0 << ",\"pid\":" << processId << ",\"tid\":" << threadId;
+        if (event.phase == PHASE_COMPLETE) {
+            output << ",\"dur\":" << event.durationNs / 1000.0;
+        }
+        else {
+            output << ",\"id\":" << event.flowId;
+            if (event.phase == PHASE_FLOW_END) {
+                output << ",\"bp\":\"e\"";
+            }
+        }
+        output << "}";
+    }
+}
+
+void Trace::enable(size_t capacity) {
+    tracer().capacity = capacity;
+    s_enabled = true;
+}
+
+void Trace::disable() {
+    s_enabled = false;
+}
+
+void Trace::setThreadName(const char* name) {
+    ThreadTrace& trace = threadTrace();
+    std::lock_guard<std::mutex> scopedLock(trace.mutex);
+    trace.name = name;
+}
+
+void Trace::complete(const char* name, uint64_t startNs, uint64_t endNs) {
+    record(name, PHASE_COMPLETE, startNs, endNs - startNs, 0);
+}
+
+void Trace::beginFlow(const char* name) {
+    if (!isEnabled()) {
+        return;
+    }
+    Tracer& flows = tracer();
+    const uint64_t flowId = flows.nextFlowId++;
+    record(name, PHASE_FLOW_START, TraceScope::now(), 0, flowId);
+    flows.latestFlowName = name;
+    flows.latestFlowId = flowId;
+}
+
+void Trace::adoptFlow() {
+    if (!isEnabled()) {
+        return;
+    }
+    Tracer& flows = tracer();
+    ThreadTrace& trace = threadTrace();
+    trace.flowId = flows.latestFlowId;
+    trace.flowName = flows.latestFlowName;
+    if (trace.flowId != 0) {
+        record(trace.flowName, PHASE_FLOW_STEP, TraceScope::now(), 0, trace.flowId);
+    }
+}
+
+void Trace::endFlow() {
+    if (!isEnabled()) {
+        return;
+    }
+    ThreadTrace& trace = threadTrace();
+    if (trace.flowId != 0) {
+        record(trace.flowName, PHASE_FLOW_END, TraceScope::now(), 0, trace.flowId);
+        trace.flowId = 0;
+    }
+}
+
+void Trace::write(std::ostream& output) {
+    Tracer& traces = tracer();
+    const pid_t processId = getpid();
+    output << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n"
+           << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" << processId << ",\"args\":{\"name\":\"factoryio\"}}";
+    std::lock_guard<std::mutex> scopedLock(traces.mutex);
+    for (const std::unique_ptr<ThreadTrace>& trace : traces.threads) {
+        std::lock_guard<std::mutex> traceLock(trace->mutex);
+        if (trace->name != nullptr) {
+            output << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << processId << ",\"tid\":"
+                   << trace->threadId << ",\"args\":{\"name\":\"" << trace->name << "\"}}";
+        }
+        // Oldest first
+        const size_t count = trace->wrapped ? trace->events.size() : trace->next;
+        const size_t first = trace->wrapped ? trace->next : 0;
+        for (size_t index = 0; index < count; ++index) {
+            writeEvent(output, trace->events[(first + index) % trace->events.size()], trace->threadId, processId);
+        }
+    }
+    output << "\n]}\n";
+}
+
+bool Trace::write(const std::string& path) {
+    std::ofstream output(path.c_str());
+    if (!output) {
+        LOG_ERROR("failed to open trace file {}", path);
+        return false;
+    }
+    write(output);
+    LOG_INFO("Wrote trace to {}", path);
+    return true;
+}
+
+uint64_t TraceScope::now() {
+    return Metrics::nowNs();
+}
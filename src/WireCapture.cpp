@@ -0,0 +1,169 @@
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "WireCapture.hpp"
+#include "Log.hpp"
+#include "ThreadProfile.hpp"
+
+const char WireCaptureFormat::MAGIC[8] = { 'F', 'I', 'O', 'W', 'I', 'R', 'E', '1' };
+
+namespace {
+    const int32_t STATUS_FAILURE(-1);
+    const std::chrono::seconds WRITE_INTERVAL(1);
+}
+
+WireCapture::WireCapture()
+: m_fd(STATUS_FAILURE), m_start(), m_mutex(), m_writeControl(), m_buffer(), m_recordCount(0),
+  m_closing(false), m_thread(nullptr) {
+}
+
+WireCapture::~WireCapture() {
+    if (m_thread != nullptr) {
+        {
+            std::lock_guard<std::mutex> scopedLock(m_mutex);
+            m_closing = true;
+        }
+        m_writeControl.notify_all();
+        m_thread->join();
+        delete m_thread;
+    }
+    if (m_fd != STATUS_FAILURE) {
+        flush();
+        close(m_fd);
+    }
+}
+
+bool WireCapture::open(const std::string& path) {
+    m_fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0644);
+    if (m_fd == STATUS_FAILURE) {
+        LOG_ERROR("failed to create capture file {}", path);
+        return false;
+    }
+    m_buffer.reserve(BUFFER_SIZE);
+    m_start = std::chrono::steady_clock::now();
+
+    WireCaptureFormat::FileHeader header;
+    memcpy(header.magic, WireCaptureFormat::MAGIC, sizeof(header.magic));
+    header.startTimeNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    const char* bytes = reinterpret_cast<const char*>(&header);
+    m_buffer.insert(m_buffer.end(), bytes, bytes + sizeof(header));
+    write();
+    m_thread = new std::thread(&WireCapture::writerThread, this);
+    LOG_INFO("Capturing frames to {}", path);
+    return true;
+}
+
+void WireCapture::record(WireCaptureFormat::Direction direction, const char* data, size_t size) {
+    WireCaptureFormat::RecordHeader header;
+    header.timestampNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - m_start).count();
+    header.size = static_cast<uint32_t>(size);
+    header.direction = direction;
+    memset(header.reserved, 0, sizeof(header.reserved));
+    const char* bytes = reinterpret_cast<const char*>(&header);
+
+    std::lock_guard<std::mutex> scopedLock(m_mutex);
+    m_buffer.insert(m_buffer.end(), bytes, bytes + sizeof(header));
+    m_buffer.insert(m_buffer.end(), data, data + size);
+    ++m_recordCount;
+    if (m_buffer.size() >= BUFFER_SIZE) {
+        write();
+    }
+}
+
+void WireCapture::flush() {
+    std::lock_guard<std::mutex> scopedLock(m_mutex);
+    write();
+}
+
+void WireCapture::writerThread() {
+    ThreadProfile::apply(ThreadProfile::ROLE_WRITER);
+    std::unique_lock<std::mutex> scopedLock(m_mutex);
+    while (!m_closing) {
+        m_writeControl.wait_for(scopedLock, WRITE_INTERVAL);
+        write();
+    }
+}
+
+void WireCapture::write() {
+    size_t written = 0;
+    while (written < m_buffer.size()) {
+        ssize_t count = ::write(m_fd, &m_buffer[written], m_buffer.size() - written);
+        if (count <= 0) {
+            LOG_ERROR("failed to write capture file; {} bytes dropped", m_buffer.size() - written);
+            break;
+        }
+        written += count;
+    }
+    m_buffer.clear();
+}
+
+WireReplay::WireReplay()
+: m_data(nullptr), m_size(0), m_position(0) {
+}
+
+WireReplay::~WireReplay() {
+    if (m_data != nullptr) {
+        munmap(const_cast<char*>(m_data), m_size);
+    }
+}
+
+bool WireReplay::open(const std::string& path) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd == STATUS_FAILURE) {
+        LOG_ERROR("failed to open capture file {}", path);
+        return false;
+    }
+    struct stat status;
+    if ((fstat(fd, &status) == STATUS_FAILURE) ||
+        (static_cast<size_t>(status.st_size) < sizeof(WireCaptureFormat::FileHeader))) {
+        LOG_ERROR("{} is not a capture file", path);
+        close(fd);
+        return false;
+    }
+    void* data = mmap(nullptr, status.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        LOG_ERROR("failed to map capture file {}", path);
+        return false;
+    }
+    madvise(data, status.st_size, MADV_SEQUENTIAL);
+    m_data = static_cast<const char*>(data);
+    m_size = status.st_size;
+    if (memcmp(m_data, WireCaptureFormat::MAGIC, sizeof(WireCaptureFormat::MAGIC)) != 0) {
+        LOG_ERROR("{} is not a capture file", path);
+        return false;
+    }
+    rewind();
+    return true;
+}
+
+bool WireReplay::next(Record& record) {
+    WireCaptureFormat::RecordHeader header;
+    if (m_size - m_position < sizeof(header)) {
+        return false;
+    }
+    memcpy(&header, m_data + m_position, sizeof(header));
+    if (m_size - m_position - sizeof(header) < header.size) {
+        return false;
+    }
+    record.timestampNs = header.timestampNs;
+    record.direction = static_cast<WireCaptureFormat::Direction>(header.direction);
+    record.data = m_data + m_position + sizeof(header);
+    record.size = header.size;
+    m_position += sizeof(header) + header.size;
+    return true;
+}
+
+void WireReplay::rewind() {
+    m_position = sizeof(WireCaptureFormat::FileHeader);
+}
+
+uint64_t WireReplay::getStartTimeNs() const {
+    WireCaptureFormat::FileHeader header;
+    memcpy(&header, m_data, sizeof(header));
+    return header.startTimeNs;
+}
@@ -0,0 +1,424 @@
+/*
+ * Microbenchmarks of the factory's hot paths, reported as JSON so results can be compared from
+ * one release to the next.
+ *
+ * Cases (each run for several parameter sets):
+ *   framing         FrameDecoder on a stream of frames delivered in pieces of a given size
+ *   dispatch        Factory::handleNewSensorValues with N sensors and M members per frame
+ *   get-value       Sensor::getValue from T threads reading the same sensor
+ *   apply-changes   Factory::applyChanges with N dirty actuators over a LoopbackTransport
+ *   wake-latency    Time from dispatching a change to a thread returning from waitForChange
+ *
+ * Usage: factoryio-benchmark [--filter text] [--min-time seconds] [--output file] [--list]
+ *
+ * A case runs when its id ("dispatch/sensors=100/members=10") contains the filter text.  Timed
+ * cases are calibrated to run for about --min-time seconds and report the median and minimum of
+ * five repetitions.
+ */
+
+#include <getopt.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "rapidjson/filewritestream.h"
+#include "rapidjson/prettywriter.h"
+#include "Actuators.hpp"
+#include "Factory.hpp"
+#include "FrameDecoder.hpp"
+#include "Log.hpp"
+#include "LoopbackTransport.hpp"
+#include "Sensors.hpp"
+#include "Station.hpp"
+
+namespace {
+
+    typedef std::vector<std::pair<std::string, double> > Values;
+
+    struct Case {
+        std::string                 name;
+        Values                      parameters;
+        std::function<Values()>     run;            // Returns the metrics
+
+        std::string id() const {
+            std::string text = name;
+            for (const std::pair<std::string, double>& parameter : parameters) {
+                text += "/" + parameter.first + "=" + std::to_string(static_cast<int64_t>(parameter.second));
+            }
+            return text;
+        }
+    };
+
+    const uint32_t REPETITIONS = 5;
+    double s_minTimeSeconds = 0.5;
+
+    /**
+     * Times a body that performs a given number of iterations of operationsPerIteration operations
+     * each.  The count is doubled until one run takes a tenth of the minimum time, then scaled so
+     * that REPETITIONS runs fill it.
+     */
+    Values measure(std::function<void(uint64_t)> body, uint32_t operationsPerIteration = 1) {
+        typedef std::chrono::steady_clock SteadyClock;
+        uint64_t iterations = 1;
+        double seconds = 0;
+        for (;;) {
+            SteadyClock::time_point start = SteadyClock::now();
+            body(iterations);
+            seconds = std::chrono::duration<double>(SteadyClock::now() - start).count();
+            if (seconds >= s_minTimeSeconds / 10) {
+                break;
+            }
+            iterations *= 2;
+        }
+        iterations = std::max<uint64_t>(1, iterations * (s_minTimeSeconds / REPETITIONS) / seconds);
+
+        std::vector<double> nsPerOperation;
+        for (uint32_t repetition = 0; repetition < REPETITIONS; ++repetition) {
+            SteadyClock::time_point start = SteadyClock::now();
+            body(iterations);
+            nsPerOperation.push_back(std::chrono::duration<double, std::nano>(SteadyClock::now() - start).count() /
+                                     (iterations * operationsPerIteration));
+        }
+        std::sort(nsPerOperation.begin(), nsPerOperation.end());
+        const double median = nsPerOperation[REPETITIONS / 2];
+        return Values {
+            { "operations", static_cast<double>(iterations * operationsPerIteration) },
+            { "nsPerOperation", median },
+            { "nsPerOperationMin", nsPerOperation.front() },
+            { "operationsPerSecond", 1e9 / median }
+        };
+    }
+
+    std::string buildFrame(uint32_t first, uint32_t memberCount, uint32_t tagCount, bool value) {
+        std::string frame = "{";
+        for (uint32_t member = 0; member < memberCount; ++member) {
+            if (member > 0) {
+                frame += ",";
+            }
+            frame += "\"Tag " + std::to_string((first + member) % tagCount) + "\":" + (value ? "true" : "false");
+        }
+        return frame + "}";
+    }
+
+    /**
+     * Frames that each change memberCount of tagCount tags, cycling so that every frame is a change.
+     */
+    std::vector<std::string> buildFrames(uint32_t tagCount, uint32_t memberCount) {
+        std::vector<std::string> frames;
+        for (uint32_t frame = 0; frame < 2 * tagCount; ++frame) {
+            const uint32_t first = frame * memberCount;
+            frames.push_back(buildFrame(first % tagCount, memberCount, tagCount, (first / tagCount) % 2 == 0));
+        }
+        return frames;
+    }
+
+    std::vector<RetroreflectiveSensor*> addSensors(Station& station, uint32_t count) {
+        std::vector<RetroreflectiveSensor*> sensors;
+        for (uint32_t tag = 0; tag < count; ++tag) {
+            sensors.push_back(new RetroreflectiveSensor(station, "Tag " + std::to_string(tag)));
+        }
+        return sensors;
+    }
+
+    template<typename T>
+    void deleteAll(std::vector<T*>& objects) {
+        for (T* object : objects) {
+            delete object;
+        }
+        objects.clear();
+    }
+
+    /**
+     * A stream of frames delivered in pieces of fragmentSize bytes (0 for the whole stream at once).
+     */
+    Values framing(uint32_t fragmentSize) {
+        const uint32_t FRAME_COUNT = 1000;
+        std::string stream;
+        std::vector<std::string> frames = buildFrames(50, 3);
+        for (uint32_t frame = 0; frame < FRAME_COUNT; ++frame) {
+            stream += FrameDecoder::encode(frames[frame % frames.size()]);
+        }
+        const size_t pieceSize = (fragmentSize == 0) ? stream.size() : fragmentSize;
+        FrameDecoder frameDecoder;
+        std::string frameText;
+        uint64_t decoded = 0;
+        Values metrics = measure([&](uint64_t iterations) {
+            for (uint64_t iteration = 0; iteration < iterations; ++iteration) {
+                for (size_t offset = 0; offset < stream.size(); offset += pieceSize) {
+                    frameDecoder.append(stream.data() + offset, std::min(pieceSize, stream.size() - offset));
+                    while (frameDecoder.next(frameText)) {
+                        ++decoded;
+                    }
+                }
+            }
+        }, FRAME_COUNT);
+        metrics.push_back({ "bytesPerFrame", static_cast<double>(stream.size()) / FRAME_COUNT });
+        return metrics;
+    }
+
+    Values dispatch(uint32_t sensorCount, uint32_t memberCount) {
+        Factory factory;
+        Station station(factory);
+        std::vector<RetroreflectiveSensor*> sensors = addSensors(station, sensorCount);
+        const std::vector<std::string> frames = buildFrames(sensorCount, memberCount);
+        size_t next = 0;
+        Values metrics = measure([&](uint64_t iterations) {
+            for (uint64_t iteration = 0; iteration < iterations; ++iteration) {
+                factory.handleNewSensorValues(frames[next]);
+                next = (next + 1) % frames.size();
+            }
+        });
+        deleteAll(sensors);
+        return metrics;
+    }
+
+    /**
+     * The reads are split between the threads and timed by the wall clock, so the time per read
+     * falls as threads are added until they contend for the sensor's lock.
+     */
+    Values getValue(uint32_t threadCount) {
+        Factory factory;
+        Station station(factory);
+        RetroreflectiveSensor sensor(station, "Tag 0");
+        std::atomic<uint64_t> detected(0);
+        return measure([&](uint64_t iterations) {
+            const uint64_t perThread = std::max<uint64_t>(1, iterations / threadCount);
+            std::vector<std::thread*> threads;
+            for (uint32_t thread = 0; thread < threadCount; ++thread) {
+                threads.push_back(new std::thread([&sensor, &detected, perThread] {
+                    uint64_t count = 0;
+                    for (uint64_t iteration = 0; iteration < perThread; ++iteration) {
+                        count += sensor.beamDetected() ? 1 : 0;
+                    }
+                    detected += count;
+                }));
+            }
+            for (std::thread* thread : threads) {
+                thread->join();
+            }
+            deleteAll(threads);
+        });
+    }
+
+    Values applyChanges(uint32_t actuatorCount, uint32_t dirtyCount) {
+        LoopbackTransport transport;
+        Factory factory;
+        Station station(factory);
+        std::vector<OnOffActuator*> actuators;
+        for (uint32_t tag = 0; tag < actuatorCount; ++tag) {
+            actuators.push_back(new OnOffActuator(station, "Output " + std::to_string(tag)));
+        }
+        factory.start(transport);
+        bool on = false;
+        Values metrics = measure([&](uint64_t iterations) {
+            for (uint64_t iteration = 0; iteration < iterations; ++iteration) {
+                on = !on;
+                for (uint32_t actuator = 0; actuator < dirtyCount; ++actuator) {
+                    actuators[actuator]->setOn(on);
+                }
+                station.applyChanges();
+            }
+        });
+        deleteAll(actuators);
+        return metrics;
+    }
+
+    /**
+     * Not calibrated: each change is dispatched after the waiters have had time to block again,
+     * and every waiter's latency is a sample.
+     */
+    Values wakeLatency(uint32_t waiterCount) {
+        typedef std::chrono::steady_clock SteadyClock;
+        const uint32_t CHANGE_COUNT = 2000;
+        Factory factory;
+        Station station(factory);
+        RetroreflectiveSensor sensor(station, "Tag 0");
+        const std::string frames[2] = { "{\"Tag 0\":true}", "{\"Tag 0\":false}" };
+        std::atomic<bool> running(true);
+        std::atomic<int64_t> dispatchTime(0);
+        std::vector<std::vector<double> > samples(waiterCount);
+        std::vector<std::thread*> waiters;
+        for (uint32_t waiter = 0; waiter < waiterCount; ++waiter) {
+            std::vector<double>* waiterSamples = &samples[waiter];
+            waiters.push_back(new std::thread([&sensor, &running, &dispatchTime, waiterSamples] {
+                for (;;) {
+                    sensor.waitForChange();
+                    const int64_t now = SteadyClock::now().time_since_epoch().count();
+                    if (!running) {
+                        break;
+                    }
+                    waiterSamples->push_back(std::chrono::duration<double, std::nano>(
+                        SteadyClock::duration(now - dispatchTime)).count());
+                }
+            }));
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        for (uint32_t change = 0; change < CHANGE_COUNT; ++change) {
+            dispatchTime = SteadyClock::now().time_since_epoch().count();
+            factory.handleNewSensorValues(frames[change % 2]);
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+        }
+        running = false;
+        factory.handleNewSensorValues(frames[CHANGE_COUNT % 2]);
+        for (std::thread* waiter : waiters) {
+            waiter->join();
+        }
+        deleteAll(waiters);
+
+        std::vector<double> latencies;
+        for (const std::vector<double>& waiterSamples : samples) {
+            latencies.insert(latencies.end(), waiterSamples.begin(), waiterSamples.end());
+        }
+        std::sort(latencies.begin(), latencies.end());
+        if (latencies.empty()) {
+            return Values();
+        }
+        return Values {
+            { "samples", static_cast<double>(latencies.size()) },
+            { "p50Ns", latencies[latencies.size() / 2] },
+            { "p90Ns", latencies[latencies.size() * 9 / 10] },
+            { "p99Ns", latencies[latencies.size() * 99 / 100] },
+            { "maxNs", latencies.back() }
+        };
+    }
+
+    std::vector<Case> createCases() {
+        std::vector<Case> cases;
+        for (uint32_t fragmentSize : { 1u, 7u, 64u, 1500u, 0u }) {
+            cases.push_back(Case { "framing", { { "fragment", fragmentSize } },
+                                   [fragmentSize] { return framing(fragmentSize); } });
+        }
+        const std::pair<uint32_t, uint32_t> dispatchSizes[] = {
+            { 10, 1 }, { 100, 1 }, { 100, 10 }, { 1000, 1 }, { 1000, 10 }, { 1000, 100 }
+        };
+        for (const std::pair<uint32_t, uint32_t>& size : dispatchSizes) {
+            cases.push_back(Case { "dispatch", { { "sensors", size.first }, { "members", size.second } },
+                                   [size] { return dispatch(size.first, size.second); } });
+        }
+        for (uint32_t threadCount : { 1u, 2u, 4u, 8u }) {
+            cases.push_back(Case { "get-value", { { "threads", threadCount } },
+                                   [threadCount] { return getValue(threadCount); } });
+        }
+        for (uint32_t dirtyCount : { 1u, 10u, 100u }) {
+            cases.push_back(Case { "apply-changes", { { "actuators", 100 }, { "dirty", dirtyCount } },
+                                   [dirtyCount] { return applyChanges(100, dirtyCount); } });
+        }
+        for (uint32_t waiterCount : { 1u, 4u }) {
+            cases.push_back(Case { "wake-latency", { { "waiters", waiterCount } },
+                                   [waiterCount] { return wakeLatency(waiterCount); } });
+        }
+        return cases;
+    }
+
+    template<typename Writer>
+    void writeValues(Writer& writer, const char* name, const Values& values) {
+        writer.Key(name);
+        writer.StartObject();
+        for (const std::pair<std::string, double>& value : values) {
+            writer.Key(value.first.c_str());
+            writer.Double(value.second);
+        }
+        writer.EndObject();
+    }
+
+    void usage(const char* program) {
+        std::cerr << "usage: " << program << " [--filter text] [--min-time seconds] [--output file] [--list]"
+                  << std::endl;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    std::string filter;
+    std::string outputPath;
+    bool list = false;
+
+    const struct option options[] = {
+        { "filter",   required_argument, nullptr, 'f' },
+        { "min-time", required_argument, nullptr, 't' },
+        { "output",   required_argument, nullptr, 'o' },
+        { "list",     no_argument,       nullptr, 'l' },
+        { "help",     no_argument,       nullptr, 'h' },
+        { nullptr,    0,                 nullptr, 0 }
+    };
+    int option;
+    while ((option = getopt_long(argc, argv, "f:t:o:lh", options, nullptr)) != -1) {
+        switch (option) {
+            case 'f': filter = optarg; break;
+            case 't': s_minTimeSeconds = strtod(optarg, nullptr); break;
+            case 'o': outputPath = optarg; break;
+            case 'l': list = true; break;
+            default:
+                usage(argv[0]);
+                return (option == 'h') ? 0 : 1;
+        }
+    }
+    Log::setLevel(LOG_LEVEL_WARNING);
+
+    const std::vector<Case> cases = createCases();
+    if (list) {
+        for (const Case& benchmarkCase : cases) {
+            std::cout << benchmarkCase.id() << std::endl;
+        }
+        return 0;
+    }
+
+    FILE* output = outputPath.empty() ? stdout : fopen(outputPath.c_str(), "w");
+    if (output == nullptr) {
+        std::cerr << "cannot create " << outputPath << std::endl;
+        return 1;
+    }
+    char buffer[64 * 1024];
+    rapidjson::FileWriteStream stream(output, buffer, sizeof(buffer));
+    rapidjson::PrettyWriter<rapidjson::FileWriteStream> writer(stream);
+
+    char date[32];
+    const time_t now = time(nullptr);
+    strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", gmtime(&now));
+    writer.StartObject();
+    writer.Key("context");
+    writer.StartObject();
+    writer.Key("date");
+    writer.String(date);
+    writer.Key("hardwareConcurrency");
+    writer.Uint(std::thread::hardware_concurrency());
+    writer.Key("minTimeSeconds");
+    writer.Double(s_minTimeSeconds);
+    writer.EndObject();
+
+    writer.Key("benchmarks");
+    writer.StartArray();
+    for (const Case& benchmarkCase : cases) {
+        const std::string id = benchmarkCase.id();
+        if (id.find(filter) == std::string::npos) {
+            continue;
+        }
+        std::cerr << id << std::endl;
+        const Values metrics = benchmarkCase.run();
+        writer.StartObject();
+        writer.Key("id");
+        writer.String(id.c_str());
+        writer.Key("name");
+        writer.String(benchmarkCase.name.c_str());
+        writeValues(writer, "parameters", benchmarkCase.parameters);
+        writeValues(writer, "metrics", metrics);
+        writer.EndObject();
+    }
+    writer.EndArray();
+    writer.EndObject();
+    stream.Put('\n');
+    stream.Flush();
+    if (output != stdout) {
+        fclose(output);
+    }
+    return 0;
+}
@@ -0,0 +1,121 @@
+/*
+ * Measures how many wake-ups and context switches each inbound sensor frame costs.
+ *
+ * A frame that toggles every tag is dispatched through Factory::handleNewSensorValues while a set
+ * of threads waits on individual sensors and another set waits on the factory as a whole.
+ *
+ * Usage: change-notification-benchmark [tags] [sensor waiters] [factory waiters] [frames]
+ */
+
+#include <sys/resource.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Factory.hpp"
+#include "Sensors.hpp"
+#include "Station.hpp"
+
+static uint32_t argument(int argc, char* argv[], int index, uint32_t defaultValue) {
+    return (argc > index) ? static_cast<uint32_t>(atoi(argv[index])) : defaultValue;
+}
+
+static std::string buildFrame(uint32_t tagCount, bool value) {
+    std::string frame = "{";
+    for (uint32_t tag = 0; tag < tagCount; ++tag) {
+        if (tag > 0) {
+            frame += ",";
+        }
+        frame += "\"Tag " + std::to_string(tag) + "\":" + (value ? "true" : "false");
+    }
+    return frame + "}";
+}
+
+static void contextSwitches(long& voluntary, long& involuntary) {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    voluntary = usage.ru_nvcsw;
+    involuntary = usage.ru_nivcsw;
+}
+
+int main(int argc, char* argv[]) {
+    const uint32_t tagCount = argument(argc, argv, 1, 50);
+    const uint32_t sensorWaiterCount = argument(argc, argv, 2, 4);
+    const uint32_t factoryWaiterCount = argument(argc, argv, 3, 4);
+    const uint32_t frameCount = argument(argc, argv, 4, 2000);
+
+    Factory factory;
+    Station station(factory);
+    std::vector<RetroreflectiveSensor*> sensors;
+    for (uint32_t tag = 0; tag < tagCount; ++tag) {
+        sensors.push_back(new RetroreflectiveSensor(station, "Tag " + std::to_string(tag)));
+    }
+
+    std::atomic<bool> running(true);
+    std::atomic<uint64_t> wakeups(0);
+    std::vector<std::thread*> waiters;
+    for (uint32_t waiter = 0; waiter < sensorWaiterCount; ++waiter) {
+        RetroreflectiveSensor* sensor = sensors[waiter % tagCount];
+        waiters.push_back(new std::thread([&running, &wakeups, sensor] {
+            while (running) {
+                sensor->waitForChange();
+                ++wakeups;
+            }
+        }));
+    }
+    for (uint32_t waiter = 0; waiter < factoryWaiterCount; ++waiter) {
+        waiters.push_back(new std::thread([&running, &wakeups, &station] {
+            while (running) {
+                station.waitForSensorChange();
+                ++wakeups;
+            }
+        }));
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    const std::string frameText[2] = { buildFrame(tagCount, true), buildFrame(tagCount, false) };
+    long voluntaryBefore, involuntaryBefore, voluntaryAfter, involuntaryAfter;
+    std::chrono::nanoseconds dispatchTime(0);
+
+    contextSwitches(voluntaryBefore, involuntaryBefore);
+    for (uint32_t frame = 0; frame < frameCount; ++frame) {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        factory.handleNewSensorValues(frameText[frame % 2]);
+        dispatchTime += std::chrono::steady_clock::now() - start;
+        // Give the waiters time to go back to sleep so every frame finds them blocked
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+    contextSwitches(voluntaryAfter, involuntaryAfter);
+    const uint64_t measuredWakeups = wakeups;
+
+    running = false;
+    factory.handleNewSensorValues(frameText[frameCount % 2]);
+    for (std::thread* waiter : waiters) {
+        waiter->join();
+        delete waiter;
+    }
+
+    // The pacing sleep costs the dispatching thread one voluntary switch per frame
+    const double frames = frameCount;
+    std::cout << "tags:                           " << tagCount << std::endl;
+    std::cout << "sensor waiters:                 " << sensorWaiterCount << std::endl;
+    std::cout << "factory waiters:                " << factoryWaiterCount << std::endl;
+    std::cout << "frames:                         " << frameCount << std::endl;
+    std::cout << "wake-ups per frame:             " << measuredWakeups / frames << std::endl;
+    std::cout << "voluntary switches per frame:   "
+              << (voluntaryAfter - voluntaryBefore) / frames - 1 << std::endl;
+    std::cout << "involuntary switches per frame: "
+              << (involuntaryAfter - involuntaryBefore) / frames << std::endl;
+    std::cout << "dispatch time per frame (ns):   "
+              << std::chrono::duration_cast<std::chrono::nanoseconds>(dispatchTime).count() / frames
+              << std::endl;
+
+    for (RetroreflectiveSensor* sensor : sensors) {
+        delete sensor;
+    }
+    return 0;
+}
@@ -0,0 +1,232 @@
+/*
+ * Saturates both directions of a Factory connection at once and reports how many frames each
+ * direction moves.
+ *
+ * A local server floods the factory with sensor frames while several station threads flood it
+ * with actuator frames.  The server drains actuator frames either as fast as it can or slowly,
+ * so that the factory's send() blocks; inbound dispatch should keep its rate in both cases.
+ * Actuator frames are counted as they are sent; station flushes that merge into a frame already
+ * on its way are reported separately.
+ *
+ * Usage: contention-benchmark [seconds per run] [station threads] [port]
+ *                             [0 = direct, 1 = pipelined, 2 = pipelined with conflation]
+ */
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Actuators.hpp"
+#include "Factory.hpp"
+#include "Log.hpp"
+#include "Metrics.hpp"
+#include "SensorDeserializer.hpp"
+#include "Station.hpp"
+
+/**
+ * Counts every inbound frame that reaches the factory's dispatch loop.
+ */
+class FrameCounter : public SensorDeserializer {
+public:
+    FrameCounter() : m_frameCount(0) {
+    }
+
+    virtual bool deserialize(const rapidjson::Document& /* jsonDocument */) {
+        ++m_frameCount;
+        return false;
+    }
+
+    virtual void notifyChange() {
+    }
+
+    uint64_t getFrameCount() const {
+        return m_frameCount;
+    }
+
+private:
+    std::atomic<uint64_t> m_frameCount;
+};
+
+/**
+ * Stand-in for the Factory IO side of the connection.
+ */
+class FloodServer {
+public:
+    FloodServer(uint32_t port)
+    : m_listenFd(-1), m_connectionFd(-1), m_running(true), m_slowReader(false),
+      m_sender(nullptr), m_reader(nullptr) {
+        m_listenFd = socket(AF_INET, SOCK_STREAM, 0);
+        int reuse = 1;
+        setsockopt(m_listenFd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+        // A small receive window makes the slow reader push back on the factory's send() quickly
+        int receiveBufferSize = 4 * 1024;
+        setsockopt(m_listenFd, SOL_SOCKET, SO_RCVBUF, &receiveBufferSize, sizeof(receiveBufferSize));
+        struct sockaddr_in address;
+        memset(&address, 0, sizeof(address));
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        address.sin_port = htons(port);
+        if ((bind(m_listenFd, (struct sockaddr *) &address, sizeof(address)) < 0) ||
+            (listen(m_listenFd, 1) < 0)) {
+            throw std::runtime_error("failed to listen");
+        }
+    }
+
+    void accept() {
+        m_connectionFd = ::accept(m_listenFd, nullptr, nullptr);
+        m_sender = new std::thread(&FloodServer::sendSensorFrames, this);
+        m_reader = new std::thread(&FloodServer::readActuatorFrames, this);
+    }
+
+    void setSlowReader(bool slowReader) {
+        m_slowReader = slowReader;
+    }
+
+    void stop() {
+        m_running = false;
+        m_sender->join();
+        shutdown(m_connectionFd, SHUT_RDWR);
+        m_reader->join();
+        close(m_connectionFd);
+        close(m_listenFd);
+        delete m_sender;
+        delete m_reader;
+    }
+
+private:
+    void sendSensorFrames() {
+        const std::string frames[2] = { "\a\a{\"Tag\":true}\b\b", "\a\a{\"Tag\":false}\b\b" };
+        for (uint64_t frame = 0; m_running; ++frame) {
+            const std::string& text = frames[frame % 2];
+            if (send(m_connectionFd, text.c_str(), text.size(), MSG_NOSIGNAL) <= 0) {
+                return;
+            }
+        }
+    }
+
+    void readActuatorFrames() {
+        char buffer[64 * 1024];
+        for (;;) {
+            size_t readSize = m_slowReader ? 64 : sizeof(buffer);
+            if (recv(m_connectionFd, buffer, readSize, 0) <= 0) {
+                return;
+            }
+            if (m_slowReader) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        }
+    }
+
+    int                 m_listenFd;
+    int                 m_connectionFd;
+    std::atomic<bool>   m_running;
+    std::atomic<bool>   m_slowReader;
+    std::thread*        m_sender;
+    std::thread*        m_reader;
+};
+
+static void printStage(const char* name, const SensorPipeline::StageStatistics& stage) {
+    const double frames = (stage.frames > 0) ? stage.frames : 1;
+    std::cout << name << ": " << stage.frames << " frames"
+              << ", queue wait avg/max " << stage.totalQueueWaitNs / frames << "/" << stage.maxQueueWaitNs
+              << " ns, service avg/max " << stage.totalServiceNs / frames << "/" << stage.maxServiceNs
+              << " ns, occupancy " << stage.occupancy << " (max " << stage.maxOccupancy << " of "
+              << stage.capacity << "), stalls " << stage.stalls << std::endl;
+}
+
+static void printPipelineStatistics(const SensorPipeline& pipeline) {
+    const SensorPipeline::Statistics statistics = pipeline.getStatistics();
+    printStage("framing ", statistics.framing);
+    printStage("parsing ", statistics.parsing);
+    printStage("dispatch", statistics.dispatch);
+    std::cout << "conflation: " << statistics.conflation.passes << " passes, "
+              << statistics.conflation.mergedFrames << " frames merged, "
+              << statistics.conflation.droppedValues << " values dropped, "
+              << statistics.conflation.preservedEdges << " edges preserved" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    const uint32_t seconds = (argc > 1) ? atoi(argv[1]) : 2;
+    const uint32_t stationCount = (argc > 2) ? atoi(argv[2]) : 4;
+    const uint32_t port = (argc > 3) ? atoi(argv[3]) : 9910;
+    const int pipelineMode = (argc > 4) ? atoi(argv[4]) : 0;
+    const bool pipelined = (pipelineMode != 0);
+
+    // Keep the sampled frame log out of the results
+    Log::setLevel(LOG_LEVEL_WARNING);
+
+    FloodServer server(port);
+    Factory factory;
+    FrameCounter frameCounter;
+    factory.add(&frameCounter);
+    if (pipelined) {
+        factory.enablePipeline(SensorPipeline::DEFAULT_CAPACITY, pipelineMode == 2);
+    }
+    std::vector<Station*> stations;
+    std::vector<OnOffActuator*> actuators;
+    for (uint32_t station = 0; station < stationCount; ++station) {
+        stations.push_back(new Station(factory));
+        actuators.push_back(new OnOffActuator(*stations.back(), "Actuator " + std::to_string(station)));
+    }
+
+    std::thread acceptor(&FloodServer::accept, &server);
+    if (!factory.start("127.0.0.1", port)) {
+        return 1;
+    }
+    acceptor.join();
+
+    std::atomic<bool> running(true);
+    std::atomic<uint64_t> flushCount(0);
+    std::vector<std::thread*> stationThreads;
+    for (uint32_t station = 0; station < stationCount; ++station) {
+        stationThreads.push_back(new std::thread([&, station] {
+            for (bool on = true; running; on = !on) {
+                actuators[station]->setOn(on);
+                stations[station]->applyChanges();
+                ++flushCount;
+            }
+        }));
+    }
+
+    std::cout << "stations: " << stationCount << ", seconds per run: " << seconds
+              << (pipelined ? ", pipelined" : "") << ((pipelineMode == 2) ? " with conflation" : "")
+              << std::endl;
+    for (int run = 0; run < 2; ++run) {
+        const bool slowReader = (run == 1);
+        server.setSlowReader(slowReader);
+        const uint64_t receivedBefore = frameCounter.getFrameCount();
+        const uint64_t sentBefore = Metrics::framesSent.get();
+        const uint64_t flushesBefore = flushCount;
+        std::this_thread::sleep_for(std::chrono::seconds(seconds));
+        const double received = (frameCounter.getFrameCount() - receivedBefore) / double(seconds);
+        const double sent = (Metrics::framesSent.get() - sentBefore) / double(seconds);
+        const double flushes = (flushCount - flushesBefore) / double(seconds);
+
+        std::cout << (slowReader ? "slow" : "fast") << " actuator reader: "
+                  << received << " sensor frames/s in, " << sent << " actuator frames/s out ("
+                  << flushes << " station flushes/s)" << std::endl;
+    }
+
+    if (pipelined) {
+        printPipelineStatistics(*factory.getPipeline());
+    }
+
+    server.setSlowReader(false);
+    running = false;
+    for (std::thread* stationThread : stationThreads) {
+        stationThread->join();
+        delete stationThread;
+    }
+    server.stop();
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    return 0;
+}
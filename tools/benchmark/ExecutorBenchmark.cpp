@@ -0,0 +1,179 @@
+/*
+ * Compares a thread per station with station tasks on the factory's Executor.
+ *
+ * Each station has one sensor and reacts to every change of it.  With threads, every station
+ * keeps a thread blocked in Sensor::waitForChange(); with the executor, every station arms a task
+ * with Sensor::resumeOnChange() that re-arms itself after reacting.  The main thread dispatches
+ * frames that toggle the sensors of all stations at once and waits for every station to react,
+ * so a frame's reaction time is the time until the last station has run.  The per-reaction
+ * latency runs from the start of the dispatch to the station running.
+ *
+ * Usage: executor-benchmark [frames] [workers] [stations...]
+ *
+ * workers 0 means one per CPU; the default station counts are 1, 10, 50 and 100.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Clock.hpp"
+#include "Executor.hpp"
+#include "Factory.hpp"
+#include "Histogram.hpp"
+#include "Log.hpp"
+#include "Metrics.hpp"
+#include "Sensors.hpp"
+#include "Station.hpp"
+
+static uint32_t argument(int argc, char* argv[], int index, uint32_t defaultValue) {
+    return (argc > index) ? static_cast<uint32_t>(atoi(argv[index])) : defaultValue;
+}
+
+static uint64_t processCpuNs() {
+    struct timespec time;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &time);
+    return static_cast<uint64_t>(time.tv_sec) * 1000000000ULL + time.tv_nsec;
+}
+
+/**
+ * A station reduced to the sensor it reacts to.
+ */
+struct BenchmarkStation {
+    BenchmarkStation(Factory& factory, const std::string& tag)
+    : station(factory), sensor(station, tag), latencies() {
+    }
+
+    Station                 station;
+    RetroreflectiveSensor   sensor;
+    Histogram               latencies;      // Only recorded by the station's own reaction
+};
+
+/**
+ * Runs one mode and station count and prints a row.
+ */
+static void run(bool useExecutor, uint32_t stationCount, uint32_t frameCount, uint32_t workerCount) {
+    RealTimeClock clock;
+    Factory factory(clock);
+    std::vector<std::unique_ptr<BenchmarkStation>> stations;
+    std::string frameText[2];
+    for (uint32_t index = 0; index < stationCount; ++index) {
+        const std::string tag = "Station " + std::to_string(index) + " At Entry";
+        stations.push_back(std::unique_ptr<BenchmarkStation>(new BenchmarkStation(factory, tag)));
+        for (uint32_t value = 0; value < 2; ++value) {
+            frameText[value] += std::string(frameText[value].empty() ? "{" : ",") + "\"" + tag + "\":" +
+                                (value ? "false" : "true");
+        }
+    }
+    frameText[0] += "}";
+    frameText[1] += "}";
+
+    std::atomic<uint64_t> dispatchNs(0);
+    std::atomic<uint64_t> reactionCount(0);
+    std::vector<std::thread> threads;
+    std::vector<Executor::Task> tasks(stationCount);
+    if (useExecutor) {
+        factory.enableExecutor(workerCount);
+        for (uint32_t index = 0; index < stationCount; ++index) {
+            BenchmarkStation* station = stations[index].get();
+            Executor::Task* task = &tasks[index];
+            *task = [station, task, &dispatchNs, &reactionCount] {
+                station->latencies.record(Metrics::nowNs() - dispatchNs.load());
+                ++reactionCount;
+                station->sensor.resumeOnChange(*task);
+            };
+            station->sensor.resumeOnChange(*task);
+        }
+    }
+    else {
+        for (uint32_t index = 0; index < stationCount; ++index) {
+            BenchmarkStation* station = stations[index].get();
+            threads.push_back(std::thread([station, &clock, &dispatchNs, &reactionCount] {
+                clock.attach();
+                try {
+                    for (;;) {
+                        station->sensor.waitForChange();
+                        station->latencies.record(Metrics::nowNs() - dispatchNs.load());
+                        ++reactionCount;
+                    }
+                }
+                catch (const Clock::Stopped&) {
+                }
+                clock.detach();
+            }));
+        }
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+    Histogram frameLatencies;
+    const uint64_t cpuStartNs = processCpuNs();
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (uint32_t frame = 0; frame < frameCount; ++frame) {
+        const uint64_t expected = reactionCount + stationCount;
+        const uint64_t startNs = Metrics::nowNs();
+        dispatchNs = startNs;
+        factory.handleNewSensorValues(frameText[frame % 2]);
+        const std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+        while ((reactionCount < expected) && (std::chrono::steady_clock::now() < deadline)) {
+            std::this_thread::yield();
+        }
+        frameLatencies.record(Metrics::nowNs() - startNs);
+    }
+    const double wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    const uint64_t cpuNs = processCpuNs() - cpuStartNs;
+    const uint32_t threadCount = useExecutor ? factory.getExecutor().getWorkerCount() + 1 : stationCount;
+
+    factory.stop();
+    if (useExecutor) {
+        factory.getExecutor().join();
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    Histogram latencies;
+    for (std::unique_ptr<BenchmarkStation>& station : stations) {
+        latencies.add(station->latencies);
+    }
+    std::cout << std::left << std::setw(10) << (useExecutor ? "executor" : "threads") << std::right
+              << std::setw(9) << stationCount << std::setw(9) << threadCount
+              << std::setw(10) << reactionCount.load()
+              << std::setw(10) << latencies.getValueAtPercentile(50) / 1000.0
+              << std::setw(10) << latencies.getValueAtPercentile(99) / 1000.0
+              << std::setw(11) << frameLatencies.getValueAtPercentile(50) / 1000.0
+              << std::setw(11) << frameLatencies.getValueAtPercentile(99) / 1000.0
+              << std::setw(14) << ((reactionCount > 0) ? cpuNs / 1000.0 / reactionCount : 0.0)
+              << std::setw(10) << frameCount / wallSeconds << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    const uint32_t frameCount = argument(argc, argv, 1, 2000);
+    const uint32_t workerCount = argument(argc, argv, 2, 0);
+    std::vector<uint32_t> stationCounts;
+    for (int index = 3; index < argc; ++index) {
+        stationCounts.push_back(argument(argc, argv, index, 1));
+    }
+    if (stationCounts.empty()) {
+        stationCounts = { 1, 10, 50, 100 };
+    }
+    Log::setLevel(LOG_LEVEL_WARNING);
+
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << std::left << std::setw(10) << "mode" << std::right << std::setw(9) << "stations"
+              << std::setw(9) << "threads" << std::setw(10) << "reactions" << std::setw(10) << "p50 us"
+              << std::setw(10) << "p99 us" << std::setw(11) << "frame p50" << std::setw(11) << "frame p99"
+              << std::setw(14) << "cpu us/react" << std::setw(10) << "frames/s" << std::endl;
+    for (uint32_t stationCount : stationCounts) {
+        for (bool useExecutor : { false, true }) {
+            run(useExecutor, stationCount, frameCount, workerCount);
+        }
+    }
+    return 0;
+}
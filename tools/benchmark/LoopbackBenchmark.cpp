@@ -0,0 +1,112 @@
+/*
+ * Measures the factory's own cost per frame, without the kernel, over a LoopbackTransport.
+ *
+ * Inbound, delimited frames that each change a few of the registered tags are injected and go
+ * through frame decoding, JSON parsing and dispatch to the sensors.  Outbound, an actuator is
+ * toggled and applied so that each change is serialized and sent.
+ *
+ * Usage: loopback-benchmark [tags] [tags per frame] [frames]
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "Actuators.hpp"
+#include "Factory.hpp"
+#include "FrameDecoder.hpp"
+#include "Log.hpp"
+#include "LoopbackTransport.hpp"
+#include "Sensors.hpp"
+#include "Station.hpp"
+
+static uint32_t argument(int argc, char* argv[], int index, uint32_t defaultValue) {
+    return (argc > index) ? static_cast<uint32_t>(atoi(argv[index])) : defaultValue;
+}
+
+/**
+ * Frame setting tagsPerFrame consecutive tags, starting at first, to value.
+ */
+static std::string buildFrame(uint32_t tagCount, uint32_t first, uint32_t tagsPerFrame, bool value) {
+    std::string frame = "{";
+    for (uint32_t index = 0; index < tagsPerFrame; ++index) {
+        if (index > 0) {
+            frame += ",";
+        }
+        frame += "\"Tag " + std::to_string((first + index) % tagCount) + "\":" + (value ? "true" : "false");
+    }
+    return FrameDecoder::encode(frame + "}");
+}
+
+static double nanosecondsPer(std::chrono::steady_clock::duration duration, uint64_t count) {
+    return std::chrono::duration<double, std::nano>(duration).count() / count;
+}
+
+int main(int argc, char* argv[]) {
+    const uint32_t tagCount = argument(argc, argv, 1, 50);
+    const uint32_t tagsPerFrame = argument(argc, argv, 2, 2);
+    const uint32_t frameCount = argument(argc, argv, 3, 1000000);
+    Log::setLevel(LOG_LEVEL_WARNING);
+
+    LoopbackTransport transport;
+    Factory factory;
+    Station station(factory);
+    std::vector<RetroreflectiveSensor*> sensors;
+    for (uint32_t tag = 0; tag < tagCount; ++tag) {
+        sensors.push_back(new RetroreflectiveSensor(station, "Tag " + std::to_string(tag)));
+    }
+    OnOffActuator actuator(station, "Output");
+    factory.start(transport);
+
+    // Every tag toggles once per cycle of frames, so every frame changes tagsPerFrame sensors
+    const uint32_t cycleLength = 2 * tagCount;
+    std::vector<std::string> frames;
+    for (uint32_t frame = 0; frame < cycleLength; ++frame) {
+        frames.push_back(buildFrame(tagCount, (frame * tagsPerFrame) % tagCount, tagsPerFrame,
+                                    ((frame * tagsPerFrame) / tagCount) % 2 == 0));
+    }
+
+    uint64_t bytes = 0;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (uint32_t frame = 0; frame < frameCount; ++frame) {
+        const std::string& frameText = frames[frame % cycleLength];
+        transport.inject(frameText);
+        bytes += frameText.size();
+    }
+    const std::chrono::steady_clock::duration inboundTime = std::chrono::steady_clock::now() - start;
+
+    start = std::chrono::steady_clock::now();
+    for (uint32_t frame = 0; frame < frameCount; ++frame) {
+        actuator.setOn(frame % 2 == 0);
+        station.applyChanges();
+    }
+    const std::chrono::steady_clock::duration outboundTime = std::chrono::steady_clock::now() - start;
+    if (transport.getSentCount() != frameCount) {
+        std::cerr << "Sent " << transport.getSentCount() << " frames for " << frameCount << " toggles" << std::endl;
+        return 1;
+    }
+
+    uint64_t changeCount = 0;
+    for (RetroreflectiveSensor* sensor : sensors) {
+        changeCount += sensor->getChangeCount();
+    }
+    std::cout << "tags:                         " << tagCount << std::endl;
+    std::cout << "tags per frame:               " << tagsPerFrame << std::endl;
+    std::cout << "frames:                       " << frameCount << std::endl;
+    std::cout << "inbound frames received:      " << transport.getReceivedCount() << std::endl;
+    std::cout << "sensor changes per frame:     " << static_cast<double>(changeCount) / frameCount << std::endl;
+    std::cout << "inbound time per frame (ns):  " << nanosecondsPer(inboundTime, frameCount) << std::endl;
+    std::cout << "inbound frames per second:    " << frameCount / std::chrono::duration<double>(inboundTime).count()
+              << std::endl;
+    std::cout << "inbound megabytes per second: " << bytes / 1e6 / std::chrono::duration<double>(inboundTime).count()
+              << std::endl;
+    std::cout << "outbound frames sent:         " << transport.getSentCount() << std::endl;
+    std::cout << "outbound time per frame (ns): " << nanosecondsPer(outboundTime, frameCount) << std::endl;
+
+    for (RetroreflectiveSensor* sensor : sensors) {
+        delete sensor;
+    }
+    return 0;
+}
@@ -0,0 +1,193 @@
+/*
+ * Compares a StaticStation with the same tags built from Sensor and Actuator parts.
+ *
+ * The sorting by weight cell is built both ways, each on its own factory.  The dispatch time is
+ * the cost of applying a parsed frame that changes all three inputs, through
+ * Factory::dispatchSensorValues.  The encode time is the cost of writing all thirteen outputs,
+ * each changed since the last flush, into a frame.  The setup time is the cost of building and
+ * registering a prefixed cell on a factory that already has the others.  Both versions are
+ * checked to read the same values and write the same frame.
+ *
+ * Usage: static-station-benchmark [frames] [cells]
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+#include "rapidjson/document.h"
+#include "rapidjson/stringbuffer.h"
+#include "rapidjson/writer.h"
+#include "Actuators.hpp"
+#include "Factory.hpp"
+#include "Log.hpp"
+#include "Sensors.hpp"
+#include "SortingByWeightFactory.hpp"
+#include "StaticStation.hpp"
+#include "Station.hpp"
+
+typedef StaticStation<SortingByWeightCell> SortingStation;
+
+/**
+ * The sorting cell as a Station with one part per tag.
+ */
+class DynamicSortingStation {
+public:
+    DynamicSortingStation(Factory& factory, const std::string& prefix)
+    : m_station(factory, prefix),
+      m_entrySensor(m_station, SortingStation::getInputName(SortingByWeightCell::ENTRY_SENSOR)),
+      m_scaleSensor(m_station, SortingStation::getInputName(SortingByWeightCell::SCALE_SENSOR)),
+      m_weightSensor(m_station, SortingStation::getInputName(SortingByWeightCell::SCALE_WEIGHT)),
+      m_actuators() {
+        for (uint32_t index = 0; index < SortingStation::OUTPUT_COUNT; ++index) {
+            m_actuators.push_back(std::unique_ptr<OnOffActuator>(
+                new OnOffActuator(m_station, SortingStation::getOutputName(index))));
+        }
+    }
+
+    void setAll(bool on) {
+        for (std::unique_ptr<OnOffActuator>& actuator : m_actuators) {
+            actuator->setOn(on);
+        }
+    }
+
+    void serialize(rapidjson::Document& jsonDocument) {
+        for (std::unique_ptr<OnOffActuator>& actuator : m_actuators) {
+            actuator->serialize(jsonDocument, true);
+        }
+    }
+
+    Station                                     m_station;
+    RetroreflectiveSensor                       m_entrySensor;
+    DiffuseSensor                               m_scaleSensor;
+    WeightSensor                                m_weightSensor;
+    std::vector<std::unique_ptr<OnOffActuator>> m_actuators;
+};
+
+static void setAll(SortingStation& station, bool on) {
+    station.set<SortingByWeightCell::EMITTER>(on);
+    station.set<SortingByWeightCell::LEFT_REMOVER>(on);
+    station.set<SortingByWeightCell::RIGHT_REMOVER>(on);
+    station.set<SortingByWeightCell::BACK_REMOVER>(on);
+    station.set<SortingByWeightCell::ENTRY_CONVEYOR>(on);
+    station.set<SortingByWeightCell::BACK_CONVEYOR>(on);
+    station.set<SortingByWeightCell::LEFT_CONVEYOR>(on);
+    station.set<SortingByWeightCell::RIGHT_CONVEYOR>(on);
+    station.set<SortingByWeightCell::SCALE_FORWARD>(on);
+    station.set<SortingByWeightCell::SCALE_BACKWARD>(on);
+    station.set<SortingByWeightCell::SORTER_FORWARD>(on);
+    station.set<SortingByWeightCell::SORTER_LEFT>(on);
+    station.set<SortingByWeightCell::SORTER_RIGHT>(on);
+}
+
+static uint32_t argument(int argc, char* argv[], int index, uint32_t defaultValue) {
+    return (argc > index) ? static_cast<uint32_t>(atoi(argv[index])) : defaultValue;
+}
+
+static std::string toString(const rapidjson::Document& jsonDocument) {
+    rapidjson::StringBuffer buffer;
+    rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+    jsonDocument.Accept(writer);
+    return buffer.GetString();
+}
+
+static double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char* argv[]) {
+    const uint32_t frameCount = argument(argc, argv, 1, 1000000);
+    const uint32_t cellCount = argument(argc, argv, 2, 200);
+    Log::setLevel(LOG_LEVEL_WARNING);
+
+    // Frames alternate the two sensors and step the weight, so every one changes all three inputs
+    static const uint32_t FRAME_VARIANTS = 16;
+    std::vector<std::unique_ptr<rapidjson::Document>> frames;
+    for (uint32_t variant = 0; variant < FRAME_VARIANTS; ++variant) {
+        const std::string on = (variant % 2 == 0) ? "true" : "false";
+        const std::string frame = "{\"Entry Sensor\":" + on + ",\"Scale Sensor\":" + on +
+                                  ",\"Conveyor Scale Weight\":" + std::to_string(variant + 0.5) + "}";
+        frames.push_back(std::unique_ptr<rapidjson::Document>(new rapidjson::Document()));
+        frames.back()->Parse(frame.c_str());
+    }
+
+    Factory dynamicFactory;
+    Factory staticFactory;
+    DynamicSortingStation dynamicStation(dynamicFactory, "");
+    SortingStation staticStation(staticFactory);
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (uint32_t frame = 0; frame < frameCount; ++frame) {
+        dynamicFactory.dispatchSensorValues(*frames[frame % FRAME_VARIANTS]);
+    }
+    const double dynamicDispatchSeconds = secondsSince(start);
+    start = std::chrono::steady_clock::now();
+    for (uint32_t frame = 0; frame < frameCount; ++frame) {
+        staticFactory.dispatchSensorValues(*frames[frame % FRAME_VARIANTS]);
+    }
+    const double staticDispatchSeconds = secondsSince(start);
+    if ((dynamicStation.m_entrySensor.beamDetected() != staticStation.get<SortingByWeightCell::ENTRY_SENSOR>()) ||
+        (dynamicStation.m_scaleSensor.itemDetected() != staticStation.get<SortingByWeightCell::SCALE_SENSOR>()) ||
+        (dynamicStation.m_weightSensor.getWeight() != staticStation.get<SortingByWeightCell::SCALE_WEIGHT>())) {
+        std::cerr << "The stations read different values" << std::endl;
+        return 1;
+    }
+
+    rapidjson::Document dynamicFrame;
+    rapidjson::Document staticFrame;
+    dynamicFrame.SetObject();
+    staticFrame.SetObject();
+    dynamicStation.serialize(dynamicFrame);
+    staticStation.serialize(staticFrame, true);
+    if (toString(dynamicFrame) != toString(staticFrame)) {
+        std::cerr << "The stations write different frames:" << std::endl
+                  << toString(dynamicFrame) << std::endl << toString(staticFrame) << std::endl;
+        return 1;
+    }
+
+    start = std::chrono::steady_clock::now();
+    for (uint32_t frame = 0; frame < frameCount; ++frame) {
+        rapidjson::Document jsonDocument;
+        jsonDocument.SetObject();
+        dynamicStation.setAll(frame % 2 == 0);
+        dynamicStation.serialize(jsonDocument);
+    }
+    const double dynamicEncodeSeconds = secondsSince(start);
+    start = std::chrono::steady_clock::now();
+    for (uint32_t frame = 0; frame < frameCount; ++frame) {
+        rapidjson::Document jsonDocument;
+        jsonDocument.SetObject();
+        setAll(staticStation, frame % 2 == 0);
+        staticStation.serialize(jsonDocument, true);
+    }
+    const double staticEncodeSeconds = secondsSince(start);
+
+    std::vector<std::unique_ptr<DynamicSortingStation>> dynamicCells;
+    std::vector<std::unique_ptr<SortingStation>> staticCells;
+    start = std::chrono::steady_clock::now();
+    for (uint32_t cell = 0; cell < cellCount; ++cell) {
+        dynamicCells.push_back(std::unique_ptr<DynamicSortingStation>(
+            new DynamicSortingStation(dynamicFactory, "Station " + std::to_string(cell + 1) + " ")));
+    }
+    const double dynamicSetupSeconds = secondsSince(start);
+    start = std::chrono::steady_clock::now();
+    for (uint32_t cell = 0; cell < cellCount; ++cell) {
+        staticCells.push_back(std::unique_ptr<SortingStation>(
+            new SortingStation(staticFactory, "Station " + std::to_string(cell + 1) + " ")));
+    }
+    const double staticSetupSeconds = secondsSince(start);
+
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << "                   dynamic    static" << std::endl;
+    std::cout << "ns/dispatch     " << std::setw(10) << dynamicDispatchSeconds * 1e9 / frameCount
+              << std::setw(10) << staticDispatchSeconds * 1e9 / frameCount << std::endl;
+    std::cout << "ns/encode       " << std::setw(10) << dynamicEncodeSeconds * 1e9 / frameCount
+              << std::setw(10) << staticEncodeSeconds * 1e9 / frameCount << std::endl;
+    std::cout << "us/cell setup   " << std::setw(10) << dynamicSetupSeconds * 1e6 / cellCount
+              << std::setw(10) << staticSetupSeconds * 1e6 / cellCount << std::endl;
+    return 0;
+}
@@ -0,0 +1,121 @@
+/*
+ * Measures the ProgramVm dispatch loop and the cost of loading many programs.
+ *
+ * A benchmark program with edge triggers, a timer, integer and real arithmetic and nested IFs is
+ * compiled once per instance, and every instance is scanned in turn with inputs that change
+ * every few scans, the way a ScanController runs them.  The dispatch rate is instructions
+ * executed per second of scanning, without the input and output copies.  The load time is the
+ * time to compile a program and bind it to a station of a ScanController, with its sensors and
+ * actuators registered with the factory.
+ *
+ * Usage: vm-benchmark [scans] [programs]
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+#include "ControlProgram.hpp"
+#include "Factory.hpp"
+#include "Log.hpp"
+#include "ProgramVm.hpp"
+#include "ScanController.hpp"
+#include "StructuredText.hpp"
+
+static const char* const PROGRAM =
+    "PROGRAM Benchmark\n"
+    "VAR_INPUT\n"
+    "    atEntry AT \"At Entry\" : BOOL;\n"
+    "    atExit AT \"At Exit\" : BOOL;\n"
+    "    weight AT \"Weight\" : REAL;\n"
+    "END_VAR\n"
+    "VAR_OUTPUT\n"
+    "    emitter AT \"Emitter\" : BOOL := TRUE;\n"
+    "    speed AT \"Speed\" : REAL;\n"
+    "    heavy AT \"Heavy\" : BOOL;\n"
+    "END_VAR\n"
+    "VAR\n"
+    "    boxes : INT;\n"
+    "    total : REAL;\n"
+    "END_VAR\n"
+    "IF R_TRIG(atEntry) THEN\n"
+    "    boxes := boxes + 1;\n"
+    "    total := total + weight;\n"
+    "    IF boxes >= 3 THEN emitter := FALSE; END_IF;\n"
+    "END_IF;\n"
+    "IF F_TRIG(atExit) AND boxes > 0 THEN\n"
+    "    boxes := boxes - 1;\n"
+    "    emitter := TRUE;\n"
+    "END_IF;\n"
+    "heavy := weight > 7.5 OR (boxes MOD 2 = 1 AND NOT atExit);\n"
+    "IF TON(NOT atEntry, T#200ms) THEN\n"
+    "    speed := 0;\n"
+    "ELSIF heavy THEN\n"
+    "    speed := 2.5 + total / (boxes + 1);\n"
+    "ELSE\n"
+    "    speed := 5 - boxes * 0.5;\n"
+    "END_IF;\n"
+    "END_PROGRAM\n";
+
+static uint32_t argument(int argc, char* argv[], int index, uint32_t defaultValue) {
+    return (argc > index) ? static_cast<uint32_t>(atoi(argv[index])) : defaultValue;
+}
+
+int main(int argc, char* argv[]) {
+    const uint32_t scanCount = argument(argc, argv, 1, 100000);
+    const uint32_t programCount = argument(argc, argv, 2, 500);
+    Log::setLevel(LOG_LEVEL_WARNING);
+
+    std::vector<std::unique_ptr<ControlProgram>> programs;
+    std::vector<std::unique_ptr<ProgramVm>> vms;
+    for (uint32_t index = 0; index < programCount; ++index) {
+        programs.push_back(std::unique_ptr<ControlProgram>(new ControlProgram()));
+        if (!StructuredText::compile(PROGRAM, "benchmark", *programs.back())) {
+            return 1;
+        }
+        vms.push_back(std::unique_ptr<ProgramVm>(new ProgramVm(*programs.back())));
+    }
+
+    // Variables 0 to 2 are the inputs, in declaration order
+    uint64_t instructionCount = 0;
+    const uint32_t scansPerProgram = std::max(scanCount / programCount, 1u);
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (uint32_t scan = 0; scan < scansPerProgram; ++scan) {
+        const double nowMs = scan * 10.0;
+        for (uint32_t index = 0; index < programCount; ++index) {
+            ProgramVm& vm = *vms[index];
+            vm.setVariable(0, ((scan + index) / 4) % 2);
+            vm.setVariable(1, ((scan + index) / 6) % 2);
+            vm.setVariable(2, (scan + index) % 10);
+            instructionCount += vm.scan(nowMs);
+        }
+    }
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    const uint64_t scansRun = static_cast<uint64_t>(scansPerProgram) * programCount;
+
+    Factory factory;
+    ScanController scanController(factory);
+    const std::chrono::steady_clock::time_point loadStart = std::chrono::steady_clock::now();
+    for (uint32_t index = 0; index < programCount; ++index) {
+        if (!scanController.load(PROGRAM, "benchmark", "Station " + std::to_string(index + 1) + " ")) {
+            return 1;
+        }
+    }
+    const double loadSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - loadStart).count();
+
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << "programs           " << programCount << " of " << programs.front()->code.size()
+              << " instructions" << std::endl;
+    std::cout << "scans              " << scansRun << std::endl;
+    std::cout << "instructions/scan  " << static_cast<double>(instructionCount) / scansRun << std::endl;
+    std::cout << "Minstructions/s    " << instructionCount / seconds / 1e6 << std::endl;
+    std::cout << "ns/instruction     " << std::setprecision(2) << seconds * 1e9 / instructionCount << std::endl;
+    std::cout << "us/scan of all     " << seconds * 1e6 / scansPerProgram << std::endl;
+    std::cout << "us/program load    " << loadSeconds * 1e6 / programCount << std::endl;
+    return 0;
+}
@@ -0,0 +1,118 @@
+/*
+ * Measures the wake latency and CPU cost of each WaitStrategy.
+ *
+ * One thread waits on a sensor (or on the factory) of a station set to the strategy, while the
+ * main thread dispatches a frame that toggles the sensor every gap.  The latency runs from the
+ * start of the dispatch to the waiter running again, so it includes parsing and applying the
+ * frame; the differences between strategies are the cost of the wake-up.  The CPU cost is the
+ * waiter's own CPU time, per wake-up and as a share of a core.
+ *
+ * Busy-polling needs a core of its own: on a machine with fewer cores than threads it competes
+ * with the dispatching thread, and both its latency and the dispatch suffer.
+ *
+ * Usage: wait-strategy-benchmark [frames] [gap us]
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include "Factory.hpp"
+#include "Histogram.hpp"
+#include "Log.hpp"
+#include "Metrics.hpp"
+#include "Sensors.hpp"
+#include "Station.hpp"
+#include "WaitStrategy.hpp"
+
+static uint32_t argument(int argc, char* argv[], int index, uint32_t defaultValue) {
+    return (argc > index) ? static_cast<uint32_t>(atoi(argv[index])) : defaultValue;
+}
+
+static uint64_t threadCpuNs() {
+    struct timespec time;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time);
+    return static_cast<uint64_t>(time.tv_sec) * 1000000000ULL + time.tv_nsec;
+}
+
+/**
+ * Runs one strategy and target and prints a row.
+ */
+static void run(WaitStrategy strategy, bool factoryWait, uint32_t frameCount, std::chrono::microseconds gap) {
+    Factory factory;
+    Station station(factory);
+    station.setWaitStrategy(strategy);
+    RetroreflectiveSensor sensor(station, "Tag");
+    const std::string frameText[2] = { "{\"Tag\":true}", "{\"Tag\":false}" };
+
+    std::atomic<bool> running(true);
+    std::atomic<uint64_t> dispatchNs(0);
+    std::atomic<uint64_t> wakeCount(0);
+    Histogram latencies;
+    uint64_t cpuNs = 0;
+    std::thread waiter([&] {
+        const uint64_t cpuStartNs = threadCpuNs();
+        while (running) {
+            if (factoryWait) {
+                station.waitForSensorChange();
+            }
+            else {
+                sensor.waitForChange();
+            }
+            if (running) {
+                latencies.record(Metrics::nowNs() - dispatchNs.load());
+                ++wakeCount;
+            }
+        }
+        cpuNs = threadCpuNs() - cpuStartNs;
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (uint32_t frame = 0; frame < frameCount; ++frame) {
+        const uint64_t expected = wakeCount + 1;
+        dispatchNs = Metrics::nowNs();
+        factory.handleNewSensorValues(frameText[frame % 2]);
+        // Let the waiter record and wait again before the next frame
+        const std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + gap;
+        while ((wakeCount < expected) && (std::chrono::steady_clock::now() < deadline + gap * 10)) {
+            std::this_thread::sleep_for(std::chrono::microseconds(10));
+        }
+        std::this_thread::sleep_until(deadline);
+    }
+    const double wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    running = false;
+    factory.handleNewSensorValues(frameText[frameCount % 2]);
+    waiter.join();
+
+    const uint64_t wakes = wakeCount;
+    std::cout << std::left << std::setw(8) << getWaitStrategyName(strategy) << std::setw(9)
+              << (factoryWait ? "factory" : "sensor") << std::right << std::setw(8) << wakes
+              << std::setw(10) << latencies.getValueAtPercentile(50) / 1000.0
+              << std::setw(10) << latencies.getValueAtPercentile(99) / 1000.0
+              << std::setw(10) << latencies.getMax() / 1000.0
+              << std::setw(12) << ((wakes > 0) ? cpuNs / 1000.0 / wakes : 0.0)
+              << std::setw(8) << cpuNs / 1e9 / wallSeconds << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    const uint32_t frameCount = argument(argc, argv, 1, 2000);
+    const std::chrono::microseconds gap(argument(argc, argv, 2, 200));
+    Log::setLevel(LOG_LEVEL_WARNING);
+
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << std::left << std::setw(8) << "wait" << std::setw(9) << "on" << std::right << std::setw(8) << "wakes"
+              << std::setw(10) << "p50 us" << std::setw(10) << "p99 us" << std::setw(10) << "max us"
+              << std::setw(12) << "cpu us/wake" << std::setw(8) << "cores" << std::endl;
+    for (WaitStrategy strategy : { WAIT_BLOCK, WAIT_SPIN_THEN_PARK, WAIT_BUSY_POLL }) {
+        for (bool factoryWait : { false, true }) {
+            run(strategy, factoryWait, frameCount, gap);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,232 @@
+/*
+ * Checks what a RuleEngine fires against the edges and levels of its inputs, and exits with 1 on
+ * any mismatch.
+ *
+ * Frames are dispatched straight into a factory connected to a LoopbackTransport, so every run
+ * is the same.  A backlog is dispatched the way SensorPipeline conflates it: one frame with the
+ * latest value of the tag, plus the tag's value in the oldest frame and the edges between the
+ * frames.  The expected edge counts come from the full sequence of values, as if every frame had
+ * been dispatched on its own.  The checks cover:
+ *   - edge rules fed conflated pulses, including a pulse the merge hides entirely
+ *   - level rules, which fire only when their conditions become true
+ *   - counters chained through rules, which stop after RuleEngine::MAX_PASSES passes
+ *
+ * Usage: rule-engine-check
+ */
+
+#include <stdint.h>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "rapidjson/document.h"
+#include "ActuatorSerializer.hpp"
+#include "Factory.hpp"
+#include "Log.hpp"
+#include "LoopbackTransport.hpp"
+#include "RuleEngine.hpp"
+#include "Sensors.hpp"
+#include "Station.hpp"
+#include "TagNames.hpp"
+
+/**
+ * Counts the writes of the rules that set it instead of sending them.
+ */
+class RecordingActuator : public ActuatorSerializer {
+public:
+    RecordingActuator()
+    : m_setCount(0), m_value(0) {
+    }
+
+    virtual void serialize(rapidjson::Document& /* jsonDocument */, bool /* onlyIfChanged */) {
+    }
+
+    virtual void setNumericValue(double value) {
+        ++m_setCount;
+        m_value = value;
+    }
+
+    uint32_t    m_setCount;
+    double      m_value;
+};
+
+static uint32_t s_checkCount = 0;
+static uint32_t s_failureCount = 0;
+
+static void check(const std::string& name, double actual, double expected) {
+    ++s_checkCount;
+    if (actual != expected) {
+        ++s_failureCount;
+        std::cerr << "FAIL " << name << ": expected " << expected << ", got " << actual << std::endl;
+    }
+}
+
+template<typename T>
+static void dispatch(Factory& factory, const std::string& tagName, T value) {
+    rapidjson::Document frame;
+    frame.SetObject();
+    rapidjson::Value name(tagName.c_str(), frame.GetAllocator());
+    frame.AddMember(name, value, frame.GetAllocator());
+    factory.dispatchSensorValues(frame);
+}
+
+/**
+ * Dispatches the values a boolean tag took in a backlog of frames as one conflated frame.
+ */
+static void dispatchConflated(Factory& factory, const std::string& tagName, const std::vector<bool>& values) {
+    rapidjson::Document frame;
+    frame.SetObject();
+    rapidjson::Value name(tagName.c_str(), frame.GetAllocator());
+    frame.AddMember(name, static_cast<bool>(values.back()), frame.GetAllocator());
+    ConflatedTag conflatedTag = { values.front(), 0 };
+    for (size_t index = 1; index < values.size(); ++index) {
+        if (values[index] != values[index - 1]) {
+            ++conflatedTag.edgeCount;
+        }
+    }
+    ConflatedTagMap conflatedTags;
+    conflatedTags[TagNames::find(tagName.data(), tagName.size())] = conflatedTag;
+    factory.dispatchSensorValues(frame, conflatedTags);
+}
+
+static void countEdges(const std::vector<bool>& values, bool previous, uint32_t& risingCount,
+                       uint32_t& fallingCount) {
+    for (bool value : values) {
+        risingCount += (!previous && value) ? 1 : 0;
+        fallingCount += (previous && !value) ? 1 : 0;
+        previous = value;
+    }
+}
+
+/**
+ * Every edge of a backlog fires the rules on it once, even when the merged frame ends on the
+ * value it started from.
+ */
+static void checkConflatedEdges() {
+    LoopbackTransport transport;
+    Factory factory;
+    Station station(factory, "Edges ");
+    LimitSensor entry(station, "Entry");
+    RecordingActuator risingActuator;
+    RecordingActuator fallingActuator;
+    RecordingActuator fullActuator;
+    RuleEngine rules(station);
+    const RuleEngine::Input entryInput = rules.input(entry);
+    const RuleEngine::Input boxes = rules.counter("boxes");
+    rules.when({ RuleEngine::rising(entryInput) }).set(risingActuator, 1).add(boxes, 1);
+    rules.when({ RuleEngine::falling(entryInput) }).set(fallingActuator, 0);
+    rules.when({ RuleEngine::compare(boxes, RuleEngine::GREATER_EQUAL, 5) }).set(fullActuator, 1);
+    factory.start(transport);
+    rules.start();
+
+    const std::vector<std::vector<bool>> backlogs = {
+        { true },
+        { false, true, false, true },
+        { true, true, false },
+        { true, false },                            // A pulse the merge hides: false before and after
+        { true, false, true, false, true, false },
+        { false, false }
+    };
+    bool previous = false;
+    uint32_t risingCount = 0;
+    uint32_t fallingCount = 0;
+    for (const std::vector<bool>& backlog : backlogs) {
+        if (backlog.size() == 1) {
+            dispatch(factory, "Edges Entry", static_cast<bool>(backlog.front()));
+        }
+        else {
+            dispatchConflated(factory, "Edges Entry", backlog);
+        }
+        countEdges(backlog, previous, risingCount, fallingCount);
+        previous = backlog.back();
+        check("rising edge rule fires after backlog " + std::to_string(&backlog - &backlogs.front()),
+              risingActuator.m_setCount, risingCount);
+        check("falling edge rule fires after backlog " + std::to_string(&backlog - &backlogs.front()),
+              fallingActuator.m_setCount, fallingCount);
+    }
+    check("counter level rule fires once the counter reaches 5", fullActuator.m_setCount, 1);
+    check("sensor value after the last backlog", entry.atLimit(), previous);
+}
+
+/**
+ * A rule without an edge condition fires when its conditions become true, not while they hold.
+ */
+static void checkLevelRules() {
+    LoopbackTransport transport;
+    Factory factory;
+    Station station(factory, "Levels ");
+    WeightSensor level(station, "Level");
+    RecordingActuator highActuator;
+    RecordingActuator lowActuator;
+    RuleEngine rules(station);
+    const RuleEngine::Input levelInput = rules.input(level);
+    rules.when({ RuleEngine::compare(levelInput, RuleEngine::GREATER, 5) }).set(highActuator, 1);
+    rules.when({ RuleEngine::compare(levelInput, RuleEngine::LESS_EQUAL, 5) }).set(lowActuator, 1);
+    factory.start(transport);
+    rules.start();
+    check("level rule that holds at start fires", lowActuator.m_setCount, 1);
+
+    const double levels[] = { 3, 6.5, 7, 7, 4, 8, 5, 5 };
+    const uint32_t expectedHigh[] = { 0, 1, 1, 1, 1, 2, 2, 2 };
+    const uint32_t expectedLow[] = { 1, 1, 1, 1, 2, 2, 3, 3 };
+    for (size_t index = 0; index < sizeof(levels) / sizeof(levels[0]); ++index) {
+        dispatch(factory, "Levels Level", levels[index]);
+        check("high rule fires after level " + std::to_string(index), highActuator.m_setCount, expectedHigh[index]);
+        check("low rule fires after level " + std::to_string(index), lowActuator.m_setCount, expectedLow[index]);
+    }
+}
+
+/**
+ * Builds a chain in which rule i increments counter i once counter i - 1 is 1, so the rule at the
+ * end of the chain runs in pass length + 1 of the frame that starts it.
+ */
+static void addChain(RuleEngine& rules, RuleEngine::Input trigger, uint32_t length, RecordingActuator& end) {
+    RuleEngine::Input previous = rules.counter("link 0");
+    rules.when({ RuleEngine::rising(trigger) }).add(previous, 1);
+    for (uint32_t link = 1; link < length; ++link) {
+        const RuleEngine::Input counter = rules.counter("link " + std::to_string(link));
+        rules.when({ RuleEngine::compare(previous, RuleEngine::EQUAL, 1) }).add(counter, 1);
+        previous = counter;
+    }
+    rules.when({ RuleEngine::compare(previous, RuleEngine::EQUAL, 1) }).set(end, 1);
+}
+
+static void checkCounterChaining() {
+    LoopbackTransport transport;
+    Factory factory;
+    Station withinStation(factory, "Within ");
+    Station beyondStation(factory, "Beyond ");
+    LimitSensor withinTrigger(withinStation, "Trigger");
+    LimitSensor beyondTrigger(beyondStation, "Trigger");
+    RecordingActuator withinEnd;
+    RecordingActuator beyondEnd;
+    RuleEngine withinRules(withinStation);
+    RuleEngine beyondRules(beyondStation);
+    addChain(withinRules, withinRules.input(withinTrigger), RuleEngine::MAX_PASSES - 1, withinEnd);
+    addChain(beyondRules, beyondRules.input(beyondTrigger), RuleEngine::MAX_PASSES, beyondEnd);
+    factory.start(transport);
+    withinRules.start();
+    beyondRules.start();
+
+    dispatch(factory, "Within Trigger", true);
+    dispatch(factory, "Beyond Trigger", true);
+    check("chain of " + std::to_string(RuleEngine::MAX_PASSES) + " passes reaches its end", withinEnd.m_setCount, 1);
+    check("chain of " + std::to_string(RuleEngine::MAX_PASSES + 1) + " passes stops before its end",
+          beyondEnd.m_setCount, 0);
+
+    // The cut-off chain is not resumed by a later frame that changes nothing it reads
+    dispatch(factory, "Beyond Trigger", true);
+    check("stopped chain stays stopped", beyondEnd.m_setCount, 0);
+}
+
+int main() {
+    Log::setLevel(LOG_LEVEL_ERROR);
+    checkConflatedEdges();
+    checkLevelRules();
+    checkCounterChaining();
+    if (s_failureCount > 0) {
+        std::cerr << s_failureCount << " of " << s_checkCount << " rule engine checks failed" << std::endl;
+        return 1;
+    }
+    std::cout << "All " << s_checkCount << " rule engine checks passed" << std::endl;
+    return 0;
+}
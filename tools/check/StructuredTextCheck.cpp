@@ -0,0 +1,249 @@
+/*
+ * Checks the structured-text compiler and the ProgramVm against hand-computed results, and exits
+ * with 1 on any mismatch.
+ *
+ * Small programs are compiled and scanned directly, with the inputs set and the variables read
+ * by name, and with scan times chosen by the check so timers are exact.  The checks cover:
+ *   - R_TRIG and F_TRIG on the first scan, with the input already on or off
+ *   - TON reaching its preset, and restarting when its input drops
+ *   - integer division and MOD, including by zero, and real division
+ *   - sources that must not compile; their errors are logged as usual
+ *
+ * Usage: structured-text-check
+ */
+
+#include <stdint.h>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "ControlProgram.hpp"
+#include "Log.hpp"
+#include "ProgramVm.hpp"
+#include "StructuredText.hpp"
+
+static uint32_t s_checkCount = 0;
+static uint32_t s_failureCount = 0;
+
+static void check(const std::string& name, double actual, double expected) {
+    ++s_checkCount;
+    if (actual != expected) {
+        ++s_failureCount;
+        std::cerr << "FAIL " << name << ": expected " << expected << ", got " << actual << std::endl;
+    }
+}
+
+static uint32_t variableIndex(const ControlProgram& program, const std::string& name) {
+    for (uint32_t index = 0; index < program.variables.size(); ++index) {
+        if (program.variables[index].name == name) {
+            return index;
+        }
+    }
+    std::cerr << "No variable " << name << " in program " << program.name << std::endl;
+    return 0;
+}
+
+static double get(const ProgramVm& vm, const std::string& name) {
+    return vm.getVariable(variableIndex(vm.getProgram(), name));
+}
+
+static void set(ProgramVm& vm, const std::string& name, double value) {
+    vm.setVariable(variableIndex(vm.getProgram(), name), value);
+}
+
+static bool compile(const std::string& source, ControlProgram& program) {
+    ++s_checkCount;
+    if (!StructuredText::compile(source, "check", program)) {
+        ++s_failureCount;
+        std::cerr << "FAIL program does not compile:" << std::endl << source;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * An input that is already on when the program starts is not a rising edge, and one that is off
+ * is not a falling edge.
+ */
+static void checkTriggers() {
+    const std::string source =
+        "PROGRAM Triggers\n"
+        "VAR_INPUT\n"
+        "    in AT \"In\" : BOOL;\n"
+        "END_VAR\n"
+        "VAR\n"
+        "    rises : INT;\n"
+        "    falls : INT;\n"
+        "END_VAR\n"
+        "IF R_TRIG(in) THEN rises := rises + 1; END_IF;\n"
+        "IF F_TRIG(in) THEN falls := falls + 1; END_IF;\n"
+        "END_PROGRAM\n";
+    ControlProgram program;
+    if (!compile(source, program)) {
+        return;
+    }
+
+    const double inputs[] = { 1, 1, 0, 0, 1, 0 };
+    const double startingOnRises[] = { 0, 0, 0, 0, 1, 1 };
+    const double startingOnFalls[] = { 0, 0, 1, 1, 1, 2 };
+    ProgramVm startingOn(program);
+    ProgramVm startingOff(program);
+    for (size_t scan = 0; scan < sizeof(inputs) / sizeof(inputs[0]); ++scan) {
+        set(startingOn, "in", inputs[scan]);
+        startingOn.scan(scan * 10.0);
+        check("R_TRIG count starting on, scan " + std::to_string(scan), get(startingOn, "rises"),
+              startingOnRises[scan]);
+        check("F_TRIG count starting on, scan " + std::to_string(scan), get(startingOn, "falls"),
+              startingOnFalls[scan]);
+
+        // The same inputs inverted, so the first scan sees the input off
+        set(startingOff, "in", 1 - inputs[scan]);
+        startingOff.scan(scan * 10.0);
+        check("R_TRIG count starting off, scan " + std::to_string(scan), get(startingOff, "rises"),
+              startingOnFalls[scan]);
+        check("F_TRIG count starting off, scan " + std::to_string(scan), get(startingOff, "falls"),
+              startingOnRises[scan]);
+    }
+
+    startingOn.reset();
+    set(startingOn, "in", 1);
+    startingOn.scan(100);
+    check("R_TRIG after reset is a first scan again", get(startingOn, "rises"), 0);
+}
+
+static void checkOnDelay() {
+    const std::string source =
+        "PROGRAM OnDelay\n"
+        "VAR_INPUT\n"
+        "    start AT \"Start\" : BOOL;\n"
+        "END_VAR\n"
+        "VAR\n"
+        "    done : BOOL;\n"
+        "END_VAR\n"
+        "done := TON(start, T#500ms);\n"
+        "END_PROGRAM\n";
+    ControlProgram program;
+    if (!compile(source, program)) {
+        return;
+    }
+
+    struct Scan {
+        double  nowMs;
+        double  start;
+        double  done;
+    };
+    const Scan scans[] = {
+        { 0, 1, 0 },
+        { 499, 1, 0 },
+        { 500, 1, 1 },
+        { 900, 1, 1 },
+        { 950, 0, 0 },      // Dropping the input resets the timer
+        { 1000, 1, 0 },
+        { 1499, 1, 0 },
+        { 1500, 1, 1 }
+    };
+    ProgramVm vm(program);
+    for (const Scan& scan : scans) {
+        set(vm, "start", scan.start);
+        vm.scan(scan.nowMs);
+        check("TON output at " + std::to_string(static_cast<int>(scan.nowMs)) + " ms", get(vm, "done"), scan.done);
+    }
+}
+
+/**
+ * INT division truncates toward zero, MOD keeps the sign of the dividend, and dividing by zero
+ * gives 0 rather than stopping the scan.
+ */
+static void checkArithmetic() {
+    const std::string source =
+        "PROGRAM Arithmetic\n"
+        "VAR\n"
+        "    seven : INT := 7;\n"
+        "    two : INT := 2;\n"
+        "    zero : INT;\n"
+        "    realSeven : REAL := 7.0;\n"
+        "    realZero : REAL;\n"
+        "    quotient : INT;\n"
+        "    negativeQuotient : INT;\n"
+        "    remainder : INT;\n"
+        "    negativeRemainder : INT;\n"
+        "    divisionByZero : INT;\n"
+        "    moduloByZero : INT;\n"
+        "    realQuotient : REAL;\n"
+        "    realDivisionByZero : REAL;\n"
+        "END_VAR\n"
+        "quotient := seven / two;\n"
+        "negativeQuotient := (0 - seven) / two;\n"
+        "remainder := seven MOD two;\n"
+        "negativeRemainder := (0 - seven) MOD two;\n"
+        "divisionByZero := seven / zero;\n"
+        "moduloByZero := seven MOD zero;\n"
+        "realQuotient := realSeven / two;\n"
+        "realDivisionByZero := realSeven / realZero;\n"
+        "END_PROGRAM\n";
+    ControlProgram program;
+    if (!compile(source, program)) {
+        return;
+    }
+
+    ProgramVm vm(program);
+    vm.scan(0);
+    check("7 / 2", get(vm, "quotient"), 3);
+    check("-7 / 2", get(vm, "negativeQuotient"), -3);
+    check("7 MOD 2", get(vm, "remainder"), 1);
+    check("-7 MOD 2", get(vm, "negativeRemainder"), -1);
+    check("7 / 0", get(vm, "divisionByZero"), 0);
+    check("7 MOD 0", get(vm, "moduloByZero"), 0);
+    check("7.0 / 2", get(vm, "realQuotient"), 3.5);
+    check("7.0 / 0.0", get(vm, "realDivisionByZero"), 0);
+}
+
+static void checkCompileErrors() {
+    const std::string header =
+        "PROGRAM Broken\n"
+        "VAR_INPUT\n"
+        "    in AT \"In\" : BOOL;\n"
+        "END_VAR\n"
+        "VAR\n"
+        "    count : INT;\n"
+        "    flag : BOOL;\n"
+        "END_VAR\n";
+    const char* const bodies[] = {
+        "missing := 1;",                              // Not declared
+        "in := TRUE;",                                // Inputs cannot be assigned
+        "IF in THEN count := 1;",                     // No END_IF
+        "count := flag + 1;",                         // BOOL in arithmetic
+        "flag := count;",                             // INT to BOOL
+        "IF count THEN flag := TRUE; END_IF;",        // Condition is not BOOL
+        "flag := TON(in, 2.5);",                      // Preset is REAL; TIME is INT milliseconds
+        "flag := R_TRIG(count);",                     // Trigger input is not BOOL
+        "count := count + ;"                          // Missing operand
+    };
+    std::cout << "The following compile errors are expected:" << std::endl;
+    for (const char* body : bodies) {
+        ControlProgram program;
+        const bool compiled = StructuredText::compile(header + body + "\nEND_PROGRAM\n", "broken", program);
+        check(std::string("compile error for ") + body, compiled, false);
+    }
+    Log::flush();
+
+    ControlProgram program;
+    const std::string twice = "PROGRAM Broken\nVAR\n    count : INT;\n    COUNT : REAL;\nEND_VAR\nEND_PROGRAM\n";
+    check("compile error for a variable declared twice", StructuredText::compile(twice, "broken", program), false);
+    check("compile error for text after END_PROGRAM",
+          StructuredText::compile(header + "END_PROGRAM\ncount := 1;\n", "broken", program), false);
+    check("compile error for an empty source", StructuredText::compile("", "broken", program), false);
+}
+
+int main() {
+    checkTriggers();
+    checkOnDelay();
+    checkArithmetic();
+    checkCompileErrors();
+    Log::flush();
+    if (s_failureCount > 0) {
+        std::cerr << s_failureCount << " of " << s_checkCount << " structured-text checks failed" << std::endl;
+        return 1;
+    }
+    std::cout << "All " << s_checkCount << " structured-text checks passed" << std::endl;
+    return 0;
+}
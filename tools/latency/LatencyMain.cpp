@@ -0,0 +1,415 @@
+/*
+ * File:   LatencyMain.cpp
+ *
+ * Sensor-edge to actuator-write reaction latency of the conveyor controller.
+ *
+ * Usage: factoryio-latency [--modes direct,pipeline,conflated] [--stations n,...] [--edges n]
+ *                          [--warmup n] [--gap-ms ms] [--output-dir directory] [--rules]
+ *                          [--thread-profile role:cpus:priority,...] [--mlockall]
+ *
+ * A FactoryServer on the loopback interface plays a scene that toggles "Station 1 At Entry" and
+ * "Station 1 At Exit" the way a passing box does, one edge at a time.  A BasicConveyorControl
+ * connected over TCP reacts to the trailing edge at the entry by turning "Station 1 Emitter" off
+ * and to the trailing edge at the exit by turning it back on.  With --stations, each run has
+ * that many stations ("Station 1 " to "Station n ") on the one connection, each with its own
+ * controller, and the passages go round the stations; a flat latency across station counts
+ * shows that a frame costs only the stations it changes.  The scene timestamps each trailing
+ * edge as it goes out and the actuator frame as it comes back, so the latency covers both socket
+ * crossings and the whole Communications, Factory, Sensor, station thread and
+ * Station::applyChanges path.  The next edge is sent a gap after the reaction, so edges never
+ * queue behind each other.
+ *
+ * The controller reads the sensor level when it wakes, so it can miss a passage whose trailing
+ * edge arrives before it has seen the leading one.  Its box count is then off by one, and the
+ * scene repeats the passage, unmeasured, until the controller reacts again.
+ *
+ * Each threading mode runs against its own server and factory:
+ *   direct     frames are parsed and dispatched on the receiver thread
+ *   pipeline   frames pass through the SensorPipeline
+ *   conflated  the pipeline, merging the backlog when dispatch falls behind
+ *
+ * --rules runs RuleConveyorControl instead, whose rules react on the dispatching thread without
+ * waking a station task.
+ *
+ * Percentiles are printed in microseconds, and with --output-dir each run's histogram is written
+ * to <mode>.hgrm, or <mode>-<stations>.hgrm for more than one station, in the HdrHistogram format.
+ *
+ * --thread-profile and --mlockall apply a ThreadProfile to the controller side, so the tail with
+ * and without pinning and real-time priorities can be compared.  The scene's threads are left
+ * alone.
+ */
+
+#include <getopt.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "BasicConveyorControl.hpp"
+#include "Clock.hpp"
+#include "Factory.hpp"
+#include "FactoryScene.hpp"
+#include "FactoryServer.hpp"
+#include "Histogram.hpp"
+#include "Log.hpp"
+#include "RuleConveyorControl.hpp"
+#include "ThreadProfile.hpp"
+
+namespace {
+
+    typedef std::chrono::steady_clock SteadyClock;
+
+    std::string stationPrefix(uint32_t station) {
+        return "Station " + std::to_string(station + 1) + " ";
+    }
+
+    /**
+     * Latencies and progress shared between the harness and the scene of its one connection.
+     */
+    struct Measurement {
+        Measurement()
+        : histogram(), reactionCount(0), missedCount(0), done(false) {
+        }
+
+        Histogram           histogram;      // Nanoseconds; written by the scene until done
+        uint32_t            reactionCount;  // Reactions received, warm-up included
+        uint32_t            missedCount;    // Edges that got no reaction within the timeout
+        std::atomic<bool>   done;
+    };
+
+    /**
+     * Box passages at the entry and then the exit of one station after another, each a leading
+     * edge (beam interrupted) and a trailing edge (beam restored) to which the station's controller
+     * reacts.
+     */
+    class EdgeScene : public FactoryScene {
+    public:
+        EdgeScene(Measurement& measurement, uint32_t stationCount, uint32_t edgeCount, uint32_t warmupCount,
+                  SteadyClock::duration gap)
+        : m_measurement(measurement), m_edgeCount(edgeCount), m_warmupCount(warmupCount), m_gap(gap),
+          m_stations(stationCount), m_station(stationCount - 1), m_startedCount(0), m_changed(false),
+          m_started(false), m_phase(0), m_stampPending(false), m_waiting(false), m_resynchronizing(false),
+          m_expectedEmitter(false), m_edgeTime(), m_nextEdgeTime() {
+            for (uint32_t station = 0; station < stationCount; ++station) {
+                m_stations[station].entrySensor = stationPrefix(station) + "At Entry";
+                m_stations[station].exitSensor = stationPrefix(station) + "At Exit";
+                m_stations[station].emitter = stationPrefix(station) + "Emitter";
+            }
+        }
+
+        virtual void applyActuatorValues(const rapidjson::Document& frame) {
+            const SteadyClock::time_point now = SteadyClock::now();
+            if (!m_started) {
+                // Every controller has started and switched everything on
+                for (EdgeStation& station : m_stations) {
+                    if (!station.started && frame.HasMember(station.emitter.c_str())) {
+                        station.started = true;
+                        ++m_startedCount;
+                    }
+                }
+                if (m_startedCount == m_stations.size()) {
+                    m_started = true;
+                    m_nextEdgeTime = now + m_gap;
+                }
+                return;
+            }
+            rapidjson::Value::ConstMemberIterator emitter = frame.FindMember(m_stations[m_station].emitter.c_str());
+            if ((emitter == frame.MemberEnd()) || !emitter->value.IsBool()) {
+                return;
+            }
+            if (m_waiting && (emitter->value.GetBool() == m_expectedEmitter)) {
+                if ((m_measurement.reactionCount++ >= m_warmupCount) && !m_resynchronizing) {
+                    m_measurement.histogram.record(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        now - m_edgeTime).count());
+                }
+                m_resynchronizing = false;
+                endEdge(now);
+                if (m_measurement.histogram.getTotalCount() >= m_edgeCount) {
+                    m_measurement.done = true;
+                }
+            }
+        }
+
+        virtual void step(double /* elapsedSeconds */) {
+            const SteadyClock::time_point now = SteadyClock::now();
+            if (!m_started || m_measurement.done) {
+                return;
+            }
+            if (m_waiting) {
+                if (!m_stampPending && (now - m_edgeTime > TIMEOUT)) {
+                    // Go back to the leading edge of the passage that was missed
+                    ++m_measurement.missedCount;
+                    m_resynchronizing = true;
+                    m_phase = (m_phase + 2) % 4;
+                    endEdge(now);
+                }
+                return;
+            }
+            if (now < m_nextEdgeTime) {
+                return;
+            }
+            // Phases: entry blocked, entry cleared, exit blocked, exit cleared; a passage that is
+            // being repeated stays on its station
+            if ((m_phase == 0) && !m_resynchronizing) {
+                m_station = (m_station + 1) % m_stations.size();
+            }
+            const bool trailing = (m_phase % 2) == 1;
+            bool& sensor = (m_phase < 2) ? m_stations[m_station].entry : m_stations[m_station].exit;
+            sensor = trailing;
+            m_changed = true;
+            if (trailing) {
+                m_waiting = true;
+                m_stampPending = true;
+                m_expectedEmitter = (m_phase == 3);
+            }
+            else {
+                m_nextEdgeTime = now + m_gap;
+            }
+            m_phase = (m_phase + 1) % 4;
+        }
+
+        virtual bool getSensorValues(rapidjson::Document& frame, bool changedOnly) {
+            if (changedOnly && !m_changed) {
+                return false;
+            }
+            // Changes come from the current station only; a full frame has every station
+            rapidjson::Document::AllocatorType& allocator = frame.GetAllocator();
+            for (uint32_t index = 0; index < m_stations.size(); ++index) {
+                if (!changedOnly || (index == m_station)) {
+                    const EdgeStation& station = m_stations[index];
+                    frame.AddMember(rapidjson::Value(station.entrySensor.c_str(), allocator),
+                                    rapidjson::Value(station.entry), allocator);
+                    frame.AddMember(rapidjson::Value(station.exitSensor.c_str(), allocator),
+                                    rapidjson::Value(station.exit), allocator);
+                }
+            }
+            m_changed = false;
+            if (m_stampPending) {
+                m_stampPending = false;
+                m_edgeTime = SteadyClock::now();
+            }
+            return true;
+        }
+
+    private:
+        static const SteadyClock::duration TIMEOUT;
+
+        struct EdgeStation {
+            EdgeStation()
+            : entrySensor(), exitSensor(), emitter(), entry(true), exit(true), started(false) {
+            }
+
+            std::string entrySensor;
+            std::string exitSensor;
+            std::string emitter;
+            bool        entry;              // Sensor values; true while the beam is clear
+            bool        exit;
+            bool        started;            // The controller has sent its first frame
+        };
+
+        void endEdge(SteadyClock::time_point now) {
+            m_waiting = false;
+            m_nextEdgeTime = now + m_gap;
+        }
+
+        Measurement&                m_measurement;
+        uint32_t                    m_edgeCount;        // Trailing edges to measure
+        uint32_t                    m_warmupCount;      // Trailing edges to send first, unmeasured
+        SteadyClock::duration       m_gap;              // Quiet time before each edge
+        std::vector<EdgeStation>    m_stations;
+        uint32_t                    m_station;          // Station of the current passage
+        uint32_t                    m_startedCount;
+        bool                        m_changed;
+        bool                        m_started;
+        uint32_t                    m_phase;
+        bool                        m_stampPending;     // The edge is set but not yet sent
+        bool                        m_waiting;          // For the reaction to the last edge
+        bool                        m_resynchronizing;  // Repeating a passage the controller missed
+        bool                        m_expectedEmitter;
+        SteadyClock::time_point     m_edgeTime;
+        SteadyClock::time_point     m_nextEdgeTime;
+    };
+
+    const SteadyClock::duration EdgeScene::TIMEOUT = std::chrono::milliseconds(250);
+
+    struct Options {
+        uint32_t                edgeCount;
+        uint32_t                warmupCount;
+        SteadyClock::duration   gap;
+        std::string             outputDirectory;
+        bool                    rules;          // Run RuleConveyorControl instead of BasicConveyorControl
+    };
+
+    /**
+     * Runs one threading mode and station count against a fresh server, factory and controllers,
+     * and tears them down.
+     */
+    bool run(const std::string& mode, uint32_t stationCount, const Options& options, Measurement& measurement) {
+        // Steps often enough that the gap, not the step period, paces the edges
+        FactoryServer server([&measurement, &options, stationCount] {
+            return new EdgeScene(measurement, stationCount, options.edgeCount, options.warmupCount, options.gap);
+        }, 20000.0);
+        if (!server.start("127.0.0.1", 0)) {
+            return false;
+        }
+        RealTimeClock clock;
+        Factory factory(clock);
+        if (mode == "pipeline") {
+            factory.enablePipeline();
+        }
+        else if (mode == "conflated") {
+            factory.enablePipeline(SensorPipeline::DEFAULT_CAPACITY, true);
+        }
+        if (!factory.start("127.0.0.1", server.getPort())) {
+            server.stop();
+            return false;
+        }
+        std::vector<std::unique_ptr<BasicConveyorControl>> controls;
+        std::vector<std::unique_ptr<RuleConveyorControl>> ruleControls;
+        for (uint32_t station = 0; station < stationCount; ++station) {
+            if (options.rules) {
+                ruleControls.push_back(std::unique_ptr<RuleConveyorControl>(
+                    new RuleConveyorControl(factory, stationPrefix(station), 1)));
+            }
+            else {
+                controls.push_back(std::unique_ptr<BasicConveyorControl>(
+                    new BasicConveyorControl(factory, stationPrefix(station), 1)));
+            }
+        }
+        for (std::unique_ptr<BasicConveyorControl>& control : controls) {
+            control->start();
+        }
+        for (std::unique_ptr<RuleConveyorControl>& control : ruleControls) {
+            control->start();
+        }
+        while (!measurement.done) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        factory.stop();
+        for (std::unique_ptr<BasicConveyorControl>& control : controls) {
+            control->waitUntilDone();
+        }
+        return true;
+    }
+
+    std::vector<std::string> split(const std::string& text) {
+        std::vector<std::string> items;
+        std::stringstream stream(text);
+        std::string item;
+        while (std::getline(stream, item, ',')) {
+            items.push_back(item);
+        }
+        return items;
+    }
+
+    void usage(const char* program) {
+        std::cerr << "usage: " << program << " [--modes direct,pipeline,conflated] [--stations n,...] [--edges n]"
+                  << " [--warmup n] [--gap-ms ms] [--output-dir directory] [--rules]"
+                  << " [--thread-profile role:cpus:priority,...] [--mlockall]" << std::endl;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    std::vector<std::string> modes = { "direct", "pipeline", "conflated" };
+    std::vector<uint32_t> stationCounts = { 1 };
+    Options options;
+    options.edgeCount = 10000;
+    options.warmupCount = 200;
+    options.gap = std::chrono::milliseconds(1);
+    options.rules = false;
+    bool lockMemory = false;
+
+    const struct option longOptions[] = {
+        { "modes",          required_argument, nullptr, 'm' },
+        { "stations",       required_argument, nullptr, 's' },
+        { "edges",          required_argument, nullptr, 'n' },
+        { "warmup",         required_argument, nullptr, 'w' },
+        { "gap-ms",         required_argument, nullptr, 'g' },
+        { "output-dir",     required_argument, nullptr, 'o' },
+        { "rules",          no_argument,       nullptr, 'r' },
+        { "thread-profile", required_argument, nullptr, 'p' },
+        { "mlockall",       no_argument,       nullptr, 'l' },
+        { "help",           no_argument,       nullptr, 'h' },
+        { nullptr,          0,                 nullptr, 0 }
+    };
+    int option;
+    while ((option = getopt_long(argc, argv, "m:s:n:w:g:o:rp:lh", longOptions, nullptr)) != -1) {
+        switch (option) {
+            case 'm': modes = split(optarg); break;
+            case 's':
+                stationCounts.clear();
+                for (const std::string& count : split(optarg)) {
+                    stationCounts.push_back(strtoul(count.c_str(), nullptr, 10));
+                }
+                break;
+            case 'n': options.edgeCount = strtoul(optarg, nullptr, 10); break;
+            case 'w': options.warmupCount = strtoul(optarg, nullptr, 10); break;
+            case 'g':
+                options.gap = std::chrono::duration_cast<SteadyClock::duration>(
+                    std::chrono::duration<double, std::milli>(strtod(optarg, nullptr)));
+                break;
+            case 'o': options.outputDirectory = optarg; break;
+            case 'r': options.rules = true; break;
+            case 'p':
+                if (!ThreadProfile::configure(optarg)) {
+                    usage(argv[0]);
+                    return 1;
+                }
+                break;
+            case 'l': lockMemory = true; break;
+            default:
+                usage(argv[0]);
+                return (option == 'h') ? 0 : 1;
+        }
+    }
+    for (const std::string& mode : modes) {
+        if ((mode != "direct") && (mode != "pipeline") && (mode != "conflated")) {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    for (uint32_t stationCount : stationCounts) {
+        if (stationCount == 0) {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    Log::setLevel(LOG_LEVEL_WARNING);
+    if (lockMemory) {
+        ThreadProfile::lockMemory();
+    }
+
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << std::left << std::setw(12) << "mode" << std::right << std::setw(10) << "stations"
+              << std::setw(10) << "edges" << std::setw(8) << "missed" << std::setw(10) << "p50 us" << std::setw(10) << "p99 us"
+              << std::setw(10) << "p99.9 us" << std::setw(10) << "max us" << std::endl;
+    for (const std::string& mode : modes) {
+        for (uint32_t stationCount : stationCounts) {
+            Measurement measurement;
+            if (!run(mode, stationCount, options, measurement)) {
+                std::cerr << "failed to run " << mode << std::endl;
+                return 1;
+            }
+            const Histogram& histogram = measurement.histogram;
+            std::cout << std::left << std::setw(12) << mode << std::right << std::setw(10) << stationCount
+                      << std::setw(10) << histogram.getTotalCount() << std::setw(8) << measurement.missedCount
+                      << std::setw(10) << histogram.getValueAtPercentile(50) / 1000.0
+                      << std::setw(10) << histogram.getValueAtPercentile(99) / 1000.0
+                      << std::setw(10) << histogram.getValueAtPercentile(99.9) / 1000.0
+                      << std::setw(10) << histogram.getMax() / 1000.0 << std::endl;
+            if (!options.outputDirectory.empty()) {
+                const std::string suffix = (stationCount > 1) ? "-" + std::to_string(stationCount) : "";
+                std::ofstream output(options.outputDirectory + "/" + mode + suffix + ".hgrm");
+                histogram.writePercentiles(output, 1000.0);
+            }
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,124 @@
+/*
+ * File:   FactoryServerMain.cpp
+ *
+ * Headless Factory IO stand-in for load and latency testing.
+ *
+ * Usage: factoryio-server [--address a.b.c.d] [--port n] [--scene name] [--tags n] [--tags-per-frame n]
+ *                         [--rate frames-per-second] [--time-scale factor] [--report seconds]
+ *
+ * The scene is "synthetic" (--tags boolean tags, --tags-per-frame of them toggled per frame) or the
+ * plant model of one of the demos: "conveyor", "packing" or "sorting".  A rate of 0 streams sensor
+ * frames as fast as the connection accepts them; a time scale of 100 runs the scene 100 times
+ * faster than real time, and 0 as fast as the connection allows.  Point Factory at the
+ * server with factory.start("127.0.0.1", port) or by passing the endpoint to the factoryio demo.
+ */
+
+#include <getopt.h>
+#include <stdlib.h>
+#include <chrono>
+#include <iostream>
+#include <thread>
+#include "FactoryServer.hpp"
+#include "PlantScenes.hpp"
+#include "SyntheticScene.hpp"
+#include "Log.hpp"
+
+namespace {
+
+    void usage(const char* program) {
+        std::cerr << "usage: " << program << " [--address a.b.c.d] [--port n]"
+                  << " [--scene synthetic|conveyor|packing|sorting] [--tags n] [--tags-per-frame n]"
+                  << " [--rate frames-per-second] [--time-scale factor] [--report seconds]" << std::endl;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    std::string address("127.0.0.1");
+    uint32_t port = 910;
+    std::string scene("synthetic");
+    uint32_t tagCount = 64;
+    uint32_t tagsPerFrame = 1;
+    double frameRate = 100.0;
+    double timeScale = 1.0;
+    uint32_t reportSeconds = 5;
+
+    const struct option options[] = {
+        { "address",        required_argument, nullptr, 'a' },
+        { "port",           required_argument, nullptr, 'p' },
+        { "scene",          required_argument, nullptr, 'c' },
+        { "tags",           required_argument, nullptr, 't' },
+        { "tags-per-frame", required_argument, nullptr, 'f' },
+        { "rate",           required_argument, nullptr, 'r' },
+        { "time-scale",     required_argument, nullptr, 'x' },
+        { "report",         required_argument, nullptr, 's' },
+        { "help",           no_argument,       nullptr, 'h' },
+        { nullptr,          0,                 nullptr, 0 }
+    };
+    int option;
+    while ((option = getopt_long(argc, argv, "a:p:c:t:f:r:x:s:h", options, nullptr)) != -1) {
+        switch (option) {
+            case 'a': address = optarg; break;
+            case 'p': port = strtoul(optarg, nullptr, 10); break;
+            case 'c': scene = optarg; break;
+            case 't': tagCount = strtoul(optarg, nullptr, 10); break;
+            case 'f': tagsPerFrame = strtoul(optarg, nullptr, 10); break;
+            case 'r': frameRate = strtod(optarg, nullptr); break;
+            case 'x': timeScale = strtod(optarg, nullptr); break;
+            case 's': reportSeconds = strtoul(optarg, nullptr, 10); break;
+            default:
+                usage(argv[0]);
+                return (option == 'h') ? 0 : 1;
+        }
+    }
+    if ((tagCount == 0) || (tagsPerFrame > tagCount) || (frameRate < 0) || (timeScale < 0) ||
+        (reportSeconds == 0)) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    FactoryServer::SceneFactory sceneFactory;
+    if (scene == "synthetic") {
+        sceneFactory = [tagCount, tagsPerFrame]() {
+            return new SyntheticScene(tagCount, tagsPerFrame);
+        };
+    }
+    else if (scene == "conveyor") {
+        sceneFactory = []() {
+            return PlantScenes::createBasicConveyorScene("Station 1 ");
+        };
+    }
+    else if (scene == "packing") {
+        sceneFactory = []() {
+            return PlantScenes::createBasicPackingScene();
+        };
+    }
+    else if (scene == "sorting") {
+        sceneFactory = []() {
+            return PlantScenes::createSortingByWeightScene();
+        };
+    }
+    else {
+        usage(argv[0]);
+        return 1;
+    }
+
+    FactoryServer server(sceneFactory, frameRate, timeScale);
+    if (!server.start(address, port)) {
+        Log::flush();
+        return 1;
+    }
+
+    FactoryServer::Statistics previous = server.getStatistics();
+    while (true) {
+        std::this_thread::sleep_for(std::chrono::seconds(reportSeconds));
+        FactoryServer::Statistics current = server.getStatistics();
+        LOG_INFO("connections {} in {} frames/s {} bytes/s out {} frames/s {} bytes/s",
+                 current.connections,
+                 (current.framesIn - previous.framesIn) / reportSeconds,
+                 (current.bytesIn - previous.bytesIn) / reportSeconds,
+                 (current.framesOut - previous.framesOut) / reportSeconds,
+                 (current.bytesOut - previous.bytesOut) / reportSeconds);
+        previous = current;
+    }
+    return 0;
+}
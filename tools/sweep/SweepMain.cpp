@@ -0,0 +1,328 @@
+/*
+ * File:   SweepMain.cpp
+ *
+ * Monte Carlo parameter sweeps of the demo controllers against their plant models.
+ *
+ * Usage: factoryio-sweep [--demo conveyor|packing] [--runs n] [--threads n] [--duration seconds]
+ *                        [--arrival-delay seconds] [--timing-jitter fraction] [--seed n]
+ *                        [--set name=value,value,...]...
+ *
+ * Every combination of the --set values is a configuration, and every configuration is run --runs
+ * times with different seeds, each run in its own Factory, DiscreteEventClock and plant model so
+ * that runs share nothing and spread across --threads worker threads.  Parameters:
+ *   conveyor:  max-box-count
+ *   packing:   delta, poll-ms, grip-ms, traverse-ms, blade-ms
+ *
+ * The seed of a run picks the item weights, the random delay added to every arrival (0.5 s on
+ * average by default) and, for packing, how far each controller delay is off its configured value
+ * (up to 10% either way by default).  With both set to 0 every run is the same, so only one run
+ * per configuration is allowed.
+ *
+ * For each configuration the sweep reports throughput (items removed per simulated hour), conveyor
+ * utilization and the distribution of item lead times from emission to removal.
+ */
+
+#include <getopt.h>
+#include <math.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "BasicConveyorControl.hpp"
+#include "BasicPackingFactory.hpp"
+#include "Clock.hpp"
+#include "Factory.hpp"
+#include "Log.hpp"
+#include "PlantScenes.hpp"
+#include "SimulatedPlant.hpp"
+
+namespace {
+
+    struct Configuration {
+        Configuration()
+        : maxBoxCount(3), packing() {
+        }
+
+        std::string         name;
+        int32_t             maxBoxCount;
+        PackingParameters   packing;
+    };
+
+    struct Options {
+        std::string demo;
+        double      durationSeconds;
+        double      arrivalDelay;
+        double      timingJitter;
+    };
+
+    /**
+     * Results of one configuration, accumulated by one worker and merged at the end.
+     */
+    struct Accumulator {
+        Accumulator()
+        : runs(0), throughputSum(0), throughputSquareSum(0), utilizationSum(0), leadTimes() {
+        }
+
+        void merge(const Accumulator& other) {
+            runs += other.runs;
+            throughputSum += other.throughputSum;
+            throughputSquareSum += other.throughputSquareSum;
+            utilizationSum += other.utilizationSum;
+            leadTimes.insert(leadTimes.end(), other.leadTimes.begin(), other.leadTimes.end());
+        }
+
+        uint32_t            runs;
+        double              throughputSum;
+        double              throughputSquareSum;
+        double              utilizationSum;
+        std::vector<double> leadTimes;
+    };
+
+    /**
+     * Scales a delay by a random factor within fraction of 1.
+     */
+    Clock::Duration jitter(Clock::Duration delay, double fraction, std::mt19937& random) {
+        std::uniform_real_distribution<double> factor(1 - fraction, 1 + fraction);
+        return std::chrono::duration_cast<Clock::Duration>(delay * factor(random));
+    }
+
+    PackingParameters jitter(const PackingParameters& parameters, double fraction, uint32_t seed) {
+        std::mt19937 random(seed);
+        PackingParameters jittered(parameters);
+        jittered.pollInterval = jitter(parameters.pollInterval, fraction, random);
+        jittered.gripDelay = jitter(parameters.gripDelay, fraction, random);
+        jittered.traverseDelay = jitter(parameters.traverseDelay, fraction, random);
+        jittered.bladeDelay = jitter(parameters.bladeDelay, fraction, random);
+        jittered.boxPollInterval = jitter(parameters.boxPollInterval, fraction, random);
+        return jittered;
+    }
+
+    void run(const Options& options, const Configuration& configuration, uint32_t seed, Accumulator& accumulator) {
+        DiscreteEventClock clock;
+        PlantScene* scene = (options.demo == "packing")
+                          ? PlantScenes::createBasicPackingScene(seed, options.arrivalDelay)
+                          : PlantScenes::createBasicConveyorScene("Station 1 ", seed, options.arrivalDelay);
+        SimulatedPlant plant(scene);
+        Factory factory(clock);
+        clock.attach();
+        factory.start(plant);
+
+        std::unique_ptr<BasicConveyorControl> conveyorControl;
+        std::unique_ptr<BasicPackingFactory> packingFactory;
+        if (options.demo == "packing") {
+            packingFactory.reset(new BasicPackingFactory(factory, jitter(configuration.packing, options.timingJitter, seed)));
+            packingFactory->start();
+        }
+        else {
+            conveyorControl.reset(new BasicConveyorControl(factory, "Station 1 ", configuration.maxBoxCount));
+            conveyorControl->start();
+        }
+        clock.sleepFor(std::chrono::duration_cast<Clock::Duration>(std::chrono::duration<double>(options.durationSeconds)) +
+                       Clock::Duration(1));
+
+        plant.inspect([&accumulator](FactoryScene& scene) {
+            const PlantScene& plantScene = static_cast<const PlantScene&>(scene);
+            const double throughput = plantScene.getStatistics().removed * 3600.0 / plantScene.getStatistics().sceneTime;
+            ++accumulator.runs;
+            accumulator.throughputSum += throughput;
+            accumulator.throughputSquareSum += throughput * throughput;
+            accumulator.utilizationSum += plantScene.getUtilization();
+            accumulator.leadTimes.insert(accumulator.leadTimes.end(), plantScene.getLeadTimes().begin(),
+                                         plantScene.getLeadTimes().end());
+        });
+
+        factory.stop();
+        if (packingFactory) {
+            packingFactory->waitUntilDone();
+        }
+        else {
+            conveyorControl->waitUntilDone();
+        }
+        clock.detach();
+    }
+
+    bool applyParameter(Configuration& configuration, const std::string& name, const std::string& value) {
+        const double number = strtod(value.c_str(), nullptr);
+        const Clock::Duration milliseconds =
+            std::chrono::duration_cast<Clock::Duration>(std::chrono::duration<double, std::milli>(number));
+        if (name == "max-box-count") {
+            configuration.maxBoxCount = static_cast<int32_t>(number);
+        }
+        else if (name == "delta") {
+            configuration.packing.delta = number;
+        }
+        else if (name == "poll-ms") {
+            configuration.packing.pollInterval = milliseconds;
+        }
+        else if (name == "grip-ms") {
+            configuration.packing.gripDelay = milliseconds;
+        }
+        else if (name == "traverse-ms") {
+            configuration.packing.traverseDelay = milliseconds;
+        }
+        else if (name == "blade-ms") {
+            configuration.packing.bladeDelay = milliseconds;
+        }
+        else {
+            return false;
+        }
+        configuration.name += (configuration.name.empty() ? "" : " ") + name + "=" + value;
+        return true;
+    }
+
+    /**
+     * Expands "name=v1,v2" sets into every combination of their values.
+     */
+    bool expand(const std::vector<std::string>& sets, std::vector<Configuration>& configurations) {
+        configurations.assign(1, Configuration());
+        for (const std::string& set : sets) {
+            size_t equals = set.find('=');
+            if (equals == std::string::npos) {
+                return false;
+            }
+            const std::string name = set.substr(0, equals);
+            std::vector<std::string> values;
+            std::stringstream valueStream(set.substr(equals + 1));
+            std::string value;
+            while (std::getline(valueStream, value, ',')) {
+                values.push_back(value);
+            }
+            std::vector<Configuration> expanded;
+            for (const Configuration& configuration : configurations) {
+                for (const std::string& value : values) {
+                    Configuration next(configuration);
+                    if (!applyParameter(next, name, value)) {
+                        return false;
+                    }
+                    expanded.push_back(next);
+                }
+            }
+            configurations.swap(expanded);
+        }
+        if (configurations.size() == 1 && configurations[0].name.empty()) {
+            configurations[0].name = "defaults";
+        }
+        return true;
+    }
+
+    double percentile(const std::vector<double>& sorted, double fraction) {
+        if (sorted.empty()) {
+            return 0;
+        }
+        return sorted[std::min(sorted.size() - 1, static_cast<size_t>(fraction * sorted.size()))];
+    }
+
+    void usage(const char* program) {
+        std::cerr << "usage: " << program << " [--demo conveyor|packing] [--runs n] [--threads n]"
+                  << " [--duration seconds] [--arrival-delay seconds] [--timing-jitter fraction] [--seed n]"
+                  << " [--set name=value,...]..."
+                  << std::endl;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    Options options;
+    options.demo = "conveyor";
+    options.durationSeconds = 8 * 3600.0;
+    options.arrivalDelay = 0.5;
+    options.timingJitter = 0.1;
+    uint32_t runCount = 16;
+    uint32_t threadCount = std::max(1u, std::thread::hardware_concurrency());
+    uint32_t seed = 1;
+    std::vector<std::string> sets;
+
+    const struct option longOptions[] = {
+        { "demo",          required_argument, nullptr, 'd' },
+        { "runs",          required_argument, nullptr, 'r' },
+        { "threads",       required_argument, nullptr, 'j' },
+        { "duration",      required_argument, nullptr, 't' },
+        { "arrival-delay", required_argument, nullptr, 'a' },
+        { "timing-jitter", required_argument, nullptr, 'J' },
+        { "seed",          required_argument, nullptr, 's' },
+        { "set",           required_argument, nullptr, 'p' },
+        { "help",          no_argument,       nullptr, 'h' },
+        { nullptr,         0,                 nullptr, 0 }
+    };
+    int option;
+    while ((option = getopt_long(argc, argv, "d:r:j:t:a:J:s:p:h", longOptions, nullptr)) != -1) {
+        switch (option) {
+            case 'd': options.demo = optarg; break;
+            case 'r': runCount = strtoul(optarg, nullptr, 10); break;
+            case 'j': threadCount = strtoul(optarg, nullptr, 10); break;
+            case 't': options.durationSeconds = strtod(optarg, nullptr); break;
+            case 'a': options.arrivalDelay = strtod(optarg, nullptr); break;
+            case 'J': options.timingJitter = strtod(optarg, nullptr); break;
+            case 's': seed = strtoul(optarg, nullptr, 10); break;
+            case 'p': sets.push_back(optarg); break;
+            default:
+                usage(argv[0]);
+                return (option == 'h') ? 0 : 1;
+        }
+    }
+    std::vector<Configuration> configurations;
+    if (((options.demo != "conveyor") && (options.demo != "packing")) || (runCount == 0) || (threadCount == 0) ||
+        (options.durationSeconds <= 0) || (options.arrivalDelay < 0) || (options.timingJitter < 0) ||
+        (options.timingJitter >= 1) || !expand(sets, configurations)) {
+        usage(argv[0]);
+        return 1;
+    }
+    const bool timingVaries = (options.demo == "packing") && (options.timingJitter > 0);
+    if ((runCount > 1) && (options.arrivalDelay == 0) && !timingVaries) {
+        std::cerr << "Nothing varies between seeds without --arrival-delay or --timing-jitter; use --runs 1"
+                  << std::endl;
+        return 1;
+    }
+    Log::setLevel(LOG_LEVEL_WARNING);
+
+    // Each worker pulls runs off a shared counter and keeps its own results
+    const uint64_t totalRuns = static_cast<uint64_t>(configurations.size()) * runCount;
+    std::atomic<uint64_t> nextRun(0);
+    std::vector<std::vector<Accumulator> > results(threadCount, std::vector<Accumulator>(configurations.size()));
+    std::vector<std::thread*> workers;
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (uint32_t worker = 0; worker < threadCount; ++worker) {
+        workers.push_back(new std::thread([&, worker]() {
+            for (uint64_t index = nextRun++; index < totalRuns; index = nextRun++) {
+                const uint32_t configuration = index / runCount;
+                run(options, configurations[configuration], seed + (index % runCount),
+                    results[worker][configuration]);
+            }
+        }));
+    }
+    for (std::thread* worker : workers) {
+        worker->join();
+        delete worker;
+    }
+    const double wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << totalRuns << " runs of " << options.durationSeconds << " simulated s on " << threadCount
+              << " threads in " << wallSeconds << " s (" << totalRuns / wallSeconds << " runs/s)" << std::endl;
+    std::cout << std::left << std::setw(40) << "configuration" << std::right
+              << std::setw(10) << "items/h" << std::setw(10) << "stddev" << std::setw(10) << "util"
+              << std::setw(10) << "p50 s" << std::setw(10) << "p99 s" << std::setw(10) << "max s" << std::endl;
+    for (size_t configuration = 0; configuration < configurations.size(); ++configuration) {
+        Accumulator total;
+        for (uint32_t worker = 0; worker < threadCount; ++worker) {
+            total.merge(results[worker][configuration]);
+        }
+        const double mean = total.throughputSum / total.runs;
+        const double variance = std::max(0.0, total.throughputSquareSum / total.runs - mean * mean);
+        std::sort(total.leadTimes.begin(), total.leadTimes.end());
+        std::cout << std::left << std::setw(40) << configurations[configuration].name << std::right
+                  << std::setw(10) << mean << std::setw(10) << sqrt(variance)
+                  << std::setw(10) << total.utilizationSum / total.runs
+                  << std::setw(10) << percentile(total.leadTimes, 0.50)
+                  << std::setw(10) << percentile(total.leadTimes, 0.99)
+                  << std::setw(10) << (total.leadTimes.empty() ? 0 : total.leadTimes.back()) << std::endl;
+    }
+    return 0;
+}